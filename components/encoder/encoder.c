@@ -1,206 +1,1021 @@
 #include "encoder.h"
-#include "driver/pulse_cnt.h"
-#include "driver/gpio.h"
-#include "esp_timer.h"
+#include "encoder_core.h"
+#include "encoder_pcnt.h"
+#include "encoder_ring.h"
+#include "metrics.h"
 #include "esp_log.h"
-#include <math.h>
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define TAG "ENCODER"
-#define PCNT_HIGH_LIMIT  32767
-#define PCNT_LOW_LIMIT  -32768
-#define SPEED_TASK_PERIOD_MS 1000   // Speed update period in milliseconds
 
-// Internal pulse counter and parameters
-static int total_pulse_count = 0;
-static pcnt_unit_handle_t pcnt_unit = NULL;
-static int pulses_per_rev = 600;
-static float wheel_diameter_m = 0.1f;         
-static float calibration_factor = 1.0f;       
-static float distance_per_pulse = 0.0f;       
+/**
+ * @brief One encoder channel: core state, PCNT backend and sample history.
+ */
+struct encoder_channel {
+    encoder_core_t core;
+    encoder_pcnt_t pcnt;
+    encoder_ring_t *ring;       ///< Internal RAM, allocated with the channel
+    encoder_event_detector_t events;
+    encoder_trigger_config_t trigger;   ///< Output and callback of the armed trigger
+    atomic_uint resets;                 ///< encoder_channel_reset() calls
+    int index;
+};
+
+/**
+ * @brief Event subscriber: a callback or a queue, optionally bound to one channel.
+ */
+typedef struct {
+    encoder_handle_t channel;   ///< NULL for every channel
+    uint32_t mask;
+    encoder_event_cb_t cb;
+    void *arg;
+    QueueHandle_t queue;
+} event_subscriber_t;
+
+// Channels are never destroyed, so handles stay valid for the program lifetime
+static struct encoder_channel s_channels[ENCODER_MAX_CHANNELS];
+static atomic_int s_channel_count = 0;
+static esp_timer_handle_t s_sample_timer = NULL;
+static TaskHandle_t s_sampler_task = NULL;
+static uint32_t s_sample_period_us;
+
+// Sampling timing; the stats are written by the sampling task only
+static atomic_uint s_sample_fire_us;                ///< Low 32 bits of the last timer fire time
+static atomic_bool s_sampler_stats_reset;
+static encoder_sampler_stats_t s_sampler_stats;
+static uint64_t s_jitter_sum_us, s_latency_sum_us, s_run_sum_us;
 
-/// Variables used for speed calculation
+// Subscribers are only appended; the sampler reads up to the published count
+static event_subscriber_t s_subscribers[ENCODER_EVENT_MAX_SUBSCRIBERS];
+static atomic_int s_subscriber_count = 0;
+static portMUX_TYPE s_subscribe_lock = portMUX_INITIALIZER_UNLOCKED;
+static atomic_uint s_events_dropped = 0;
 
-static int last_pulse_count = 0;
-static float last_speed = 0.0;
-static int64_t last_time_us = 0;
+// Serializes trigger arming, reset and reconfiguration against the sampler's trigger service
+static SemaphoreHandle_t s_trigger_mutex = NULL;
+static StaticSemaphore_t s_trigger_mutex_buf;
+
+// Legacy single-encoder API operates on channel 0
+#define DEFAULT_CHANNEL (&s_channels[0])
 
 /**
- * @brief Pulse counter event callback for high/low limit overflow handling.
+ * @brief Creates a channel: PCNT unit, core and sample ring.
  */
-static bool IRAM_ATTR pcnt_on_reach(pcnt_unit_handle_t unit, const pcnt_watch_event_data_t *edata, void *user_ctx) {
-    if (edata->watch_point_value == PCNT_HIGH_LIMIT) {
-        total_pulse_count += PCNT_HIGH_LIMIT;
-    } else if (edata->watch_point_value == PCNT_LOW_LIMIT) {
-        total_pulse_count += PCNT_LOW_LIMIT;
+esp_err_t encoder_channel_new(const encoder_config_t *config, encoder_handle_t *out) {
+    if (!config || !out || config->counting.pulses_per_rev <= 0 || config->wheel_diameter_mm <= 0.0f) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    int index = atomic_load(&s_channel_count);
+    if (index >= ENCODER_MAX_CHANNELS) {
+        ESP_LOGE(TAG, "No free encoder channel");
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (!s_trigger_mutex) {
+        s_trigger_mutex = xSemaphoreCreateMutexStatic(&s_trigger_mutex_buf);
+    }
+
+    struct encoder_channel *ch = &s_channels[index];
+    ch->index = index;
+    ch->ring = heap_caps_malloc(sizeof(encoder_ring_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!ch->ring) {
+        return ESP_ERR_NO_MEM;
+    }
+    encoder_ring_init(ch->ring);
+
+    ch->core.calibration_factor = config->calibration_factor > 0.0f ? config->calibration_factor : 1.0f;
+    ch->core.speed_mode = config->speed_mode;
+    ch->core.count_mode = config->counting.count_mode;
+    encoder_core_init(&ch->core, NULL, NULL, config->counting.pulses_per_rev, config->wheel_diameter_mm);
+    encoder_core_set_plausibility(&ch->core, &config->noise.plausibility);
+    encoder_event_detector_init(&ch->events, &config->events);
+    encoder_pcnt_config_t pcnt_config = {
+        .pin_a = config->counting.pin_a,
+        .pin_b = config->counting.pin_b,
+        .pin_z = config->counting.pin_z,
+        .count_mode = config->counting.count_mode,
+        .invert = config->counting.invert,
+        .glitch_filter_ns = config->noise.glitch_filter_ns,
+    };
+    esp_err_t err = encoder_pcnt_init(&ch->pcnt, &pcnt_config, &ch->core);
+    if (err != ESP_OK) {
+        heap_caps_free(ch->ring);
+        ch->ring = NULL;
+        return err;
     }
-    return true;
+
+    // Bind the backend only once the unit is running, then arm the estimator
+    ch->core.backend = &encoder_pcnt_backend;
+    ch->core.backend_ctx = &ch->pcnt;
+    encoder_core_set_speed_mode(&ch->core, ch->core.speed_mode);
+
+    // Publish last: the sampling timer picks the channel up on its next pass
+    atomic_store(&s_channel_count, index + 1);
+    *out = ch;
+
+    ESP_LOGI(TAG, "Encoder channel %d initialized (A=%d, B=%d, Z=%d, x%d%s)", index, config->counting.pin_a,
+             config->counting.pin_b, config->counting.pin_z, config->counting.count_mode,
+             config->counting.invert ? ", inverted" : "");
+    return ESP_OK;
 }
 
 /**
- * @brief Updates the distance per pulse value based on wheel diameter and pulses per revolution.
+ * @brief Returns the number of created channels.
  */
-static void update_distance_per_pulse(void) {
-    distance_per_pulse = (float)M_PI * wheel_diameter_m / (float)pulses_per_rev;
+size_t encoder_channel_count(void) {
+    return (size_t)atomic_load(&s_channel_count);
 }
 
 /**
- * @brief Initializes the encoder using pulse counter with specified GPIOs.
+ * @brief Returns the handle of a channel by index, or NULL.
  */
-void encoder_init(gpio_num_t pin_a, gpio_num_t pin_b, int ppr, float wheel_diameter_mm) {
-    pulses_per_rev = ppr;
-    wheel_diameter_m = wheel_diameter_mm / 1000.0f;
-    update_distance_per_pulse();  // <- important to call this after setting wheel diameter
+encoder_handle_t encoder_channel_get(size_t index) {
+    return index < encoder_channel_count() ? &s_channels[index] : NULL;
+}
 
-    pcnt_unit_config_t unit_config = {
-        .high_limit = PCNT_HIGH_LIMIT,
-        .low_limit = PCNT_LOW_LIMIT,
-    };
-    ESP_ERROR_CHECK(pcnt_new_unit(&unit_config, &pcnt_unit));
+/**
+ * @brief Returns the index of a channel.
+ */
+int encoder_channel_index(encoder_handle_t enc) {
+    return enc->index;
+}
 
-    // Channel A configuration
-    pcnt_chan_config_t chan_a = {
-        .edge_gpio_num = pin_a,
-        .level_gpio_num = pin_b,
-    };
-    pcnt_channel_handle_t pcnt_chan_a = NULL;
-    ESP_ERROR_CHECK(pcnt_new_channel(pcnt_unit, &chan_a, &pcnt_chan_a));
-    ESP_ERROR_CHECK(pcnt_channel_set_edge_action(pcnt_chan_a, PCNT_CHANNEL_EDGE_ACTION_INCREASE, PCNT_CHANNEL_EDGE_ACTION_DECREASE));
-    ESP_ERROR_CHECK(pcnt_channel_set_level_action(pcnt_chan_a, PCNT_CHANNEL_LEVEL_ACTION_KEEP, PCNT_CHANNEL_LEVEL_ACTION_INVERSE));
-
-    // Channel B configuration
-    pcnt_chan_config_t chan_b = {
-        .edge_gpio_num = pin_b,
-        .level_gpio_num = pin_a,
+/**
+ * @brief Returns the current total pulse count including overflow.
+ */
+int64_t encoder_channel_get_pulses(encoder_handle_t enc) {
+    return encoder_core_get_pulses(&enc->core);
+}
+
+/**
+ * @brief Returns a torn-read-free snapshot of pulse count and time.
+ */
+void encoder_channel_get_snapshot(encoder_handle_t enc, encoder_snapshot_t *out) {
+    encoder_core_snapshot(&enc->core, out);
+}
+
+/**
+ * @brief Resets pulse count and speed state.
+ */
+void encoder_channel_reset(encoder_handle_t enc) {
+    xSemaphoreTake(s_trigger_mutex, portMAX_DELAY);
+    encoder_core_reset(&enc->core);
+    xSemaphoreGive(s_trigger_mutex);
+    encoder_event_detector_restart(&enc->events);
+    atomic_fetch_add(&enc->resets, 1);
+}
+
+/**
+ * @brief Returns how often the count was reset since boot.
+ */
+uint32_t encoder_channel_get_reset_count(encoder_handle_t enc) {
+    return atomic_load(&enc->resets);
+}
+
+/**
+ * @brief Sets the total pulse count (odometer restore).
+ */
+void encoder_channel_set_pulses(encoder_handle_t enc, int64_t pulses) {
+    xSemaphoreTake(s_trigger_mutex, portMAX_DELAY);
+    encoder_core_set_pulses(&enc->core, pulses);
+    xSemaphoreGive(s_trigger_mutex);
+    encoder_event_detector_restart(&enc->events);
+}
+
+/**
+ * @brief Returns the calculated distance in meters.
+ */
+float encoder_channel_get_distance_m(encoder_handle_t enc) {
+    return encoder_core_get_distance_m(&enc->core);
+}
+
+/**
+ * @brief Returns the travelled distance in micrometres.
+ */
+int64_t encoder_channel_get_distance_um(encoder_handle_t enc) {
+    return encoder_core_get_distance_um(&enc->core);
+}
+
+/**
+ * @brief Converts a sampled pulse count to micrometres with the current calibration.
+ */
+int64_t encoder_channel_pulses_to_um(encoder_handle_t enc, int64_t pulses) {
+    return encoder_core_pulses_to_um(&enc->core, pulses);
+}
+
+/**
+ * @brief Sets new wheel diameter in millimeters.
+ */
+void encoder_channel_set_wheel_diameter_mm(encoder_handle_t enc, float diameter_mm) {
+    encoder_core_set_wheel_diameter_mm(&enc->core, diameter_mm);
+}
+
+/**
+ * @brief Sets calibration factor for distance correction.
+ */
+void encoder_channel_set_calibration_factor(encoder_handle_t enc, float factor) {
+    encoder_core_set_calibration_factor(&enc->core, factor);
+}
+
+/**
+ * @brief Returns current wheel diameter in millimeters.
+ */
+float encoder_channel_get_wheel_diameter_mm(encoder_handle_t enc) {
+    return encoder_core_get_wheel_diameter_mm(&enc->core);
+}
+
+/**
+ * @brief Returns current calibration factor.
+ */
+float encoder_channel_get_calibration_factor(encoder_handle_t enc) {
+    return encoder_core_get_calibration_factor(&enc->core);
+}
+
+/**
+ * @brief Returns last calculated speed in meters per second.
+ */
+float encoder_channel_get_speed_mps(encoder_handle_t enc) {
+    return encoder_core_get_speed_mps(&enc->core);
+}
+
+/**
+ * @brief Returns the last unfiltered speed estimate.
+ */
+float encoder_channel_get_raw_speed_mps(encoder_handle_t enc) {
+    return encoder_core_get_raw_speed_mps(&enc->core);
+}
+
+/**
+ * @brief Returns the least-squares acceleration estimate.
+ */
+float encoder_channel_get_accel_mps2(encoder_handle_t enc) {
+    return encoder_core_get_accel_mps2(&enc->core);
+}
+
+/**
+ * @brief Returns the least-squares jerk estimate.
+ */
+float encoder_channel_get_jerk_mps3(encoder_handle_t enc) {
+    return encoder_core_get_jerk_mps3(&enc->core);
+}
+
+/**
+ * @brief Sets the acceleration/jerk window; applied on the next sample.
+ */
+void encoder_channel_set_accel_window(encoder_handle_t enc, uint16_t samples) {
+    encoder_core_set_deriv_window(&enc->core, samples);
+}
+
+/**
+ * @brief Returns the acceleration/jerk window in samples.
+ */
+uint16_t encoder_channel_get_accel_window(encoder_handle_t enc) {
+    return encoder_core_get_deriv_window(&enc->core);
+}
+
+/**
+ * @brief Replaces the speed filter; applied on the next sample.
+ */
+void encoder_channel_set_speed_filter(encoder_handle_t enc, const encoder_filter_config_t *config) {
+    encoder_core_set_filter(&enc->core, config);
+}
+
+/**
+ * @brief Returns the speed filter configuration in effect.
+ */
+encoder_filter_config_t encoder_channel_get_speed_filter(encoder_handle_t enc) {
+    return encoder_core_get_filter(&enc->core);
+}
+
+/**
+ * @brief Selects the speed estimator.
+ */
+void encoder_channel_set_speed_mode(encoder_handle_t enc, encoder_speed_mode_t mode) {
+    encoder_core_set_speed_mode(&enc->core, mode);
+}
+
+/**
+ * @brief Returns the estimator used for the last speed sample.
+ */
+encoder_speed_mode_t encoder_channel_get_speed_mode(encoder_handle_t enc) {
+    return encoder_core_get_active_speed_mode(&enc->core);
+}
+
+/**
+ * @brief Returns the measurement window of the last speed sample.
+ */
+int64_t encoder_channel_get_speed_window_us(encoder_handle_t enc) {
+    return encoder_core_get_speed_window_us(&enc->core);
+}
+
+/**
+ * @brief Applies the glitch filter and the plausibility limits.
+ */
+esp_err_t encoder_channel_set_noise_config(encoder_handle_t enc, const encoder_noise_config_t *config) {
+    // A filter change rebuilds the unit; keep the sampler's trigger service off it meanwhile
+    xSemaphoreTake(s_trigger_mutex, portMAX_DELAY);
+    esp_err_t err = encoder_pcnt_set_glitch_filter(&enc->pcnt, config->glitch_filter_ns);
+    xSemaphoreGive(s_trigger_mutex);
+    if (err != ESP_OK) {
+        return err;
+    }
+    encoder_core_set_plausibility(&enc->core, &config->plausibility);
+    return ESP_OK;
+}
+
+/**
+ * @brief Returns the noise rejection configuration.
+ */
+encoder_noise_config_t encoder_channel_get_noise_config(encoder_handle_t enc) {
+    encoder_noise_config_t config = {
+        .glitch_filter_ns = enc->pcnt.config.glitch_filter_ns,
+        .plausibility = encoder_core_get_plausibility(&enc->core),
     };
-    pcnt_channel_handle_t pcnt_chan_b = NULL;
-    ESP_ERROR_CHECK(pcnt_new_channel(pcnt_unit, &chan_b, &pcnt_chan_b));
-    ESP_ERROR_CHECK(pcnt_channel_set_edge_action(pcnt_chan_b, PCNT_CHANNEL_EDGE_ACTION_INCREASE, PCNT_CHANNEL_EDGE_ACTION_DECREASE));
-    ESP_ERROR_CHECK(pcnt_channel_set_level_action(pcnt_chan_b, PCNT_CHANNEL_LEVEL_ACTION_INVERSE, PCNT_CHANNEL_LEVEL_ACTION_KEEP));
-
-    // Add overflow watchpoints
-    ESP_ERROR_CHECK(pcnt_unit_add_watch_point(pcnt_unit, PCNT_HIGH_LIMIT));
-    ESP_ERROR_CHECK(pcnt_unit_add_watch_point(pcnt_unit, PCNT_LOW_LIMIT));
-
-    // Register callback
-    pcnt_event_callbacks_t cbs = {
-        .on_reach = pcnt_on_reach,
+    return config;
+}
+
+/**
+ * @brief Returns the plausibility counters.
+ */
+encoder_plausibility_stats_t encoder_channel_get_noise_stats(encoder_handle_t enc) {
+    return encoder_core_get_plausibility_stats(&enc->core);
+}
+
+/**
+ * @brief Clears the plausibility counters.
+ */
+void encoder_channel_clear_noise_stats(encoder_handle_t enc) {
+    encoder_core_clear_plausibility_stats(&enc->core);
+}
+
+static bool pin_used_by_other(encoder_handle_t enc, gpio_num_t pin) {
+    if (pin == GPIO_NUM_NC) {
+        return false;
+    }
+    size_t count = encoder_channel_count();
+    for (size_t i = 0; i < count; i++) {
+        const encoder_pcnt_config_t *other = &s_channels[i].pcnt.config;
+        if (&s_channels[i] != enc && (other->pin_a == pin || other->pin_b == pin || other->pin_z == pin)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Rebuilds the PCNT channels for new pins or decoding and applies the resolution.
+ */
+esp_err_t encoder_channel_set_counting(encoder_handle_t enc, const encoder_counting_t *counting) {
+    if (counting->pulses_per_rev <= 0 || pin_used_by_other(enc, counting->pin_a) ||
+        pin_used_by_other(enc, counting->pin_b) || pin_used_by_other(enc, counting->pin_z)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    encoder_pcnt_config_t pcnt_config = enc->pcnt.config;
+    pcnt_config.pin_a = counting->pin_a;
+    pcnt_config.pin_b = counting->pin_b;
+    pcnt_config.pin_z = counting->pin_z;
+    pcnt_config.count_mode = counting->count_mode;
+    pcnt_config.invert = counting->invert;
+    xSemaphoreTake(s_trigger_mutex, portMAX_DELAY);
+    esp_err_t err = encoder_pcnt_reconfigure(&enc->pcnt, &pcnt_config);
+    xSemaphoreGive(s_trigger_mutex);
+    if (err != ESP_OK) {
+        return err;
+    }
+    encoder_core_set_pulses_per_rev(&enc->core, counting->pulses_per_rev);
+    return ESP_OK;
+}
+
+/**
+ * @brief Returns the pins and decoding in effect.
+ */
+encoder_counting_t encoder_channel_get_counting(encoder_handle_t enc) {
+    encoder_counting_t counting = {
+        .pin_a = enc->pcnt.config.pin_a,
+        .pin_b = enc->pcnt.config.pin_b,
+        .pin_z = enc->pcnt.config.pin_z,
+        .pulses_per_rev = encoder_core_get_pulses_per_rev(&enc->core),
+        .count_mode = encoder_core_get_count_mode(&enc->core),
+        .invert = enc->pcnt.config.invert,
     };
-    ESP_ERROR_CHECK(pcnt_unit_register_event_callbacks(pcnt_unit, &cbs, NULL));
+    return counting;
+}
 
-    // Enable and start the unit
-    ESP_ERROR_CHECK(pcnt_unit_enable(pcnt_unit));
-    ESP_ERROR_CHECK(pcnt_unit_clear_count(pcnt_unit));
-    ESP_ERROR_CHECK(pcnt_unit_start(pcnt_unit));
+/**
+ * @brief Sets the stall time and overspeed limit.
+ */
+void encoder_channel_set_event_config(encoder_handle_t enc, const encoder_event_config_t *config) {
+    enc->events.config = *config;
+}
 
-    ESP_LOGI(TAG, "Encoder initialized");
+/**
+ * @brief Returns the event thresholds.
+ */
+encoder_event_config_t encoder_channel_get_event_config(encoder_handle_t enc) {
+    return enc->events.config;
 }
 
 /**
- * @brief Returns the current total pulse count including overflow.
+ * @brief Arms the target-distance event.
  */
-int encoder_get_pulses(void) {
-    int count = 0;
-    if (pcnt_unit) {
-        pcnt_unit_get_count(pcnt_unit, &count);
-        return total_pulse_count + count;
+void encoder_channel_set_target_um(encoder_handle_t enc, int64_t target_um) {
+    encoder_event_detector_set_target(&enc->events, target_um);
+}
+
+/**
+ * @brief Disarms the target-distance event.
+ */
+void encoder_channel_clear_target(encoder_handle_t enc) {
+    encoder_event_detector_clear_target(&enc->events);
+}
+
+/**
+ * @brief Trigger ISR trampoline: drives the output first, then the user callback.
+ */
+static void IRAM_ATTR trigger_fired(void *arg) {
+    struct encoder_channel *ch = arg;
+    if (ch->trigger.output_pin != GPIO_NUM_NC) {
+        gpio_set_level(ch->trigger.output_pin, ch->trigger.output_level);
+    }
+    if (ch->trigger.cb) {
+        ch->trigger.cb(ch->trigger.arg);
     }
-    return 0;
 }
 
 /**
- * @brief Resets pulse count and speed state.
+ * @brief Arms the hardware target-distance trigger.
  */
-void encoder_reset(void) {
-    if (pcnt_unit) {
-        pcnt_unit_clear_count(pcnt_unit);
-        total_pulse_count = 0;
-        last_pulse_count = 0;
-        last_speed = 0.0f;
+esp_err_t encoder_channel_arm_trigger(encoder_handle_t enc, const encoder_trigger_config_t *config) {
+    if (!config || (config->output_pin != GPIO_NUM_NC &&
+                    (!GPIO_IS_VALID_OUTPUT_GPIO(config->output_pin) || pin_used_by_other(NULL, config->output_pin)))) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    xSemaphoreTake(s_trigger_mutex, portMAX_DELAY);
+    encoder_core_disarm_trigger(&enc->core);
+    enc->trigger = *config;
+    if (config->output_pin != GPIO_NUM_NC) {
+        gpio_reset_pin(config->output_pin);
+        gpio_set_direction(config->output_pin, GPIO_MODE_OUTPUT);
+        gpio_set_level(config->output_pin, !config->output_level);
     }
+    int64_t target = encoder_core_um_to_pulses(&enc->core, config->target_um);
+    bool armed = encoder_core_arm_trigger(&enc->core, target, trigger_fired, enc);
+    xSemaphoreGive(s_trigger_mutex);
+    if (!armed) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    ESP_LOGI(TAG, "Channel %d trigger armed at %lld um (%lld counts)", enc->index,
+             (long long)config->target_um, (long long)target);
+    return ESP_OK;
 }
 
 /**
- * @brief Returns the calculated distance in meters.
+ * @brief Cancels the trigger; the output keeps its level.
  */
-float encoder_get_distance_m(void) {
-    int pulses = encoder_get_pulses();
-    return pulses * distance_per_pulse * calibration_factor;
+void encoder_channel_disarm_trigger(encoder_handle_t enc) {
+    xSemaphoreTake(s_trigger_mutex, portMAX_DELAY);
+    encoder_core_disarm_trigger(&enc->core);
+    xSemaphoreGive(s_trigger_mutex);
 }
 
 /**
- * @brief Sets new wheel diameter in millimeters.
+ * @brief Returns the trigger state.
  */
-void encoder_set_wheel_diameter_mm(float diameter_mm) {
-    if (diameter_mm > 0.0f) {
-        wheel_diameter_m = diameter_mm / 1000.0f;
-        update_distance_per_pulse();
+encoder_trigger_state_t encoder_channel_get_trigger_state(encoder_handle_t enc) {
+    return encoder_core_get_trigger_state(&enc->core);
+}
+
+/**
+ * @brief Returns the trigger latency statistics.
+ */
+void encoder_channel_get_trigger_stats(encoder_handle_t enc, encoder_trigger_stats_t *out) {
+    encoder_core_get_trigger_stats(&enc->core, out);
+}
+
+/**
+ * @brief Returns the interrupt counters.
+ */
+encoder_irq_stats_t encoder_channel_get_irq_stats(encoder_handle_t enc) {
+    return encoder_core_get_irq_stats(&enc->core);
+}
+
+/**
+ * @brief Returns the index pulse record.
+ */
+void encoder_channel_get_index(encoder_handle_t enc, encoder_index_t *out) {
+    encoder_core_get_index(&enc->core, out);
+}
+
+/**
+ * @brief Arms homing on the next index pulse.
+ */
+void encoder_channel_home_on_index(encoder_handle_t enc) {
+    encoder_core_home_on_index(&enc->core);
+}
+
+/**
+ * @brief Returns the position relative to the home index.
+ */
+int64_t encoder_channel_get_position(encoder_handle_t enc) {
+    return encoder_core_get_position(&enc->core);
+}
+
+/**
+ * @brief Returns the angle since the last index.
+ */
+bool encoder_channel_get_angle_deg(encoder_handle_t enc, float *out_deg) {
+    return encoder_core_get_angle_deg(&enc->core, out_deg);
+}
+
+/**
+ * @brief Positions a consumer cursor at the next sample to be produced.
+ */
+void encoder_channel_samples_cursor_init(encoder_handle_t enc, encoder_ring_cursor_t *cursor) {
+    encoder_ring_cursor_init(enc->ring, cursor);
+}
+
+/**
+ * @brief Positions a consumer cursor at a sample sequence number.
+ */
+void encoder_channel_samples_cursor_seek(encoder_handle_t enc, encoder_ring_cursor_t *cursor, uint32_t seq) {
+    encoder_ring_cursor_seek(enc->ring, cursor, seq);
+}
+
+/**
+ * @brief Drains buffered samples for one consumer.
+ */
+size_t encoder_channel_samples_read(encoder_handle_t enc, encoder_ring_cursor_t *cursor, encoder_sample_t *out, size_t max) {
+    return encoder_ring_read(enc->ring, cursor, out, max);
+}
+
+/**
+ * @brief Returns the most recent sample.
+ */
+bool encoder_channel_get_latest_sample(encoder_handle_t enc, encoder_sample_t *out) {
+    return encoder_ring_latest(enc->ring, out) != 0;
+}
+
+/**
+ * @brief Registers a subscriber under the subscribe lock and publishes it.
+ */
+static esp_err_t add_subscriber(const event_subscriber_t *subscriber) {
+    esp_err_t err = ESP_OK;
+    taskENTER_CRITICAL(&s_subscribe_lock);
+    int count = atomic_load(&s_subscriber_count);
+    if (count < ENCODER_EVENT_MAX_SUBSCRIBERS) {
+        s_subscribers[count] = *subscriber;
+        atomic_store(&s_subscriber_count, count + 1);
+    } else {
+        err = ESP_ERR_NO_MEM;
     }
+    taskEXIT_CRITICAL(&s_subscribe_lock);
+    return err;
 }
 
 /**
- * @brief Sets calibration factor for distance correction.
+ * @brief Subscribes a callback to the events in mask.
  */
-void encoder_set_calibration_factor(float factor) {
-    if (factor > 0.0f) {
-        calibration_factor = factor;
+esp_err_t encoder_event_subscribe(encoder_handle_t enc, uint32_t mask, encoder_event_cb_t cb, void *arg) {
+    if (!cb || !(mask & ENCODER_EVENT_ALL)) {
+        return ESP_ERR_INVALID_ARG;
     }
+    event_subscriber_t subscriber = { .channel = enc, .mask = mask, .cb = cb, .arg = arg };
+    return add_subscriber(&subscriber);
 }
 
 /**
- * @brief Returns current wheel diameter in millimeters.
+ * @brief Subscribes a queue of encoder_event_t items to the events in mask.
  */
-float encoder_get_wheel_diameter_mm(void) {
-    return wheel_diameter_m * 1000.0f;
+esp_err_t encoder_event_subscribe_queue(encoder_handle_t enc, uint32_t mask, QueueHandle_t queue) {
+    if (!queue || !(mask & ENCODER_EVENT_ALL)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    event_subscriber_t subscriber = { .channel = enc, .mask = mask, .queue = queue };
+    return add_subscriber(&subscriber);
 }
 
 /**
- * @brief Returns current calibration factor.
+ * @brief Returns the number of events dropped on full queues.
  */
-float encoder_get_calibration_factor(void) {
-    return calibration_factor;
+uint32_t encoder_event_dropped(void) {
+    return atomic_load(&s_events_dropped);
 }
 
 /**
- * @brief Updates speed calculation based on encoder pulses over time.
+ * @brief Delivers the events raised by one sample to the matching subscribers.
  */
-void encoder_update_speed(void) {
-    int current_pulses = encoder_get_pulses();
-    int delta_pulses = current_pulses - last_pulse_count;
+static void dispatch_events(struct encoder_channel *ch, uint32_t events, const encoder_sample_t *sample,
+                            int64_t distance_um) {
+    encoder_event_t event = {
+        .channel = ch->index,
+        .timestamp_us = sample->timestamp_us,
+        .pulses = sample->pulses,
+        .distance_um = distance_um,
+        .speed_mps = sample->speed_mps,
+        .direction = ch->events.direction,
+    };
+    int count = atomic_load(&s_subscriber_count);
+    while (events) {
+        event.type = (encoder_event_type_t)(events & -events);  // lowest set bit
+        events &= events - 1;
+        for (int i = 0; i < count; i++) {
+            const event_subscriber_t *subscriber = &s_subscribers[i];
+            if (!(subscriber->mask & event.type) || (subscriber->channel && subscriber->channel != ch)) {
+                continue;
+            }
+            if (subscriber->cb) {
+                subscriber->cb(&event, subscriber->arg);
+            } else if (xQueueSend(subscriber->queue, &event, 0) != pdTRUE) {
+                atomic_fetch_add(&s_events_dropped, 1);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Samples one channel and publishes the record.
+ */
+static void sample_channel(struct encoder_channel *ch) {
+    // Never wait here: a busy mutex only postpones the trigger service by one period
+    if (xSemaphoreTake(s_trigger_mutex, 0) == pdTRUE) {
+        encoder_core_service_trigger(&ch->core);
+        xSemaphoreGive(s_trigger_mutex);
+    }
+    encoder_core_update_speed(&ch->core);
 
-    int64_t now_us = esp_timer_get_time();
-    float interval_s = (last_time_us == 0)
-        ? 1.0f
-        : (now_us - last_time_us) / 1000000.0f;
+    encoder_sample_t sample = {
+        .timestamp_us = ch->core.last_time_us,
+        .pulses = ch->core.last_pulse_count,
+        .speed_mps = ch->core.last_speed,
+        .accel_mps2 = ch->core.accel,
+    };
+    encoder_ring_push(ch->ring, &sample);
 
-    float distance = delta_pulses * distance_per_pulse * calibration_factor;
-    last_speed = distance / interval_s;
+    int64_t distance_um = encoder_core_pulses_to_um(&ch->core, sample.pulses);
+    uint32_t events = encoder_event_detector_update(&ch->events, sample.timestamp_us, sample.pulses,
+                                                    distance_um, sample.speed_mps);
+    if (events) {
+        dispatch_events(ch, events, &sample, distance_um);
+    }
+}
 
-    last_pulse_count = current_pulses;
-    last_time_us = now_us;
+/**
+ * @brief Sampling timer callback: wakes the sampling task.
+ */
+#if CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+static void IRAM_ATTR encoder_sample_tick(void* arg) {
+    atomic_store_explicit(&s_sample_fire_us, (uint32_t)esp_timer_get_time(), memory_order_relaxed);
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(s_sampler_task, &woken);
+    if (woken) {
+        esp_timer_isr_dispatch_need_yield();
+    }
+}
+#else
+static void encoder_sample_tick(void* arg) {
+    atomic_store_explicit(&s_sample_fire_us, (uint32_t)esp_timer_get_time(), memory_order_relaxed);
+    xTaskNotifyGive(s_sampler_task);
 }
+#endif
 
 /**
- * @brief Returns last calculated speed in meters per second.
+ * @brief Adds one pass to the timing statistics.
  */
-float encoder_get_speed_mps(void) {
-    return last_speed;
+static void record_pass(uint32_t ticks, int64_t start_us, int64_t *last_start_us, uint32_t latency_us,
+                        uint32_t run_us) {
+    encoder_sampler_stats_t *st = &s_sampler_stats;
+    if (atomic_exchange(&s_sampler_stats_reset, false)) {
+        uint32_t rate_hz = st->rate_hz;
+        memset(st, 0, sizeof(*st));
+        st->rate_hz = rate_hz;
+        s_jitter_sum_us = s_latency_sum_us = s_run_sum_us = 0;
+        *last_start_us = 0;
+    }
+    st->core = xPortGetCoreID();
+    st->passes++;
+    st->overruns += ticks - 1;
+
+    if (*last_start_us) {
+        int32_t interval = (int32_t)(start_us - *last_start_us);
+        uint32_t jitter = (uint32_t)abs(interval - (int32_t)s_sample_period_us);
+        if (st->passes == 2 || interval < st->interval_min_us) st->interval_min_us = interval;
+        if (interval > st->interval_max_us) st->interval_max_us = interval;
+        if (jitter > st->jitter_max_us) st->jitter_max_us = jitter;
+        s_jitter_sum_us += jitter;
+        st->jitter_mean_us = s_jitter_sum_us / (st->passes - 1);
+        METRICS_RECORD(METRIC_SAMPLER_JITTER, jitter);
+    }
+    *last_start_us = start_us;
+
+    METRICS_RECORD(METRIC_SAMPLER_WAKE, latency_us);
+    METRICS_RECORD(METRIC_SAMPLER_RUN, run_us);
+    if (latency_us > st->wake_latency_max_us) st->wake_latency_max_us = latency_us;
+    s_latency_sum_us += latency_us;
+    st->wake_latency_mean_us = s_latency_sum_us / st->passes;
+    if (run_us > st->run_max_us) st->run_max_us = run_us;
+    s_run_sum_us += run_us;
+    st->run_mean_us = s_run_sum_us / st->passes;
 }
 
 /**
- * @brief Background FreeRTOS task to periodically update speed.
+ * @brief Sampling task: services every channel in one pass per timer tick.
  */
-static void encoder_speed_task(void* arg) {
+static void encoder_sampler_task(void* arg) {
+    int64_t last_start_us = 0;
     while (1) {
-        encoder_update_speed();
-        vTaskDelay(pdMS_TO_TICKS(SPEED_TASK_PERIOD_MS));
+        uint32_t ticks = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        int64_t start_us = esp_timer_get_time();
+        uint32_t latency_us = (uint32_t)start_us - atomic_load_explicit(&s_sample_fire_us, memory_order_relaxed);
+
+        int count = atomic_load(&s_channel_count);
+        for (int i = 0; i < count; i++) {
+            sample_channel(&s_channels[i]);
+        }
+        record_pass(ticks, start_us, &last_start_us, latency_us, (uint32_t)(esp_timer_get_time() - start_us));
+    }
+}
+
+/**
+ * @brief Starts the sampling task and the periodic timer shared by all channels.
+ */
+esp_err_t encoder_start_sampler(const encoder_sampler_config_t *config) {
+    if (s_sample_timer) {
+        ESP_LOGW(TAG, "Speed sampling already running");
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint32_t rate_hz = config->rate_hz;
+    if (rate_hz < ENCODER_SAMPLE_RATE_MIN_HZ) rate_hz = ENCODER_SAMPLE_RATE_MIN_HZ;
+    if (rate_hz > ENCODER_SAMPLE_RATE_MAX_HZ) rate_hz = ENCODER_SAMPLE_RATE_MAX_HZ;
+    s_sample_period_us = 1000000 / rate_hz;
+    s_sampler_stats.rate_hz = rate_hz;
+    s_sampler_stats.core = -1;
+
+    if (xTaskCreatePinnedToCore(encoder_sampler_task, "encoder_sample", config->stack_size, NULL,
+                                config->priority, &s_sampler_task, config->core) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    const esp_timer_create_args_t args = {
+        .callback = encoder_sample_tick,
+#if CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+        .dispatch_method = ESP_TIMER_ISR,
+#else
+        .dispatch_method = ESP_TIMER_TASK,
+#endif
+        .name = "encoder_sample",
+    };
+    esp_err_t err = esp_timer_create(&args, &s_sample_timer);
+    if (err == ESP_OK) {
+        err = esp_timer_start_periodic(s_sample_timer, s_sample_period_us);
+    }
+    if (err != ESP_OK) {
+        if (s_sample_timer) {
+            esp_timer_delete(s_sample_timer);
+            s_sample_timer = NULL;
+        }
+        vTaskDelete(s_sampler_task);
+        s_sampler_task = NULL;
+        return err;
+    }
+
+    ESP_LOGI(TAG, "Speed sampling at %u Hz, task on core %d", (unsigned)rate_hz, (int)config->core);
+    return ESP_OK;
+}
+
+void encoder_start_speed_task(uint32_t rate_hz) {
+    encoder_sampler_config_t config = ENCODER_SAMPLER_CONFIG_DEFAULT(rate_hz);
+    esp_err_t err = encoder_start_sampler(&config);
+    if (err != ESP_ERR_INVALID_STATE) {
+        ESP_ERROR_CHECK(err);
     }
 }
 
 /**
- * @brief Starts background task for speed measurement.
+ * @brief Copies the sampling statistics; fields may be one pass apart.
+ */
+void encoder_get_sampler_stats(encoder_sampler_stats_t *out) {
+    *out = s_sampler_stats;
+}
+
+void encoder_reset_sampler_stats(void) {
+    atomic_store(&s_sampler_stats_reset, true);
+}
+
+// ---------------------------------------------------------------------------
+// Single-encoder API (channel 0)
+// ---------------------------------------------------------------------------
+
+/**
+ * @brief Initializes the encoder using pulse counter with specified GPIOs.
  */
-void encoder_start_speed_task(void) {
-    xTaskCreatePinnedToCore(encoder_speed_task, "encoder_speed_task", 2048, NULL, 5, NULL, 0);
+void encoder_init(gpio_num_t pin_a, gpio_num_t pin_b, int ppr, float wheel_diameter_mm) {
+    encoder_config_t config = ENCODER_CONFIG_DEFAULT(pin_a, pin_b);
+    config.counting.pulses_per_rev = ppr;
+    config.wheel_diameter_mm = wheel_diameter_mm;
+
+    encoder_handle_t enc;
+    ESP_ERROR_CHECK(encoder_channel_new(&config, &enc));
+}
+
+int64_t encoder_get_pulses(void) {
+    return encoder_channel_get_pulses(DEFAULT_CHANNEL);
+}
+
+void encoder_get_snapshot(encoder_snapshot_t *out) {
+    encoder_channel_get_snapshot(DEFAULT_CHANNEL, out);
+}
+
+void encoder_reset(void) {
+    encoder_channel_reset(DEFAULT_CHANNEL);
+}
+
+void encoder_set_pulses(int64_t pulses) {
+    encoder_channel_set_pulses(DEFAULT_CHANNEL, pulses);
+}
+
+float encoder_get_distance_m(void) {
+    return encoder_channel_get_distance_m(DEFAULT_CHANNEL);
+}
+
+int64_t encoder_get_distance_um(void) {
+    return encoder_channel_get_distance_um(DEFAULT_CHANNEL);
+}
+
+int64_t encoder_pulses_to_um(int64_t pulses) {
+    return encoder_channel_pulses_to_um(DEFAULT_CHANNEL, pulses);
+}
+
+void encoder_set_wheel_diameter_mm(float diameter_mm) {
+    encoder_channel_set_wheel_diameter_mm(DEFAULT_CHANNEL, diameter_mm);
+}
+
+void encoder_set_calibration_factor(float factor) {
+    encoder_channel_set_calibration_factor(DEFAULT_CHANNEL, factor);
+}
+
+float encoder_get_wheel_diameter_mm(void) {
+    return encoder_channel_get_wheel_diameter_mm(DEFAULT_CHANNEL);
+}
+
+float encoder_get_calibration_factor(void) {
+    return encoder_channel_get_calibration_factor(DEFAULT_CHANNEL);
+}
+
+void encoder_update_speed(void) {
+    xSemaphoreTake(s_trigger_mutex, portMAX_DELAY);
+    encoder_core_service_trigger(&DEFAULT_CHANNEL->core);
+    xSemaphoreGive(s_trigger_mutex);
+    encoder_core_update_speed(&DEFAULT_CHANNEL->core);
+}
+
+float encoder_get_speed_mps(void) {
+    return encoder_channel_get_speed_mps(DEFAULT_CHANNEL);
+}
+
+float encoder_get_raw_speed_mps(void) {
+    return encoder_channel_get_raw_speed_mps(DEFAULT_CHANNEL);
+}
+
+float encoder_get_accel_mps2(void) {
+    return encoder_channel_get_accel_mps2(DEFAULT_CHANNEL);
+}
+
+float encoder_get_jerk_mps3(void) {
+    return encoder_channel_get_jerk_mps3(DEFAULT_CHANNEL);
+}
+
+void encoder_set_accel_window(uint16_t samples) {
+    encoder_channel_set_accel_window(DEFAULT_CHANNEL, samples);
+}
+
+uint16_t encoder_get_accel_window(void) {
+    return encoder_channel_get_accel_window(DEFAULT_CHANNEL);
+}
+
+void encoder_set_speed_filter(const encoder_filter_config_t *config) {
+    encoder_channel_set_speed_filter(DEFAULT_CHANNEL, config);
+}
+
+encoder_filter_config_t encoder_get_speed_filter(void) {
+    return encoder_channel_get_speed_filter(DEFAULT_CHANNEL);
+}
+
+void encoder_set_speed_mode(encoder_speed_mode_t mode) {
+    encoder_channel_set_speed_mode(DEFAULT_CHANNEL, mode);
+}
+
+encoder_speed_mode_t encoder_get_speed_mode(void) {
+    return encoder_channel_get_speed_mode(DEFAULT_CHANNEL);
+}
+
+int64_t encoder_get_speed_window_us(void) {
+    return encoder_channel_get_speed_window_us(DEFAULT_CHANNEL);
+}
+
+esp_err_t encoder_set_noise_config(const encoder_noise_config_t *config) {
+    return encoder_channel_set_noise_config(DEFAULT_CHANNEL, config);
+}
+
+encoder_noise_config_t encoder_get_noise_config(void) {
+    return encoder_channel_get_noise_config(DEFAULT_CHANNEL);
+}
+
+encoder_plausibility_stats_t encoder_get_noise_stats(void) {
+    return encoder_channel_get_noise_stats(DEFAULT_CHANNEL);
+}
+
+void encoder_clear_noise_stats(void) {
+    encoder_channel_clear_noise_stats(DEFAULT_CHANNEL);
+}
+
+esp_err_t encoder_set_counting(const encoder_counting_t *counting) {
+    return encoder_channel_set_counting(DEFAULT_CHANNEL, counting);
+}
+
+encoder_counting_t encoder_get_counting(void) {
+    return encoder_channel_get_counting(DEFAULT_CHANNEL);
+}
+
+void encoder_set_event_config(const encoder_event_config_t *config) {
+    encoder_channel_set_event_config(DEFAULT_CHANNEL, config);
+}
+
+encoder_event_config_t encoder_get_event_config(void) {
+    return encoder_channel_get_event_config(DEFAULT_CHANNEL);
+}
+
+void encoder_set_target_um(int64_t target_um) {
+    encoder_channel_set_target_um(DEFAULT_CHANNEL, target_um);
+}
+
+void encoder_clear_target(void) {
+    encoder_channel_clear_target(DEFAULT_CHANNEL);
+}
+
+esp_err_t encoder_arm_trigger(const encoder_trigger_config_t *config) {
+    return encoder_channel_arm_trigger(DEFAULT_CHANNEL, config);
+}
+
+void encoder_disarm_trigger(void) {
+    encoder_channel_disarm_trigger(DEFAULT_CHANNEL);
+}
+
+void encoder_get_trigger_stats(encoder_trigger_stats_t *out) {
+    encoder_channel_get_trigger_stats(DEFAULT_CHANNEL, out);
+}
+
+uint32_t encoder_get_reset_count(void) {
+    return encoder_channel_get_reset_count(DEFAULT_CHANNEL);
+}
+
+encoder_irq_stats_t encoder_get_irq_stats(void) {
+    return encoder_channel_get_irq_stats(DEFAULT_CHANNEL);
+}
+
+void encoder_get_index(encoder_index_t *out) {
+    encoder_channel_get_index(DEFAULT_CHANNEL, out);
+}
+
+void encoder_home_on_index(void) {
+    encoder_channel_home_on_index(DEFAULT_CHANNEL);
+}
+
+int64_t encoder_get_position(void) {
+    return encoder_channel_get_position(DEFAULT_CHANNEL);
+}
+
+bool encoder_get_angle_deg(float *out_deg) {
+    return encoder_channel_get_angle_deg(DEFAULT_CHANNEL, out_deg);
+}
+
+void encoder_samples_cursor_init(encoder_ring_cursor_t *cursor) {
+    if (DEFAULT_CHANNEL->ring) {
+        encoder_channel_samples_cursor_init(DEFAULT_CHANNEL, cursor);
+    } else {
+        *cursor = (encoder_ring_cursor_t){0};
+    }
+}
+
+void encoder_samples_cursor_seek(encoder_ring_cursor_t *cursor, uint32_t seq) {
+    if (DEFAULT_CHANNEL->ring) {
+        encoder_channel_samples_cursor_seek(DEFAULT_CHANNEL, cursor, seq);
+    } else {
+        *cursor = (encoder_ring_cursor_t){0};
+    }
+}
+
+size_t encoder_samples_read(encoder_ring_cursor_t *cursor, encoder_sample_t *out, size_t max) {
+    return DEFAULT_CHANNEL->ring ? encoder_channel_samples_read(DEFAULT_CHANNEL, cursor, out, max) : 0;
+}
+
+bool encoder_get_latest_sample(encoder_sample_t *out) {
+    return DEFAULT_CHANNEL->ring && encoder_channel_get_latest_sample(DEFAULT_CHANNEL, out);
 }
@@ -0,0 +1,994 @@
+#include "encoder_core.h"
+#include <math.h>
+#include <stddef.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_attr.h"
+#else
+#define IRAM_ATTR
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/**
+ * @brief Recomputes the combined pulse scale after diameter, factor or PPR changed.
+ *
+ * Done once per configuration change so the per-call paths are a single
+ * multiplication: float meters per pulse for the speed estimators, and
+ * micrometres per pulse in Q32.32 for exact distance accumulation.
+ */
+static void update_distance_per_pulse(encoder_core_t *core) {
+    if (core->pulses_per_rev <= 0) {
+        return;
+    }
+    core->counts_per_rev = core->pulses_per_rev * (int)core->count_mode / 4;
+    core->pulses_per_edge = core->count_mode == ENCODER_COUNT_X4 ? 2 : 1;
+    double counts_per_rev = (double)core->pulses_per_rev * (double)core->count_mode / 4.0;
+    double m_per_pulse = M_PI * (double)core->wheel_diameter_m / counts_per_rev;
+    core->distance_per_pulse = (float)m_per_pulse;
+    core->m_per_pulse = (float)(m_per_pulse * core->calibration_factor);
+    core->um_per_pulse_q32 = (uint64_t)(m_per_pulse * core->calibration_factor * 1e6 * 4294967296.0 + 0.5);
+}
+
+/**
+ * @brief (pulses * scale_q32) >> 32 without 128-bit arithmetic, exact for any int64 pulse count.
+ */
+static int64_t mul_q32(int64_t pulses, uint64_t scale_q32) {
+    uint64_t mag = pulses < 0 ? 0 - (uint64_t)pulses : (uint64_t)pulses;
+    uint64_t ph = mag >> 32, pl = mag & 0xFFFFFFFFu;
+    uint64_t sh = scale_q32 >> 32, sl = scale_q32 & 0xFFFFFFFFu;
+    uint64_t result = ((ph * sh) << 32) + ph * sl + pl * sh + ((pl * sl) >> 32);
+    return pulses < 0 ? -(int64_t)result : (int64_t)result;
+}
+
+static void set_edge_capture(encoder_core_t *core, bool enable) {
+    if (!core->backend || enable == core->edge_capture) {
+        return;
+    }
+    if (!enable) {
+        core->used_edge_us = 0;     // edges are not captured while counting
+    }
+    core->edge_capture = enable;
+    if (core->backend->set_edge_capture) {
+        core->backend->set_edge_capture(core->backend_ctx, enable);
+    }
+}
+
+/**
+ * @brief Initializes the core state and binds it to a backend.
+ */
+void encoder_core_init(encoder_core_t *core, const encoder_backend_t *backend, void *backend_ctx,
+                       int ppr, float wheel_diameter_mm) {
+    core->backend = backend;
+    core->backend_ctx = backend_ctx;
+    atomic_store(&core->seq, 0);
+    core->total_pulse_count = 0;
+    core->last_count = 0;
+    core->fold_credit = 0;
+    core->limit_irq = true;     // the backend starts with the limit watch points added
+    atomic_store(&core->watch_irqs, 0);
+    core->pulses_per_rev = ppr;
+    if (core->count_mode != ENCODER_COUNT_X1 && core->count_mode != ENCODER_COUNT_X2) {
+        core->count_mode = ENCODER_COUNT_X4;
+    }
+    core->wheel_diameter_m = wheel_diameter_mm / 1000.0f;
+    if (core->calibration_factor <= 0.0f) {
+        core->calibration_factor = 1.0f;
+    }
+    update_distance_per_pulse(core);  // <- important to call this after setting wheel diameter
+
+    core->last_pulse_count = 0;
+    core->last_speed = 0.0f;
+    core->raw_speed = 0.0f;
+    core->last_time_us = 0;
+    encoder_filter_init(&core->speed_filter, &core->speed_filter.config);
+    uint16_t window = core->accel_deriv.window ? core->accel_deriv.window : ENCODER_DERIV_DEFAULT_WINDOW;
+    encoder_deriv_init(&core->accel_deriv, window);
+    encoder_deriv_init(&core->jerk_deriv, window);
+    core->accel = 0.0f;
+    core->jerk = 0.0f;
+    atomic_store(&core->deriv_window_pending, 0);
+    encoder_core_clear_plausibility_stats(core);
+    core->index = (encoder_index_t){0};
+    atomic_store(&core->home_armed, false);
+    atomic_store(&core->trigger_state, ENCODER_TRIGGER_IDLE);
+    core->trigger_cb = NULL;
+    core->trigger_arg = NULL;
+    core->trigger_stats = (encoder_trigger_stats_t){0};
+
+    core->active_speed_mode = ENCODER_SPEED_MODE_COUNT;
+    core->speed_window_us = 0;
+    atomic_store(&core->rereference, false);
+    atomic_store(&core->edge_seq, 0);
+    core->edge_count = 0;
+    core->last_edge_us = 0;
+    core->used_edge_count = 0;
+    core->used_edge_us = 0;
+    core->edge_capture = false;
+    set_edge_capture(core, core->speed_mode == ENCODER_SPEED_MODE_PERIOD);
+}
+
+/**
+ * @brief Enters the writer side: takes the backend lock and makes the generation odd.
+ */
+static inline void IRAM_ATTR write_begin(encoder_core_t *core) {
+    if (core->backend && core->backend->lock) {
+        core->backend->lock(core->backend_ctx);
+    }
+    atomic_fetch_add_explicit(&core->seq, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+/**
+ * @brief Leaves the writer side: publishes the update by making the generation even again.
+ */
+static inline void IRAM_ATTR write_end(encoder_core_t *core) {
+    atomic_fetch_add_explicit(&core->seq, 1, memory_order_release);
+    if (core->backend && core->backend->unlock) {
+        core->backend->unlock(core->backend_ctx);
+    }
+}
+
+/**
+ * @brief Count change from one hardware count to another, extended across a limit reset.
+ *
+ * The unit resets to zero at either limit, so a change of more than half the
+ * window in one direction is a reset crossed in the other: forward through
+ * the high limit or backward through the low one.
+ */
+static inline int IRAM_ATTR extend_count(int from, int to) {
+    int delta = to - from;
+    if (delta < -ENCODER_CORE_HALF_WINDOW) {
+        delta += ENCODER_CORE_HIGH_LIMIT;
+    } else if (delta > ENCODER_CORE_HALF_WINDOW) {
+        delta += ENCODER_CORE_LOW_LIMIT;
+    }
+    return delta;
+}
+
+/**
+ * @brief Moves the count change since the last fold into the accumulator; caller holds the writer side.
+ *
+ * A reset found here while the limit interrupts are on is credited, so its
+ * interrupt, when it arrives, does not add the limit a second time.
+ *
+ * @return Counts folded
+ */
+static int IRAM_ATTR fold_locked(encoder_core_t *core) {
+    int count = core->backend->get_count(core->backend_ctx);
+    int raw = count - core->last_count;
+    int delta = extend_count(core->last_count, count);
+    if (delta != raw && core->limit_irq) {
+        core->fold_credit += delta > raw ? 1 : -1;
+    }
+    core->total_pulse_count += delta;
+    core->last_count = count;
+    return delta;
+}
+
+/**
+ * @brief Runs the trigger callback if the watch point is the programmed target.
+ *
+ * The window (the pulses at hardware count zero) cannot move while the watch
+ * point is programmed (a limit is never crossed before the target), but the
+ * count is folded and the window checked anyway so a stale watch point never
+ * fires.
+ */
+static void IRAM_ATTR fire_trigger_isr(encoder_core_t *core, int watch_point_value) {
+    if (!core->backend) {
+        return;
+    }
+    int64_t entry_us = core->backend->now_us(core->backend_ctx);
+    if (atomic_load_explicit(&core->trigger_state, memory_order_acquire) != ENCODER_TRIGGER_PROGRAMMED ||
+        watch_point_value != core->trigger_watch) {
+        return;
+    }
+    write_begin(core);
+    fold_locked(core);
+    int64_t window = core->total_pulse_count - core->last_count;
+    write_end(core);
+    if (window + watch_point_value != core->trigger_target) {
+        return;
+    }
+    // Claim the fire against a concurrent late fire or disarm from the task
+    int expected = ENCODER_TRIGGER_PROGRAMMED;
+    if (!atomic_compare_exchange_strong(&core->trigger_state, &expected, ENCODER_TRIGGER_FIRED)) {
+        return;
+    }
+    if (core->trigger_cb) {
+        core->trigger_cb(core->trigger_arg);
+    }
+    int overshoot = core->backend->get_count(core->backend_ctx) - watch_point_value;
+    uint32_t latency = (uint32_t)(core->backend->now_us(core->backend_ctx) - entry_us);
+
+    write_begin(core);
+    encoder_trigger_stats_t *stats = &core->trigger_stats;
+    int32_t magnitude = overshoot < 0 ? -overshoot : overshoot;
+    stats->fires++;
+    stats->last_overshoot = overshoot;
+    if (magnitude > stats->max_overshoot) stats->max_overshoot = magnitude;
+    stats->last_latency_us = latency;
+    if (latency > stats->max_latency_us) stats->max_latency_us = latency;
+    stats->total_latency_us += latency;
+    write_end(core);
+}
+
+/**
+ * @brief Folds a high/low limit event into the software accumulator.
+ */
+void IRAM_ATTR encoder_core_on_watch_point(encoder_core_t *core, int watch_point_value) {
+    if (watch_point_value != ENCODER_CORE_HIGH_LIMIT && watch_point_value != ENCODER_CORE_LOW_LIMIT) {
+        fire_trigger_isr(core, watch_point_value);
+        return;
+    }
+    if (!core->backend) {
+        return;
+    }
+    int sign = watch_point_value > 0 ? 1 : -1;
+    write_begin(core);
+    if (!core->limit_irq || core->fold_credit * sign > 0) {
+        // A fold already extended across this reset
+        if (core->limit_irq) {
+            core->fold_credit -= sign;
+        }
+        fold_locked(core);
+    } else {
+        // Exact whatever the count did since the last fold: it ran up to the limit, then from zero
+        int count = core->backend->get_count(core->backend_ctx);
+        core->total_pulse_count += (watch_point_value - core->last_count) + count;
+        core->last_count = count;
+    }
+    write_end(core);
+    atomic_fetch_add_explicit(&core->watch_irqs, 1, memory_order_relaxed);
+}
+
+/**
+ * @brief Latches the count at an index pulse and measures the revolution error.
+ */
+void IRAM_ATTR encoder_core_on_index(encoder_core_t *core, int64_t timestamp_us) {
+    if (!core->backend) {
+        return;
+    }
+    write_begin(core);
+    // Folding first also takes in a limit reset whose interrupt is still pending
+    fold_locked(core);
+    int64_t pulses = core->total_pulse_count;
+    encoder_index_t *index = &core->index;
+
+    if (index->count > 0) {
+        int64_t span = pulses - index->pulses;
+        if (span < 0) span = -span;
+        if (span * 2 >= core->counts_per_rev) {
+            int32_t error = (int32_t)(span - core->counts_per_rev);
+            int32_t magnitude = error < 0 ? -error : error;
+            index->last_error = error;
+            index->revolutions++;
+            if (magnitude > index->max_error) index->max_error = magnitude;
+            if (magnitude > ENCODER_INDEX_TOLERANCE) index->error_events++;
+        }
+    }
+    index->count++;
+    index->pulses = pulses;
+    index->timestamp_us = timestamp_us;
+    if (atomic_exchange_explicit(&core->home_armed, false, memory_order_relaxed)) {
+        index->homed = true;
+        index->home_pulses = pulses;
+    }
+    write_end(core);
+}
+
+/**
+ * @brief Publishes a new edge timestamp; single writer (the edge ISR).
+ */
+void IRAM_ATTR encoder_core_on_edge(encoder_core_t *core, int64_t timestamp_us) {
+    atomic_fetch_add_explicit(&core->edge_seq, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    core->edge_count++;
+    core->last_edge_us = timestamp_us;
+    atomic_fetch_add_explicit(&core->edge_seq, 1, memory_order_release);
+}
+
+/**
+ * @brief Seqlock read of the edge record.
+ */
+static void read_edges(encoder_core_t *core, uint32_t *count, int64_t *last_us) {
+    unsigned begin, end;
+    do {
+        begin = atomic_load_explicit(&core->edge_seq, memory_order_acquire);
+        *count = core->edge_count;
+        *last_us = core->last_edge_us;
+        atomic_thread_fence(memory_order_acquire);
+        end = atomic_load_explicit(&core->edge_seq, memory_order_relaxed);
+    } while ((begin & 1u) || begin != end);
+}
+
+/**
+ * @brief Returns the interrupt counters.
+ */
+encoder_irq_stats_t encoder_core_get_irq_stats(encoder_core_t *core) {
+    uint32_t edges;
+    int64_t last_us;
+    read_edges(core, &edges, &last_us);
+    encoder_irq_stats_t stats = {
+        .watch_irqs = atomic_load_explicit(&core->watch_irqs, memory_order_relaxed),
+        .limit_irq = core->limit_irq,
+        .edge_irqs = edges,
+    };
+    return stats;
+}
+
+/**
+ * @brief Seqlock read of the last fold, the hardware count and time as one consistent set.
+ *
+ * A limit reset not folded yet needs no retry: the caller extends the count
+ * from the last fold across it.
+ */
+static void read_counts(encoder_core_t *core, int64_t *total, int *last, int *count, int64_t *now_us) {
+    const encoder_backend_t *backend = core->backend;
+    unsigned begin, end;
+    do {
+        begin = atomic_load_explicit(&core->seq, memory_order_acquire);
+        *total = core->total_pulse_count;
+        *last = core->last_count;
+        *count = backend->get_count(core->backend_ctx);
+        *now_us = backend->now_us(core->backend_ctx);
+        atomic_thread_fence(memory_order_acquire);
+        end = atomic_load_explicit(&core->seq, memory_order_relaxed);
+    } while ((begin & 1u) || begin != end);
+}
+
+/**
+ * @brief Reads accumulator plus hardware count and time.
+ */
+void encoder_core_snapshot(encoder_core_t *core, encoder_snapshot_t *out) {
+    if (!core->backend) {
+        out->pulses = 0;
+        out->timestamp_us = 0;
+        return;
+    }
+    int64_t total;
+    int last, count;
+    read_counts(core, &total, &last, &count, &out->timestamp_us);
+    out->pulses = total + extend_count(last, count);
+}
+
+/**
+ * @brief Returns the current total pulse count including overflow.
+ */
+int64_t encoder_core_get_pulses(encoder_core_t *core) {
+    encoder_snapshot_t snap;
+    encoder_core_snapshot(core, &snap);
+    return snap.pulses;
+}
+
+/**
+ * @brief Resets pulse count and speed state.
+ */
+void encoder_core_reset(encoder_core_t *core) {
+    if (core->backend) {
+        encoder_core_disarm_trigger(core);
+        write_begin(core);
+        fold_locked(core);
+        int64_t cleared = core->total_pulse_count;
+        core->total_pulse_count = 0;
+        core->index.pulses -= cleared;
+        core->index.home_pulses -= cleared;
+        write_end(core);
+        core->last_pulse_count = 0;
+        core->last_speed = 0.0f;
+        core->raw_speed = 0.0f;
+        encoder_filter_reset(&core->speed_filter);
+        encoder_deriv_reset(&core->accel_deriv);
+        encoder_deriv_reset(&core->jerk_deriv);
+        core->accel = 0.0f;
+        core->jerk = 0.0f;
+    }
+}
+
+/**
+ * @brief Presets the total pulse count.
+ */
+void encoder_core_set_pulses(encoder_core_t *core, int64_t pulses) {
+    if (!core->backend) {
+        return;
+    }
+    encoder_core_disarm_trigger(core);
+    write_begin(core);
+    fold_locked(core);
+    int64_t shift = pulses - core->total_pulse_count;
+    core->total_pulse_count = pulses;
+    core->index.pulses += shift;
+    core->index.home_pulses += shift;
+    write_end(core);
+    atomic_store_explicit(&core->rereference, true, memory_order_release);
+}
+
+/**
+ * @brief Seqlock read of the index record.
+ */
+void encoder_core_get_index(encoder_core_t *core, encoder_index_t *out) {
+    unsigned begin, end;
+    do {
+        begin = atomic_load_explicit(&core->seq, memory_order_acquire);
+        *out = core->index;
+        atomic_thread_fence(memory_order_acquire);
+        end = atomic_load_explicit(&core->seq, memory_order_relaxed);
+    } while ((begin & 1u) || begin != end);
+}
+
+/**
+ * @brief Arms homing on the next index pulse.
+ */
+void encoder_core_home_on_index(encoder_core_t *core) {
+    atomic_store_explicit(&core->home_armed, true, memory_order_relaxed);
+}
+
+/**
+ * @brief Returns the pulse count relative to the home index.
+ */
+int64_t encoder_core_get_position(encoder_core_t *core) {
+    encoder_index_t index;
+    encoder_core_get_index(core, &index);
+    int64_t pulses = encoder_core_get_pulses(core);
+    return index.homed ? pulses - index.home_pulses : pulses;
+}
+
+/**
+ * @brief Returns the angle since the last index in degrees.
+ */
+bool encoder_core_get_angle_deg(encoder_core_t *core, float *out_deg) {
+    encoder_index_t index;
+    encoder_core_get_index(core, &index);
+    int counts_per_rev = core->counts_per_rev;
+    if (index.count == 0 || counts_per_rev <= 0) {
+        return false;
+    }
+    int64_t offset = (encoder_core_get_pulses(core) - index.pulses) % counts_per_rev;
+    if (offset < 0) {
+        offset += counts_per_rev;
+    }
+    *out_deg = 360.0f * (float)offset / (float)counts_per_rev;
+    return true;
+}
+
+/**
+ * @brief Seqlock read of the 64-bit scale, which a 32-bit core cannot load atomically.
+ */
+static uint64_t read_scale_q32(const encoder_core_t *core) {
+    encoder_core_t *c = (encoder_core_t *)core;
+    unsigned begin, end;
+    uint64_t scale;
+    do {
+        begin = atomic_load_explicit(&c->seq, memory_order_acquire);
+        scale = c->um_per_pulse_q32;
+        atomic_thread_fence(memory_order_acquire);
+        end = atomic_load_explicit(&c->seq, memory_order_relaxed);
+    } while ((begin & 1u) || begin != end);
+    return scale;
+}
+
+/**
+ * @brief Converts a pulse count into micrometres with the fixed-point scale.
+ */
+int64_t encoder_core_pulses_to_um(const encoder_core_t *core, int64_t pulses) {
+    return mul_q32(pulses, read_scale_q32(core));
+}
+
+/**
+ * @brief Returns the travelled distance in integer micrometres.
+ */
+int64_t encoder_core_get_distance_um(encoder_core_t *core) {
+    return encoder_core_pulses_to_um(core, encoder_core_get_pulses(core));
+}
+
+/**
+ * @brief Returns the calculated distance in meters.
+ */
+float encoder_core_get_distance_m(encoder_core_t *core) {
+    return (float)(encoder_core_get_distance_um(core) / 1e6);
+}
+
+/**
+ * @brief Converts micrometres into the nearest pulse count.
+ */
+int64_t encoder_core_um_to_pulses(const encoder_core_t *core, int64_t um) {
+    uint64_t scale = read_scale_q32(core);
+    if (scale == 0) {
+        return 0;
+    }
+    return (int64_t)llround((double)um * 4294967296.0 / (double)scale);
+}
+
+static int8_t trigger_side_of(int64_t target, int64_t pulses) {
+    return target > pulses ? 1 : (target < pulses ? -1 : 0);
+}
+
+/**
+ * @brief Fires from task context for a target the count has already reached.
+ */
+static void fire_trigger_late(encoder_core_t *core) {
+    atomic_store_explicit(&core->trigger_state, ENCODER_TRIGGER_IDLE, memory_order_release);
+    if (core->trigger_cb) {
+        core->trigger_cb(core->trigger_arg);
+    }
+    write_begin(core);
+    core->trigger_stats.late_fires++;
+    write_end(core);
+}
+
+/**
+ * @brief Arms the one-shot trigger and programs it if the target is in range.
+ */
+bool encoder_core_arm_trigger(encoder_core_t *core, int64_t target_pulses, encoder_trigger_cb_t cb, void *arg) {
+    if (!core->backend || !core->backend->add_watch || !core->backend->remove_watch) {
+        return false;
+    }
+    encoder_core_disarm_trigger(core);
+    core->trigger_target = target_pulses;
+    core->trigger_side = trigger_side_of(target_pulses, encoder_core_get_pulses(core));
+    core->trigger_cb = cb;
+    core->trigger_arg = arg;
+    atomic_store_explicit(&core->trigger_state, ENCODER_TRIGGER_ARMED, memory_order_release);
+    encoder_core_service_trigger(core);
+    return true;
+}
+
+/**
+ * @brief Cancels the trigger and removes a programmed watch point.
+ */
+void encoder_core_disarm_trigger(encoder_core_t *core) {
+    int state = atomic_exchange_explicit(&core->trigger_state, ENCODER_TRIGGER_IDLE, memory_order_acq_rel);
+    if ((state == ENCODER_TRIGGER_PROGRAMMED || state == ENCODER_TRIGGER_FIRED) && core->backend) {
+        core->backend->remove_watch(core->backend_ctx, core->trigger_watch);
+    }
+}
+
+/**
+ * @brief Moves the trigger along: program when in range, fire late if passed, clean up after firing.
+ */
+void encoder_core_service_trigger(encoder_core_t *core) {
+    int state = atomic_load_explicit(&core->trigger_state, memory_order_acquire);
+    if (state == ENCODER_TRIGGER_IDLE || !core->backend) {
+        return;
+    }
+    if (state == ENCODER_TRIGGER_FIRED) {
+        core->backend->remove_watch(core->backend_ctx, core->trigger_watch);
+        atomic_store_explicit(&core->trigger_state, ENCODER_TRIGGER_IDLE, memory_order_release);
+        return;
+    }
+
+    // Position and window (the pulses at hardware count zero) from the same pass
+    int64_t total, now_us;
+    int last, count;
+    read_counts(core, &total, &last, &count, &now_us);
+    int64_t pulses = total + extend_count(last, count);
+    int64_t window = pulses - count;
+    if (state == ENCODER_TRIGGER_PROGRAMMED) {
+        if (window + core->trigger_watch == core->trigger_target) {
+            return;     // window unchanged, waiting for the ISR
+        }
+        // A limit reset moved the window away from the target: start over
+        core->backend->remove_watch(core->backend_ctx, core->trigger_watch);
+        atomic_store_explicit(&core->trigger_state, ENCODER_TRIGGER_ARMED, memory_order_release);
+    }
+
+    if (core->trigger_side == 0 || trigger_side_of(core->trigger_target, pulses) != core->trigger_side) {
+        fire_trigger_late(core);
+        return;
+    }
+    int64_t watch = core->trigger_target - window;
+    if (watch <= ENCODER_CORE_LOW_LIMIT || watch >= ENCODER_CORE_HIGH_LIMIT) {
+        return;     // not in this window yet; limit resets bring it closer
+    }
+    if (core->backend->add_watch(core->backend_ctx, (int)watch) != 0) {
+        return;     // retried on the next service call
+    }
+    core->trigger_watch = (int)watch;
+    atomic_store_explicit(&core->trigger_state, ENCODER_TRIGGER_PROGRAMMED, memory_order_release);
+
+    // The count may have reached the target while the watch point was being added
+    pulses = encoder_core_get_pulses(core);
+    if (trigger_side_of(core->trigger_target, pulses) != core->trigger_side) {
+        int expected = ENCODER_TRIGGER_PROGRAMMED;
+        if (atomic_compare_exchange_strong(&core->trigger_state, &expected, ENCODER_TRIGGER_FIRED)) {
+            core->backend->remove_watch(core->backend_ctx, core->trigger_watch);
+            fire_trigger_late(core);
+        }
+    }
+}
+
+/**
+ * @brief Returns the trigger state.
+ */
+encoder_trigger_state_t encoder_core_get_trigger_state(const encoder_core_t *core) {
+    return (encoder_trigger_state_t)atomic_load_explicit(&((encoder_core_t *)core)->trigger_state, memory_order_acquire);
+}
+
+/**
+ * @brief Seqlock read of the trigger statistics.
+ */
+void encoder_core_get_trigger_stats(encoder_core_t *core, encoder_trigger_stats_t *out) {
+    unsigned begin, end;
+    do {
+        begin = atomic_load_explicit(&core->seq, memory_order_acquire);
+        *out = core->trigger_stats;
+        atomic_thread_fence(memory_order_acquire);
+        end = atomic_load_explicit(&core->seq, memory_order_relaxed);
+    } while ((begin & 1u) || begin != end);
+}
+
+/**
+ * @brief Counts and clamps a raw speed sample that no real shaft could produce.
+ */
+static void check_plausibility(encoder_core_t *core, float prev_speed, int64_t interval_us) {
+    float max_speed = core->plausibility.max_speed_mps;
+    float max_accel = core->plausibility.max_accel_mps2;
+    atomic_fetch_add_explicit(&core->plausible_samples, 1, memory_order_relaxed);
+
+    if (max_speed > 0.0f && fabsf(core->raw_speed) > max_speed) {
+        atomic_fetch_add_explicit(&core->speed_violations, 1, memory_order_relaxed);
+        core->raw_speed = core->raw_speed > 0.0f ? max_speed : -max_speed;
+    }
+    if (max_accel > 0.0f && core->last_time_us != 0) {
+        float max_step = max_accel * (interval_us / 1000000.0f);
+        float step = core->raw_speed - prev_speed;
+        if (fabsf(step) > max_step) {
+            atomic_fetch_add_explicit(&core->accel_violations, 1, memory_order_relaxed);
+            core->raw_speed = prev_speed + (step > 0.0f ? max_step : -max_step);
+        }
+    }
+}
+
+/**
+ * @brief Turns the limit interrupts on or off; the credit starts over either way.
+ *
+ * Enabling goes to the hardware first and disabling last, so an interrupt
+ * that sees limit_irq clear always finds a fold-only core.
+ */
+static void set_limit_irq(encoder_core_t *core, bool enable) {
+    if (enable) {
+        core->backend->set_limit_irq(core->backend_ctx, true);
+    }
+    write_begin(core);
+    core->limit_irq = enable;
+    core->fold_credit = 0;
+    write_end(core);
+    if (!enable) {
+        core->backend->set_limit_irq(core->backend_ctx, false);
+    }
+}
+
+/**
+ * @brief Sampler-side fold; keeps the limit interrupts on only while the count moves fast.
+ */
+static void fold(encoder_core_t *core) {
+    write_begin(core);
+    int delta = fold_locked(core);
+    write_end(core);
+    if (!core->backend->set_limit_irq) {
+        return;
+    }
+    int magnitude = delta < 0 ? -delta : delta;
+    if (!core->limit_irq && magnitude >= ENCODER_CORE_BACKSTOP_ON) {
+        set_limit_irq(core, true);
+    } else if (core->limit_irq && magnitude < ENCODER_CORE_BACKSTOP_OFF) {
+        set_limit_irq(core, false);
+    }
+}
+
+/**
+ * @brief Updates speed calculation based on encoder pulses over time.
+ */
+void encoder_core_update_speed(encoder_core_t *core) {
+    if (!core->backend) {
+        return;
+    }
+    fold(core);
+    encoder_snapshot_t snap;
+    encoder_core_snapshot(core, &snap);
+    int64_t current_pulses = snap.pulses;
+
+    if (atomic_exchange_explicit(&core->rereference, false, memory_order_acquire)) {
+        // Count scale changed: start over from here and keep the last speed
+        core->last_pulse_count = current_pulses;
+        core->last_time_us = snap.timestamp_us;
+        core->used_edge_us = 0;
+        return;
+    }
+    int64_t delta_pulses = current_pulses - core->last_pulse_count;
+
+    int64_t now_us = snap.timestamp_us;
+    int64_t interval_us = (core->last_time_us == 0)
+        ? 1000000
+        : now_us - core->last_time_us;
+    if (interval_us <= 0) {
+        return;
+    }
+
+    float scale = core->m_per_pulse;
+    float prev_speed = core->raw_speed;
+    // Count-based speed on the integer path: exact delta distance, one division
+    float count_speed = (float)(encoder_core_pulses_to_um(core, delta_pulses) * 1000000 / interval_us) / 1e6f;
+
+    uint32_t edges;
+    int64_t edge_us;
+    read_edges(core, &edges, &edge_us);
+
+    encoder_speed_mode_t mode = core->speed_mode;
+    if (mode == ENCODER_SPEED_MODE_AUTO) {
+        int64_t rate_pps = (delta_pulses < 0 ? -delta_pulses : delta_pulses) * 1000000 / interval_us;
+        if (rate_pps > ENCODER_SPEED_AUTO_COUNT_PPS) {
+            mode = ENCODER_SPEED_MODE_COUNT;
+        } else if (rate_pps < ENCODER_SPEED_AUTO_PERIOD_PPS) {
+            mode = ENCODER_SPEED_MODE_PERIOD;
+        } else {
+            mode = core->edge_capture ? ENCODER_SPEED_MODE_PERIOD : ENCODER_SPEED_MODE_COUNT;
+        }
+        set_edge_capture(core, mode == ENCODER_SPEED_MODE_PERIOD);
+    }
+
+    bool capturing = mode == ENCODER_SPEED_MODE_PERIOD;
+    if (capturing && core->used_edge_us != 0 && edges != core->used_edge_count) {
+        // Whole edges over the exact time between them
+        uint32_t n = edges - core->used_edge_count;
+        int64_t span_us = edge_us - core->used_edge_us;
+        float sign = delta_pulses < 0 ? -1.0f : (delta_pulses > 0 ? 1.0f : 0.0f);
+        core->raw_speed = span_us > 0 ? sign * n * core->pulses_per_edge * scale * 1000000.0f / span_us : 0.0f;
+        core->speed_window_us = span_us;
+    } else if (capturing && core->used_edge_us != 0) {
+        // No new edge: the true speed is at most one edge over the time since the last one
+        int64_t since_us = now_us - core->used_edge_us;
+        float bound = since_us > 0 ? core->pulses_per_edge * scale * 1000000.0f / since_us : 0.0f;
+        if (since_us >= ENCODER_SPEED_STALL_US) {
+            core->raw_speed = 0.0f;
+        } else if (core->raw_speed > bound) {
+            core->raw_speed = bound;
+        } else if (core->raw_speed < -bound) {
+            core->raw_speed = -bound;
+        }
+        core->speed_window_us = since_us;
+    } else {
+        core->raw_speed = count_speed;
+        core->speed_window_us = interval_us;
+        mode = ENCODER_SPEED_MODE_COUNT;    // also when period mode has no edge reference yet
+    }
+
+    if (capturing && edges != core->used_edge_count) {
+        core->used_edge_count = edges;
+        core->used_edge_us = edge_us;
+    }
+    check_plausibility(core, prev_speed, interval_us);
+    if (atomic_exchange_explicit(&core->filter_update, false, memory_order_acquire)) {
+        encoder_filter_init(&core->speed_filter, &core->filter_pending);
+    }
+    core->last_speed = encoder_filter_apply(&core->speed_filter, core->raw_speed, interval_us / 1000000.0f);
+
+    unsigned window = atomic_exchange_explicit(&core->deriv_window_pending, 0, memory_order_acquire);
+    if (window) {
+        encoder_deriv_init(&core->accel_deriv, (uint16_t)window);
+        encoder_deriv_init(&core->jerk_deriv, (uint16_t)window);
+    }
+    core->accel = encoder_deriv_push(&core->accel_deriv, core->raw_speed, now_us);
+    core->jerk = encoder_deriv_push(&core->jerk_deriv, core->accel, now_us);
+
+    core->active_speed_mode = mode;
+    core->last_pulse_count = current_pulses;
+    core->last_time_us = now_us;
+}
+
+/**
+ * @brief Returns last calculated speed in meters per second.
+ */
+float encoder_core_get_speed_mps(const encoder_core_t *core) {
+    return core->last_speed;
+}
+
+/**
+ * @brief Returns the last unfiltered speed estimate.
+ */
+float encoder_core_get_raw_speed_mps(const encoder_core_t *core) {
+    return core->raw_speed;
+}
+
+/**
+ * @brief Returns the least-squares acceleration estimate.
+ */
+float encoder_core_get_accel_mps2(const encoder_core_t *core) {
+    return core->accel;
+}
+
+/**
+ * @brief Returns the least-squares jerk estimate.
+ */
+float encoder_core_get_jerk_mps3(const encoder_core_t *core) {
+    return core->jerk;
+}
+
+/**
+ * @brief Hands a new differentiation window to the sampling path.
+ */
+void encoder_core_set_deriv_window(encoder_core_t *core, uint16_t samples) {
+    if (samples < 2) samples = 2;
+    if (samples > ENCODER_DERIV_MAX_WINDOW) samples = ENCODER_DERIV_MAX_WINDOW;
+    atomic_store_explicit(&core->deriv_window_pending, samples, memory_order_release);
+}
+
+/**
+ * @brief Returns the differentiation window, including a pending change.
+ */
+uint16_t encoder_core_get_deriv_window(const encoder_core_t *core) {
+    unsigned pending = atomic_load_explicit(&((encoder_core_t *)core)->deriv_window_pending, memory_order_acquire);
+    return pending ? (uint16_t)pending : core->accel_deriv.window;
+}
+
+/**
+ * @brief Sets the plausibility limits (negative values disable a check).
+ */
+void encoder_core_set_plausibility(encoder_core_t *core, const encoder_plausibility_t *limits) {
+    core->plausibility.max_speed_mps = limits->max_speed_mps > 0.0f ? limits->max_speed_mps : 0.0f;
+    core->plausibility.max_accel_mps2 = limits->max_accel_mps2 > 0.0f ? limits->max_accel_mps2 : 0.0f;
+}
+
+/**
+ * @brief Returns the plausibility limits.
+ */
+encoder_plausibility_t encoder_core_get_plausibility(const encoder_core_t *core) {
+    return core->plausibility;
+}
+
+/**
+ * @brief Returns the plausibility counters.
+ */
+encoder_plausibility_stats_t encoder_core_get_plausibility_stats(const encoder_core_t *core) {
+    encoder_core_t *c = (encoder_core_t *)core;
+    encoder_plausibility_stats_t stats = {
+        .samples = atomic_load_explicit(&c->plausible_samples, memory_order_relaxed),
+        .speed_violations = atomic_load_explicit(&c->speed_violations, memory_order_relaxed),
+        .accel_violations = atomic_load_explicit(&c->accel_violations, memory_order_relaxed),
+    };
+    return stats;
+}
+
+/**
+ * @brief Clears the plausibility counters.
+ */
+void encoder_core_clear_plausibility_stats(encoder_core_t *core) {
+    atomic_store_explicit(&core->plausible_samples, 0, memory_order_relaxed);
+    atomic_store_explicit(&core->speed_violations, 0, memory_order_relaxed);
+    atomic_store_explicit(&core->accel_violations, 0, memory_order_relaxed);
+}
+
+/**
+ * @brief Hands a new filter configuration to the sampling path.
+ */
+void encoder_core_set_filter(encoder_core_t *core, const encoder_filter_config_t *config) {
+    core->filter_pending = *config;
+    atomic_store_explicit(&core->filter_update, true, memory_order_release);
+}
+
+/**
+ * @brief Returns the filter configuration in effect (after clamping).
+ */
+encoder_filter_config_t encoder_core_get_filter(const encoder_core_t *core) {
+    return core->speed_filter.config;
+}
+
+/**
+ * @brief Selects the speed estimator and arms the edge capture it needs.
+ */
+void encoder_core_set_speed_mode(encoder_core_t *core, encoder_speed_mode_t mode) {
+    core->speed_mode = mode;
+    core->used_edge_us = 0;     // re-reference on the next edge
+    core->active_speed_mode = ENCODER_SPEED_MODE_COUNT;
+    set_edge_capture(core, mode != ENCODER_SPEED_MODE_COUNT);
+}
+
+/**
+ * @brief Returns the estimator used for the last sample.
+ */
+encoder_speed_mode_t encoder_core_get_active_speed_mode(const encoder_core_t *core) {
+    return core->active_speed_mode;
+}
+
+/**
+ * @brief Returns the measurement window of the last sample.
+ */
+int64_t encoder_core_get_speed_window_us(const encoder_core_t *core) {
+    return core->speed_window_us;
+}
+
+/**
+ * @brief Sets new wheel diameter in millimeters.
+ */
+void encoder_core_set_wheel_diameter_mm(encoder_core_t *core, float diameter_mm) {
+    if (diameter_mm > 0.0f) {
+        write_begin(core);
+        core->wheel_diameter_m = diameter_mm / 1000.0f;
+        update_distance_per_pulse(core);
+        write_end(core);
+    }
+}
+
+/**
+ * @brief Rescales a count from one decoding mode to another.
+ */
+static int64_t rescale_count(int64_t count, int from, int to) {
+    return count * to / from;
+}
+
+/**
+ * @brief Folds and rescales the count for a new decoding mode.
+ */
+void encoder_core_set_count_mode(encoder_core_t *core, encoder_count_mode_t mode) {
+    if ((mode != ENCODER_COUNT_X1 && mode != ENCODER_COUNT_X2 && mode != ENCODER_COUNT_X4) ||
+        mode == core->count_mode) {
+        return;
+    }
+    encoder_core_disarm_trigger(core);     // the target was counted in the old mode
+    write_begin(core);
+    int from = core->count_mode;
+    if (core->backend) {
+        fold_locked(core);  // the count from here on is in the new mode
+    }
+    core->total_pulse_count = rescale_count(core->total_pulse_count, from, mode);
+    core->index.pulses = rescale_count(core->index.pulses, from, mode);
+    core->index.home_pulses = rescale_count(core->index.home_pulses, from, mode);
+    core->count_mode = mode;
+    update_distance_per_pulse(core);
+    write_end(core);
+    atomic_store_explicit(&core->rereference, true, memory_order_release);
+}
+
+/**
+ * @brief Returns the decoding mode.
+ */
+encoder_count_mode_t encoder_core_get_count_mode(const encoder_core_t *core) {
+    return core->count_mode;
+}
+
+/**
+ * @brief Sets the counts per revolution in x4 decoding.
+ */
+void encoder_core_set_pulses_per_rev(encoder_core_t *core, int pulses_per_rev) {
+    if (pulses_per_rev > 0) {
+        write_begin(core);
+        core->pulses_per_rev = pulses_per_rev;
+        update_distance_per_pulse(core);
+        write_end(core);
+    }
+}
+
+/**
+ * @brief Returns the counts per revolution in x4 decoding.
+ */
+int encoder_core_get_pulses_per_rev(const encoder_core_t *core) {
+    return core->pulses_per_rev;
+}
+
+/**
+ * @brief Returns current wheel diameter in millimeters.
+ */
+float encoder_core_get_wheel_diameter_mm(const encoder_core_t *core) {
+    return core->wheel_diameter_m * 1000.0f;
+}
+
+/**
+ * @brief Sets calibration factor for distance correction.
+ */
+void encoder_core_set_calibration_factor(encoder_core_t *core, float factor) {
+    if (factor > 0.0f) {
+        write_begin(core);
+        core->calibration_factor = factor;
+        update_distance_per_pulse(core);
+        write_end(core);
+    }
+}
+
+/**
+ * @brief Returns current calibration factor.
+ */
+float encoder_core_get_calibration_factor(const encoder_core_t *core) {
+    return core->calibration_factor;
+}
@@ -0,0 +1,67 @@
+#include "encoder_deriv.h"
+#include <string.h>
+
+#define MICRO_PER_UNIT 1000000.0f
+
+/**
+ * @brief Converts base units to saturated integer micro-units.
+ */
+static int32_t to_micro(float value) {
+    float micro = value * MICRO_PER_UNIT;
+    if (micro > 2147483000.0f) return INT32_MAX;
+    if (micro < -2147483000.0f) return -INT32_MAX;
+    return (int32_t)(micro < 0.0f ? micro - 0.5f : micro + 0.5f);
+}
+
+void encoder_deriv_init(encoder_deriv_t *deriv, uint16_t window) {
+    if (window < 2) window = 2;
+    if (window > ENCODER_DERIV_MAX_WINDOW) window = ENCODER_DERIV_MAX_WINDOW;
+    deriv->window = window;
+    encoder_deriv_reset(deriv);
+}
+
+void encoder_deriv_reset(encoder_deriv_t *deriv) {
+    uint16_t window = deriv->window;
+    memset(deriv, 0, sizeof(*deriv));
+    deriv->window = window;
+}
+
+float encoder_deriv_push(encoder_deriv_t *deriv, float value, int64_t timestamp_us) {
+    int32_t v = to_micro(value);
+    int64_t n = deriv->window;
+
+    if (deriv->count == n) {
+        // Drop the oldest (k = 0); every remaining index moves down by one
+        int32_t oldest = deriv->samples[deriv->index];
+        deriv->sum -= oldest;
+        deriv->weighted_sum -= deriv->sum;
+    } else {
+        deriv->count++;
+        n = deriv->count;
+    }
+    deriv->samples[deriv->index] = v;
+    deriv->times_us[deriv->index] = timestamp_us;
+    deriv->weighted_sum += (n - 1) * v;
+    deriv->sum += v;
+
+    uint16_t newest = deriv->index;
+    deriv->index = (uint16_t)((deriv->index + 1) % deriv->window);
+    if (n < 2) {
+        return 0.0f;
+    }
+
+    // Oldest sample sits where the next one will be written once the window is full
+    uint16_t oldest = deriv->count == deriv->window
+        ? deriv->index
+        : (uint16_t)((newest + deriv->window + 1 - n) % deriv->window);
+    int64_t span_us = deriv->times_us[newest] - deriv->times_us[oldest];
+    if (span_us <= 0) {
+        return 0.0f;
+    }
+
+    // Slope per sample: (12 * sum(k v) - 6 (n - 1) sum(v)) / (n (n^2 - 1))
+    int64_t num = 12 * deriv->weighted_sum - 6 * (n - 1) * deriv->sum;
+    int64_t den = n * (n * n - 1);
+    // Per second: divide by the mean sample interval, span / (n - 1)
+    return (float)((double)num * (double)(n - 1) * 1e6 / ((double)den * (double)span_us)) / MICRO_PER_UNIT;
+}
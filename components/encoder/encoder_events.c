@@ -0,0 +1,137 @@
+#include "encoder_events.h"
+#include <math.h>
+
+// Requests posted to the sampler by other tasks
+#define COMMAND_RESTART      (1u << 0)
+#define COMMAND_SET_TARGET   (1u << 1)
+#define COMMAND_CLEAR_TARGET (1u << 2)
+
+void encoder_event_detector_init(encoder_event_detector_t *det, const encoder_event_config_t *config) {
+    det->config = *config;
+    det->primed = false;
+    det->direction = 0;
+    det->turn_pulses = 0;
+    det->last_pulses = 0;
+    det->last_motion_us = 0;
+    det->stalled = true;
+    det->overspeed = false;
+    det->target_armed = false;
+    det->target_side = 0;
+    det->target_um = 0;
+    atomic_store(&det->commands, 0);
+    det->target_pending_um = 0;
+}
+
+void encoder_event_detector_restart(encoder_event_detector_t *det) {
+    atomic_fetch_or_explicit(&det->commands, COMMAND_RESTART, memory_order_release);
+}
+
+void encoder_event_detector_set_target(encoder_event_detector_t *det, int64_t target_um) {
+    det->target_pending_um = target_um;
+    atomic_fetch_or_explicit(&det->commands, COMMAND_SET_TARGET, memory_order_release);
+}
+
+void encoder_event_detector_clear_target(encoder_event_detector_t *det) {
+    atomic_fetch_and_explicit(&det->commands, ~COMMAND_SET_TARGET, memory_order_relaxed);
+    atomic_fetch_or_explicit(&det->commands, COMMAND_CLEAR_TARGET, memory_order_release);
+}
+
+static int8_t side_of(int64_t target_um, int64_t distance_um) {
+    return target_um > distance_um ? 1 : (target_um < distance_um ? -1 : 0);
+}
+
+/**
+ * @brief Applies pending requests; a set wins over a clear posted before it.
+ */
+static void apply_commands(encoder_event_detector_t *det, int64_t distance_um) {
+    unsigned commands = atomic_exchange_explicit(&det->commands, 0, memory_order_acquire);
+    if (commands & COMMAND_RESTART) {
+        det->primed = false;
+    }
+    if (commands & COMMAND_CLEAR_TARGET) {
+        det->target_armed = false;
+    }
+    if (commands & COMMAND_SET_TARGET) {
+        det->target_um = det->target_pending_um;
+        det->target_armed = true;
+    }
+    if (commands & (COMMAND_RESTART | COMMAND_SET_TARGET)) {
+        det->target_side = side_of(det->target_um, distance_um);
+    }
+}
+
+uint32_t encoder_event_detector_update(encoder_event_detector_t *det, int64_t timestamp_us, int64_t pulses,
+                                       int64_t distance_um, float speed_mps) {
+    uint32_t events = 0;
+    apply_commands(det, distance_um);
+
+    if (!det->primed) {
+        det->primed = true;
+        det->direction = 0;
+        det->turn_pulses = pulses;
+        det->last_pulses = pulses;
+        det->last_motion_us = timestamp_us;
+        det->stalled = true;
+    }
+
+    // Direction: a reversal needs the hysteresis in counts back from the turning point
+    if (det->direction >= 0 && pulses > det->turn_pulses) {
+        if (det->direction == 0 && pulses - det->turn_pulses >= ENCODER_EVENT_DIRECTION_HYSTERESIS) {
+            det->direction = 1;
+        }
+        if (det->direction == 1) det->turn_pulses = pulses;
+    } else if (det->direction <= 0 && pulses < det->turn_pulses) {
+        if (det->direction == 0 && det->turn_pulses - pulses >= ENCODER_EVENT_DIRECTION_HYSTERESIS) {
+            det->direction = -1;
+        }
+        if (det->direction == -1) det->turn_pulses = pulses;
+    } else if (det->direction == 1 && det->turn_pulses - pulses >= ENCODER_EVENT_DIRECTION_HYSTERESIS) {
+        det->direction = -1;
+        det->turn_pulses = pulses;
+        events |= ENCODER_EVENT_DIRECTION;
+    } else if (det->direction == -1 && pulses - det->turn_pulses >= ENCODER_EVENT_DIRECTION_HYSTERESIS) {
+        det->direction = 1;
+        det->turn_pulses = pulses;
+        events |= ENCODER_EVENT_DIRECTION;
+    }
+
+    // Stall: fires once after motion stops for stall_ms
+    if (pulses != det->last_pulses) {
+        det->last_pulses = pulses;
+        det->last_motion_us = timestamp_us;
+        det->stalled = false;
+    } else if (!det->stalled && det->config.stall_ms > 0 &&
+               timestamp_us - det->last_motion_us >= (int64_t)det->config.stall_ms * 1000) {
+        det->stalled = true;
+        events |= ENCODER_EVENT_STALL;
+    }
+
+    // Overspeed with hysteresis
+    float limit = det->config.overspeed_mps;
+    float speed = fabsf(speed_mps);
+    if (limit > 0.0f && !det->overspeed && speed > limit) {
+        det->overspeed = true;
+        events |= ENCODER_EVENT_OVERSPEED;
+    } else if (det->overspeed && (limit <= 0.0f || speed < limit * ENCODER_EVENT_OVERSPEED_REARM)) {
+        det->overspeed = false;
+    }
+
+    // Target: reached or crossed from the side it was armed on
+    if (det->target_armed &&
+        (det->target_side == 0 || side_of(det->target_um, distance_um) != det->target_side)) {
+        det->target_armed = false;
+        events |= ENCODER_EVENT_TARGET;
+    }
+
+    return events;
+}
+
+const char *encoder_event_name(encoder_event_type_t type) {
+    switch (type) {
+        case ENCODER_EVENT_DIRECTION: return "direction";
+        case ENCODER_EVENT_STALL:     return "stall";
+        case ENCODER_EVENT_OVERSPEED: return "overspeed";
+        case ENCODER_EVENT_TARGET:    return "target";
+        default:                      return "unknown";
+    }
+}
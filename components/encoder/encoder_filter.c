@@ -0,0 +1,197 @@
+#include "encoder_filter.h"
+#include <string.h>
+
+#define UM_PER_M 1000000.0f
+
+static const char *const type_names[] = {
+    [ENCODER_FILTER_NONE]           = "none",
+    [ENCODER_FILTER_MOVING_AVERAGE] = "ma",
+    [ENCODER_FILTER_EMA]            = "ema",
+    [ENCODER_FILTER_ALPHA_BETA]     = "alpha_beta",
+    [ENCODER_FILTER_KALMAN]         = "kalman",
+};
+
+/**
+ * @brief Converts m/s to saturated integer micrometres per second.
+ */
+static int32_t to_um(float mps) {
+    float um = mps * UM_PER_M;
+    if (um > 2147483000.0f) return INT32_MAX;
+    if (um < -2147483000.0f) return -INT32_MAX;
+    return (int32_t)(um < 0.0f ? um - 0.5f : um + 0.5f);
+}
+
+encoder_filter_config_t encoder_filter_default_config(void) {
+    encoder_filter_config_t config = {
+        .type = ENCODER_FILTER_NONE,
+        .window = 8,
+        .alpha = 0.2f,
+        .beta = 0.02f,
+        .process_noise = 1.0f,
+        .measurement_noise = 0.01f,
+    };
+    return config;
+}
+
+void encoder_filter_init(encoder_filter_t *filter, const encoder_filter_config_t *config) {
+    filter->config = config ? *config : encoder_filter_default_config();
+    if (!config) {
+        filter->config.type = ENCODER_FILTER_NONE;
+    }
+
+    encoder_filter_config_t *c = &filter->config;
+    if ((unsigned)c->type > ENCODER_FILTER_KALMAN) c->type = ENCODER_FILTER_NONE;
+    if (c->window < 1) c->window = 1;
+    if (c->window > ENCODER_FILTER_MAX_WINDOW) c->window = ENCODER_FILTER_MAX_WINDOW;
+    if (!(c->alpha > 0.0f)) c->alpha = 0.01f;
+    if (c->alpha > 1.0f) c->alpha = 1.0f;
+    if (!(c->beta >= 0.0f)) c->beta = 0.0f;
+    if (c->beta > 2.0f) c->beta = 2.0f;
+    if (!(c->process_noise > 0.0f)) c->process_noise = 1e-6f;
+    if (!(c->measurement_noise > 0.0f)) c->measurement_noise = 1e-9f;
+
+    encoder_filter_reset(filter);
+}
+
+void encoder_filter_reset(encoder_filter_t *filter) {
+    filter->primed = 0;
+    switch (filter->config.type) {
+    case ENCODER_FILTER_MOVING_AVERAGE:
+        memset(&filter->ma, 0, sizeof(filter->ma));
+        break;
+    case ENCODER_FILTER_EMA:
+        filter->ema.alpha_q16 = (int32_t)(filter->config.alpha * 65536.0f + 0.5f);
+        filter->ema.value_q16 = 0;
+        break;
+    case ENCODER_FILTER_ALPHA_BETA:
+        filter->ab.speed = 0.0f;
+        filter->ab.accel = 0.0f;
+        break;
+    case ENCODER_FILTER_KALMAN:
+        filter->kf.speed = 0.0f;
+        filter->kf.accel = 0.0f;
+        filter->kf.p00 = filter->config.measurement_noise;
+        filter->kf.p01 = 0.0f;
+        filter->kf.p11 = 1.0f;
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Fixed-window mean with an O(1) integer running sum.
+ */
+static float apply_moving_average(encoder_filter_t *f, float raw) {
+    int32_t um = to_um(raw);
+    uint16_t window = f->config.window;
+    if (f->ma.count == window) {
+        f->ma.sum -= f->ma.samples[f->ma.index];
+    } else {
+        f->ma.count++;
+    }
+    f->ma.samples[f->ma.index] = um;
+    f->ma.sum += um;
+    f->ma.index = (uint16_t)((f->ma.index + 1) % window);
+    return (float)(f->ma.sum / f->ma.count) / UM_PER_M;
+}
+
+/**
+ * @brief y += alpha * (x - y) on Q16 micrometres per second.
+ */
+static float apply_ema(encoder_filter_t *f, float raw) {
+    int64_t x_q16 = (int64_t)to_um(raw) << 16;
+    if (!f->primed) {
+        f->ema.value_q16 = x_q16;
+    } else {
+        f->ema.value_q16 += ((x_q16 - f->ema.value_q16) * f->ema.alpha_q16) >> 16;
+    }
+    return (float)(f->ema.value_q16 >> 16) / UM_PER_M;
+}
+
+/**
+ * @brief Predicts with the tracked acceleration and corrects both states by the residual.
+ */
+static float apply_alpha_beta(encoder_filter_t *f, float raw, float dt) {
+    if (!f->primed) {
+        f->ab.speed = raw;
+        f->ab.accel = 0.0f;
+        return raw;
+    }
+    float predicted = f->ab.speed + f->ab.accel * dt;
+    float residual = raw - predicted;
+    f->ab.speed = predicted + f->config.alpha * residual;
+    f->ab.accel += f->config.beta * residual / dt;
+    return f->ab.speed;
+}
+
+/**
+ * @brief Constant-acceleration Kalman filter with white-jerk process noise.
+ */
+static float apply_kalman(encoder_filter_t *f, float raw, float dt) {
+    if (!f->primed) {
+        f->kf.speed = raw;
+        return raw;
+    }
+    float q = f->config.process_noise;
+    float r = f->config.measurement_noise;
+
+    // Predict: x = F x, P = F P F' + Q with F = [1 dt; 0 1]
+    f->kf.speed += f->kf.accel * dt;
+    float p00 = f->kf.p00 + dt * (2.0f * f->kf.p01 + dt * f->kf.p11) + q * dt * dt * dt / 3.0f;
+    float p01 = f->kf.p01 + dt * f->kf.p11 + q * dt * dt / 2.0f;
+    float p11 = f->kf.p11 + q * dt;
+
+    // Update with H = [1 0]
+    float s = p00 + r;
+    float k0 = p00 / s;
+    float k1 = p01 / s;
+    float residual = raw - f->kf.speed;
+    f->kf.speed += k0 * residual;
+    f->kf.accel += k1 * residual;
+    f->kf.p00 = (1.0f - k0) * p00;
+    f->kf.p01 = (1.0f - k0) * p01;
+    f->kf.p11 = p11 - k1 * p01;
+    return f->kf.speed;
+}
+
+float encoder_filter_apply(encoder_filter_t *filter, float raw_mps, float dt_s) {
+    if (!(dt_s > 0.0f)) {
+        dt_s = 1e-3f;
+    }
+    float out;
+    switch (filter->config.type) {
+    case ENCODER_FILTER_MOVING_AVERAGE: out = apply_moving_average(filter, raw_mps); break;
+    case ENCODER_FILTER_EMA:            out = apply_ema(filter, raw_mps); break;
+    case ENCODER_FILTER_ALPHA_BETA:     out = apply_alpha_beta(filter, raw_mps, dt_s); break;
+    case ENCODER_FILTER_KALMAN:         out = apply_kalman(filter, raw_mps, dt_s); break;
+    default:                            out = raw_mps; break;
+    }
+    filter->primed = 1;
+    return out;
+}
+
+float encoder_filter_get_accel(const encoder_filter_t *filter) {
+    switch (filter->config.type) {
+    case ENCODER_FILTER_ALPHA_BETA: return filter->ab.accel;
+    case ENCODER_FILTER_KALMAN:     return filter->kf.accel;
+    default:                        return 0.0f;
+    }
+}
+
+const char *encoder_filter_type_name(encoder_filter_type_t type) {
+    if ((unsigned)type > ENCODER_FILTER_KALMAN) {
+        return "none";
+    }
+    return type_names[type];
+}
+
+int encoder_filter_type_from_name(const char *name, encoder_filter_type_t *out) {
+    for (unsigned i = 0; i <= ENCODER_FILTER_KALMAN; i++) {
+        if (strcmp(name, type_names[i]) == 0) {
+            *out = (encoder_filter_type_t)i;
+            return 0;
+        }
+    }
+    return -1;
+}
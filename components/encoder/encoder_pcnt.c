@@ -0,0 +1,369 @@
+#include "encoder_pcnt.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "metrics.h"
+#include "freertos/FreeRTOS.h"
+
+#define TAG "ENCODER_PCNT"
+
+// Serializes core writers: the watch-point ISR and task-side reset
+static portMUX_TYPE s_writer_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief Pulse counter event callback for high/low limit overflow handling.
+ */
+static bool IRAM_ATTR pcnt_on_reach(pcnt_unit_handle_t unit, const pcnt_watch_event_data_t *edata, void *user_ctx) {
+    METRICS_START(start);
+    encoder_core_on_watch_point((encoder_core_t *)user_ctx, edata->watch_point_value);
+    METRICS_STOP(METRIC_PCNT_ISR, start);
+    return true;
+}
+
+/**
+ * @brief Phase A edge interrupt: timestamps the edge for the period estimator.
+ */
+static void IRAM_ATTR phase_a_edge_isr(void *arg) {
+    encoder_pcnt_t *pcnt = arg;
+    encoder_core_on_edge(pcnt->core, esp_timer_get_time());
+}
+
+/**
+ * @brief Index (Z) rising edge: latches the count in the core.
+ */
+static void IRAM_ATTR index_isr(void *arg) {
+    encoder_pcnt_t *pcnt = arg;
+    encoder_core_on_index(pcnt->core, esp_timer_get_time());
+}
+
+static int pcnt_backend_get_count(void *ctx) {
+    int count = 0;
+    pcnt_unit_get_count(((encoder_pcnt_t *)ctx)->unit, &count);
+    return count;
+}
+
+static int64_t pcnt_backend_now_us(void *ctx) {
+    return esp_timer_get_time();
+}
+
+static void IRAM_ATTR pcnt_backend_lock(void *ctx) {
+    portENTER_CRITICAL_SAFE(&s_writer_lock);
+}
+
+static void IRAM_ATTR pcnt_backend_unlock(void *ctx) {
+    portEXIT_CRITICAL_SAFE(&s_writer_lock);
+}
+
+static void pcnt_backend_set_edge_capture(void *ctx, bool enable) {
+    encoder_pcnt_t *pcnt = ctx;
+    pcnt->edge_capture = enable;
+    if (enable) {
+        gpio_intr_enable(pcnt->config.pin_a);
+    } else {
+        gpio_intr_disable(pcnt->config.pin_a);
+    }
+}
+
+static int pcnt_backend_add_watch(void *ctx, int value) {
+    return pcnt_unit_add_watch_point(((encoder_pcnt_t *)ctx)->unit, value) == ESP_OK ? 0 : -1;
+}
+
+static void pcnt_backend_remove_watch(void *ctx, int value) {
+    pcnt_unit_remove_watch_point(((encoder_pcnt_t *)ctx)->unit, value);
+}
+
+/**
+ * @brief Adds or removes the limit watch points; the unit resets at its limits either way.
+ */
+static void pcnt_backend_set_limit_irq(void *ctx, bool enable) {
+    pcnt_unit_handle_t unit = ((encoder_pcnt_t *)ctx)->unit;
+    if (enable) {
+        pcnt_unit_add_watch_point(unit, ENCODER_CORE_HIGH_LIMIT);
+        pcnt_unit_add_watch_point(unit, ENCODER_CORE_LOW_LIMIT);
+    } else {
+        pcnt_unit_remove_watch_point(unit, ENCODER_CORE_HIGH_LIMIT);
+        pcnt_unit_remove_watch_point(unit, ENCODER_CORE_LOW_LIMIT);
+    }
+}
+
+// Kept in DRAM: the lock entries are dereferenced from the watch-point ISR
+DRAM_ATTR const encoder_backend_t encoder_pcnt_backend = {
+    .get_count   = pcnt_backend_get_count,
+    .now_us      = pcnt_backend_now_us,
+    .lock        = pcnt_backend_lock,
+    .unlock      = pcnt_backend_unlock,
+    .set_edge_capture = pcnt_backend_set_edge_capture,
+    .add_watch   = pcnt_backend_add_watch,
+    .remove_watch = pcnt_backend_remove_watch,
+    .set_limit_irq = pcnt_backend_set_limit_irq,
+};
+
+static bool config_valid(const encoder_pcnt_config_t *config) {
+    if (!GPIO_IS_VALID_GPIO(config->pin_a) || !GPIO_IS_VALID_GPIO(config->pin_b) || config->pin_a == config->pin_b) {
+        return false;
+    }
+    if (config->pin_z != GPIO_NUM_NC &&
+        (!GPIO_IS_VALID_GPIO(config->pin_z) || config->pin_z == config->pin_a || config->pin_z == config->pin_b)) {
+        return false;
+    }
+    if (config->count_mode != ENCODER_COUNT_X1 && config->count_mode != ENCODER_COUNT_X2 &&
+        config->count_mode != ENCODER_COUNT_X4) {
+        return false;
+    }
+    return config->glitch_filter_ns <= ENCODER_PCNT_GLITCH_MAX_NS;
+}
+
+/**
+ * @brief Applies the glitch filter width; the unit must be disabled.
+ */
+static esp_err_t apply_glitch_filter(pcnt_unit_handle_t unit, uint32_t glitch_filter_ns) {
+    pcnt_glitch_filter_config_t filter_config = {
+        .max_glitch_ns = glitch_filter_ns,
+    };
+    // A NULL config disables the filter
+    return pcnt_unit_set_glitch_filter(unit, glitch_filter_ns ? &filter_config : NULL);
+}
+
+/**
+ * @brief Creates the decoding channels; the unit must be disabled.
+ *
+ * x4: A edge / B level plus B edge / A level. x2: channel A only, both
+ * edges. x1: channel A only, rising edge. Inversion swaps increase and
+ * decrease on every edge action.
+ */
+static esp_err_t create_channels(encoder_pcnt_t *pcnt, const encoder_pcnt_config_t *config) {
+    pcnt_channel_edge_action_t up = config->invert ? PCNT_CHANNEL_EDGE_ACTION_DECREASE : PCNT_CHANNEL_EDGE_ACTION_INCREASE;
+    pcnt_channel_edge_action_t down = config->invert ? PCNT_CHANNEL_EDGE_ACTION_INCREASE : PCNT_CHANNEL_EDGE_ACTION_DECREASE;
+
+    // Channel A configuration
+    pcnt_chan_config_t chan_a = {
+        .edge_gpio_num = config->pin_a,
+        .level_gpio_num = config->pin_b,
+    };
+    ESP_RETURN_ON_ERROR(pcnt_new_channel(pcnt->unit, &chan_a, &pcnt->chan_a), TAG, "channel A");
+    pcnt_channel_edge_action_t fall = config->count_mode == ENCODER_COUNT_X1 ? PCNT_CHANNEL_EDGE_ACTION_HOLD : down;
+    ESP_RETURN_ON_ERROR(pcnt_channel_set_edge_action(pcnt->chan_a, up, fall), TAG, "channel A edge");
+    ESP_RETURN_ON_ERROR(pcnt_channel_set_level_action(pcnt->chan_a, PCNT_CHANNEL_LEVEL_ACTION_KEEP, PCNT_CHANNEL_LEVEL_ACTION_INVERSE), TAG, "channel A level");
+
+    if (config->count_mode != ENCODER_COUNT_X4) {
+        pcnt->chan_b = NULL;
+        return ESP_OK;
+    }
+
+    // Channel B configuration
+    pcnt_chan_config_t chan_b = {
+        .edge_gpio_num = config->pin_b,
+        .level_gpio_num = config->pin_a,
+    };
+    ESP_RETURN_ON_ERROR(pcnt_new_channel(pcnt->unit, &chan_b, &pcnt->chan_b), TAG, "channel B");
+    ESP_RETURN_ON_ERROR(pcnt_channel_set_edge_action(pcnt->chan_b, up, down), TAG, "channel B edge");
+    ESP_RETURN_ON_ERROR(pcnt_channel_set_level_action(pcnt->chan_b, PCNT_CHANNEL_LEVEL_ACTION_INVERSE, PCNT_CHANNEL_LEVEL_ACTION_KEEP), TAG, "channel B level");
+    return ESP_OK;
+}
+
+static void delete_channels(encoder_pcnt_t *pcnt) {
+    if (pcnt->chan_a) {
+        pcnt_del_channel(pcnt->chan_a);
+        pcnt->chan_a = NULL;
+    }
+    if (pcnt->chan_b) {
+        pcnt_del_channel(pcnt->chan_b);
+        pcnt->chan_b = NULL;
+    }
+}
+
+/**
+ * @brief Installs the phase A edge and index interrupts.
+ *
+ * Edge timestamps on phase A feed the period estimator; the GPIO matrix lets
+ * the pin feed PCNT and raise its own interrupt at the same time.
+ */
+static esp_err_t attach_pin_interrupts(encoder_pcnt_t *pcnt, const encoder_pcnt_config_t *config) {
+    gpio_int_type_t edge_type = config->count_mode == ENCODER_COUNT_X1 ? GPIO_INTR_POSEDGE : GPIO_INTR_ANYEDGE;
+    ESP_RETURN_ON_ERROR(gpio_set_intr_type(config->pin_a, edge_type), TAG, "edge intr type");
+    ESP_RETURN_ON_ERROR(gpio_isr_handler_add(config->pin_a, phase_a_edge_isr, pcnt), TAG, "edge isr");
+    if (pcnt->edge_capture) {
+        gpio_intr_enable(config->pin_a);
+    } else {
+        gpio_intr_disable(config->pin_a);
+    }
+
+    if (config->pin_z != GPIO_NUM_NC) {
+        gpio_config_t z_config = {
+            .pin_bit_mask = 1ULL << config->pin_z,
+            .mode = GPIO_MODE_INPUT,
+            .pull_up_en = GPIO_PULLUP_ENABLE,
+            .intr_type = GPIO_INTR_POSEDGE,
+        };
+        esp_err_t err = gpio_config(&z_config);
+        if (err == ESP_OK) {
+            err = gpio_isr_handler_add(config->pin_z, index_isr, pcnt);
+        }
+        if (err != ESP_OK) {
+            // Leave nothing half attached: the caller only detaches what succeeded
+            gpio_intr_disable(config->pin_a);
+            gpio_isr_handler_remove(config->pin_a);
+            ESP_LOGE(TAG, "index pin %d: %s", config->pin_z, esp_err_to_name(err));
+            return err;
+        }
+    }
+    pcnt->pins_attached = true;
+    return ESP_OK;
+}
+
+static void detach_pin_interrupts(encoder_pcnt_t *pcnt) {
+    if (!pcnt->pins_attached) {
+        return;
+    }
+    pcnt->pins_attached = false;
+    gpio_intr_disable(pcnt->config.pin_a);
+    gpio_isr_handler_remove(pcnt->config.pin_a);
+    if (pcnt->config.pin_z != GPIO_NUM_NC) {
+        gpio_intr_disable(pcnt->config.pin_z);
+        gpio_isr_handler_remove(pcnt->config.pin_z);
+    }
+}
+
+/**
+ * @brief Builds, starts and wires up the unit; stops at the first error.
+ *
+ * Whatever was created before the error stays in the context for
+ * encoder_pcnt_deinit() to release.
+ */
+static esp_err_t start_unit(encoder_pcnt_t *pcnt) {
+    pcnt_unit_config_t unit_config = {
+        .high_limit = ENCODER_CORE_HIGH_LIMIT,
+        .low_limit = ENCODER_CORE_LOW_LIMIT,
+    };
+    ESP_RETURN_ON_ERROR(pcnt_new_unit(&unit_config, &pcnt->unit), TAG, "new unit");
+    pcnt_unit_handle_t unit = pcnt->unit;
+    ESP_RETURN_ON_ERROR(apply_glitch_filter(unit, pcnt->config.glitch_filter_ns), TAG, "glitch filter");
+    ESP_RETURN_ON_ERROR(create_channels(pcnt, &pcnt->config), TAG, "channels");
+
+    // Add overflow watchpoints; the sampler drops them again while the count moves slowly
+    ESP_RETURN_ON_ERROR(pcnt_unit_add_watch_point(unit, ENCODER_CORE_HIGH_LIMIT), TAG, "high watch point");
+    ESP_RETURN_ON_ERROR(pcnt_unit_add_watch_point(unit, ENCODER_CORE_LOW_LIMIT), TAG, "low watch point");
+
+    // Register callback
+    pcnt_event_callbacks_t cbs = {
+        .on_reach = pcnt_on_reach,
+    };
+    ESP_RETURN_ON_ERROR(pcnt_unit_register_event_callbacks(unit, &cbs, pcnt->core), TAG, "callbacks");
+
+    // Enable and start the unit
+    ESP_RETURN_ON_ERROR(pcnt_unit_enable(unit), TAG, "enable");
+    ESP_RETURN_ON_ERROR(pcnt_unit_clear_count(unit), TAG, "clear");
+    ESP_RETURN_ON_ERROR(pcnt_unit_start(unit), TAG, "start");
+
+    esp_err_t err = gpio_install_isr_service(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {   // already installed (e.g. by button.c)
+        return err;
+    }
+    return attach_pin_interrupts(pcnt, &pcnt->config);
+}
+
+/**
+ * @brief Configures a PCNT unit with the channels of the selected decoding mode.
+ */
+esp_err_t encoder_pcnt_init(encoder_pcnt_t *pcnt, const encoder_pcnt_config_t *config, encoder_core_t *core) {
+    if (!config_valid(config)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pcnt->config = *config;
+    pcnt->unit = NULL;
+    pcnt->chan_a = NULL;
+    pcnt->chan_b = NULL;
+    pcnt->edge_capture = false;
+    pcnt->pins_attached = false;
+    pcnt->core = core;
+
+    esp_err_t err = start_unit(pcnt);
+    if (err != ESP_OK) {
+        encoder_pcnt_deinit(pcnt);
+    }
+    return err;
+}
+
+/**
+ * @brief Releases the pin interrupts, channels and unit, in reverse order of creation.
+ *
+ * Works on a partly built context: stopping or disabling a unit that never
+ * got that far fails harmlessly, and NULL handles are skipped.
+ */
+void encoder_pcnt_deinit(encoder_pcnt_t *pcnt) {
+    detach_pin_interrupts(pcnt);
+    if (!pcnt->unit) {
+        return;
+    }
+    pcnt_unit_stop(pcnt->unit);
+    pcnt_unit_disable(pcnt->unit);
+    delete_channels(pcnt);
+    pcnt_unit_remove_watch_point(pcnt->unit, ENCODER_CORE_HIGH_LIMIT);
+    pcnt_unit_remove_watch_point(pcnt->unit, ENCODER_CORE_LOW_LIMIT);
+    pcnt_del_unit(pcnt->unit);
+    pcnt->unit = NULL;
+}
+
+/**
+ * @brief Tears down the channels and pin interrupts of a stopped unit and builds them for config.
+ *
+ * Also recovers from a previous failed attempt: stopping or disabling a unit
+ * that is already stopped or disabled fails harmlessly. pcnt->config is only
+ * replaced once everything is in place.
+ */
+static esp_err_t rebuild_channels(encoder_pcnt_t *pcnt, const encoder_pcnt_config_t *config) {
+    detach_pin_interrupts(pcnt);
+    pcnt_unit_stop(pcnt->unit);
+    pcnt_unit_disable(pcnt->unit);
+    delete_channels(pcnt);
+    ESP_RETURN_ON_ERROR(apply_glitch_filter(pcnt->unit, config->glitch_filter_ns), TAG, "glitch filter");
+    ESP_RETURN_ON_ERROR(create_channels(pcnt, config), TAG, "channels");
+    ESP_RETURN_ON_ERROR(pcnt_unit_enable(pcnt->unit), TAG, "enable");
+    ESP_RETURN_ON_ERROR(pcnt_unit_start(pcnt->unit), TAG, "start");
+    ESP_RETURN_ON_ERROR(attach_pin_interrupts(pcnt, config), TAG, "pin interrupts");
+    pcnt->config = *config;
+    return ESP_OK;
+}
+
+/**
+ * @brief Rebuilds the channels for new pins or decoding: stop, fold, rebuild, restart.
+ *
+ * On failure the previous configuration and count mode are put back.
+ */
+esp_err_t encoder_pcnt_reconfigure(encoder_pcnt_t *pcnt, const encoder_pcnt_config_t *config) {
+    if (!config_valid(config)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ESP_RETURN_ON_ERROR(pcnt_unit_stop(pcnt->unit), TAG, "stop");
+    // The count is frozen: fold it at the old scale before the decoding changes
+    encoder_count_mode_t previous_mode = encoder_core_get_count_mode(pcnt->core);
+    encoder_core_set_count_mode(pcnt->core, config->count_mode);
+
+    encoder_pcnt_config_t previous = pcnt->config;
+    esp_err_t err = rebuild_channels(pcnt, config);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Reconfigure failed (%s), restoring the previous setup", esp_err_to_name(err));
+        pcnt_unit_stop(pcnt->unit);     // freeze the count again for the fold back
+        encoder_core_set_count_mode(pcnt->core, previous_mode);
+        if (rebuild_channels(pcnt, &previous) != ESP_OK) {
+            ESP_LOGE(TAG, "Restore failed: channel on A=%d is not counting", previous.pin_a);
+        }
+        return err;
+    }
+
+    ESP_LOGI(TAG, "Reconfigured: A=%d B=%d Z=%d x%d%s, glitch %u ns", config->pin_a, config->pin_b, config->pin_z,
+             config->count_mode, config->invert ? " inverted" : "", (unsigned)config->glitch_filter_ns);
+    return ESP_OK;
+}
+
+/**
+ * @brief Reconfigures the glitch filter only.
+ */
+esp_err_t encoder_pcnt_set_glitch_filter(encoder_pcnt_t *pcnt, uint32_t glitch_filter_ns) {
+    if (glitch_filter_ns == pcnt->config.glitch_filter_ns) {
+        return ESP_OK;
+    }
+    encoder_pcnt_config_t config = pcnt->config;
+    config.glitch_filter_ns = glitch_filter_ns;
+    return encoder_pcnt_reconfigure(pcnt, &config);
+}
@@ -0,0 +1,125 @@
+#include "encoder_ring.h"
+
+#define RING_MASK (ENCODER_RING_CAPACITY - 1)
+
+_Static_assert((ENCODER_RING_CAPACITY & RING_MASK) == 0, "ENCODER_RING_CAPACITY must be a power of two");
+
+/**
+ * @brief Empties the ring.
+ */
+void encoder_ring_init(encoder_ring_t *ring) {
+    for (size_t i = 0; i < ENCODER_RING_CAPACITY; i++) {
+        atomic_store(&ring->slots[i].gen, 0);
+    }
+    atomic_store(&ring->head, 0);
+}
+
+/**
+ * @brief Writes the slot under its generation counter, then publishes the new head.
+ */
+void encoder_ring_push(encoder_ring_t *ring, encoder_sample_t *sample) {
+    uint32_t seq = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    encoder_ring_slot_t *slot = &ring->slots[seq & RING_MASK];
+
+    sample->seq = seq;
+    atomic_fetch_add_explicit(&slot->gen, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    slot->sample = *sample;
+    atomic_fetch_add_explicit(&slot->gen, 1, memory_order_release);
+
+    atomic_store_explicit(&ring->head, seq + 1, memory_order_release);
+}
+
+/**
+ * @brief Sequence number of the oldest sample held, given the current head.
+ *
+ * Sequence numbers wrap at 2^32, so the head alone cannot tell a ring that
+ * has not filled yet from one that wrapped: the slot the producer writes next
+ * has a non-zero generation once it has been written before.
+ */
+static uint32_t oldest_seq(const encoder_ring_t *ring, uint32_t head) {
+    encoder_ring_slot_t *next = (encoder_ring_slot_t *)&ring->slots[head & RING_MASK];
+    if (atomic_load_explicit(&next->gen, memory_order_relaxed) != 0) {
+        return head - ENCODER_RING_CAPACITY;
+    }
+    return 0;   // Not filled yet: everything from the first push is held
+}
+
+void encoder_ring_cursor_init(const encoder_ring_t *ring, encoder_ring_cursor_t *cursor) {
+    cursor->next = atomic_load_explicit(&((encoder_ring_t *)ring)->head, memory_order_acquire);
+    cursor->dropped = 0;
+}
+
+void encoder_ring_cursor_oldest(const encoder_ring_t *ring, encoder_ring_cursor_t *cursor) {
+    uint32_t head = atomic_load_explicit(&((encoder_ring_t *)ring)->head, memory_order_acquire);
+    cursor->next = oldest_seq(ring, head);
+    cursor->dropped = 0;
+}
+
+void encoder_ring_cursor_seek(const encoder_ring_t *ring, encoder_ring_cursor_t *cursor, uint32_t seq) {
+    uint32_t head = atomic_load_explicit(&((encoder_ring_t *)ring)->head, memory_order_acquire);
+    uint32_t oldest = oldest_seq(ring, head);
+    cursor->dropped = 0;
+    if ((int32_t)(head - seq) < 0) {
+        cursor->next = oldest;
+    } else if (head - seq > head - oldest) {
+        cursor->next = oldest;
+        cursor->dropped = oldest - seq;
+    } else {
+        cursor->next = seq;
+    }
+}
+
+/**
+ * @brief Copies one slot if it still holds the wanted sample.
+ *
+ * @return int 1 on success, 0 if the producer overwrote or is overwriting it
+ */
+static int read_slot(const encoder_ring_t *ring, uint32_t seq, encoder_sample_t *out) {
+    encoder_ring_slot_t *slot = (encoder_ring_slot_t *)&ring->slots[seq & RING_MASK];
+    unsigned begin = atomic_load_explicit(&slot->gen, memory_order_acquire);
+    if (begin & 1u) {
+        return 0;
+    }
+    *out = slot->sample;
+    atomic_thread_fence(memory_order_acquire);
+    unsigned end = atomic_load_explicit(&slot->gen, memory_order_relaxed);
+    return begin == end && out->seq == seq;
+}
+
+size_t encoder_ring_read(const encoder_ring_t *ring, encoder_ring_cursor_t *cursor, encoder_sample_t *out, size_t max) {
+    size_t n = 0;
+    while (n < max) {
+        uint32_t head = atomic_load_explicit(&((encoder_ring_t *)ring)->head, memory_order_acquire);
+        if (cursor->next == head) {
+            break;
+        }
+        if (head - cursor->next > ENCODER_RING_CAPACITY) {
+            // Fell behind: skip to the oldest sample still held
+            cursor->dropped += head - ENCODER_RING_CAPACITY - cursor->next;
+            cursor->next = head - ENCODER_RING_CAPACITY;
+        }
+        if (read_slot(ring, cursor->next, &out[n])) {
+            n++;
+            cursor->next++;
+        } else {
+            // Overwritten while reading; the next pass re-evaluates head and skips
+            cursor->next++;
+            cursor->dropped++;
+        }
+    }
+    return n;
+}
+
+int encoder_ring_latest(const encoder_ring_t *ring, encoder_sample_t *out) {
+    for (;;) {
+        uint32_t head = atomic_load_explicit(&((encoder_ring_t *)ring)->head, memory_order_acquire);
+        encoder_ring_slot_t *last = (encoder_ring_slot_t *)&ring->slots[(head - 1) & RING_MASK];
+        if (atomic_load_explicit(&last->gen, memory_order_relaxed) == 0) {
+            return 0;   // Nothing pushed yet; head == 0 is also reached again when the sequence wraps
+        }
+        if (read_slot(ring, head - 1, out)) {
+            return 1;
+        }
+    }
+}
@@ -1,7 +1,255 @@
 #pragma once
 
 #include "driver/gpio.h"
+#include "esp_err.h"
 #include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "encoder_core.h"
+#include "encoder_ring.h"
+#include "encoder_events.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+#define ENCODER_SAMPLE_RATE_MIN_HZ 1
+#define ENCODER_SAMPLE_RATE_MAX_HZ 1000
+
+#ifndef ENCODER_MAX_CHANNELS
+#define ENCODER_MAX_CHANNELS 8          ///< One PCNT unit per channel (8 on the ESP32)
+#endif
+
+/**
+ * @brief Handle of one encoder channel.
+ */
+typedef struct encoder_channel *encoder_handle_t;
+
+#define ENCODER_GLITCH_FILTER_DEFAULT_NS 1000   ///< Rejects pulses shorter than 1 us
+
+#ifndef ENCODER_EVENT_MAX_SUBSCRIBERS
+#define ENCODER_EVENT_MAX_SUBSCRIBERS 8
+#endif
+
+/**
+ * @brief Event callback; runs on the sampling task and must not block.
+ */
+typedef void (*encoder_event_cb_t)(const encoder_event_t *event, void *arg);
+
+/**
+ * @brief Sampling rate and the task that runs the sampling passes.
+ */
+typedef struct {
+    uint32_t rate_hz;                   ///< Clamped to ENCODER_SAMPLE_RATE_MIN_HZ..ENCODER_SAMPLE_RATE_MAX_HZ
+    BaseType_t core;                    ///< Core the task is pinned to, tskNO_AFFINITY to float
+    UBaseType_t priority;
+    uint32_t stack_size;
+} encoder_sampler_config_t;
+
+#define ENCODER_SAMPLER_CONFIG_DEFAULT(rate) { \
+    .rate_hz = (rate),                          \
+    .core = 1,                                  \
+    .priority = configMAX_PRIORITIES - 5,       \
+    .stack_size = 4096,                         \
+}
+
+/**
+ * @brief Timing of the sampling passes, to compare task layouts.
+ *
+ * Interval jitter is the deviation of the time between two passes from the
+ * period; wake latency is the delay from the timer firing to the pass starting.
+ */
+typedef struct {
+    uint32_t rate_hz;
+    int core;                           ///< Core the task runs on, -1 if floating
+    uint32_t passes;
+    int32_t interval_min_us;
+    int32_t interval_max_us;
+    uint32_t jitter_mean_us;            ///< Mean |interval - period|
+    uint32_t jitter_max_us;             ///< Largest |interval - period|
+    uint32_t wake_latency_mean_us;
+    uint32_t wake_latency_max_us;
+    uint32_t run_mean_us;               ///< Duration of one pass over all channels
+    uint32_t run_max_us;
+    uint32_t overruns;                  ///< Timer ticks that fired while a pass was still running
+} encoder_sampler_stats_t;
+
+/**
+ * @brief Noise rejection: hardware glitch filter and software plausibility limits.
+ */
+typedef struct {
+    uint32_t glitch_filter_ns;          ///< PCNT glitch filter width (0 = off, max ENCODER_PCNT_GLITCH_MAX_NS)
+    encoder_plausibility_t plausibility; ///< Speed / acceleration limits (0 = check off)
+} encoder_noise_config_t;
+
+/**
+ * @brief Hardware target-distance trigger.
+ */
+typedef struct {
+    int64_t target_um;                  ///< Calibrated distance to fire at
+    gpio_num_t output_pin;              ///< Set to output_level on fire, GPIO_NUM_NC for none
+    int output_level;                   ///< Output level after firing; the pin idles at the opposite level
+    encoder_trigger_cb_t cb;            ///< Runs in the PCNT ISR after the output is set; may be NULL
+    void *arg;
+} encoder_trigger_config_t;
+
+/**
+ * @brief Pins and decoding of a channel; changeable at runtime.
+ */
+typedef struct {
+    gpio_num_t pin_a;                   ///< GPIO for signal A
+    gpio_num_t pin_b;                   ///< GPIO for signal B
+    gpio_num_t pin_z;                   ///< GPIO for the index pulse, GPIO_NUM_NC if not wired
+    int pulses_per_rev;                 ///< Counts per revolution in x4 decoding (4 x encoder lines)
+    encoder_count_mode_t count_mode;    ///< x1 / x2 / x4 decoding
+    bool invert;                        ///< Reverses the counting direction
+} encoder_counting_t;
+
+/**
+ * @brief Channel configuration for encoder_channel_new().
+ */
+typedef struct {
+    encoder_counting_t counting;        ///< Pins, resolution and decoding
+    float wheel_diameter_mm;            ///< Diameter of the shaft or wheel in millimeters
+    float calibration_factor;           ///< Distance correction factor (<= 0 means 1.0)
+    encoder_speed_mode_t speed_mode;    ///< Speed estimator
+    encoder_noise_config_t noise;       ///< Glitch filter and plausibility limits
+    encoder_event_config_t events;      ///< Stall time and overspeed limit
+} encoder_config_t;
+
+#define ENCODER_CONFIG_DEFAULT(a, b) {  \
+    .counting = {                       \
+        .pin_a = (a),                   \
+        .pin_b = (b),                   \
+        .pin_z = GPIO_NUM_NC,           \
+        .pulses_per_rev = 600,          \
+        .count_mode = ENCODER_COUNT_X4, \
+        .invert = false,                \
+    },                                  \
+    .wheel_diameter_mm = 100.0f,        \
+    .calibration_factor = 1.0f,         \
+    .speed_mode = ENCODER_SPEED_MODE_AUTO, \
+    .noise = { .glitch_filter_ns = ENCODER_GLITCH_FILTER_DEFAULT_NS }, \
+    .events = { .stall_ms = ENCODER_EVENT_DEFAULT_STALL_MS },         \
+}
+
+/**
+ * @brief Creates an encoder channel on its own PCNT unit.
+ *
+ * Channels live for the rest of the program, so handles may be shared freely
+ * between tasks. All channels are sampled by the single timer started with
+ * encoder_start_speed_task(), in one pass per tick; a channel created later
+ * joins on the next tick. The first channel created is the one served by the
+ * single-encoder API below.
+ *
+ * @param config Pins, geometry and estimator
+ * @param out Handle of the new channel
+ * @return ESP_OK, ESP_ERR_INVALID_ARG, ESP_ERR_NO_MEM, or a PCNT/GPIO error
+ */
+esp_err_t encoder_channel_new(const encoder_config_t *config, encoder_handle_t *out);
+
+/**
+ * @brief Returns the number of channels created so far.
+ */
+size_t encoder_channel_count(void);
+
+/**
+ * @brief Returns a channel by creation index.
+ *
+ * @return encoder_handle_t Handle, or NULL if index is out of range
+ */
+encoder_handle_t encoder_channel_get(size_t index);
+
+/**
+ * @brief Returns the creation index of a channel.
+ */
+int encoder_channel_index(encoder_handle_t enc);
+
+/**
+ * @brief Subscribes a callback to encoder events.
+ *
+ * Events are detected by the sampling timer (encoder_start_speed_task()), so
+ * they arrive within one sampling period; the callback runs on the sampling
+ * task and must return quickly. Subscriptions last for the program lifetime.
+ *
+ * @param enc Channel to watch, or NULL for every channel
+ * @param mask ENCODER_EVENT_* bits to deliver
+ * @param cb Callback
+ * @param arg Passed to the callback
+ * @return ESP_OK, ESP_ERR_INVALID_ARG, or ESP_ERR_NO_MEM if ENCODER_EVENT_MAX_SUBSCRIBERS are taken
+ */
+esp_err_t encoder_event_subscribe(encoder_handle_t enc, uint32_t mask, encoder_event_cb_t cb, void *arg);
+
+/**
+ * @brief Subscribes a FreeRTOS queue to encoder events.
+ *
+ * Each event is sent as an encoder_event_t without blocking; create the queue
+ * with that item size. Events that find the queue full are dropped and counted.
+ *
+ * @param enc Channel to watch, or NULL for every channel
+ * @param mask ENCODER_EVENT_* bits to deliver
+ * @param queue Queue of encoder_event_t
+ * @return ESP_OK, ESP_ERR_INVALID_ARG, or ESP_ERR_NO_MEM if ENCODER_EVENT_MAX_SUBSCRIBERS are taken
+ */
+esp_err_t encoder_event_subscribe_queue(encoder_handle_t enc, uint32_t mask, QueueHandle_t queue);
+
+/**
+ * @brief Returns the number of events dropped because a subscriber queue was full.
+ */
+uint32_t encoder_event_dropped(void);
+
+/*
+ * Per-channel API. Each function behaves like its single-encoder counterpart
+ * below (encoder_channel_get_pulses() like encoder_get_pulses() and so on).
+ */
+int64_t encoder_channel_get_pulses(encoder_handle_t enc);
+void encoder_channel_get_snapshot(encoder_handle_t enc, encoder_snapshot_t *out);
+void encoder_channel_reset(encoder_handle_t enc);
+uint32_t encoder_channel_get_reset_count(encoder_handle_t enc);
+void encoder_channel_set_pulses(encoder_handle_t enc, int64_t pulses);
+float encoder_channel_get_distance_m(encoder_handle_t enc);
+int64_t encoder_channel_get_distance_um(encoder_handle_t enc);
+int64_t encoder_channel_pulses_to_um(encoder_handle_t enc, int64_t pulses);
+float encoder_channel_get_speed_mps(encoder_handle_t enc);
+float encoder_channel_get_raw_speed_mps(encoder_handle_t enc);
+float encoder_channel_get_accel_mps2(encoder_handle_t enc);
+float encoder_channel_get_jerk_mps3(encoder_handle_t enc);
+void encoder_channel_set_accel_window(encoder_handle_t enc, uint16_t samples);
+uint16_t encoder_channel_get_accel_window(encoder_handle_t enc);
+void encoder_channel_set_speed_filter(encoder_handle_t enc, const encoder_filter_config_t *config);
+encoder_filter_config_t encoder_channel_get_speed_filter(encoder_handle_t enc);
+void encoder_channel_set_speed_mode(encoder_handle_t enc, encoder_speed_mode_t mode);
+encoder_speed_mode_t encoder_channel_get_speed_mode(encoder_handle_t enc);
+int64_t encoder_channel_get_speed_window_us(encoder_handle_t enc);
+esp_err_t encoder_channel_set_noise_config(encoder_handle_t enc, const encoder_noise_config_t *config);
+encoder_noise_config_t encoder_channel_get_noise_config(encoder_handle_t enc);
+encoder_plausibility_stats_t encoder_channel_get_noise_stats(encoder_handle_t enc);
+void encoder_channel_clear_noise_stats(encoder_handle_t enc);
+encoder_irq_stats_t encoder_channel_get_irq_stats(encoder_handle_t enc);
+void encoder_channel_set_event_config(encoder_handle_t enc, const encoder_event_config_t *config);
+encoder_event_config_t encoder_channel_get_event_config(encoder_handle_t enc);
+void encoder_channel_set_target_um(encoder_handle_t enc, int64_t target_um);
+void encoder_channel_clear_target(encoder_handle_t enc);
+esp_err_t encoder_channel_arm_trigger(encoder_handle_t enc, const encoder_trigger_config_t *config);
+void encoder_channel_disarm_trigger(encoder_handle_t enc);
+encoder_trigger_state_t encoder_channel_get_trigger_state(encoder_handle_t enc);
+void encoder_channel_get_trigger_stats(encoder_handle_t enc, encoder_trigger_stats_t *out);
+esp_err_t encoder_channel_set_counting(encoder_handle_t enc, const encoder_counting_t *counting);
+encoder_counting_t encoder_channel_get_counting(encoder_handle_t enc);
+void encoder_channel_get_index(encoder_handle_t enc, encoder_index_t *out);
+void encoder_channel_home_on_index(encoder_handle_t enc);
+int64_t encoder_channel_get_position(encoder_handle_t enc);
+bool encoder_channel_get_angle_deg(encoder_handle_t enc, float *out_deg);
+void encoder_channel_samples_cursor_init(encoder_handle_t enc, encoder_ring_cursor_t *cursor);
+void encoder_channel_samples_cursor_seek(encoder_handle_t enc, encoder_ring_cursor_t *cursor, uint32_t seq);
+size_t encoder_channel_samples_read(encoder_handle_t enc, encoder_ring_cursor_t *cursor, encoder_sample_t *out, size_t max);
+bool encoder_channel_get_latest_sample(encoder_handle_t enc, encoder_sample_t *out);
+void encoder_channel_set_calibration_factor(encoder_handle_t enc, float factor);
+float encoder_channel_get_calibration_factor(encoder_handle_t enc);
+void encoder_channel_set_wheel_diameter_mm(encoder_handle_t enc, float diameter_mm);
+float encoder_channel_get_wheel_diameter_mm(encoder_handle_t enc);
+
+/*
+ * Single-encoder API, operating on the first channel.
+ */
 
 /**
  * @brief Initializes the encoder with specified GPIO pins for phases A and B.
@@ -16,15 +264,32 @@ void encoder_init(gpio_num_t pin_a, gpio_num_t pin_b, int pulses_per_revolution,
 /**
  * @brief Returns the total number of pulses (with direction).
  * 
- * @return int Current pulse count
+ * @return int64_t Current pulse count
  */
-int encoder_get_pulses(void);
+int64_t encoder_get_pulses(void);
+
+/**
+ * @brief Returns a consistent {pulses, timestamp_us} pair.
+ *
+ * Lock-free and safe to call at high rates from any task; never disables
+ * interrupts.
+ *
+ * @param out Snapshot of the pulse count and the time it was taken
+ */
+void encoder_get_snapshot(encoder_snapshot_t *out);
 
 /**
  * @brief Resets the pulse counter to zero.
  */
 void encoder_reset(void);
 
+/**
+ * @brief Sets the pulse counter, e.g. to restore a saved odometer.
+ *
+ * @param pulses Total pulse count in the current counting mode
+ */
+void encoder_set_pulses(int64_t pulses);
+
 /**
  * @brief Calculates the distance traveled in meters.
  * 
@@ -32,6 +297,23 @@ void encoder_reset(void);
  */
 float encoder_get_distance_m(void);
 
+/**
+ * @brief Returns the distance traveled in micrometres.
+ *
+ * Exact fixed-point counterpart of encoder_get_distance_m() for long runs.
+ * 
+ * @return int64_t Distance traveled in micrometres
+ */
+int64_t encoder_get_distance_um(void);
+
+/**
+ * @brief Converts a pulse count (e.g. of a ring sample) to micrometres.
+ *
+ * @param pulses Pulse count
+ * @return int64_t Calibrated distance in micrometres
+ */
+int64_t encoder_pulses_to_um(int64_t pulses);
+
 /**
  * @brief Calculates speed in meters per second.
  * 
@@ -39,15 +321,317 @@ float encoder_get_distance_m(void);
  */
 float encoder_get_speed_mps(void);
 
+/**
+ * @brief Returns the last speed estimate before filtering.
+ *
+ * @return float Raw speed in meters per second
+ */
+float encoder_get_raw_speed_mps(void);
+
+/**
+ * @brief Returns the acceleration in meters per second squared.
+ *
+ * Least-squares (Savitzky-Golay) slope of the raw speed over the last N
+ * samples, updated in constant time per sample. The value belongs to the
+ * centre of the window, (N - 1) / 2 samples in the past.
+ *
+ * @return float Acceleration in m/s^2
+ */
+float encoder_get_accel_mps2(void);
+
+/**
+ * @brief Returns the jerk in meters per second cubed.
+ *
+ * Least-squares slope of the acceleration over the same window length.
+ *
+ * @return float Jerk in m/s^3
+ */
+float encoder_get_jerk_mps3(void);
+
+/**
+ * @brief Sets the differentiation window for acceleration and jerk.
+ *
+ * Takes effect on the next speed sample and restarts the history.
+ *
+ * @param samples Window length, clamped to 2..ENCODER_DERIV_MAX_WINDOW (default ENCODER_DERIV_DEFAULT_WINDOW)
+ */
+void encoder_set_accel_window(uint16_t samples);
+
+/**
+ * @brief Returns the differentiation window in samples.
+ */
+uint16_t encoder_get_accel_window(void);
+
+/**
+ * @brief Selects the filter between the raw estimate and encoder_get_speed_mps().
+ *
+ * Takes effect on the next speed sample; parameters are clamped to valid ranges.
+ *
+ * @param config Filter type and parameters
+ */
+void encoder_set_speed_filter(const encoder_filter_config_t *config);
+
+/**
+ * @brief Returns the speed filter configuration in effect.
+ */
+encoder_filter_config_t encoder_get_speed_filter(void);
+
 /**
  * @brief Should be called periodically to update the speed.
+ *
+ * Not needed once encoder_start_speed_task() runs the sampling timer.
  */
 void encoder_update_speed(void);
 
 /**
- * @brief Starts a separate FreeRTOS task to calculate speed.
+ * @brief Selects the speed estimator.
+ *
+ * COUNT divides the pulse delta by the sampling window. PERIOD timestamps
+ * phase A edges and divides whole edges by the exact time between them,
+ * which resolves speeds far below one pulse per window. AUTO (default) uses
+ * PERIOD at low pulse rates and COUNT at high rates, where the edge interrupt
+ * would cost too much.
+ *
+ * @param mode Estimator to use
+ */
+void encoder_set_speed_mode(encoder_speed_mode_t mode);
+
+/**
+ * @brief Returns the estimator used for the last speed sample.
+ *
+ * @return encoder_speed_mode_t ENCODER_SPEED_MODE_COUNT or ENCODER_SPEED_MODE_PERIOD
+ */
+encoder_speed_mode_t encoder_get_speed_mode(void);
+
+/**
+ * @brief Returns the time span the last speed sample was measured over.
+ *
+ * @return int64_t Effective measurement window in microseconds
+ */
+int64_t encoder_get_speed_window_us(void);
+
+/**
+ * @brief Configures noise rejection.
+ *
+ * The glitch filter drops pulses narrower than the given width in hardware;
+ * changing it pauses the counter for a few microseconds. The plausibility
+ * limits then flag speed samples that exceed the maximum speed or whose
+ * change implies more than the maximum acceleration; such samples are
+ * clamped and counted, while the pulse count itself is left untouched.
+ *
+ * @param config Glitch filter width and plausibility limits
+ * @return esp_err_t ESP_OK, or ESP_ERR_INVALID_ARG if the glitch width is out of range
+ */
+esp_err_t encoder_set_noise_config(const encoder_noise_config_t *config);
+
+/**
+ * @brief Returns the noise rejection configuration.
+ */
+encoder_noise_config_t encoder_get_noise_config(void);
+
+/**
+ * @brief Returns the plausibility counters (samples checked, speed and acceleration violations).
+ */
+encoder_plausibility_stats_t encoder_get_noise_stats(void);
+
+/**
+ * @brief Clears the plausibility counters.
+ */
+void encoder_clear_noise_stats(void);
+
+/**
+ * @brief Sets the stall time and the overspeed limit of the event detector.
+ *
+ * @param config Thresholds; 0 disables the stall or overspeed event
+ */
+void encoder_set_event_config(const encoder_event_config_t *config);
+
+/**
+ * @brief Returns the event thresholds.
+ */
+encoder_event_config_t encoder_get_event_config(void);
+
+/**
+ * @brief Arms a one-shot ENCODER_EVENT_TARGET at a calibrated distance.
+ *
+ * The event fires on the first sample at or past the target, seen from the
+ * side the distance is on when the target is armed.
+ *
+ * @param target_um Target distance in micrometres
+ */
+void encoder_set_target_um(int64_t target_um);
+
+/**
+ * @brief Disarms the target-distance event.
+ */
+void encoder_clear_target(void);
+
+/**
+ * @brief Arms a one-shot cut-to-length trigger.
+ *
+ * The target distance is converted to the nearest count and programmed as a
+ * PCNT watch point once it lies within the current 16-bit counter window;
+ * targets further away are re-checked every sampling period as the window
+ * moves. When the count reaches the target, the watch-point ISR drives the
+ * output pin and runs the callback, so the response does not depend on the
+ * sampling rate. The trigger fires once, from either direction, and is
+ * cancelled by encoder_reset() or a counting change. Arming again replaces it.
+ *
+ * @param config Target, output pin and callback
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG for an unusable output pin
+ */
+esp_err_t encoder_arm_trigger(const encoder_trigger_config_t *config);
+
+/**
+ * @brief Cancels the trigger; the output pin keeps its level.
+ */
+void encoder_disarm_trigger(void);
+
+/**
+ * @brief Returns the trigger statistics: fires, overshoot in counts and ISR-to-output latency.
+ */
+void encoder_get_trigger_stats(encoder_trigger_stats_t *out);
+
+/**
+ * @brief Returns the interrupt counters.
+ *
+ * The sampler folds the hardware count into the 64-bit total, and the PCNT
+ * limit interrupts are only on (limit_irq) while the count moves fast enough
+ * for one late sample to matter. watch_irqs counts those interrupts, one per
+ * 32768 counts travelled while they are on; edge_irqs counts the period
+ * estimator's edge interrupts.
+ */
+encoder_irq_stats_t encoder_get_irq_stats(void);
+
+/**
+ * @brief Returns how often encoder_reset() cleared the count since boot.
+ */
+uint32_t encoder_get_reset_count(void);
+
+/**
+ * @brief Changes pins, resolution, decoding mode or direction at runtime.
+ *
+ * The PCNT unit is stopped, its channels are rebuilt for the new setup and it
+ * is restarted; the accumulated distance is kept and rescaled so it stays
+ * continuous across a decoding change. Speed sampling resumes from the next
+ * tick. pulses_per_rev always counts x4 edges, so x1 / x2 need no new
+ * calibration.
+ *
+ * @param counting New pins and decoding
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_ARG for an invalid or already used pin, mode or resolution
+ */
+esp_err_t encoder_set_counting(const encoder_counting_t *counting);
+
+/**
+ * @brief Returns the pins and decoding in effect.
+ */
+encoder_counting_t encoder_get_counting(void);
+
+/**
+ * @brief Returns the index (Z) pulse record.
+ *
+ * Every index latches the pulse count; the counts of each full revolution are
+ * compared with pulses_per_rev, so missed or extra counts show up as
+ * last_error / max_error / error_events long before they become a distance
+ * error. All fields stay zero if no index pin is configured.
+ *
+ * @param out Index record
+ */
+void encoder_get_index(encoder_index_t *out);
+
+/**
+ * @brief Takes the next index pulse as the zero of encoder_get_position().
+ *
+ * The distance counter is not affected.
+ */
+void encoder_home_on_index(void);
+
+/**
+ * @brief Returns the pulse count relative to the home index.
+ *
+ * @return int64_t Position in pulses (raw pulse count until homed)
+ */
+int64_t encoder_get_position(void);
+
+/**
+ * @brief Returns the shaft angle within the current revolution.
+ *
+ * @param out_deg Angle in degrees (0..360) counted from the last index
+ * @return true once an index pulse has been seen
+ */
+bool encoder_get_angle_deg(float *out_deg);
+
+/**
+ * @brief Starts periodic speed sampling for all channels.
+ *
+ * A periodic esp_timer wakes a dedicated task, which updates the speed of
+ * every channel and pushes a {timestamp, pulses, speed} record into each
+ * channel's sample ring buffer. With CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+ * the timer wakes the task straight from its interrupt, so the esp_timer
+ * task (and Wi-Fi above it on core 0) is not in the path.
+ *
+ * @param config Rate and task placement
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_STATE if already running, ESP_ERR_NO_MEM
+ */
+esp_err_t encoder_start_sampler(const encoder_sampler_config_t *config);
+
+/**
+ * @brief Starts sampling at rate_hz with ENCODER_SAMPLER_CONFIG_DEFAULT() placement.
+ */
+void encoder_start_speed_task(uint32_t rate_hz);
+
+/**
+ * @brief Returns the sampling timing statistics since start or the last reset.
+ */
+void encoder_get_sampler_stats(encoder_sampler_stats_t *out);
+
+/**
+ * @brief Restarts the sampling timing statistics; applied by the next pass.
+ */
+void encoder_reset_sampler_stats(void);
+
+/**
+ * @brief Initializes a consumer cursor at the next sample to be produced.
+ *
+ * Each consumer (web server, logger, display...) owns its cursor and drains
+ * at its own pace without blocking the sampler or other consumers.
+ *
+ * @param cursor Cursor to initialize
+ */
+void encoder_samples_cursor_init(encoder_ring_cursor_t *cursor);
+
+/**
+ * @brief Positions a consumer cursor at a sample sequence number.
+ *
+ * Lets a client that remembers the last sequence it saw fetch everything
+ * after it. Samples no longer held are counted in cursor->dropped; see
+ * encoder_ring_cursor_seek().
+ *
+ * @param cursor Cursor to position
+ * @param seq Sequence number of the first sample to read
+ */
+void encoder_samples_cursor_seek(encoder_ring_cursor_t *cursor, uint32_t seq);
+
+/**
+ * @brief Reads samples produced since the cursor's last read.
+ *
+ * If the consumer fell behind by more than ENCODER_RING_CAPACITY samples the
+ * oldest ones are skipped and counted in cursor->dropped.
+ *
+ * @param cursor Consumer cursor
+ * @param out Destination array
+ * @param max Capacity of out
+ * @return size_t Number of samples read
+ */
+size_t encoder_samples_read(encoder_ring_cursor_t *cursor, encoder_sample_t *out, size_t max);
+
+/**
+ * @brief Returns the most recent sample.
+ *
+ * @param out Latest sample
+ * @return true if a sample was available
  */
-void encoder_start_speed_task(void);
+bool encoder_get_latest_sample(encoder_sample_t *out);
 
 /**
  * @brief Sets a calibration factor to correct distance calculation.
@@ -0,0 +1,572 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "encoder_filter.h"
+#include "encoder_deriv.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Hardware-independent encoder core.
+ *
+ * Holds the pulse accounting, overflow handling and speed math. The core does
+ * not touch PCNT, esp_timer or FreeRTOS directly: the counter and the clock are
+ * reached through an encoder_backend_t, so the same code runs on the ESP32
+ * (PCNT backend) and on a Linux host (simulated counter, see host/).
+ */
+
+#define ENCODER_CORE_HIGH_LIMIT  32767
+#define ENCODER_CORE_LOW_LIMIT  -32768
+
+#define ENCODER_SPEED_AUTO_COUNT_PPS  2000      ///< Auto mode: pulse rate above which count-based speed is used
+#define ENCODER_SPEED_AUTO_PERIOD_PPS 1000      ///< Auto mode: pulse rate below which period-based speed is used
+#define ENCODER_SPEED_STALL_US        2000000   ///< Period mode: no edge for this long reports zero speed
+
+#define ENCODER_CORE_HALF_WINDOW      16383     ///< Largest count change between two folds that extends unambiguously
+#define ENCODER_CORE_BACKSTOP_ON      8192      ///< |counts per fold| at which the limit interrupts are turned on
+#define ENCODER_CORE_BACKSTOP_OFF     4096      ///< |counts per fold| below which they are turned off again
+
+
+#ifndef ENCODER_INDEX_TOLERANCE
+#define ENCODER_INDEX_TOLERANCE       1         ///< Counts per revolution an index may deviate before it is an error event
+#endif
+
+/**
+ * @brief Quadrature decoding: counts per encoder cycle.
+ */
+typedef enum {
+    ENCODER_COUNT_X1 = 1,               ///< Rising edges of A only
+    ENCODER_COUNT_X2 = 2,               ///< Both edges of A
+    ENCODER_COUNT_X4 = 4,               ///< Both edges of A and B
+} encoder_count_mode_t;
+
+/**
+ * @brief Speed estimator selection.
+ */
+typedef enum {
+    ENCODER_SPEED_MODE_COUNT = 0,   ///< Pulse delta over the sampling window
+    ENCODER_SPEED_MODE_PERIOD,      ///< Pulses between timestamped edges over the exact edge interval
+    ENCODER_SPEED_MODE_AUTO,        ///< Period at low speed, count at high speed (configuration only)
+} encoder_speed_mode_t;
+
+/**
+ * @brief Limits of physically possible motion; 0 disables a check.
+ *
+ * Samples outside these limits come from electrical noise rather than the
+ * shaft. They are clamped before filtering and counted; the pulse count itself
+ * is never altered, so real pulses are not lost.
+ */
+typedef struct {
+    float max_speed_mps;                ///< Largest plausible |speed|
+    float max_accel_mps2;               ///< Largest plausible |speed change| per second
+} encoder_plausibility_t;
+
+/**
+ * @brief Plausibility violations counted since init or the last clear.
+ */
+typedef struct {
+    uint32_t samples;                   ///< Speed samples checked
+    uint32_t speed_violations;          ///< Samples above max_speed_mps
+    uint32_t accel_violations;          ///< Samples whose speed jump exceeded max_accel_mps2
+} encoder_plausibility_stats_t;
+
+/**
+ * @brief Index (Z) pulse record.
+ *
+ * The count is latched in the index interrupt, so at speed it includes the
+ * counts travelled during the interrupt latency.
+ */
+typedef struct {
+    uint32_t count;                     ///< Index pulses seen
+    int64_t pulses;                     ///< Pulse count latched at the last index
+    int64_t timestamp_us;               ///< Time of the last index
+    int32_t last_error;                 ///< Counts of the last full revolution minus counts_per_rev
+    int32_t max_error;                  ///< Largest |last_error| seen
+    uint32_t revolutions;               ///< Full revolutions measured between indexes
+    uint32_t error_events;              ///< Revolutions with |error| > ENCODER_INDEX_TOLERANCE
+    bool homed;                         ///< An index has been taken as the position zero
+    int64_t home_pulses;                ///< Pulse count at the homing index
+} encoder_index_t;
+
+/**
+ * @brief Interrupt counters since init.
+ *
+ * The sampler folds the hardware count into the accumulator, so the limit
+ * interrupts are only enabled while the count moves fast enough for one
+ * missed sample to matter (limit_irq). Below that watch_irqs stays put.
+ */
+typedef struct {
+    uint32_t watch_irqs;                ///< Watch-point (limit) interrupts
+    bool limit_irq;                     ///< Limit interrupts currently enabled as the backstop
+    uint32_t edge_irqs;                 ///< Phase A edge interrupts of the period estimator
+} encoder_irq_stats_t;
+
+/**
+ * @brief Called when the trigger count is reached; runs in the counter ISR.
+ */
+typedef void (*encoder_trigger_cb_t)(void *arg);
+
+/**
+ * @brief Trigger state.
+ */
+typedef enum {
+    ENCODER_TRIGGER_IDLE = 0,
+    ENCODER_TRIGGER_ARMED,              ///< Target outside the hardware window, waiting for it to come in range
+    ENCODER_TRIGGER_PROGRAMMED,         ///< Watch point set on the hardware count
+    ENCODER_TRIGGER_FIRED,              ///< Fired; the watch point is removed by the next service call
+} encoder_trigger_state_t;
+
+/**
+ * @brief Trigger statistics since init.
+ *
+ * Latency is measured from entry of the watch-point handler to the return of
+ * the trigger callback (output set). Overshoot is how far the hardware count
+ * had moved past the target by then, i.e. the interrupt latency expressed in
+ * counts.
+ */
+typedef struct {
+    uint32_t fires;                     ///< Triggers fired from the watch-point ISR
+    uint32_t late_fires;                ///< Targets already passed when programmed, fired from the task
+    int32_t last_overshoot;             ///< Counts past the target at the last ISR fire
+    int32_t max_overshoot;              ///< Largest |overshoot|
+    uint32_t last_latency_us;
+    uint32_t max_latency_us;
+    uint64_t total_latency_us;          ///< Sum over ISR fires, for the mean
+} encoder_trigger_stats_t;
+
+/**
+ * @brief Counter and clock access used by the core.
+ */
+typedef struct {
+    int     (*get_count)(void *ctx);    ///< Current hardware count within the limit window
+    int64_t (*now_us)(void *ctx);       ///< Monotonic time in microseconds
+    void    (*lock)(void *ctx);         ///< Serializes writers (ISR and task); may be NULL
+    void    (*unlock)(void *ctx);
+    void    (*set_edge_capture)(void *ctx, bool enable);   ///< Edge timestamp ISR on/off; may be NULL
+    int     (*add_watch)(void *ctx, int value);     ///< Adds a watch point inside the limits, 0 on success; may be NULL
+    void    (*remove_watch)(void *ctx, int value);  ///< Removes a watch point added with add_watch
+    void    (*set_limit_irq)(void *ctx, bool enable);  ///< Limit interrupts on/off; may be NULL (always on)
+} encoder_backend_t;
+
+/**
+ * @brief Consistent pulse count / time pair.
+ */
+typedef struct {
+    int64_t pulses;                     ///< Total pulses (with direction)
+    int64_t timestamp_us;               ///< Backend time at which the count was read
+} encoder_snapshot_t;
+
+/**
+ * @brief Encoder state: overflow accumulator, geometry and speed state.
+ */
+typedef struct {
+    const encoder_backend_t *backend;
+    void *backend_ctx;
+
+    atomic_uint seq;                    ///< Generation counter, odd while a writer is active
+    int64_t total_pulse_count;          ///< Pulses up to the last fold
+    int last_count;                     ///< Hardware count at the last fold
+    int fold_credit;                    ///< Limit resets seen by a fold whose interrupt is still due (+ high, - low)
+    bool limit_irq;                     ///< Limit interrupts enabled
+    atomic_uint watch_irqs;
+    int pulses_per_rev;                     ///< Counts per revolution in x4 decoding
+    encoder_count_mode_t count_mode;
+    int counts_per_rev;                     ///< Counts per revolution in count_mode
+    float wheel_diameter_m;
+    float calibration_factor;
+    float distance_per_pulse;               ///< Uncalibrated meters per pulse
+    float m_per_pulse;                      ///< distance_per_pulse * calibration_factor
+    uint64_t um_per_pulse_q32;              ///< Calibrated micrometres per pulse, Q32.32
+
+    int64_t last_pulse_count;
+    float last_speed;                       ///< Filtered speed
+    float raw_speed;                        ///< Estimator output before filtering
+    int64_t last_time_us;
+
+    encoder_filter_t speed_filter;
+    encoder_filter_config_t filter_pending; ///< Written by encoder_core_set_filter()
+    atomic_bool filter_update;              ///< filter_pending waits to be applied
+
+    encoder_deriv_t accel_deriv;            ///< Differentiates the raw speed
+    encoder_deriv_t jerk_deriv;             ///< Differentiates the acceleration
+    float accel;                            ///< m/s^2, centred on the fit window
+    float jerk;                             ///< m/s^3
+    atomic_uint deriv_window_pending;       ///< Requested window length, 0 if none
+
+    encoder_plausibility_t plausibility;    ///< Single-word fields, read by the sampler without locking
+    atomic_uint plausible_samples;
+    atomic_uint speed_violations;
+    atomic_uint accel_violations;
+
+    encoder_index_t index;                  ///< Written under seq by the index ISR and reset
+    atomic_bool home_armed;                 ///< Take the next index as the position zero
+
+    atomic_int trigger_state;               ///< encoder_trigger_state_t
+    int64_t trigger_target;                 ///< Target as a total pulse count
+    int8_t trigger_side;                    ///< Sign of (target - pulses) when armed
+    int trigger_watch;                      ///< Hardware watch point value while PROGRAMMED
+    encoder_trigger_cb_t trigger_cb;
+    void *trigger_arg;
+    encoder_trigger_stats_t trigger_stats;  ///< Written by the ISR under seq
+
+    encoder_speed_mode_t speed_mode;        ///< Configured estimator
+    encoder_speed_mode_t active_speed_mode; ///< Estimator used for the last sample
+    int64_t speed_window_us;                ///< Time span the last sample was measured over
+    int pulses_per_edge;                    ///< Counted pulses per captured edge
+    atomic_bool rereference;                ///< Count scale changed; next sample restarts the speed reference
+    bool edge_capture;                      ///< Edge capture currently enabled
+
+    atomic_uint edge_seq;                   ///< Generation counter of the edge record
+    uint32_t edge_count;                    ///< Edges captured since init
+    int64_t last_edge_us;                   ///< Timestamp of the most recent edge
+    uint32_t used_edge_count;               ///< Edge record consumed by the previous sample
+    int64_t used_edge_us;
+} encoder_core_t;
+
+/**
+ * @brief Initializes the core and binds it to a backend.
+ *
+ * @param core Core state to initialize
+ * @param backend Counter/clock operations
+ * @param backend_ctx Context passed to every backend call
+ * @param pulses_per_revolution Counts per revolution in x4 decoding
+ * @param wheel_diameter_mm Diameter of the shaft or wheel in millimeters
+ *
+ * count_mode may be set before the call; it defaults to ENCODER_COUNT_X4.
+ */
+void encoder_core_init(encoder_core_t *core, const encoder_backend_t *backend, void *backend_ctx,
+                       int pulses_per_revolution, float wheel_diameter_mm);
+
+/**
+ * @brief Accounts a watch-point event. Safe to call from the counter ISR.
+ *
+ * A limit event is the backstop of the sampler's fold: if a fold already
+ * extended across this reset it only folds, otherwise it adds the limit
+ * itself, which stays exact however long the sampler was away.
+ *
+ * @param core Core state
+ * @param watch_point_value Limit that was reached (high or low)
+ */
+void encoder_core_on_watch_point(encoder_core_t *core, int watch_point_value);
+
+/**
+ * @brief Returns the interrupt counters.
+ */
+encoder_irq_stats_t encoder_core_get_irq_stats(encoder_core_t *core);
+
+/**
+ * @brief Records a timestamped edge of the captured phase. Called from the edge ISR.
+ *
+ * @param core Core state
+ * @param timestamp_us Backend time of the edge
+ */
+void encoder_core_on_edge(encoder_core_t *core, int64_t timestamp_us);
+
+/**
+ * @brief Latches the pulse count at an index (Z) pulse. Called from the index ISR.
+ *
+ * Compares the counts since the previous index with counts_per_rev. When the
+ * shaft reverses over the index the span is shorter than half a revolution
+ * and no error is taken. The count is folded before it is latched, so a
+ * limit reset whose interrupt is still pending is included.
+ *
+ * @param core Core state
+ * @param timestamp_us Backend time of the index edge
+ */
+void encoder_core_on_index(encoder_core_t *core, int64_t timestamp_us);
+
+/**
+ * @brief Reads accumulator, hardware count and time as one consistent snapshot.
+ *
+ * Lock-free on the read path: the accumulator is published under a
+ * generation counter (seqlock) and the read is retried if a writer ran
+ * meanwhile, so a 64-bit value is never observed half-updated. The pulses
+ * are the accumulator plus the hardware count change since the last fold,
+ * extended across a limit reset the same way the fold does it.
+ *
+ * The hardware resets its count at a limit before any fold or watch-point
+ * ISR has accounted for it, and that ISR may run on the other core. The
+ * extension needs no help from either: a reset the reader sees first is
+ * recognised by the count change since the last fold. The result is exact
+ * whatever the ISR timing, under the same condition as the fold itself, a
+ * change of at most ENCODER_CORE_HALF_WINDOW since the last fold.
+ *
+ * @param core Core state
+ * @param out Snapshot; zeroed if the core has no backend
+ */
+void encoder_core_snapshot(encoder_core_t *core, encoder_snapshot_t *out);
+
+/**
+ * @brief Returns the total number of pulses (with direction).
+ */
+int64_t encoder_core_get_pulses(encoder_core_t *core);
+
+/**
+ * @brief Resets pulse count and speed state.
+ *
+ * The index latch and home reference are shifted with the count, so the
+ * angle and the homed position stay valid. An armed trigger is cancelled.
+ */
+void encoder_core_reset(encoder_core_t *core);
+
+/**
+ * @brief Sets the total pulse count, e.g. to restore a saved odometer.
+ *
+ * Like encoder_core_reset() but to an arbitrary count: the accumulator is
+ * set (the hardware count is left running), the index latch and home reference move with the count and an
+ * armed trigger is cancelled. The speed estimate continues; the next sample
+ * restarts its reference instead of seeing the jump.
+ */
+void encoder_core_set_pulses(encoder_core_t *core, int64_t pulses);
+
+/**
+ * @brief Returns a consistent copy of the index record.
+ */
+void encoder_core_get_index(encoder_core_t *core, encoder_index_t *out);
+
+/**
+ * @brief Takes the next index pulse as the position zero.
+ */
+void encoder_core_home_on_index(encoder_core_t *core);
+
+/**
+ * @brief Returns the pulse count relative to the home index (raw count if not homed).
+ */
+int64_t encoder_core_get_position(encoder_core_t *core);
+
+/**
+ * @brief Returns the shaft angle within the revolution, measured from the last index.
+ *
+ * @param core Core state
+ * @param out_deg Angle in degrees, 0..360
+ * @return true once an index has been seen
+ */
+bool encoder_core_get_angle_deg(encoder_core_t *core, float *out_deg);
+
+/**
+ * @brief Returns the calculated distance in meters.
+ */
+float encoder_core_get_distance_m(encoder_core_t *core);
+
+/**
+ * @brief Returns the travelled distance in micrometres.
+ *
+ * Computed from the 64-bit pulse count with a Q32.32 micrometres-per-pulse
+ * scale that is only recomputed when diameter, factor or PPR change, so the
+ * result stays exact over multi-kilometre runs where a float would have run
+ * out of mantissa.
+ */
+int64_t encoder_core_get_distance_um(encoder_core_t *core);
+
+/**
+ * @brief Converts a pulse count into micrometres with the fixed-point scale.
+ */
+int64_t encoder_core_pulses_to_um(const encoder_core_t *core, int64_t pulses);
+
+/**
+ * @brief Converts micrometres into the nearest pulse count with the fixed-point scale.
+ */
+int64_t encoder_core_um_to_pulses(const encoder_core_t *core, int64_t um);
+
+/**
+ * @brief Arms a one-shot trigger at a total pulse count.
+ *
+ * The target is turned into a hardware watch point as soon as it lies within
+ * the current counter window; targets further away are chained: every call
+ * of encoder_core_service_trigger() re-checks as folds move the
+ * window. A programmed watch point lies strictly inside the limits, so the
+ * window stays fixed until the count gets there. The callback then runs directly in
+ * the watch-point ISR, independent of the sampling period. If the count has
+ * already passed the target when it is programmed, the callback runs from
+ * the calling task and is counted as a late fire.
+ *
+ * Requires a backend with add_watch / remove_watch. Task context only.
+ *
+ * @param core Core state
+ * @param target_pulses Total pulse count to fire at (reached from either side)
+ * @param cb Callback, run in ISR context
+ * @param arg Passed to the callback
+ * @return true if armed
+ */
+bool encoder_core_arm_trigger(encoder_core_t *core, int64_t target_pulses, encoder_trigger_cb_t cb, void *arg);
+
+/**
+ * @brief Cancels the trigger and removes its watch point. Task context only.
+ */
+void encoder_core_disarm_trigger(encoder_core_t *core);
+
+/**
+ * @brief Programs, re-programs or cleans up the trigger watch point.
+ *
+ * Called by the sampler each period, before encoder_core_update_speed().
+ */
+void encoder_core_service_trigger(encoder_core_t *core);
+
+/**
+ * @brief Returns the trigger state.
+ */
+encoder_trigger_state_t encoder_core_get_trigger_state(const encoder_core_t *core);
+
+/**
+ * @brief Returns the trigger statistics.
+ */
+void encoder_core_get_trigger_stats(encoder_core_t *core, encoder_trigger_stats_t *out);
+
+/**
+ * @brief Updates speed from the pulse delta since the previous call and runs the speed filter.
+ *
+ * First folds the hardware count into the 64-bit accumulator. The count is
+ * never cleared from software: the change since the previous fold is
+ * extended across a limit reset, which is unambiguous while it stays within
+ * ENCODER_CORE_HALF_WINDOW, so the sampler must run at least that often.
+ * The limit interrupts are turned on as the backstop once a fold sees
+ * ENCODER_CORE_BACKSTOP_ON counts, and off again below
+ * ENCODER_CORE_BACKSTOP_OFF; at lower rates no overflow interrupt fires.
+ *
+ * The raw estimate is checked against the plausibility limits (and clamped)
+ * before it reaches the filter. Also advances the acceleration and jerk
+ * differentiators by one sample.
+ *
+ * In period mode speed is taken over the exact interval between the last
+ * edge consumed by the previous call and the newest edge; without new edges
+ * the estimate decays as 1 edge over the time since the last edge. Auto mode
+ * switches between the two on the pulse rate (with hysteresis) and turns the
+ * edge capture off while counting.
+ */
+void encoder_core_update_speed(encoder_core_t *core);
+
+/**
+ * @brief Returns the last calculated speed in meters per second.
+ */
+float encoder_core_get_speed_mps(const encoder_core_t *core);
+
+/**
+ * @brief Returns the last unfiltered speed estimate in meters per second.
+ */
+float encoder_core_get_raw_speed_mps(const encoder_core_t *core);
+
+/**
+ * @brief Returns acceleration from the least-squares slope of the raw speed.
+ */
+float encoder_core_get_accel_mps2(const encoder_core_t *core);
+
+/**
+ * @brief Returns jerk from the least-squares slope of the acceleration.
+ */
+float encoder_core_get_jerk_mps3(const encoder_core_t *core);
+
+/**
+ * @brief Sets the differentiation window in samples (clamped to 2..ENCODER_DERIV_MAX_WINDOW).
+ *
+ * Applied by the next encoder_core_update_speed(), which restarts the history.
+ * A longer window smooths more but delays the estimate by (N - 1) / 2 samples.
+ */
+void encoder_core_set_deriv_window(encoder_core_t *core, uint16_t samples);
+
+/**
+ * @brief Returns the differentiation window in samples.
+ */
+uint16_t encoder_core_get_deriv_window(const encoder_core_t *core);
+
+/**
+ * @brief Sets the plausibility limits applied to every raw speed sample.
+ */
+void encoder_core_set_plausibility(encoder_core_t *core, const encoder_plausibility_t *limits);
+
+/**
+ * @brief Returns the plausibility limits.
+ */
+encoder_plausibility_t encoder_core_get_plausibility(const encoder_core_t *core);
+
+/**
+ * @brief Returns the plausibility counters.
+ */
+encoder_plausibility_stats_t encoder_core_get_plausibility_stats(const encoder_core_t *core);
+
+/**
+ * @brief Clears the plausibility counters.
+ */
+void encoder_core_clear_plausibility_stats(encoder_core_t *core);
+
+/**
+ * @brief Replaces the speed filter.
+ *
+ * The configuration is picked up by the next encoder_core_update_speed(), so
+ * the sampling path never sees a half-applied filter. Intended for a single
+ * configuring task.
+ */
+void encoder_core_set_filter(encoder_core_t *core, const encoder_filter_config_t *config);
+
+/**
+ * @brief Returns the filter configuration in effect.
+ */
+encoder_filter_config_t encoder_core_get_filter(const encoder_core_t *core);
+
+/**
+ * @brief Selects the speed estimator.
+ */
+void encoder_core_set_speed_mode(encoder_core_t *core, encoder_speed_mode_t mode);
+
+/**
+ * @brief Returns the estimator used for the last sample (COUNT or PERIOD).
+ */
+encoder_speed_mode_t encoder_core_get_active_speed_mode(const encoder_core_t *core);
+
+/**
+ * @brief Returns the time span in microseconds the last sample was measured over.
+ */
+int64_t encoder_core_get_speed_window_us(const encoder_core_t *core);
+
+/**
+ * @brief Switches the decoding mode of the accumulated count.
+ *
+ * Must be called with the counter stopped. The hardware count is folded into
+ * the accumulator and cleared, and the accumulator, index latch and home
+ * reference are rescaled to the new mode, so distance and position continue
+ * across the switch (to within one count of the coarser mode). The next speed
+ * sample restarts its reference instead of seeing a jump.
+ */
+void encoder_core_set_count_mode(encoder_core_t *core, encoder_count_mode_t mode);
+
+/**
+ * @brief Returns the decoding mode.
+ */
+encoder_count_mode_t encoder_core_get_count_mode(const encoder_core_t *core);
+
+/**
+ * @brief Sets the counts per revolution in x4 decoding (ignored if <= 0).
+ */
+void encoder_core_set_pulses_per_rev(encoder_core_t *core, int pulses_per_rev);
+
+/**
+ * @brief Returns the counts per revolution in x4 decoding.
+ */
+int encoder_core_get_pulses_per_rev(const encoder_core_t *core);
+
+/**
+ * @brief Sets a new wheel diameter in millimeters (ignored if <= 0).
+ */
+void encoder_core_set_wheel_diameter_mm(encoder_core_t *core, float diameter_mm);
+
+/**
+ * @brief Returns the wheel diameter in millimeters.
+ */
+float encoder_core_get_wheel_diameter_mm(const encoder_core_t *core);
+
+/**
+ * @brief Sets the calibration factor (ignored if <= 0).
+ */
+void encoder_core_set_calibration_factor(encoder_core_t *core, float factor);
+
+/**
+ * @brief Returns the calibration factor.
+ */
+float encoder_core_get_calibration_factor(const encoder_core_t *core);
+
+#ifdef __cplusplus
+}
+#endif
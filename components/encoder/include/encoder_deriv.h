@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Least-squares differentiator over the last N samples.
+ *
+ * Fits a straight line to the window and returns its slope, which is the
+ * Savitzky-Golay first derivative at the window centre (for polynomial order
+ * 1 and 2 the coefficients are identical). Samples are kept as integer
+ * micro-units (micrometres per second for speed) with two 64-bit running sums,
+ * sum(v) and sum(k * v), which are updated in O(1) per sample and never drift.
+ * The estimate lags the input by (N - 1) / 2 samples.
+ */
+
+#define ENCODER_DERIV_MAX_WINDOW     32
+#define ENCODER_DERIV_DEFAULT_WINDOW 8
+
+/**
+ * @brief Differentiator state; held inline, no allocation.
+ */
+typedef struct {
+    uint16_t window;                    ///< Fit length N (2..ENCODER_DERIV_MAX_WINDOW)
+    uint16_t index;                     ///< Slot of the next sample
+    uint16_t count;                     ///< Samples in the window
+    int32_t samples[ENCODER_DERIV_MAX_WINDOW];
+    int64_t times_us[ENCODER_DERIV_MAX_WINDOW];
+    int64_t sum;                        ///< sum(v)
+    int64_t weighted_sum;               ///< sum(k * v), k = 0 for the oldest sample
+} encoder_deriv_t;
+
+/**
+ * @brief Initializes the differentiator with a window length (clamped).
+ */
+void encoder_deriv_init(encoder_deriv_t *deriv, uint16_t window);
+
+/**
+ * @brief Clears the history, keeping the window length.
+ */
+void encoder_deriv_reset(encoder_deriv_t *deriv);
+
+/**
+ * @brief Feeds one sample and returns the slope of the window.
+ *
+ * The sample spacing is taken as the mean interval across the window, so a
+ * periodic sampler with jitter still yields an unbiased slope.
+ *
+ * @param deriv Differentiator state
+ * @param value Input in base units (e.g. m/s)
+ * @param timestamp_us Time of the sample
+ * @return float Derivative in base units per second; 0 until two samples are in
+ */
+float encoder_deriv_push(encoder_deriv_t *deriv, float value, int64_t timestamp_us);
+
+#ifdef __cplusplus
+}
+#endif
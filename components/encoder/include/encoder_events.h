@@ -0,0 +1,123 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Motion event detection.
+ *
+ * Runs once per speed sample on the sampled pulse count, distance and speed,
+ * so events are raised within one sampling period without any extra
+ * interrupt. Each detector is edge-triggered: an event fires once when its
+ * condition starts and re-arms only after the condition has cleared.
+ */
+
+#define ENCODER_EVENT_DIRECTION_HYSTERESIS 4    ///< Counts back from the turning point before a reversal is reported
+#define ENCODER_EVENT_DEFAULT_STALL_MS     500
+#define ENCODER_EVENT_OVERSPEED_REARM      0.9f ///< Overspeed re-arms below this fraction of the limit
+
+/**
+ * @brief Event types; also used as subscription mask bits.
+ */
+typedef enum {
+    ENCODER_EVENT_DIRECTION = 1u << 0,  ///< Motion reversed
+    ENCODER_EVENT_STALL     = 1u << 1,  ///< No count for stall_ms after moving
+    ENCODER_EVENT_OVERSPEED = 1u << 2,  ///< |speed| rose above overspeed_mps
+    ENCODER_EVENT_TARGET    = 1u << 3,  ///< Distance reached or crossed the armed target
+} encoder_event_type_t;
+
+#define ENCODER_EVENT_ALL (ENCODER_EVENT_DIRECTION | ENCODER_EVENT_STALL | ENCODER_EVENT_OVERSPEED | ENCODER_EVENT_TARGET)
+
+/**
+ * @brief Detection thresholds; 0 disables a detector.
+ */
+typedef struct {
+    uint32_t stall_ms;                  ///< Time without counts that is a stall
+    float overspeed_mps;                ///< Largest allowed |speed|
+} encoder_event_config_t;
+
+/**
+ * @brief One delivered event.
+ */
+typedef struct {
+    encoder_event_type_t type;
+    int channel;                        ///< Creation index of the channel
+    int64_t timestamp_us;               ///< Time of the sample that raised the event
+    int64_t pulses;                     ///< Pulse count of that sample
+    int64_t distance_um;                ///< Calibrated distance of that sample
+    float speed_mps;                    ///< Filtered speed of that sample
+    int8_t direction;                   ///< +1 / -1 after a reversal, 0 if not yet known
+} encoder_event_t;
+
+/**
+ * @brief Detector state of one channel; updated by the sampler only.
+ */
+typedef struct {
+    encoder_event_config_t config;      ///< Single-word fields, read by the sampler without locking
+    bool primed;                        ///< Baseline taken from a first sample
+    int8_t direction;                   ///< Current direction, 0 until the first move past the hysteresis
+    int64_t turn_pulses;                ///< Extreme count in the current direction
+    int64_t last_pulses;
+    int64_t last_motion_us;
+    bool stalled;
+    bool overspeed;
+    bool target_armed;
+    int8_t target_side;                 ///< Sign of (target - distance) when armed
+    int64_t target_um;
+
+    atomic_uint commands;               ///< Pending requests from other tasks (restart, target set / clear)
+    int64_t target_pending_um;          ///< Written before the set request is posted
+} encoder_event_detector_t;
+
+/**
+ * @brief Initializes the detector; the encoder counts as stalled until it first moves.
+ */
+void encoder_event_detector_init(encoder_event_detector_t *det, const encoder_event_config_t *config);
+
+/**
+ * @brief Drops the direction and motion history after the count was reset; any task.
+ *
+ * The next sample becomes the new baseline, so a reset does not read as a
+ * reversal. An armed target stays armed, measured from the new distance.
+ */
+void encoder_event_detector_restart(encoder_event_detector_t *det);
+
+/**
+ * @brief Arms the target; any task. Takes effect on the next sample.
+ *
+ * The event fires once when the distance reaches or crosses target_um from
+ * the side it was on at the next sample, then the target disarms.
+ */
+void encoder_event_detector_set_target(encoder_event_detector_t *det, int64_t target_um);
+
+/**
+ * @brief Disarms the target; any task.
+ */
+void encoder_event_detector_clear_target(encoder_event_detector_t *det);
+
+/**
+ * @brief Feeds one sample and returns the events it raised.
+ *
+ * @param det Detector state
+ * @param timestamp_us Sample time
+ * @param pulses Sampled pulse count
+ * @param distance_um Calibrated distance of the sample
+ * @param speed_mps Filtered speed of the sample
+ * @return uint32_t Mask of encoder_event_type_t bits, 0 if nothing happened
+ */
+uint32_t encoder_event_detector_update(encoder_event_detector_t *det, int64_t timestamp_us, int64_t pulses,
+                                       int64_t distance_um, float speed_mps);
+
+/**
+ * @brief Returns a short name of an event type ("direction", "stall", ...).
+ */
+const char *encoder_event_name(encoder_event_type_t type);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Speed filtering stage between the raw estimator and encoder_get_speed_mps().
+ *
+ * All state is held inline (no allocation). The moving average keeps its
+ * window as integer micrometres per second with a 64-bit running sum, so the
+ * per-sample cost is O(1) and the sum never drifts; the EMA uses a Q16
+ * coefficient on the same integer scale. The alpha-beta tracker and the
+ * Kalman filter work in single-precision float, which the ESP32 FPU handles
+ * in hardware.
+ */
+
+#define ENCODER_FILTER_MAX_WINDOW 64
+
+/**
+ * @brief Filter selection.
+ */
+typedef enum {
+    ENCODER_FILTER_NONE = 0,            ///< Raw estimate passed through
+    ENCODER_FILTER_MOVING_AVERAGE,      ///< Fixed-window mean over the last N samples
+    ENCODER_FILTER_EMA,                 ///< Exponential moving average
+    ENCODER_FILTER_ALPHA_BETA,          ///< Alpha-beta tracker on speed and acceleration
+    ENCODER_FILTER_KALMAN,              ///< 1D Kalman filter, state [speed, acceleration]
+} encoder_filter_type_t;
+
+/**
+ * @brief Filter parameters; fields not used by the selected type are ignored.
+ */
+typedef struct {
+    encoder_filter_type_t type;
+    uint16_t window;                    ///< Moving average length (1..ENCODER_FILTER_MAX_WINDOW)
+    float alpha;                        ///< EMA / alpha-beta gain (0..1]
+    float beta;                         ///< Alpha-beta acceleration gain (0..2)
+    float process_noise;                ///< Kalman jerk variance, (m/s^3)^2
+    float measurement_noise;            ///< Kalman speed measurement variance, (m/s)^2
+} encoder_filter_config_t;
+
+/**
+ * @brief Filter state.
+ */
+typedef struct {
+    encoder_filter_config_t config;
+    uint8_t primed;                     ///< First sample seen
+    union {
+        struct {
+            int32_t samples[ENCODER_FILTER_MAX_WINDOW];
+            int64_t sum;
+            uint16_t index;
+            uint16_t count;
+        } ma;
+        struct {
+            int32_t alpha_q16;
+            int64_t value_q16;          ///< Micrometres per second, Q16
+        } ema;
+        struct {
+            float speed;
+            float accel;
+        } ab;
+        struct {
+            float speed;
+            float accel;
+            float p00, p01, p11;        ///< Symmetric covariance
+        } kf;
+    };
+} encoder_filter_t;
+
+/**
+ * @brief Returns the default configuration (no filtering).
+ */
+encoder_filter_config_t encoder_filter_default_config(void);
+
+/**
+ * @brief Clamps parameters into their valid ranges and resets the state.
+ *
+ * @param filter Filter to initialize
+ * @param config Parameters; NULL selects ENCODER_FILTER_NONE
+ */
+void encoder_filter_init(encoder_filter_t *filter, const encoder_filter_config_t *config);
+
+/**
+ * @brief Clears the filter history, keeping the configuration.
+ */
+void encoder_filter_reset(encoder_filter_t *filter);
+
+/**
+ * @brief Feeds one raw speed sample and returns the filtered speed.
+ *
+ * @param filter Filter state
+ * @param raw_mps Raw speed in meters per second
+ * @param dt_s Time since the previous sample in seconds
+ * @return float Filtered speed in meters per second
+ */
+float encoder_filter_apply(encoder_filter_t *filter, float raw_mps, float dt_s);
+
+/**
+ * @brief Returns the filter's acceleration estimate (alpha-beta and Kalman only, else 0).
+ */
+float encoder_filter_get_accel(const encoder_filter_t *filter);
+
+/**
+ * @brief Short lowercase name of a filter type ("none", "ma", "ema", "alpha_beta", "kalman").
+ */
+const char *encoder_filter_type_name(encoder_filter_type_t type);
+
+/**
+ * @brief Parses a name produced by encoder_filter_type_name().
+ *
+ * @return int 0 on success, -1 if the name is unknown
+ */
+int encoder_filter_type_from_name(const char *name, encoder_filter_type_t *out);
+
+#ifdef __cplusplus
+}
+#endif
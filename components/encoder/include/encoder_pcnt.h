@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdbool.h>
+#include "driver/gpio.h"
+#include "driver/pulse_cnt.h"
+#include "encoder_core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The filter counts APB cycles (80 MHz) in a 10-bit register: 1023 * 12.5 ns
+#define ENCODER_PCNT_GLITCH_MAX_NS 12787
+
+/**
+ * @brief Pins and decoding of one PCNT unit.
+ */
+typedef struct {
+    gpio_num_t pin_a;
+    gpio_num_t pin_b;
+    gpio_num_t pin_z;                   ///< Index input, GPIO_NUM_NC if not wired
+    encoder_count_mode_t count_mode;    ///< x1 / x2 use channel A only
+    bool invert;                        ///< Swaps the counting direction
+    uint32_t glitch_filter_ns;          ///< Pulses narrower than this are ignored; 0 = filter off
+} encoder_pcnt_config_t;
+
+/**
+ * @brief PCNT backend context: one unit decoding one encoder.
+ */
+typedef struct {
+    pcnt_unit_handle_t unit;
+    pcnt_channel_handle_t chan_a;
+    pcnt_channel_handle_t chan_b;       ///< NULL unless decoding x4
+    encoder_pcnt_config_t config;
+    bool edge_capture;                  ///< Phase A edge interrupt requested by the core
+    bool pins_attached;                 ///< Edge and index handlers installed
+    encoder_core_t *core;               ///< Receives watch-point and edge events
+} encoder_pcnt_t;
+
+/**
+ * @brief PCNT implementation of the encoder core backend.
+ *
+ * The backend context is the encoder_pcnt_t passed to encoder_pcnt_init().
+ */
+extern const encoder_backend_t encoder_pcnt_backend;
+
+/**
+ * @brief Creates and starts a PCNT unit decoding phases A/B.
+ *
+ * Watch points at the unit limits are routed to encoder_core_on_watch_point()
+ * of the given core. A GPIO interrupt on phase A (any edge, rising only in x1)
+ * is installed for the period speed estimator; it stays disabled until the
+ * core asks for it. If an index pin is given, its rising edge latches the
+ * count through encoder_core_on_index(). On failure everything created so
+ * far is released with encoder_pcnt_deinit().
+ *
+ * @param pcnt Backend context to fill
+ * @param config Pins, decoding and glitch filter
+ * @param core Core receiving the overflow and edge events
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t encoder_pcnt_init(encoder_pcnt_t *pcnt, const encoder_pcnt_config_t *config, encoder_core_t *core);
+
+/**
+ * @brief Stops the unit and releases its pin interrupts, channels and the unit itself.
+ *
+ * Safe on a context that encoder_pcnt_init() only partly built. The GPIO ISR
+ * service stays installed; other drivers share it.
+ *
+ * @param pcnt Backend context
+ */
+void encoder_pcnt_deinit(encoder_pcnt_t *pcnt);
+
+/**
+ * @brief Applies new pins, decoding mode, direction or glitch filter to a running unit.
+ *
+ * The unit is stopped, the core folds and rescales its count for the new mode
+ * (encoder_core_set_count_mode()), the channels are rebuilt and the unit is
+ * restarted. Edges during the few microseconds this takes are not counted.
+ * If any step fails, the previous configuration and count mode are restored
+ * and pcnt->config keeps describing what is in effect.
+ *
+ * @param pcnt Backend context
+ * @param config New configuration
+ * @return esp_err_t ESP_OK, or ESP_ERR_INVALID_ARG for an invalid pin, mode or filter width
+ */
+esp_err_t encoder_pcnt_reconfigure(encoder_pcnt_t *pcnt, const encoder_pcnt_config_t *config);
+
+/**
+ * @brief Changes the hardware glitch filter of a running unit.
+ *
+ * Shorthand for encoder_pcnt_reconfigure() with only the filter width changed.
+ *
+ * @param pcnt Backend context
+ * @param glitch_filter_ns Filter width in ns (0 = off)
+ * @return esp_err_t ESP_OK, or ESP_ERR_INVALID_ARG if the width is out of range
+ */
+esp_err_t encoder_pcnt_set_glitch_filter(encoder_pcnt_t *pcnt, uint32_t glitch_filter_ns);
+
+#ifdef __cplusplus
+}
+#endif
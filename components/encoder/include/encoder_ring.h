@@ -0,0 +1,108 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Single-producer / multi-consumer ring of speed samples.
+ *
+ * The producer (the sampling timer) never blocks and never waits for
+ * readers: when the ring is full the oldest sample is overwritten. Each
+ * consumer owns a cursor and drains at its own pace; a consumer that falls
+ * more than a ring length behind skips forward and the skipped samples are
+ * counted in its cursor. Slots are published with a per-slot generation
+ * counter, so readers need no lock and never see a half-written sample.
+ */
+
+#ifndef ENCODER_RING_CAPACITY
+#define ENCODER_RING_CAPACITY 512       ///< Samples kept per channel; must be a power of two
+#endif
+
+/**
+ * @brief One speed sample.
+ */
+typedef struct {
+    uint32_t seq;                       ///< Sample sequence number, increments by one per sample
+    int64_t timestamp_us;               ///< Time the pulse count was read
+    int64_t pulses;                     ///< Total pulses at timestamp_us
+    float speed_mps;                    ///< Speed estimate in meters per second
+    float accel_mps2;                   ///< Acceleration estimate in meters per second squared
+} encoder_sample_t;
+
+typedef struct {
+    atomic_uint gen;                    ///< Odd while the producer writes the slot
+    encoder_sample_t sample;
+} encoder_ring_slot_t;
+
+typedef struct {
+    atomic_uint head;                   ///< Sequence number of the next sample to be written
+    encoder_ring_slot_t slots[ENCODER_RING_CAPACITY];
+} encoder_ring_t;
+
+/**
+ * @brief Per-consumer read position.
+ */
+typedef struct {
+    uint32_t next;                      ///< Sequence number of the next sample to read
+    uint32_t dropped;                   ///< Samples overwritten before this consumer read them
+} encoder_ring_cursor_t;
+
+/**
+ * @brief Empties the ring.
+ */
+void encoder_ring_init(encoder_ring_t *ring);
+
+/**
+ * @brief Appends a sample (producer only). Fills in sample->seq.
+ *
+ * @param ring Ring buffer
+ * @param sample Sample to store; its seq field is assigned
+ */
+void encoder_ring_push(encoder_ring_t *ring, encoder_sample_t *sample);
+
+/**
+ * @brief Positions a cursor at the next sample to be produced.
+ */
+void encoder_ring_cursor_init(const encoder_ring_t *ring, encoder_ring_cursor_t *cursor);
+
+/**
+ * @brief Positions a cursor at the oldest sample still held.
+ */
+void encoder_ring_cursor_oldest(const encoder_ring_t *ring, encoder_ring_cursor_t *cursor);
+
+/**
+ * @brief Positions a cursor at a given sequence number.
+ *
+ * A sequence that was already overwritten resumes at the oldest sample held,
+ * with the skipped samples counted in cursor->dropped. A sequence ahead of the
+ * producer (e.g. remembered from before a reboot) also resumes at the oldest
+ * sample held, with nothing counted.
+ */
+void encoder_ring_cursor_seek(const encoder_ring_t *ring, encoder_ring_cursor_t *cursor, uint32_t seq);
+
+/**
+ * @brief Copies up to max samples from the cursor position and advances it.
+ *
+ * @param ring Ring buffer
+ * @param cursor Consumer cursor
+ * @param out Destination array
+ * @param max Capacity of out
+ * @return size_t Number of samples copied
+ */
+size_t encoder_ring_read(const encoder_ring_t *ring, encoder_ring_cursor_t *cursor, encoder_sample_t *out, size_t max);
+
+/**
+ * @brief Returns the most recent sample without moving any cursor.
+ *
+ * @return int 1 if a sample was returned, 0 if the ring is empty
+ */
+int encoder_ring_latest(const encoder_ring_t *ring, encoder_sample_t *out);
+
+#ifdef __cplusplus
+}
+#endif
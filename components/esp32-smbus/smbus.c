@@ -54,6 +54,7 @@
 #include "esp_log.h"
 
 #include "smbus.h"
+#include "metrics.h"
 
 static const char * TAG = "smbus";
 
@@ -111,6 +112,19 @@ static esp_err_t _check_i2c_error(esp_err_t err)
     return err;
 }
 
+// Runs one I2C transaction and records its duration
+static esp_err_t _cmd_begin(const smbus_info_t * smbus_info, i2c_cmd_handle_t cmd)
+{
+    METRICS_START(start);
+    esp_err_t err = _check_i2c_error(i2c_master_cmd_begin(smbus_info->i2c_port, cmd, smbus_info->timeout));
+    METRICS_STOP(METRIC_I2C, start);
+    if (err != ESP_OK)
+    {
+        METRICS_INC(METRIC_I2C_ERRORS);
+    }
+    return err;
+}
+
 esp_err_t _write_bytes(const smbus_info_t * smbus_info, uint8_t command, uint8_t * data, size_t len)
 {
     // Protocol: [S | ADDR | Wr | As | COMMAND | As | (DATA | As){*len} | P]
@@ -126,7 +140,7 @@ esp_err_t _write_bytes(const smbus_info_t * smbus_info, uint8_t command, uint8_t
 #ifdef MEASURE
         uint64_t start_time = esp_timer_get_time();
 #endif
-        err = _check_i2c_error(i2c_master_cmd_begin(smbus_info->i2c_port, cmd, smbus_info->timeout));
+        err = _cmd_begin(smbus_info, cmd);
 #ifdef MEASURE
         ESP_LOGI(TAG, "_write_bytes: i2c_master_cmd_begin took %"PRIu64" us", esp_timer_get_time() - start_time);
 #endif
@@ -156,7 +170,7 @@ esp_err_t _read_bytes(const smbus_info_t * smbus_info, uint8_t command, uint8_t
 #ifdef MEASURE
         uint64_t start_time = esp_timer_get_time();
 #endif
-        err = _check_i2c_error(i2c_master_cmd_begin(smbus_info->i2c_port, cmd, smbus_info->timeout));
+        err = _cmd_begin(smbus_info, cmd);
 #ifdef MEASURE
         ESP_LOGI(TAG, "_read_bytes: i2c_master_cmd_begin took %"PRIu64" us", esp_timer_get_time() - start_time);
 #endif
@@ -235,7 +249,7 @@ esp_err_t smbus_quick(const smbus_info_t * smbus_info, bool bit)
         i2c_master_start(cmd);
         i2c_master_write_byte(cmd, smbus_info->address << 1 | bit, ACK_CHECK);
         i2c_master_stop(cmd);
-        err = _check_i2c_error(i2c_master_cmd_begin(smbus_info->i2c_port, cmd, smbus_info->timeout));
+        err = _cmd_begin(smbus_info, cmd);
         i2c_cmd_link_delete(cmd);
     }
     return err;
@@ -252,7 +266,7 @@ esp_err_t smbus_send_byte(const smbus_info_t * smbus_info, uint8_t data)
         i2c_master_write_byte(cmd, smbus_info->address << 1 | WRITE_BIT, ACK_CHECK);
         i2c_master_write_byte(cmd, data, ACK_CHECK);
         i2c_master_stop(cmd);
-        err = _check_i2c_error(i2c_master_cmd_begin(smbus_info->i2c_port, cmd, smbus_info->timeout));
+        err = _cmd_begin(smbus_info, cmd);
         i2c_cmd_link_delete(cmd);
     }
     return err;
@@ -269,7 +283,7 @@ esp_err_t smbus_receive_byte(const smbus_info_t * smbus_info, uint8_t * data)
         i2c_master_write_byte(cmd, smbus_info->address << 1 | READ_BIT, ACK_CHECK);
         i2c_master_read_byte(cmd, data, NACK_VALUE);
         i2c_master_stop(cmd);
-        err = _check_i2c_error(i2c_master_cmd_begin(smbus_info->i2c_port, cmd, smbus_info->timeout));
+        err = _cmd_begin(smbus_info, cmd);
         i2c_cmd_link_delete(cmd);
     }
     return err;
@@ -330,7 +344,7 @@ esp_err_t smbus_write_block(const smbus_info_t * smbus_info, uint8_t command, ui
             i2c_master_write_byte(cmd, data[i], ACK_CHECK);
         }
         i2c_master_stop(cmd);
-        err = _check_i2c_error(i2c_master_cmd_begin(smbus_info->i2c_port, cmd, smbus_info->timeout));
+        err = _cmd_begin(smbus_info, cmd);
         i2c_cmd_link_delete(cmd);
     }
     return err;
@@ -351,7 +365,7 @@ esp_err_t smbus_read_block(const smbus_info_t * smbus_info, uint8_t command, uin
         i2c_master_write_byte(cmd, smbus_info->address << 1 | READ_BIT, ACK_CHECK);
         uint8_t slave_len = 0;
         i2c_master_read_byte(cmd, &slave_len, ACK_VALUE);
-        err = _check_i2c_error(i2c_master_cmd_begin(smbus_info->i2c_port, cmd, smbus_info->timeout));
+        err = _cmd_begin(smbus_info, cmd);
         i2c_cmd_link_delete(cmd);
 
         if (err != ESP_OK)
@@ -373,7 +387,7 @@ esp_err_t smbus_read_block(const smbus_info_t * smbus_info, uint8_t command, uin
         }
         i2c_master_read_byte(cmd, &data[slave_len - 1], NACK_VALUE);
         i2c_master_stop(cmd);
-        err = _check_i2c_error(i2c_master_cmd_begin(smbus_info->i2c_port, cmd, smbus_info->timeout));
+        err = _cmd_begin(smbus_info, cmd);
         i2c_cmd_link_delete(cmd);
 
         if (err == ESP_OK)
@@ -0,0 +1,109 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "esp_timer.h"
+
+/**
+ * Latency instrumentation.
+ *
+ * Each metric is a histogram of durations in microseconds with power-of-two
+ * buckets, plus a count, a sum and a maximum; counters count error events.
+ * Recording is lock-free: each core records into its own copy of the
+ * histograms with interrupts masked for a few instructions, so the two cores
+ * never wait on each other, and metrics_get() merges the copies. It is
+ * IRAM-safe and may be used in ISRs. Build with -DMETRICS_ENABLED=0 to
+ * compile every METRICS_* macro to nothing.
+ */
+
+#ifndef METRICS_ENABLED
+#define METRICS_ENABLED 1
+#endif
+
+#define METRICS_BUCKETS 16      ///< Bucket b holds [2^(b-1), 2^b) us; bucket 0 is < 1 us, the last is open-ended
+
+/**
+ * @brief Recorded metrics.
+ */
+typedef enum {
+    METRIC_SAMPLER_JITTER,      ///< |interval - period| of the encoder sampling task
+    METRIC_SAMPLER_WAKE,        ///< Timer fire to sampling pass start
+    METRIC_SAMPLER_RUN,         ///< Duration of one sampling pass
+    METRIC_DISPLAY_JITTER,      ///< Lateness of the display refresh against its 1 s period
+    METRIC_PCNT_ISR,            ///< Duration of the PCNT watch-point ISR
+    METRIC_I2C,                 ///< Duration of one I2C transaction
+    METRIC_HTTP,                ///< Duration of one HTTP handler
+    METRIC_COUNT
+} metric_id_t;
+
+/**
+ * @brief Event counters.
+ */
+typedef enum {
+    METRIC_I2C_ERRORS,          ///< Failed I2C transactions (no ACK, timeout, ...)
+    METRIC_COUNTER_COUNT
+} metric_counter_id_t;
+
+/**
+ * @brief Copy of one histogram.
+ */
+typedef struct {
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t sum_us;
+    uint32_t buckets[METRICS_BUCKETS];
+} metrics_histogram_t;
+
+#if METRICS_ENABLED
+#define METRICS_START(var)          int64_t var = esp_timer_get_time()
+#define METRICS_STOP(id, var)       metrics_record((id), (uint32_t)(esp_timer_get_time() - (var)))
+#define METRICS_RECORD(id, us)      metrics_record((id), (us))
+#define METRICS_INC(id)             metrics_counter_inc(id)
+#else
+#define METRICS_START(var)          do {} while (0)
+#define METRICS_STOP(id, var)       ((void)0)
+#define METRICS_RECORD(id, us)      ((void)0)
+#define METRICS_INC(id)             ((void)0)
+#endif
+
+/**
+ * @brief Adds one duration to a histogram; any context, including ISRs.
+ */
+void metrics_record(metric_id_t id, uint32_t us);
+
+/**
+ * @brief Copies a histogram, merged over both cores; each core's part is consistent.
+ */
+void metrics_get(metric_id_t id, metrics_histogram_t *out);
+
+/**
+ * @brief Increments a counter; any context, including ISRs.
+ */
+void metrics_counter_inc(metric_counter_id_t id);
+
+/**
+ * @brief Returns a counter; counters are never cleared.
+ */
+uint32_t metrics_counter_get(metric_counter_id_t id);
+
+/**
+ * @brief Clears every histogram.
+ */
+void metrics_reset(void);
+
+/**
+ * @brief Returns the short name of a metric ("sampler_jitter", "i2c", ...).
+ */
+const char *metrics_name(metric_id_t id);
+
+/**
+ * @brief Returns the short name of a counter ("i2c_errors", ...).
+ */
+const char *metrics_counter_name(metric_counter_id_t id);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,122 @@
+#include "metrics.h"
+#include "esp_attr.h"
+#include "freertos/FreeRTOS.h"
+#include <string.h>
+#include <stdatomic.h>
+
+/**
+ * @brief One core's copy of a histogram.
+ *
+ * Only its own core writes it, with interrupts masked, so writers never
+ * meet; seq lets metrics_get() on the other core copy it without tearing.
+ */
+typedef struct {
+    atomic_uint seq;                    ///< Odd while the owning core is updating
+    uint32_t gen;                       ///< s_reset_gen the contents belong to
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t sum_us;
+    uint32_t buckets[METRICS_BUCKETS];
+} histogram_t;
+
+static histogram_t s_histograms[portNUM_PROCESSORS][METRIC_COUNT];
+static atomic_uint s_reset_gen;         // bumped by metrics_reset(); older copies read as empty
+static atomic_uint s_counters[METRIC_COUNTER_COUNT];
+
+static const char *const s_names[METRIC_COUNT] = {
+    [METRIC_SAMPLER_JITTER] = "sampler_jitter",
+    [METRIC_SAMPLER_WAKE]   = "sampler_wake",
+    [METRIC_SAMPLER_RUN]    = "sampler_run",
+    [METRIC_DISPLAY_JITTER] = "display_jitter",
+    [METRIC_PCNT_ISR]       = "pcnt_isr",
+    [METRIC_I2C]            = "i2c",
+    [METRIC_HTTP]           = "http",
+};
+
+static const char *const s_counter_names[METRIC_COUNTER_COUNT] = {
+    [METRIC_I2C_ERRORS] = "i2c_errors",
+};
+
+/**
+ * @brief Adds one duration to the calling core's copy.
+ */
+void IRAM_ATTR metrics_record(metric_id_t id, uint32_t us) {
+    int bucket = us ? 32 - __builtin_clz(us) : 0;
+    if (bucket >= METRICS_BUCKETS) bucket = METRICS_BUCKETS - 1;
+    uint32_t gen = atomic_load_explicit(&s_reset_gen, memory_order_relaxed);
+
+    // Masking keeps an ISR on this core out; the other core has its own copy
+    UBaseType_t mask = portSET_INTERRUPT_MASK_FROM_ISR();
+    histogram_t *h = &s_histograms[xPortGetCoreID()][id];
+    unsigned seq = atomic_load_explicit(&h->seq, memory_order_relaxed);
+    atomic_store_explicit(&h->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    if (h->gen != gen) {
+        for (int b = 0; b < METRICS_BUCKETS; b++) {
+            h->buckets[b] = 0;      // no memset: this must stay IRAM-safe
+        }
+        h->count = 0;
+        h->max_us = 0;
+        h->sum_us = 0;
+        h->gen = gen;
+    }
+    h->buckets[bucket]++;
+    h->count++;
+    h->sum_us += us;
+    if (us > h->max_us) h->max_us = us;
+    atomic_store_explicit(&h->seq, seq + 2, memory_order_release);
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+}
+
+/**
+ * @brief Merges the per-core copies of a histogram.
+ */
+void metrics_get(metric_id_t id, metrics_histogram_t *out) {
+    memset(out, 0, sizeof(*out));
+    uint32_t gen = atomic_load_explicit(&s_reset_gen, memory_order_relaxed);
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        histogram_t *h = &s_histograms[core][id];
+        histogram_t copy;
+        unsigned begin, end;
+        do {
+            begin = atomic_load_explicit(&h->seq, memory_order_acquire);
+            copy.gen = h->gen;
+            copy.count = h->count;
+            copy.max_us = h->max_us;
+            copy.sum_us = h->sum_us;
+            memcpy(copy.buckets, h->buckets, sizeof(copy.buckets));
+            atomic_thread_fence(memory_order_acquire);
+            end = atomic_load_explicit(&h->seq, memory_order_relaxed);
+        } while ((begin & 1u) || begin != end);
+        if (copy.gen != gen) {
+            continue;   // nothing recorded on this core since the last reset
+        }
+        out->count += copy.count;
+        out->sum_us += copy.sum_us;
+        if (copy.max_us > out->max_us) out->max_us = copy.max_us;
+        for (int b = 0; b < METRICS_BUCKETS; b++) {
+            out->buckets[b] += copy.buckets[b];
+        }
+    }
+}
+
+void IRAM_ATTR metrics_counter_inc(metric_counter_id_t id) {
+    atomic_fetch_add_explicit(&s_counters[id], 1, memory_order_relaxed);
+}
+
+uint32_t metrics_counter_get(metric_counter_id_t id) {
+    return atomic_load_explicit(&s_counters[id], memory_order_relaxed);
+}
+
+void metrics_reset(void) {
+    // Each core clears its own copy on its next record; until then readers skip it
+    atomic_fetch_add_explicit(&s_reset_gen, 1, memory_order_relaxed);
+}
+
+const char *metrics_name(metric_id_t id) {
+    return (id >= 0 && id < METRIC_COUNT) ? s_names[id] : "unknown";
+}
+
+const char *metrics_counter_name(metric_counter_id_t id) {
+    return (id >= 0 && id < METRIC_COUNTER_COUNT) ? s_counter_names[id] : "unknown";
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "encoder.h"
+
+#define ODOMETER_FLASH_SLOTS 8      ///< NVS keys the flash checkpoints rotate through
+
+/**
+ * @brief Checkpoint intervals and the checkpoint task.
+ */
+typedef struct {
+    uint32_t rtc_interval_ms;       ///< RTC memory checkpoint; cheap, survives software resets
+    uint32_t flash_interval_ms;     ///< Flash checkpoint; only written if a count changed
+    BaseType_t core;                ///< Core the task is pinned to, tskNO_AFFINITY to float
+    UBaseType_t priority;
+    uint32_t stack_size;
+} odometer_config_t;
+
+#define ODOMETER_CONFIG_DEFAULT() { \
+    .rtc_interval_ms = 100,         \
+    .flash_interval_ms = 60000,     \
+    .core = tskNO_AFFINITY,         \
+    .priority = 2,                  \
+    .stack_size = 3072,             \
+}
+
+/**
+ * @brief Restores the pulse counts of all created channels.
+ *
+ * The RTC memory copy is used if it survived the reset (esp_restart(), panic,
+ * watchdog, usually brownout); after a power cycle the newest valid flash
+ * checkpoint is used instead. Counts saved in another counting mode are
+ * rescaled to the current one. Call after creating the encoder channels.
+ *
+ * @return esp_err_t ESP_OK if restored, ESP_ERR_NOT_FOUND if no checkpoint exists
+ */
+esp_err_t odometer_restore(void);
+
+/**
+ * @brief Starts the low-priority checkpoint task.
+ *
+ * Flash checkpoints rotate through ODOMETER_FLASH_SLOTS NVS keys with a
+ * sequence number and CRC, so a write torn by power loss leaves the previous
+ * checkpoint readable, and unchanged counts are never rewritten.
+ *
+ * @param config Checkpoint intervals
+ * @return esp_err_t ESP_OK, or ESP_ERR_INVALID_STATE if already running
+ */
+esp_err_t odometer_start(const odometer_config_t *config);
+
+/**
+ * @brief Writes an RTC and a flash checkpoint now.
+ *
+ * Call after resetting a counter or before a planned esp_restart().
+ *
+ * @return esp_err_t Result of the flash write
+ */
+esp_err_t odometer_save_now(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,226 @@
+#include "odometer.h"
+#include "nvs_flash.h"
+#include "nvs.h"
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_system.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char* TAG = "ODOMETER";
+static const char* NVS_NAMESPACE = "odometer";
+
+#define ODOMETER_MAGIC 0x4F444F31u  // "ODO1"; change with the record layout
+
+/**
+ * @brief Checkpoint of every channel's pulse count.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;                                   ///< Increments per flash write; newest slot wins
+    uint32_t channels;
+    uint8_t count_mode[ENCODER_MAX_CHANNELS];       ///< Mode the counts were taken in
+    int64_t pulses[ENCODER_MAX_CHANNELS];
+    uint32_t crc;                                   ///< CRC-32 of all fields above
+} odometer_record_t;
+
+// Survives software resets; validated by magic and CRC, garbage after power-on
+static RTC_NOINIT_ATTR odometer_record_t s_rtc_record;
+
+static odometer_config_t s_config;
+static TaskHandle_t s_task = NULL;
+static SemaphoreHandle_t s_lock = NULL;
+static uint32_t s_flash_seq = 0;                    ///< Sequence of the newest flash checkpoint
+static odometer_record_t s_flashed;                 ///< Counts of the last flash write
+static bool s_flashed_valid = false;
+
+static uint32_t record_crc(const odometer_record_t* rec) {
+    return esp_rom_crc32_le(0, (const uint8_t*)rec, offsetof(odometer_record_t, crc));
+}
+
+static bool record_valid(const odometer_record_t* rec) {
+    return rec->magic == ODOMETER_MAGIC && rec->channels <= ENCODER_MAX_CHANNELS && rec->crc == record_crc(rec);
+}
+
+// Captures the current counts of all channels
+static void record_capture(odometer_record_t* rec) {
+    memset(rec, 0, sizeof(*rec));
+    rec->magic = ODOMETER_MAGIC;
+    rec->channels = encoder_channel_count();
+    for (uint32_t i = 0; i < rec->channels; i++) {
+        encoder_handle_t enc = encoder_channel_get(i);
+        rec->count_mode[i] = (uint8_t)encoder_channel_get_counting(enc).count_mode;
+        rec->pulses[i] = encoder_channel_get_pulses(enc);
+    }
+}
+
+static bool counts_equal(const odometer_record_t* a, const odometer_record_t* b) {
+    return a->channels == b->channels &&
+           memcmp(a->count_mode, b->count_mode, sizeof(a->count_mode)) == 0 &&
+           memcmp(a->pulses, b->pulses, sizeof(a->pulses)) == 0;
+}
+
+static void slot_key(char* buf, size_t len, uint32_t seq) {
+    snprintf(buf, len, "odo%u", (unsigned)(seq % ODOMETER_FLASH_SLOTS));
+}
+
+// Finds the newest valid flash checkpoint; also sets the sequence to continue from
+static bool flash_latest(odometer_record_t* out) {
+    nvs_handle_t handle;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return false;
+    }
+    bool found = false;
+    for (uint32_t slot = 0; slot < ODOMETER_FLASH_SLOTS; slot++) {
+        char key[NVS_KEY_NAME_MAX_SIZE];
+        slot_key(key, sizeof(key), slot);
+        odometer_record_t rec;
+        size_t size = sizeof(rec);
+        if (nvs_get_blob(handle, key, &rec, &size) == ESP_OK && size == sizeof(rec) && record_valid(&rec) &&
+            (!found || (int32_t)(rec.seq - out->seq) > 0)) {
+            *out = rec;
+            found = true;
+        }
+    }
+    nvs_close(handle);
+    if (found) {
+        s_flash_seq = out->seq;
+    }
+    return found;
+}
+
+// Writes the record to the slot after the newest one
+static esp_err_t flash_write(odometer_record_t* rec) {
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    rec->seq = s_flash_seq + 1;
+    rec->crc = record_crc(rec);
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    slot_key(key, sizeof(key), rec->seq);
+    err = nvs_set_blob(handle, key, rec, sizeof(*rec));
+    if (err == ESP_OK) err = nvs_commit(handle);
+    nvs_close(handle);
+
+    if (err == ESP_OK) {
+        s_flash_seq = rec->seq;
+        s_flashed = *rec;
+        s_flashed_valid = true;
+    } else {
+        ESP_LOGE(TAG, "Flash checkpoint failed: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
+static void rtc_write(odometer_record_t* rec) {
+    rec->seq = s_flash_seq;
+    rec->crc = record_crc(rec);
+    s_rtc_record = *rec;
+}
+
+/**
+ * @brief Restores every channel from the RTC copy or the newest flash checkpoint.
+ */
+esp_err_t odometer_restore(void) {
+    odometer_record_t flash;
+    bool have_flash = flash_latest(&flash);
+    // What flash holds now, whichever copy is restored: an RTC copy newer than it still gets written
+    s_flashed = flash;
+    s_flashed_valid = have_flash;
+
+    odometer_record_t rec;
+    const char* source;
+    if (esp_reset_reason() != ESP_RST_POWERON && record_valid(&s_rtc_record)) {
+        rec = s_rtc_record;
+        source = "RTC memory";
+    } else if (have_flash) {
+        rec = flash;
+        source = "flash";
+    } else {
+        ESP_LOGW(TAG, "No checkpoint, starting from zero");
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    uint32_t count = encoder_channel_count();
+    for (uint32_t i = 0; i < rec.channels && i < count; i++) {
+        encoder_handle_t enc = encoder_channel_get(i);
+        int64_t pulses = rec.pulses[i];
+        int mode = encoder_channel_get_counting(enc).count_mode;
+        if (rec.count_mode[i] != 0 && rec.count_mode[i] != mode) {
+            pulses = pulses * mode / rec.count_mode[i];
+        }
+        encoder_channel_set_pulses(enc, pulses);
+        ESP_LOGI(TAG, "Channel %u restored from %s: %lld pulses", (unsigned)i, source, (long long)pulses);
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Writes both checkpoints under the lock.
+ */
+esp_err_t odometer_save_now(void) {
+    if (!s_lock) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    odometer_record_t rec;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    record_capture(&rec);
+    esp_err_t err = flash_write(&rec);
+    rtc_write(&rec);
+    xSemaphoreGive(s_lock);
+    return err;
+}
+
+/**
+ * @brief Checkpoint loop: RTC every rtc_interval_ms, flash every flash_interval_ms if moved.
+ */
+static void odometer_task(void* arg) {
+    TickType_t last_flash = xTaskGetTickCount();
+    TickType_t last_wake = last_flash;
+    while (1) {
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(s_config.rtc_interval_ms));
+
+        odometer_record_t rec;
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        record_capture(&rec);
+        if (xTaskGetTickCount() - last_flash >= pdMS_TO_TICKS(s_config.flash_interval_ms)) {
+            last_flash = xTaskGetTickCount();
+            if (!s_flashed_valid || !counts_equal(&rec, &s_flashed)) {
+                flash_write(&rec);
+            }
+        }
+        rtc_write(&rec);
+        xSemaphoreGive(s_lock);
+    }
+}
+
+/**
+ * @brief Starts periodic checkpointing.
+ */
+esp_err_t odometer_start(const odometer_config_t* config) {
+    if (s_task) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_config = *config;
+    if (s_config.rtc_interval_ms < 10) s_config.rtc_interval_ms = 10;
+    if (s_config.flash_interval_ms < s_config.rtc_interval_ms) s_config.flash_interval_ms = s_config.rtc_interval_ms;
+
+    s_lock = xSemaphoreCreateMutex();
+    if (!s_lock) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreatePinnedToCore(odometer_task, "odometer", s_config.stack_size, NULL, s_config.priority, &s_task,
+                                s_config.core) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Checkpoints: RTC every %u ms, flash every %u ms", (unsigned)s_config.rtc_interval_ms,
+             (unsigned)s_config.flash_interval_ms);
+    return ESP_OK;
+}
@@ -1,6 +1,11 @@
 #pragma once
 
 #include "esp_err.h"
+#include "encoder_filter.h"
+#include "encoder.h"
+#include "settings_httpd.h"
+
+#define SETTINGS_MAX_CHANNELS 8     ///< Encoder channels with their own stored settings
 
 /**
  * @brief Load settings from NVS or use defaults.
@@ -19,3 +24,107 @@ esp_err_t settings_load(float* out_diameter, float* out_factor);
  * @return esp_err_t 
  */
 esp_err_t settings_save(float diameter, float factor);
+
+/**
+ * @brief Load the settings of one encoder channel from NVS or use defaults.
+ *
+ * Channel 0 shares its keys with settings_load(), so existing devices keep
+ * their calibration.
+ *
+ * @param channel Encoder channel index (0..SETTINGS_MAX_CHANNELS-1)
+ * @param out_diameter Pointer to store diameter value (mm)
+ * @param out_factor Pointer to store calibration factor
+ * @return esp_err_t 
+ */
+esp_err_t settings_load_channel(int channel, float* out_diameter, float* out_factor);
+
+/**
+ * @brief Save the settings of one encoder channel to NVS.
+ *
+ * @param channel Encoder channel index (0..SETTINGS_MAX_CHANNELS-1)
+ * @param diameter Diameter in millimeters
+ * @param factor Calibration factor
+ * @return esp_err_t 
+ */
+esp_err_t settings_save_channel(int channel, float diameter, float factor);
+
+/**
+ * @brief Load the speed filter configuration from NVS.
+ *
+ * Falls back to encoder_filter_default_config() if nothing is stored.
+ *
+ * @param channel Encoder channel index (0..SETTINGS_MAX_CHANNELS-1)
+ * @param out_config Pointer to store the configuration
+ * @return esp_err_t 
+ */
+esp_err_t settings_load_filter(int channel, encoder_filter_config_t* out_config);
+
+/**
+ * @brief Save the speed filter configuration to NVS.
+ *
+ * @param channel Encoder channel index (0..SETTINGS_MAX_CHANNELS-1)
+ * @param config Filter configuration
+ * @return esp_err_t 
+ */
+esp_err_t settings_save_filter(int channel, const encoder_filter_config_t* config);
+
+/**
+ * @brief Load the noise rejection configuration of one encoder channel from NVS.
+ *
+ * Falls back to the default glitch filter with plausibility checks off.
+ *
+ * @param channel Encoder channel index (0..SETTINGS_MAX_CHANNELS-1)
+ * @param out_config Pointer to store the configuration
+ * @return esp_err_t 
+ */
+esp_err_t settings_load_noise(int channel, encoder_noise_config_t* out_config);
+
+/**
+ * @brief Save the noise rejection configuration of one encoder channel to NVS.
+ *
+ * @param channel Encoder channel index (0..SETTINGS_MAX_CHANNELS-1)
+ * @param config Noise rejection configuration
+ * @return esp_err_t 
+ */
+esp_err_t settings_save_noise(int channel, const encoder_noise_config_t* config);
+
+/**
+ * @brief Load the pins and decoding of one encoder channel from NVS.
+ *
+ * Leaves out_counting untouched if nothing is stored, so the caller fills in
+ * the board defaults first.
+ *
+ * @param channel Encoder channel index (0..SETTINGS_MAX_CHANNELS-1)
+ * @param out_counting Defaults on entry, stored configuration on return
+ * @return esp_err_t 
+ */
+esp_err_t settings_load_counting(int channel, encoder_counting_t* out_counting);
+
+/**
+ * @brief Save the pins and decoding of one encoder channel to NVS.
+ *
+ * @param channel Encoder channel index (0..SETTINGS_MAX_CHANNELS-1)
+ * @param counting Pins, resolution and decoding
+ * @return esp_err_t 
+ */
+esp_err_t settings_save_counting(int channel, const encoder_counting_t* counting);
+
+/**
+ * @brief Load the HTTP server tuning from NVS.
+ *
+ * Leaves out_config untouched if nothing is stored, so the caller fills in
+ * the defaults first. Tuning stored by older firmware is read with
+ * lru_purge off, the current default.
+ *
+ * @param out_config Defaults on entry, stored tuning on return
+ * @return esp_err_t 
+ */
+esp_err_t settings_load_httpd(settings_httpd_t* out_config);
+
+/**
+ * @brief Save the HTTP server tuning to NVS; applied at the next start.
+ *
+ * @param config Server tuning
+ * @return esp_err_t 
+ */
+esp_err_t settings_save_httpd(const settings_httpd_t* config);
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Kept free of IDF headers so the web layer's host build can use it
+
+/**
+ * @brief HTTP server tuning; read when the server starts.
+ */
+typedef struct {
+    uint16_t max_open_sockets;          ///< Client connections held at once, streams included
+    uint16_t backlog_conn;              ///< Pending connections queued by the listener
+    bool lru_purge;                     ///< When full, close the least recently used connection (streams excepted)
+    bool keep_alive;                    ///< TCP keep-alive probes on idle connections
+    uint16_t keep_alive_idle_s;         ///< Idle time before the first probe
+    uint16_t recv_timeout_s;
+    uint16_t send_timeout_s;
+    uint32_t stack_size;                ///< Server task stack in bytes
+    int8_t core;                        ///< Server task core
+} settings_httpd_t;
@@ -2,20 +2,39 @@
 #include "nvs_flash.h"
 #include "nvs.h"
 #include "esp_log.h"
+#include <stdio.h>
 
 static const char* TAG = "SETTINGS";
 static const char* NVS_NAMESPACE = "storage";
 static const char* KEY_DIAMETER = "diameter";
 static const char* KEY_FACTOR   = "factor";
+static const char* KEY_FILTER   = "filter";
+static const char* KEY_NOISE    = "noise";
+static const char* KEY_COUNTING = "counting";
+static const char* KEY_HTTPD    = "httpd2";
+static const char* KEY_HTTPD_V1 = "httpd";     // written while lru_purge defaulted to true
 
 static const float DEFAULT_DIAMETER = 100.0f;
 static const float DEFAULT_FACTOR = 1.0f;
 
 static bool nvs_initialized = false;
 // Cache for loaded settings to avoid unnecessary writes
-static float cached_diameter = -1.0f;
-static float cached_factor = -1.0f;
-static bool cache_loaded = false;
+static float cached_diameter[SETTINGS_MAX_CHANNELS];
+static float cached_factor[SETTINGS_MAX_CHANNELS];
+static bool cache_loaded[SETTINGS_MAX_CHANNELS];
+
+// Builds the NVS key of a per-channel value; channel 0 keeps the original key names
+static void channel_key(char* buf, size_t len, const char* base, int channel) {
+    if (channel == 0) {
+        snprintf(buf, len, "%s", base);
+    } else {
+        snprintf(buf, len, "%s%d", base, channel);
+    }
+}
+
+static bool channel_valid(int channel) {
+    return channel >= 0 && channel < SETTINGS_MAX_CHANNELS;
+}
 
 // Ensures NVS is initialized before reading or writing
 static esp_err_t ensure_nvs_ready(void) {
@@ -36,7 +55,22 @@ static esp_err_t ensure_nvs_ready(void) {
 
 // Loads settings from NVS or applies defaults if not found
 esp_err_t settings_load(float* out_diameter, float* out_factor) {
-    if (!out_diameter || !out_factor) return ESP_ERR_INVALID_ARG;
+    return settings_load_channel(0, out_diameter, out_factor);
+}
+
+// Saves settings to NVS only if values changed (to reduce flash wear)
+esp_err_t settings_save(float diameter, float factor) {
+    return settings_save_channel(0, diameter, factor);
+}
+
+// Loads the settings of one encoder channel or applies defaults if not found
+esp_err_t settings_load_channel(int channel, float* out_diameter, float* out_factor) {
+    if (!out_diameter || !out_factor || !channel_valid(channel)) return ESP_ERR_INVALID_ARG;
+
+    char key_diameter[NVS_KEY_NAME_MAX_SIZE];
+    char key_factor[NVS_KEY_NAME_MAX_SIZE];
+    channel_key(key_diameter, sizeof(key_diameter), KEY_DIAMETER, channel);
+    channel_key(key_factor, sizeof(key_factor), KEY_FACTOR, channel);
 
     esp_err_t err = ensure_nvs_ready();
     if (err != ESP_OK) return err;
@@ -50,14 +84,14 @@ esp_err_t settings_load(float* out_diameter, float* out_factor) {
     } else {
         size_t size = sizeof(float);
 
-        err = nvs_get_blob(handle, KEY_DIAMETER, out_diameter, &size);
+        err = nvs_get_blob(handle, key_diameter, out_diameter, &size);
         if (err != ESP_OK) {
             *out_diameter = DEFAULT_DIAMETER;
             ESP_LOGW(TAG, "Diameter not found, default %.2f", *out_diameter);
         }
 
         size = sizeof(float);
-        err = nvs_get_blob(handle, KEY_FACTOR, out_factor, &size);
+        err = nvs_get_blob(handle, key_factor, out_factor, &size);
         if (err != ESP_OK) {
             *out_factor = DEFAULT_FACTOR;
             ESP_LOGW(TAG, "Factor not found, default %.3f", *out_factor);
@@ -66,21 +100,23 @@ esp_err_t settings_load(float* out_diameter, float* out_factor) {
         nvs_close(handle);
     }
 
-    cached_diameter = *out_diameter;
-    cached_factor = *out_factor;
-    cache_loaded = true;
+    cached_diameter[channel] = *out_diameter;
+    cached_factor[channel] = *out_factor;
+    cache_loaded[channel] = true;
 
-    ESP_LOGI(TAG, "Loaded settings: diameter=%.2f, factor=%.3f", *out_diameter, *out_factor);
+    ESP_LOGI(TAG, "Loaded settings [%d]: diameter=%.2f, factor=%.3f", channel, *out_diameter, *out_factor);
 
     return ESP_OK;
 }
 
-// Saves settings to NVS only if values changed (to reduce flash wear)
-esp_err_t settings_save(float diameter, float factor) {
+// Saves the settings of one encoder channel only if values changed
+esp_err_t settings_save_channel(int channel, float diameter, float factor) {
+    if (!channel_valid(channel)) return ESP_ERR_INVALID_ARG;
+
     esp_err_t err = ensure_nvs_ready();
     if (err != ESP_OK) return err;
 
-    if (cache_loaded && diameter == cached_diameter && factor == cached_factor) {
+    if (cache_loaded[channel] && diameter == cached_diameter[channel] && factor == cached_factor[channel]) {
         ESP_LOGI(TAG, "No change in settings, skip save");
         return ESP_OK;
     }
@@ -92,14 +128,17 @@ esp_err_t settings_save(float diameter, float factor) {
         return err;
     }
 
-    err = nvs_set_blob(handle, KEY_DIAMETER, &diameter, sizeof(float));
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    channel_key(key, sizeof(key), KEY_DIAMETER, channel);
+    err = nvs_set_blob(handle, key, &diameter, sizeof(float));
     if (err != ESP_OK) {
         nvs_close(handle);
         ESP_LOGE(TAG, "Save diameter failed");
         return err;
     }
 
-    err = nvs_set_blob(handle, KEY_FACTOR, &factor, sizeof(float));
+    channel_key(key, sizeof(key), KEY_FACTOR, channel);
+    err = nvs_set_blob(handle, key, &factor, sizeof(float));
     if (err != ESP_OK) {
         nvs_close(handle);
         ESP_LOGE(TAG, "Save factor failed");
@@ -110,14 +149,261 @@ esp_err_t settings_save(float diameter, float factor) {
     nvs_close(handle);
 
     if (err == ESP_OK) {
-        cached_diameter = diameter;
-        cached_factor = factor;
-        cache_loaded = true;
+        cached_diameter[channel] = diameter;
+        cached_factor[channel] = factor;
+        cache_loaded[channel] = true;
 
-        ESP_LOGI(TAG, "Settings saved: diameter=%.2f mm, factor=%.3f", diameter, factor);
+        ESP_LOGI(TAG, "Settings saved [%d]: diameter=%.2f mm, factor=%.3f", channel, diameter, factor);
     } else {
         ESP_LOGE(TAG, "Commit failed");
     }
 
     return err;
 }
+
+// Loads the speed filter configuration, or the default (no filtering) if none is stored
+esp_err_t settings_load_filter(int channel, encoder_filter_config_t* out_config) {
+    if (!out_config || !channel_valid(channel)) return ESP_ERR_INVALID_ARG;
+
+    *out_config = encoder_filter_default_config();
+
+    esp_err_t err = ensure_nvs_ready();
+    if (err != ESP_OK) return err;
+
+    nvs_handle_t handle;
+    err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "NVS open failed, filter default");
+        return ESP_OK;
+    }
+
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    channel_key(key, sizeof(key), KEY_FILTER, channel);
+
+    encoder_filter_config_t stored;
+    size_t size = sizeof(stored);
+    err = nvs_get_blob(handle, key, &stored, &size);
+    nvs_close(handle);
+
+    if (err == ESP_OK && size == sizeof(stored)) {
+        *out_config = stored;
+        ESP_LOGI(TAG, "Loaded filter [%d]: %s", channel, encoder_filter_type_name(stored.type));
+    } else {
+        ESP_LOGW(TAG, "Filter [%d] not found, default %s", channel, encoder_filter_type_name(out_config->type));
+    }
+    return ESP_OK;
+}
+
+// Saves the speed filter configuration
+esp_err_t settings_save_filter(int channel, const encoder_filter_config_t* config) {
+    if (!config || !channel_valid(channel)) return ESP_ERR_INVALID_ARG;
+
+    esp_err_t err = ensure_nvs_ready();
+    if (err != ESP_OK) return err;
+
+    nvs_handle_t handle;
+    err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "NVS open failed");
+        return err;
+    }
+
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    channel_key(key, sizeof(key), KEY_FILTER, channel);
+    err = nvs_set_blob(handle, key, config, sizeof(*config));
+    if (err == ESP_OK) err = nvs_commit(handle);
+    nvs_close(handle);
+
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Filter saved [%d]: %s", channel, encoder_filter_type_name(config->type));
+    } else {
+        ESP_LOGE(TAG, "Save filter failed");
+    }
+    return err;
+}
+
+// Loads the noise rejection configuration, or the default glitch filter if none is stored
+esp_err_t settings_load_noise(int channel, encoder_noise_config_t* out_config) {
+    if (!out_config || !channel_valid(channel)) return ESP_ERR_INVALID_ARG;
+
+    *out_config = (encoder_noise_config_t){ .glitch_filter_ns = ENCODER_GLITCH_FILTER_DEFAULT_NS };
+
+    esp_err_t err = ensure_nvs_ready();
+    if (err != ESP_OK) return err;
+
+    nvs_handle_t handle;
+    err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "NVS open failed, noise default");
+        return ESP_OK;
+    }
+
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    channel_key(key, sizeof(key), KEY_NOISE, channel);
+
+    encoder_noise_config_t stored;
+    size_t size = sizeof(stored);
+    err = nvs_get_blob(handle, key, &stored, &size);
+    nvs_close(handle);
+
+    if (err == ESP_OK && size == sizeof(stored)) {
+        *out_config = stored;
+        ESP_LOGI(TAG, "Loaded noise [%d]: glitch=%u ns, max speed=%.2f, max accel=%.2f", channel,
+                 (unsigned)stored.glitch_filter_ns, stored.plausibility.max_speed_mps, stored.plausibility.max_accel_mps2);
+    } else {
+        ESP_LOGW(TAG, "Noise [%d] not found, default glitch %u ns", channel, (unsigned)out_config->glitch_filter_ns);
+    }
+    return ESP_OK;
+}
+
+// Saves the noise rejection configuration
+esp_err_t settings_save_noise(int channel, const encoder_noise_config_t* config) {
+    if (!config || !channel_valid(channel)) return ESP_ERR_INVALID_ARG;
+
+    esp_err_t err = ensure_nvs_ready();
+    if (err != ESP_OK) return err;
+
+    nvs_handle_t handle;
+    err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "NVS open failed");
+        return err;
+    }
+
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    channel_key(key, sizeof(key), KEY_NOISE, channel);
+    err = nvs_set_blob(handle, key, config, sizeof(*config));
+    if (err == ESP_OK) err = nvs_commit(handle);
+    nvs_close(handle);
+
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Noise saved [%d]: glitch=%u ns", channel, (unsigned)config->glitch_filter_ns);
+    } else {
+        ESP_LOGE(TAG, "Save noise failed");
+    }
+    return err;
+}
+
+// Loads pins and decoding; out_counting keeps the caller's defaults if none are stored
+esp_err_t settings_load_counting(int channel, encoder_counting_t* out_counting) {
+    if (!out_counting || !channel_valid(channel)) return ESP_ERR_INVALID_ARG;
+
+    esp_err_t err = ensure_nvs_ready();
+    if (err != ESP_OK) return err;
+
+    nvs_handle_t handle;
+    err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "NVS open failed, counting default");
+        return ESP_OK;
+    }
+
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    channel_key(key, sizeof(key), KEY_COUNTING, channel);
+
+    encoder_counting_t stored;
+    size_t size = sizeof(stored);
+    err = nvs_get_blob(handle, key, &stored, &size);
+    nvs_close(handle);
+
+    if (err == ESP_OK && size == sizeof(stored)) {
+        *out_counting = stored;
+        ESP_LOGI(TAG, "Loaded counting [%d]: A=%d B=%d Z=%d, ppr=%d x%d%s", channel, stored.pin_a, stored.pin_b,
+                 stored.pin_z, stored.pulses_per_rev, stored.count_mode, stored.invert ? " inverted" : "");
+    } else {
+        ESP_LOGW(TAG, "Counting [%d] not found, using defaults", channel);
+    }
+    return ESP_OK;
+}
+
+// Saves pins and decoding
+esp_err_t settings_save_counting(int channel, const encoder_counting_t* counting) {
+    if (!counting || !channel_valid(channel)) return ESP_ERR_INVALID_ARG;
+
+    esp_err_t err = ensure_nvs_ready();
+    if (err != ESP_OK) return err;
+
+    nvs_handle_t handle;
+    err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "NVS open failed");
+        return err;
+    }
+
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    channel_key(key, sizeof(key), KEY_COUNTING, channel);
+    err = nvs_set_blob(handle, key, counting, sizeof(*counting));
+    if (err == ESP_OK) err = nvs_commit(handle);
+    nvs_close(handle);
+
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Counting saved [%d]: ppr=%d x%d", channel, counting->pulses_per_rev, counting->count_mode);
+    } else {
+        ESP_LOGE(TAG, "Save counting failed");
+    }
+    return err;
+}
+
+// Loads the HTTP server tuning; out_config keeps the caller's defaults if none is stored
+esp_err_t settings_load_httpd(settings_httpd_t* out_config) {
+    if (!out_config) return ESP_ERR_INVALID_ARG;
+
+    esp_err_t err = ensure_nvs_ready();
+    if (err != ESP_OK) return err;
+
+    nvs_handle_t handle;
+    err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "NVS open failed, httpd default");
+        return ESP_OK;
+    }
+
+    settings_httpd_t stored;
+    size_t size = sizeof(stored);
+    err = nvs_get_blob(handle, KEY_HTTPD, &stored, &size);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        // Migrate: the old blob carries the old lru_purge default, which closed idle-looking streams
+        size = sizeof(stored);
+        err = nvs_get_blob(handle, KEY_HTTPD_V1, &stored, &size);
+        if (err == ESP_OK && size == sizeof(stored) && stored.lru_purge) {
+            stored.lru_purge = false;
+            ESP_LOGW(TAG, "Httpd tuning from older firmware: lru_purge turned off");
+        }
+    }
+    nvs_close(handle);
+
+    if (err == ESP_OK && size == sizeof(stored)) {
+        *out_config = stored;
+        ESP_LOGI(TAG, "Loaded httpd: %u sockets, stack %u on core %d", (unsigned)stored.max_open_sockets,
+                 (unsigned)stored.stack_size, stored.core);
+    } else {
+        ESP_LOGW(TAG, "Httpd tuning not found, using defaults");
+    }
+    return ESP_OK;
+}
+
+// Saves the HTTP server tuning
+esp_err_t settings_save_httpd(const settings_httpd_t* config) {
+    if (!config) return ESP_ERR_INVALID_ARG;
+
+    esp_err_t err = ensure_nvs_ready();
+    if (err != ESP_OK) return err;
+
+    nvs_handle_t handle;
+    err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "NVS open failed");
+        return err;
+    }
+
+    err = nvs_set_blob(handle, KEY_HTTPD, config, sizeof(*config));
+    if (err == ESP_OK) err = nvs_commit(handle);
+    nvs_close(handle);
+
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Httpd saved: %u sockets", (unsigned)config->max_open_sockets);
+    } else {
+        ESP_LOGE(TAG, "Save httpd failed");
+    }
+    return err;
+}
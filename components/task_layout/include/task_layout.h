@@ -0,0 +1,100 @@
+#pragma once
+
+/**
+ * Core, priority and stack of every task the project creates.
+ *
+ * Core 0 runs the Wi-Fi driver (CONFIG_ESP_WIFI_TASK_PINNED_TO_CORE_0), the
+ * esp_timer task and everything network-facing. Core 1 is kept for the
+ * measurement pipeline, so encoder sampling is not delayed by Wi-Fi bursts.
+ * Each value can be overridden with a build flag (-DTASK_SAMPLER_CORE=0) to
+ * compare layouts with the sampler jitter statistics in /data.
+ *
+ * Interrupts are not placed by these values. An ISR runs on the core that
+ * allocated it, so app_main creates the encoder channels from a task pinned
+ * to TASK_SAMPLER_CORE: the PCNT watch-point ISRs and the GPIO ISR service
+ * (edge and index pulses) follow the sampler. The esp_timer ISR that wakes
+ * the sampler is set in sdkconfig (CONFIG_ESP_TIMER_ISR_AFFINITY_CPU1); when
+ * moving the sampler to core 0, change it there as well.
+ */
+
+#include "freertos/FreeRTOS.h"
+
+#define TASK_CORE_NETWORK 0
+#define TASK_CORE_MEASURE 1
+
+// Encoder sampling: speed, rings, events, trigger service
+#ifndef TASK_SAMPLER_CORE
+#define TASK_SAMPLER_CORE       TASK_CORE_MEASURE
+#endif
+#ifndef TASK_SAMPLER_PRIORITY
+#define TASK_SAMPLER_PRIORITY   (configMAX_PRIORITIES - 5)
+#endif
+#ifndef TASK_SAMPLER_STACK
+#define TASK_SAMPLER_STACK      4096
+#endif
+
+// LCD refresh and encoder event log
+#ifndef TASK_DISPLAY_CORE
+#define TASK_DISPLAY_CORE       TASK_CORE_NETWORK
+#endif
+#ifndef TASK_DISPLAY_PRIORITY
+#define TASK_DISPLAY_PRIORITY   3
+#endif
+#ifndef TASK_DISPLAY_STACK
+#define TASK_DISPLAY_STACK      4096
+#endif
+
+// Wi-Fi connection, then web server start
+#ifndef TASK_WIFI_CORE
+#define TASK_WIFI_CORE          TASK_CORE_NETWORK
+#endif
+#ifndef TASK_WIFI_PRIORITY
+#define TASK_WIFI_PRIORITY      5
+#endif
+#ifndef TASK_WIFI_STACK
+#define TASK_WIFI_STACK         4096
+#endif
+
+// esp_http_server
+#ifndef TASK_HTTPD_CORE
+#define TASK_HTTPD_CORE         TASK_CORE_NETWORK
+#endif
+#ifndef TASK_HTTPD_PRIORITY
+#define TASK_HTTPD_PRIORITY     5
+#endif
+#ifndef TASK_HTTPD_STACK
+#define TASK_HTTPD_STACK        4096
+#endif
+
+// WebSocket sample broadcaster
+#ifndef TASK_WS_CORE
+#define TASK_WS_CORE            TASK_CORE_NETWORK
+#endif
+#ifndef TASK_WS_PRIORITY
+#define TASK_WS_PRIORITY        4
+#endif
+#ifndef TASK_WS_STACK
+#define TASK_WS_STACK           3072
+#endif
+
+// Server-Sent Events stream
+#ifndef TASK_SSE_CORE
+#define TASK_SSE_CORE           TASK_CORE_NETWORK
+#endif
+#ifndef TASK_SSE_PRIORITY
+#define TASK_SSE_PRIORITY       4
+#endif
+#ifndef TASK_SSE_STACK
+#define TASK_SSE_STACK          4096
+#endif
+
+// Odometer checkpoints; flash writes stall both cores' caches regardless of the core
+#ifndef TASK_ODOMETER_CORE
+#define TASK_ODOMETER_CORE      TASK_CORE_NETWORK
+#endif
+#ifndef TASK_ODOMETER_PRIORITY
+#define TASK_ODOMETER_PRIORITY  2
+#endif
+#ifndef TASK_ODOMETER_STACK
+#define TASK_ODOMETER_STACK     3072
+#endif
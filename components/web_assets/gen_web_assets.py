@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+"""Generates the embedded web asset table from the files in data/.
+
+Each file is gzipped when that makes it smaller and appended to one const
+blob, so it stays in flash and is sent straight from the mapped image. The
+table is sorted by path for binary search and carries the MIME type, so
+the server needs no per-file code. The ETag is a hash of the stored bytes,
+so it changes exactly when the response body does. Output is deterministic
+(gzip mtime 0, sorted paths).
+"""
+import argparse
+import gzip
+import hashlib
+import os
+import sys
+
+MIME_TYPES = {
+    ".html": "text/html",
+    ".css": "text/css",
+    ".js": "application/javascript",
+    ".json": "application/json",
+    ".svg": "image/svg+xml",
+    ".png": "image/png",
+    ".ico": "image/x-icon",
+    ".txt": "text/plain",
+    ".woff2": "font/woff2",
+}
+
+
+def c_bytes(data, indent="    ", per_line=16):
+    lines = []
+    for i in range(0, len(data), per_line):
+        lines.append(indent + ", ".join("0x%02x" % b for b in data[i:i + per_line]) + ",")
+    return "\n".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--out", required=True, help="C file to write")
+    parser.add_argument("files", nargs="*", help="Asset files; served as /<file name>")
+    args = parser.parse_args()
+
+    assets = []
+    for path in args.files:
+        if not os.path.isfile(path):
+            continue
+        with open(path, "rb") as f:
+            raw = f.read()
+        packed = gzip.compress(raw, compresslevel=9, mtime=0)
+        gz = len(packed) < len(raw)
+        body = packed if gz else raw
+        etag = hashlib.sha256(body).hexdigest()[:16]
+        assets.append(("/" + os.path.basename(path), body, etag, gz, len(raw)))
+    assets.sort(key=lambda a: a[0].encode())
+
+    out = ["// Generated by gen_web_assets.py from data/; do not edit.", "",
+           '#include "web_assets.h"', ""]
+    blob = bytearray()
+    offsets = []
+    for url, body, _, _, raw_len in assets:
+        out.append("// %s at %d: %d -> %d bytes" % (url, len(blob), raw_len, len(body)))
+        offsets.append(len(blob))
+        blob += body
+    out.append("static const uint8_t web_assets_blob[] = {")
+    out.append(c_bytes(blob) if blob else "    0,")
+    out.append("};")
+    out.append("")
+    out.append("// Sorted by path (strcmp order) for web_assets_find()")
+    out.append("const web_asset_t web_assets[] = {")
+    for (url, body, etag, gz, _), offset in zip(assets, offsets):
+        mime = MIME_TYPES.get(os.path.splitext(url)[1].lower(), "application/octet-stream")
+        out.append('    { "%s", web_assets_blob + %d, %d, "%s", "\\"%s\\"", %s },'
+                   % (url, offset, len(body), mime, etag, "true" if gz else "false"))
+    if not assets:
+        out.append("    { 0 },")
+    out.append("};")
+    out.append("")
+    out.append("const size_t web_assets_count = %d;" % len(assets))
+    out.append("")
+
+    text = "\n".join(out)
+    # Leave an identical file untouched so dependants are not rebuilt
+    if os.path.exists(args.out):
+        with open(args.out) as f:
+            if f.read() == text:
+                return 0
+    with open(args.out, "w") as f:
+        f.write(text)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Web pages embedded in the application image.
+ *
+ * The files in data/ are gzipped at build time (gen_web_assets.py) and
+ * linked as one const blob, so they are read straight from memory-mapped
+ * flash with no filesystem involved. The generated table is sorted by path;
+ * adding a file to data/ needs no code or URI handler.
+ */
+
+/**
+ * @brief One embedded file.
+ */
+typedef struct {
+    const char *path;           ///< URI path, e.g. "/index.html"
+    const uint8_t *data;        ///< Body as stored, in flash
+    size_t size;
+    const char *mime;           ///< Content-Type, from the file extension
+    const char *etag;           ///< Strong ETag, quoted, derived from the stored bytes
+    bool gzip;                  ///< Body is gzip-encoded
+} web_asset_t;
+
+/**
+ * @brief Looks up an embedded file by URI path; binary search, O(log n).
+ *
+ * @param path Path without query string
+ * @return const web_asset_t* The asset, or NULL if none matches
+ */
+const web_asset_t *web_assets_find(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
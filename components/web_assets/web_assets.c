@@ -0,0 +1,18 @@
+#include "web_assets.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Generated table, sorted by path; see gen_web_assets.py
+extern const web_asset_t web_assets[];
+extern const size_t web_assets_count;
+
+static int compare_path(const void *key, const void *entry) {
+    return strcmp(key, ((const web_asset_t *)entry)->path);
+}
+
+/**
+ * @brief Looks up an embedded file by URI path.
+ */
+const web_asset_t *web_assets_find(const char *path) {
+    return bsearch(path, web_assets, web_assets_count, sizeof(web_asset_t), compare_path);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief GET /metrics in the Prometheus text exposition format.
+ *
+ * Rendered line by line into one static buffer that is sent in chunks
+ * whenever it fills, so a scrape allocates nothing.
+ */
+esp_err_t prometheus_metrics_handler(httpd_req_t *req);
+
+extern const httpd_uri_t uri_prometheus_metrics;
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+#include <assert.h>
+
+#include "encoder.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief One sample in the binary wire formats of /ws and /api/samples.
+ *
+ * Little-endian, packed, 32 bytes. Distance is in exact micrometres, so no
+ * precision is lost to text formatting.
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t channel;
+    uint8_t reserved[3];
+    uint32_t seq;
+    int64_t timestamp_us;
+    int64_t distance_um;
+    float speed_mps;
+    float accel_mps2;
+} sample_record_t;
+
+static_assert(sizeof(sample_record_t) == 32, "wire record layout");
+
+/**
+ * @brief Encodes a ring sample of a channel.
+ */
+static inline sample_record_t sample_record_make(encoder_handle_t enc, uint8_t channel, const encoder_sample_t *sample) {
+    sample_record_t record = {
+        .channel = channel,
+        .seq = sample->seq,
+        .timestamp_us = sample->timestamp_us,
+        .distance_um = encoder_channel_pulses_to_um(enc, sample->pulses),
+        .speed_mps = sample->speed_mps,
+        .accel_mps2 = sample->accel_mps2,
+    };
+    return record;
+}
+
+#ifdef __cplusplus
+}
+#endif
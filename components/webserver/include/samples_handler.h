@@ -0,0 +1,38 @@
+#pragma once
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Batched sample history (GET /api/samples).
+ *
+ * Query: channel (default 0), since (sequence of the first sample wanted;
+ * default the oldest held), max (default and cap ENCODER_RING_CAPACITY) and
+ * format=json|bin (also selected by "Accept: application/octet-stream").
+ *
+ * JSON: {"channel", "fields": [...], "samples": [[seq, t_us, pulses,
+ * distance_um, speed_mps, accel_mps2], ...], "next", "dropped"}. Pass "next"
+ * as since on the following request; "dropped" counts samples overwritten
+ * before they could be returned.
+ *
+ * Binary: 8-byte header {u8 version, u8 record size, u8 channel, u8 reserved,
+ * u32 samples skipped because since was no longer held}, then sample_record_t
+ * records to the end of the body. Later losses show as gaps in seq.
+ *
+ * The ring holds ENCODER_RING_CAPACITY samples per channel, so a collector
+ * must poll at least that often (about 5 s at 100 Hz) to see every sample.
+ */
+
+#define SAMPLES_BIN_VERSION 1
+
+esp_err_t samples_get_handler(httpd_req_t *req);
+
+extern const httpd_uri_t uri_api_samples;
+
+#ifdef __cplusplus
+}
+#endif
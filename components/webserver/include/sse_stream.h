@@ -0,0 +1,47 @@
+#pragma once
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Server-Sent Events stream (/events?rate=N).
+ *
+ * For clients behind proxies that do not pass WebSockets. The request is
+ * taken over as an async handler and answered with a chunked
+ * text/event-stream response that stays open. Each tick of the rate sends
+ * one "data:" message with the newest distance and speed of every channel.
+ * Intermediate samples are coalesced away, and unchanged states are not
+ * resent. Encoder events go out to every client as "event: encoder"
+ * messages as soon as they occur.
+ *
+ * Sends run as work on the server task and never block it: each writes
+ * what the socket takes right now and leaves the rest for the next tick. A
+ * client that cannot keep up collects text in its backlog. Once the backlog
+ * is full, its states are skipped and its events are counted in an
+ * "event: dropped" message. A client whose socket takes nothing for
+ * SSE_STREAM_STALL_MS is disconnected.
+ */
+
+#define SSE_STREAM_MAX_CLIENTS      3
+#define SSE_STREAM_MAX_RATE_HZ      20
+#define SSE_STREAM_DEFAULT_RATE_HZ  5
+#define SSE_STREAM_KEEPALIVE_MS     15000   ///< Comment line sent to idle clients so proxies keep the connection
+#define SSE_STREAM_BACKLOG          2048    ///< Bytes of text held per client while a send is pending
+#define SSE_STREAM_STALL_MS         5000    ///< A client whose socket takes nothing for this long is dropped
+
+/**
+ * @brief Starts the stream task.
+ *
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_STATE if already started, ESP_ERR_NO_MEM
+ */
+esp_err_t sse_stream_start(void);
+
+extern const httpd_uri_t uri_sse_stream;
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Wildcard GET route for the pages embedded from data/ (web_assets.h).
+ *
+ * "/" redirects to /index.html. Sends gzip-encoded bodies with a strong
+ * ETag and answers a matching If-None-Match with 304. Register it last;
+ * every GET no other route claims ends up here.
+ */
+esp_err_t serve_file_handler(httpd_req_t *req);
+
+extern const httpd_uri_t uri_static;
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+#include "settings_httpd.h"
+#include "encoder_core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Request body parsers of the web API.
+ *
+ * Pure functions over the body text. They do no I/O and take no encoder or
+ * NVS state, so the host build (host/web_bench.c) can fuzz and time them.
+ * Partial updates are applied onto values the caller fills in first.
+ */
+
+/**
+ * @brief Wi-Fi credentials posted to /config.
+ */
+typedef struct {
+    char ssid[33];                  ///< Up to 32 bytes, NUL-terminated
+    char password[65];              ///< Up to 64 bytes, NUL-terminated
+} web_wifi_credentials_t;
+
+/**
+ * @brief Trigger request posted to /api/trigger.
+ */
+typedef struct {
+    int channel;                    ///< Default 0
+    bool disarm;                    ///< {"disarm": true}; the other fields are then unused
+    double target_m;
+    int output_pin;                 ///< -1 if not given
+    int output_level;               ///< Default 1
+} web_trigger_request_t;
+
+/**
+ * @brief Channel settings posted to /api/settings.
+ *
+ * Pins are plain ints so the parsers stay free of the GPIO driver headers;
+ * -1 means not wired.
+ */
+typedef struct {
+    float diameter;                 ///< Wheel diameter in millimeters
+    float factor;                   ///< Calibration factor
+    bool has_filter;                ///< The body had a "filter" object
+    encoder_filter_config_t filter;
+    bool has_noise;                 ///< The body had a "noise" object
+    uint32_t glitch_filter_ns;
+    encoder_plausibility_t plausibility;
+    bool has_counting;              ///< The body had a "counting" object
+    int pin_a;
+    int pin_b;
+    int pin_z;
+    int pulses_per_rev;
+    encoder_count_mode_t count_mode;
+    bool invert;
+} web_settings_t;
+
+/**
+ * @brief Parses {"ssid", "password"}.
+ *
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_ARG if not JSON or a field is missing,
+ *         ESP_ERR_INVALID_SIZE if a field is too long
+ */
+esp_err_t web_parse_wifi_credentials(const char *body, web_wifi_credentials_t *out);
+
+/**
+ * @brief Parses a trigger arm or disarm request.
+ *
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_ARG if not JSON, ESP_ERR_NOT_FOUND if target_m is missing
+ */
+esp_err_t web_parse_trigger(const char *body, web_trigger_request_t *out);
+
+/**
+ * @brief Applies the fields present in a /api/httpd body; others keep their value.
+ *
+ * Negative numbers read as 0; the caller clamps the result to what the
+ * server supports.
+ *
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_ARG if not JSON
+ */
+esp_err_t web_parse_httpd_tuning(const char *body, settings_httpd_t *inout);
+
+/**
+ * @brief Reads the channel a /api/settings body is for, so its current values can be loaded.
+ *
+ * @return esp_err_t ESP_OK (channel 0 if not given), ESP_ERR_INVALID_ARG if not JSON
+ */
+esp_err_t web_parse_settings_channel(const char *body, int *channel);
+
+/**
+ * @brief Applies the fields present in a /api/settings body; others keep their value.
+ *
+ * A negative glitch_ns is ignored, larger values saturate.
+ *
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_ARG if not JSON, ESP_ERR_NOT_SUPPORTED for an unknown filter type
+ */
+esp_err_t web_parse_settings(const char *body, web_settings_t *inout);
+
+/**
+ * @brief Parses the form-urlencoded "value=<factor>" posted to /set_calib.
+ *
+ * @return esp_err_t ESP_OK, ESP_ERR_NOT_FOUND without a value field,
+ *         ESP_ERR_INVALID_ARG if the value is not a finite number > 0
+ */
+esp_err_t web_parse_calibration(const char *body, float *value);
+
+#ifdef __cplusplus
+}
+#endif
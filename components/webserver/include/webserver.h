@@ -6,6 +6,19 @@ extern "C" {
 
 #include "esp_err.h"
 #include "esp_http_server.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define MAX_URI_HANDLERS 20
+
+/**
+ * @brief Request counter of one route.
+ */
+typedef struct {
+    const char *uri;
+    httpd_method_t method;
+    uint32_t requests;
+} webserver_route_stats_t;
 
 /**
  * @brief Starts the HTTP web server.
@@ -26,6 +39,15 @@ esp_err_t start_webserver(void);
  */
 void register_api_handlers(httpd_handle_t server);
 
+/**
+ * @brief Copies the request counters of the registered routes.
+ *
+ * @param out Destination array
+ * @param max Capacity of out, MAX_URI_HANDLERS covers every route
+ * @return size_t Number of routes copied
+ */
+size_t webserver_get_route_stats(webserver_route_stats_t *out, size_t max);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Live sample stream over WebSocket (/ws).
+ *
+ * One broadcaster task reads every channel's sample ring with a single
+ * cursor and encodes each sample once. Each client then gets the records
+ * that match its rate, appended to its own backlog. The client's next binary
+ * frame carries the whole backlog. Frames are written without blocking the
+ * server task: each send writes what the socket takes right now and leaves
+ * the rest for the next tick. Meanwhile records keep collecting, and the
+ * oldest are dropped once the backlog is full, so a slow client never stalls
+ * the others. A client whose socket takes nothing for WS_STREAM_STALL_MS is
+ * disconnected. The dropped count also
+ * includes samples the ring overwrote before the broadcaster read them; those
+ * are counted at the sampling rate, not the client's.
+ *
+ * Frame: 8-byte header {u8 version, u8 record size, u16 record count,
+ * u32 records dropped since the previous frame}, then little-endian records
+ * {u8 channel, u8[3] reserved, u32 seq, i64 timestamp_us, i64 distance_um,
+ * f32 speed_mps, f32 accel_mps2} (sample_record_t).
+ *
+ * A client selects its rate by sending the text "rate=N" (Hz, 1..WS_STREAM_MAX_RATE_HZ).
+ */
+
+#define WS_STREAM_MAX_CLIENTS      4
+#define WS_STREAM_MAX_RATE_HZ      100
+#define WS_STREAM_DEFAULT_RATE_HZ  20
+#define WS_STREAM_BACKLOG          64      ///< Records held per client between frames
+#define WS_STREAM_STALL_MS         5000    ///< A client whose socket takes nothing for this long is closed
+#define WS_STREAM_VERSION          1
+
+/**
+ * @brief Starts the broadcaster task for the given server.
+ *
+ * @param server Running HTTP server
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_STATE if already started, ESP_ERR_NO_MEM
+ */
+esp_err_t ws_stream_start(httpd_handle_t server);
+
+/**
+ * @brief Forgets a client whose socket is closing; called from the server's close_fn.
+ */
+void ws_stream_on_close(int fd);
+
+extern const httpd_uri_t uri_ws_stream;
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,183 @@
+#include "prometheus_handler.h"
+#include "webserver.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <inttypes.h>
+
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_wifi.h"
+#include "encoder.h"
+#include "metrics.h"
+
+static const char *TAG = "PROMETHEUS";
+
+#define PROMETHEUS_CHUNK_SIZE 1536
+
+/**
+ * @brief Output position in the chunk buffer.
+ */
+typedef struct {
+    httpd_req_t *req;
+    size_t len;
+    esp_err_t err;      ///< First send error; later output is dropped
+} prom_writer_t;
+
+static char s_chunk[PROMETHEUS_CHUNK_SIZE];    // handlers run on the single httpd task
+
+static void prom_flush(prom_writer_t *w) {
+    if (w->len && w->err == ESP_OK) {
+        w->err = httpd_resp_send_chunk(w->req, s_chunk, w->len);
+    }
+    w->len = 0;
+}
+
+/**
+ * @brief Appends formatted text, sending the buffer first if the text does not fit.
+ */
+static void prom_printf(prom_writer_t *w, const char *fmt, ...) {
+    for (int attempt = 0; attempt < 2 && w->err == ESP_OK; attempt++) {
+        va_list args;
+        va_start(args, fmt);
+        int n = vsnprintf(s_chunk + w->len, sizeof(s_chunk) - w->len, fmt, args);
+        va_end(args);
+        if (n < 0) {
+            return;
+        }
+        if (w->len + n < sizeof(s_chunk)) {
+            w->len += n;
+            return;
+        }
+        prom_flush(w);
+    }
+}
+
+static void prom_header(prom_writer_t *w, const char *name, const char *type, const char *help) {
+    prom_printf(w, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+static const char *method_name(httpd_method_t method) {
+    switch (method) {
+        case HTTP_GET:    return "GET";
+        case HTTP_POST:   return "POST";
+        case HTTP_PUT:    return "PUT";
+        case HTTP_DELETE: return "DELETE";
+        default:          return "OTHER";
+    }
+}
+
+static void write_encoder_metrics(prom_writer_t *w) {
+    size_t count = encoder_channel_count();
+
+    prom_header(w, "encoder_pulses", "gauge", "Signed pulse count; decreases on reverse motion and resets");
+    for (size_t i = 0; i < count; i++) {
+        prom_printf(w, "encoder_pulses{channel=\"%u\"} %" PRId64 "\n", (unsigned)i,
+                    encoder_channel_get_pulses(encoder_channel_get(i)));
+    }
+    prom_header(w, "encoder_distance_meters", "gauge", "Calibrated travelled distance");
+    for (size_t i = 0; i < count; i++) {
+        prom_printf(w, "encoder_distance_meters{channel=\"%u\"} %.6f\n", (unsigned)i,
+                    encoder_channel_get_distance_m(encoder_channel_get(i)));
+    }
+    prom_header(w, "encoder_speed_meters_per_second", "gauge", "Filtered speed");
+    for (size_t i = 0; i < count; i++) {
+        prom_printf(w, "encoder_speed_meters_per_second{channel=\"%u\"} %.4f\n", (unsigned)i,
+                    encoder_channel_get_speed_mps(encoder_channel_get(i)));
+    }
+
+    prom_header(w, "encoder_overflow_irqs_total", "counter", "PCNT limit interrupts");
+    for (size_t i = 0; i < count; i++) {
+        encoder_irq_stats_t irq = encoder_channel_get_irq_stats(encoder_channel_get(i));
+        prom_printf(w, "encoder_overflow_irqs_total{channel=\"%u\"} %u\n", (unsigned)i, (unsigned)irq.watch_irqs);
+    }
+    prom_header(w, "encoder_resets_total", "counter", "Count resets since boot");
+    for (size_t i = 0; i < count; i++) {
+        prom_printf(w, "encoder_resets_total{channel=\"%u\"} %u\n", (unsigned)i,
+                    (unsigned)encoder_channel_get_reset_count(encoder_channel_get(i)));
+    }
+    prom_header(w, "encoder_rejected_samples_total", "counter", "Speed samples rejected by the plausibility limits");
+    for (size_t i = 0; i < count; i++) {
+        encoder_plausibility_stats_t noise = encoder_channel_get_noise_stats(encoder_channel_get(i));
+        prom_printf(w, "encoder_rejected_samples_total{channel=\"%u\",limit=\"speed\"} %u\n"
+                       "encoder_rejected_samples_total{channel=\"%u\",limit=\"accel\"} %u\n",
+                    (unsigned)i, (unsigned)noise.speed_violations, (unsigned)i, (unsigned)noise.accel_violations);
+    }
+
+    encoder_sampler_stats_t sampler;
+    encoder_get_sampler_stats(&sampler);
+    prom_header(w, "encoder_sampler_overruns_total", "counter", "Sampling ticks missed because a pass was still running");
+    prom_printf(w, "encoder_sampler_overruns_total %u\n", (unsigned)sampler.overruns);
+}
+
+static void write_system_metrics(prom_writer_t *w) {
+    webserver_route_stats_t routes[MAX_URI_HANDLERS];
+    size_t count = webserver_get_route_stats(routes, MAX_URI_HANDLERS);
+    prom_header(w, "http_requests_total", "counter", "HTTP requests per route");
+    for (size_t i = 0; i < count; i++) {
+        prom_printf(w, "http_requests_total{uri=\"%s\",method=\"%s\"} %u\n", routes[i].uri,
+                    method_name(routes[i].method), (unsigned)routes[i].requests);
+    }
+
+#if METRICS_ENABLED
+    prom_header(w, "i2c_errors_total", "counter", "Failed I2C transactions");
+    prom_printf(w, "i2c_errors_total %u\n", (unsigned)metrics_counter_get(METRIC_I2C_ERRORS));
+#endif
+
+    prom_header(w, "heap_free_bytes", "gauge", "Free heap");
+    prom_printf(w, "heap_free_bytes %u\n", (unsigned)esp_get_free_heap_size());
+    prom_header(w, "heap_min_free_bytes", "gauge", "Lowest free heap since boot");
+    prom_printf(w, "heap_min_free_bytes %u\n", (unsigned)esp_get_minimum_free_heap_size());
+
+    wifi_ap_record_t ap;
+    if (esp_wifi_sta_get_ap_info(&ap) == ESP_OK) {
+        prom_header(w, "wifi_rssi_dbm", "gauge", "Signal strength of the associated access point");
+        prom_printf(w, "wifi_rssi_dbm %d\n", ap.rssi);
+    }
+}
+
+#if METRICS_ENABLED
+static void write_histograms(prom_writer_t *w) {
+    prom_header(w, "latency_seconds", "histogram", "Task jitter, ISR, I2C and HTTP handler durations");
+    for (int id = 0; id < METRIC_COUNT; id++) {
+        metrics_histogram_t hist;
+        metrics_get((metric_id_t)id, &hist);
+        const char *name = metrics_name((metric_id_t)id);
+        uint32_t cumulative = 0;
+        for (int b = 0; b < METRICS_BUCKETS - 1; b++) {
+            cumulative += hist.buckets[b];
+            // Bucket b ends below 2^b us; samples are whole us, so its inclusive bound is 2^b - 1
+            prom_printf(w, "latency_seconds_bucket{source=\"%s\",le=\"%g\"} %u\n", name,
+                        (double)((1u << b) - 1) / 1e6, (unsigned)cumulative);
+        }
+        prom_printf(w, "latency_seconds_bucket{source=\"%s\",le=\"+Inf\"} %u\n"
+                       "latency_seconds_sum{source=\"%s\"} %.6f\n"
+                       "latency_seconds_count{source=\"%s\"} %u\n",
+                    name, (unsigned)hist.count, name, (double)hist.sum_us / 1e6, name, (unsigned)hist.count);
+    }
+}
+#endif
+
+esp_err_t prometheus_metrics_handler(httpd_req_t *req) {
+    httpd_resp_set_type(req, "text/plain; version=0.0.4; charset=utf-8");
+    prom_writer_t writer = { .req = req, .len = 0, .err = ESP_OK };
+
+    write_encoder_metrics(&writer);
+    write_system_metrics(&writer);
+#if METRICS_ENABLED
+    write_histograms(&writer);
+#endif
+    prom_flush(&writer);
+
+    if (writer.err != ESP_OK) {
+        ESP_LOGW(TAG, "Scrape aborted: %s", esp_err_to_name(writer.err));
+        return writer.err;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+const httpd_uri_t uri_prometheus_metrics = {
+    .uri       = "/metrics",
+    .method    = HTTP_GET,
+    .handler   = prometheus_metrics_handler,
+    .user_ctx  = NULL
+};
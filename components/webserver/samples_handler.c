@@ -0,0 +1,167 @@
+#include "samples_handler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+#include "encoder.h"
+#include "sample_record.h"
+
+#define SAMPLES_CHUNK_SIZE 2048
+#define SAMPLES_READ_BATCH 32
+
+typedef struct __attribute__((packed)) {
+    uint8_t version;
+    uint8_t record_size;
+    uint8_t channel;
+    uint8_t reserved;
+    uint32_t skipped;
+} samples_bin_header_t;
+
+static_assert(sizeof(samples_bin_header_t) == 8, "wire header layout");
+
+static char s_chunk[SAMPLES_CHUNK_SIZE];       // handlers run on the single httpd task
+
+/**
+ * @brief Parsed query of one request.
+ */
+typedef struct {
+    int channel;
+    bool has_since;
+    uint32_t since;
+    size_t max;
+    bool binary;
+} samples_query_t;
+
+static void parse_query(httpd_req_t *req, samples_query_t *q) {
+    q->channel = 0;
+    q->has_since = false;
+    q->since = 0;
+    q->max = ENCODER_RING_CAPACITY;
+    q->binary = false;
+
+    char accept[48];
+    if (httpd_req_get_hdr_value_str(req, "Accept", accept, sizeof(accept)) == ESP_OK &&
+        strstr(accept, "application/octet-stream")) {
+        q->binary = true;
+    }
+
+    char query[96], value[16];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK) {
+        return;
+    }
+    if (httpd_query_key_value(query, "channel", value, sizeof(value)) == ESP_OK) {
+        q->channel = atoi(value);
+    }
+    if (httpd_query_key_value(query, "since", value, sizeof(value)) == ESP_OK) {
+        q->since = (uint32_t)strtoul(value, NULL, 10);
+        q->has_since = true;
+    }
+    if (httpd_query_key_value(query, "max", value, sizeof(value)) == ESP_OK) {
+        long max = atol(value);
+        if (max > 0 && max < ENCODER_RING_CAPACITY) q->max = (size_t)max;
+    }
+    if (httpd_query_key_value(query, "format", value, sizeof(value)) == ESP_OK) {
+        q->binary = strcmp(value, "bin") == 0;
+    }
+}
+
+/**
+ * @brief Appends to the chunk buffer, sending it first when full; returns the new length.
+ */
+static size_t chunk_append(httpd_req_t *req, size_t len, const void *data, size_t size, esp_err_t *err) {
+    if (len + size > sizeof(s_chunk)) {
+        if (*err == ESP_OK) *err = httpd_resp_send_chunk(req, s_chunk, len);
+        len = 0;
+    }
+    memcpy(s_chunk + len, data, size);
+    return len + size;
+}
+
+static esp_err_t send_binary(httpd_req_t *req, encoder_handle_t enc, int channel, encoder_ring_cursor_t *cursor,
+                             size_t max) {
+    httpd_resp_set_type(req, "application/octet-stream");
+    esp_err_t err = ESP_OK;
+    samples_bin_header_t header = {
+        .version = SAMPLES_BIN_VERSION,
+        .record_size = sizeof(sample_record_t),
+        .channel = (uint8_t)channel,
+        .skipped = cursor->dropped,
+    };
+    size_t len = chunk_append(req, 0, &header, sizeof(header), &err);
+
+    encoder_sample_t samples[SAMPLES_READ_BATCH];
+    size_t total = 0, n;
+    while (total < max && err == ESP_OK &&
+           (n = encoder_channel_samples_read(enc, cursor, samples,
+                                             max - total < SAMPLES_READ_BATCH ? max - total : SAMPLES_READ_BATCH)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            sample_record_t record = sample_record_make(enc, (uint8_t)channel, &samples[i]);
+            len = chunk_append(req, len, &record, sizeof(record), &err);
+        }
+        total += n;
+    }
+    if (err == ESP_OK && len) err = httpd_resp_send_chunk(req, s_chunk, len);
+    if (err == ESP_OK) err = httpd_resp_send_chunk(req, NULL, 0);
+    return err;
+}
+
+static esp_err_t send_json(httpd_req_t *req, encoder_handle_t enc, int channel, encoder_ring_cursor_t *cursor,
+                           size_t max) {
+    httpd_resp_set_type(req, "application/json");
+    esp_err_t err = ESP_OK;
+    char line[160];
+    int n = snprintf(line, sizeof(line),
+                     "{\"channel\": %d, \"fields\": [\"seq\",\"t_us\",\"pulses\",\"distance_um\",\"speed_mps\","
+                     "\"accel_mps2\"], \"samples\": [", channel);
+    size_t len = chunk_append(req, 0, line, n, &err);
+
+    encoder_sample_t samples[SAMPLES_READ_BATCH];
+    size_t total = 0, count;
+    while (total < max && err == ESP_OK &&
+           (count = encoder_channel_samples_read(enc, cursor, samples,
+                                                 max - total < SAMPLES_READ_BATCH ? max - total : SAMPLES_READ_BATCH)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            const encoder_sample_t *s = &samples[i];
+            // %.9g round-trips a float exactly
+            n = snprintf(line, sizeof(line), "%s[%" PRIu32 ",%" PRId64 ",%" PRId64 ",%" PRId64 ",%.9g,%.9g]",
+                         total + i ? "," : "", s->seq, s->timestamp_us, s->pulses,
+                         encoder_channel_pulses_to_um(enc, s->pulses), s->speed_mps, s->accel_mps2);
+            len = chunk_append(req, len, line, n, &err);
+        }
+        total += count;
+    }
+    n = snprintf(line, sizeof(line), "], \"next\": %" PRIu32 ", \"dropped\": %" PRIu32 "}", cursor->next,
+                 cursor->dropped);
+    len = chunk_append(req, len, line, n, &err);
+    if (err == ESP_OK) err = httpd_resp_send_chunk(req, s_chunk, len);
+    if (err == ESP_OK) err = httpd_resp_send_chunk(req, NULL, 0);
+    return err;
+}
+
+esp_err_t samples_get_handler(httpd_req_t *req) {
+    samples_query_t q;
+    parse_query(req, &q);
+    encoder_handle_t enc = q.channel >= 0 ? encoder_channel_get((size_t)q.channel) : NULL;
+    if (!enc) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown channel");
+    }
+
+    encoder_ring_cursor_t cursor;
+    if (q.has_since) {
+        encoder_channel_samples_cursor_seek(enc, &cursor, q.since);
+    } else {
+        // Seeking to 0 lands on the oldest sample held
+        encoder_channel_samples_cursor_seek(enc, &cursor, 0);
+        cursor.dropped = 0;
+    }
+    return q.binary ? send_binary(req, enc, q.channel, &cursor, q.max) : send_json(req, enc, q.channel, &cursor, q.max);
+}
+
+const httpd_uri_t uri_api_samples = {
+    .uri       = "/api/samples",
+    .method    = HTTP_GET,
+    .handler   = samples_get_handler,
+    .user_ctx  = NULL
+};
@@ -0,0 +1,337 @@
+#include "sse_stream.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "lwip/sockets.h"
+#include "encoder.h"
+#include "task_layout.h"
+
+static const char *TAG = "SSE_STREAM";
+
+#define SSE_STREAM_PERIOD_MS (1000 / SSE_STREAM_MAX_RATE_HZ)
+#define SSE_STATE_MAX (64 + 48 * ENCODER_MAX_CHANNELS)
+#define SSE_EVENTS_MAX 1024
+#define SSE_EVENT_QUEUE_LEN 16
+#define SSE_CHUNK_OVERHEAD 16    // hex length line and trailing CRLF of one HTTP chunk
+
+/**
+ * @brief One open stream; req is NULL for a free slot.
+ */
+typedef struct {
+    httpd_req_t *req;               ///< Async copy of the request, owned until completed
+    int64_t interval_us;
+    int64_t next_due_us;
+    int64_t last_send_us;
+    uint32_t version;               ///< State version last queued for this client
+    uint32_t dropped;               ///< Encoder events that did not fit in the backlog
+    bool send_queued;               ///< A send is queued on the server task
+    size_t pending_len;
+    char pending[SSE_STREAM_BACKLOG];   ///< Text not yet handed to the server task
+    size_t sending_len;             ///< Chunk in sending, 0 if none; set by send_work under the lock
+    size_t sent;                    ///< Bytes of that chunk the socket has taken
+    int64_t stalled_since_us;       ///< First send the socket took nothing of, 0 while it makes progress
+    char sending[SSE_STREAM_BACKLOG + SSE_CHUNK_OVERHEAD];  ///< Framed chunk; only send_work touches it
+} sse_client_t;
+
+static TaskHandle_t s_task = NULL;
+static QueueHandle_t s_events = NULL;
+static SemaphoreHandle_t s_lock = NULL;     // guards s_clients between the handler, send_work and the stream task
+static sse_client_t s_clients[SSE_STREAM_MAX_CLIENTS];
+
+// Formatted once per tick for all clients; only the stream task touches these
+static char s_channels[SSE_STATE_MAX];
+static char s_channels_sent[SSE_STATE_MAX];
+static char s_state[SSE_STATE_MAX + 48];
+static char s_event_text[SSE_EVENTS_MAX];
+static uint32_t s_state_version = 0;
+
+/**
+ * @brief Appends text to a client's backlog; false if it does not fit.
+ */
+static bool client_append(sse_client_t *client, const char *text, size_t len) {
+    if (len > sizeof(client->pending) - client->pending_len) {
+        return false;
+    }
+    memcpy(client->pending + client->pending_len, text, len);
+    client->pending_len += len;
+    return true;
+}
+
+/**
+ * @brief Reports events lost to a full backlog, once there is room again.
+ */
+static void client_append_dropped(sse_client_t *client) {
+    if (!client->dropped) {
+        return;
+    }
+    char notice[48];
+    int n = snprintf(notice, sizeof(notice), "event: dropped\ndata: {\"count\":%u}\n\n", (unsigned)client->dropped);
+    if (client_append(client, notice, n)) {
+        client->dropped = 0;
+    }
+}
+
+/**
+ * @brief Writes a client's backlog to its socket without blocking; runs on the server task.
+ *
+ * The backlog is framed as one HTTP chunk, as httpd_resp_send_chunk() would,
+ * and written with MSG_DONTWAIT, so the server task never waits on a client.
+ * What the socket does not take now stays in sending and is retried on the
+ * next tick while new text collects in pending. A client whose socket takes
+ * nothing for SSE_STREAM_STALL_MS is dropped, its connection closed.
+ */
+static void send_work(void *arg) {
+    sse_client_t *client = arg;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    httpd_req_t *req = client->req;
+    if (req && !client->sending_len && client->pending_len) {
+        int n = snprintf(client->sending, SSE_CHUNK_OVERHEAD, "%x\r\n", (unsigned)client->pending_len);
+        memcpy(client->sending + n, client->pending, client->pending_len);
+        memcpy(client->sending + n + client->pending_len, "\r\n", 2);
+        client->sending_len = n + client->pending_len + 2;
+        client->sent = 0;
+        client->pending_len = 0;
+    }
+    size_t len = client->sending_len;
+    xSemaphoreGive(s_lock);
+
+    bool drop = false;
+    if (req && len) {
+        int fd = httpd_req_to_sockfd(req);
+        int n = httpd_socket_send(req->handle, fd, client->sending + client->sent, len - client->sent, MSG_DONTWAIT);
+        if (n > 0) {
+            client->sent += n;
+            client->stalled_since_us = 0;
+            // The client never sends, so without this LRU purge (if enabled) would take the stream first
+            httpd_sess_update_lru_counter(req->handle, fd);
+        } else if (n == 0 || n == HTTPD_SOCK_ERR_TIMEOUT) {
+            int64_t now_us = esp_timer_get_time();
+            if (!client->stalled_since_us) {
+                client->stalled_since_us = now_us;
+            }
+            drop = now_us - client->stalled_since_us >= SSE_STREAM_STALL_MS * 1000LL;
+        } else {
+            drop = true;
+        }
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    client->send_queued = false;
+    if (client->sent == client->sending_len) {
+        client->sending_len = 0;
+    }
+    if (drop) {
+        // Cut off mid-chunk the response cannot go on, so the connection goes too
+        httpd_handle_t handle = req->handle;
+        int fd = httpd_req_to_sockfd(req);
+        httpd_req_async_handler_complete(req);
+        httpd_sess_trigger_close(handle, fd);
+        client->req = NULL;
+        client->sending_len = 0;
+        ESP_LOGI(TAG, "Client left");
+    }
+    xSemaphoreGive(s_lock);
+}
+
+/**
+ * @brief Formats the queued encoder events; returns the text length and their number.
+ */
+static size_t format_events(uint32_t *count) {
+    size_t len = 0;
+    uint32_t dropped = 0;
+    *count = 0;
+    encoder_event_t event;
+    while (xQueueReceive(s_events, &event, 0) == pdTRUE) {
+        // Leave room for the dropped notice
+        int n = snprintf(s_event_text + len, sizeof(s_event_text) - len - 64,
+                         "event: encoder\ndata: {\"channel\":%d,\"type\":\"%s\",\"distance\":%.3f,"
+                         "\"speed\":%.3f,\"direction\":%d}\n\n",
+                         event.channel, encoder_event_name(event.type), event.distance_um / 1e6,
+                         event.speed_mps, event.direction);
+        if (n > 0 && len + n < sizeof(s_event_text) - 64) {
+            len += n;
+            (*count)++;
+        } else {
+            dropped++;
+        }
+    }
+    if (dropped) {
+        len += snprintf(s_event_text + len, sizeof(s_event_text) - len, "event: dropped\ndata: {\"count\":%u}\n\n",
+                        (unsigned)dropped);
+    }
+    return len;
+}
+
+/**
+ * @brief Formats the newest state of every channel; bumps the version if it changed.
+ */
+static size_t format_state(int64_t now_us) {
+    size_t len = 0;
+    size_t count = encoder_channel_count();
+    for (size_t i = 0; i < count && len < sizeof(s_channels); i++) {
+        encoder_handle_t enc = encoder_channel_get(i);
+        len += snprintf(s_channels + len, sizeof(s_channels) - len, "%s{\"distance\":%.3f,\"speed\":%.3f}",
+                        i ? "," : "", encoder_channel_get_distance_m(enc), encoder_channel_get_speed_mps(enc));
+    }
+    if (strcmp(s_channels, s_channels_sent) != 0) {
+        strcpy(s_channels_sent, s_channels);
+        s_state_version++;
+    }
+    int n = snprintf(s_state, sizeof(s_state), "data: {\"t\":%lld,\"channels\":[%s]}\n\n",
+                     (long long)(now_us / 1000), s_channels);
+    return n < (int)sizeof(s_state) ? (size_t)n : sizeof(s_state) - 1;
+}
+
+/**
+ * @brief Stream task: one tick per SSE_STREAM_PERIOD_MS, formats once and fans out.
+ *
+ * Text goes into each client's backlog and the send is queued on the server
+ * task, as ws_stream does. send_work never blocks on a socket, so one slow
+ * client delays neither the others' ticks nor their sends.
+ */
+static void sse_stream_task(void *arg) {
+    const TickType_t period = pdMS_TO_TICKS(SSE_STREAM_PERIOD_MS) ? pdMS_TO_TICKS(SSE_STREAM_PERIOD_MS) : 1;
+    TickType_t last_wake = xTaskGetTickCount();
+
+    while (1) {
+        vTaskDelayUntil(&last_wake, period);
+        int64_t now_us = esp_timer_get_time();
+        uint32_t event_count;
+        size_t events_len = format_events(&event_count);
+
+        bool state_formatted = false;
+        size_t state_len = 0;
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        for (int c = 0; c < SSE_STREAM_MAX_CLIENTS; c++) {
+            sse_client_t *client = &s_clients[c];
+            if (!client->req) {
+                continue;
+            }
+            client_append_dropped(client);
+            if (events_len) {
+                if (client_append(client, s_event_text, events_len)) {
+                    client->last_send_us = now_us;
+                } else {
+                    client->dropped += event_count;
+                }
+            }
+            if (now_us >= client->next_due_us) {
+                client->next_due_us += client->interval_us;
+                if (client->next_due_us <= now_us) {
+                    client->next_due_us = now_us + client->interval_us;
+                }
+
+                if (!state_formatted) {
+                    state_len = format_state(now_us);
+                    state_formatted = true;
+                }
+                if (client->version != s_state_version) {
+                    // A state that does not fit is retried on the next due tick
+                    if (client_append(client, s_state, state_len)) {
+                        client->version = s_state_version;
+                        client->last_send_us = now_us;
+                    }
+                } else if (now_us - client->last_send_us >= SSE_STREAM_KEEPALIVE_MS * 1000LL) {
+                    static const char keepalive[] = ": keep-alive\n\n";
+                    if (client_append(client, keepalive, sizeof(keepalive) - 1)) {
+                        client->last_send_us = now_us;
+                    }
+                }
+            }
+
+            if ((client->pending_len || client->sending_len) && !client->send_queued) {
+                client->send_queued = httpd_queue_work(client->req->handle, send_work, client) == ESP_OK;
+            }
+        }
+        xSemaphoreGive(s_lock);
+    }
+}
+
+/**
+ * @brief Opens a stream: sends the headers, then hands the request to the stream task.
+ */
+static esp_err_t sse_stream_handler(httpd_req_t *req) {
+    int rate_hz = SSE_STREAM_DEFAULT_RATE_HZ;
+    char query[32], value[8];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "rate", value, sizeof(value)) == ESP_OK) {
+        rate_hz = atoi(value);
+        if (rate_hz < 1) rate_hz = 1;
+        if (rate_hz > SSE_STREAM_MAX_RATE_HZ) rate_hz = SSE_STREAM_MAX_RATE_HZ;
+    }
+
+    // Slots are only claimed here and freed in send_work, both on the server task. A freed
+    // slot may still have a send queued; it is not reused until that has run.
+    sse_client_t *slot = NULL;
+    for (int c = 0; c < SSE_STREAM_MAX_CLIENTS && !slot; c++) {
+        if (!s_clients[c].req && !s_clients[c].send_queued) slot = &s_clients[c];
+    }
+    if (!slot || !s_task) {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        return httpd_resp_sendstr(req, "Too many event streams");
+    }
+
+    httpd_resp_set_type(req, "text/event-stream");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    httpd_resp_set_hdr(req, "X-Accel-Buffering", "no");     // ask nginx-style proxies not to buffer
+    static const char hello[] = "retry: 2000\n\n";
+    esp_err_t err = httpd_resp_send_chunk(req, hello, sizeof(hello) - 1);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    httpd_req_t *async = NULL;
+    err = httpd_req_async_handler_begin(req, &async);
+    if (err != ESP_OK) {
+        return err;
+    }
+    int64_t now_us = esp_timer_get_time();
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    slot->interval_us = 1000000 / rate_hz;
+    slot->next_due_us = now_us;
+    slot->last_send_us = now_us;
+    slot->version = s_state_version - 1;    // first tick sends the state
+    slot->dropped = 0;
+    slot->pending_len = 0;
+    slot->sending_len = 0;
+    slot->stalled_since_us = 0;
+    slot->req = async;
+    xSemaphoreGive(s_lock);
+    ESP_LOGI(TAG, "Client joined at %d Hz", rate_hz);
+    return ESP_OK;
+}
+
+esp_err_t sse_stream_start(void) {
+    if (s_task) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_lock = xSemaphoreCreateMutex();
+    s_events = xQueueCreate(SSE_EVENT_QUEUE_LEN, sizeof(encoder_event_t));
+    if (!s_lock || !s_events) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t err = encoder_event_subscribe_queue(NULL, ENCODER_EVENT_ALL, s_events);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (xTaskCreatePinnedToCore(sse_stream_task, "sse_stream", TASK_SSE_STACK, NULL, TASK_SSE_PRIORITY, &s_task,
+                                TASK_SSE_CORE) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+const httpd_uri_t uri_sse_stream = {
+    .uri       = "/events",
+    .method    = HTTP_GET,
+    .handler   = sse_stream_handler,
+    .user_ctx  = NULL
+};
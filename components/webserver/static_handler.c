@@ -0,0 +1,58 @@
+#include "static_handler.h"
+#include <string.h>
+
+#include "esp_log.h"
+#include "web_assets.h"
+
+#define TAG "STATIC"
+
+esp_err_t serve_file_handler(httpd_req_t *req) {
+    // Wildcard route: serves the pages embedded from data/, gzipped, straight from flash
+    if (strcmp(req->uri, "/") == 0) {
+        // Redirect root to /index.html
+        httpd_resp_set_status(req, "302 Found");
+        httpd_resp_set_hdr(req, "Location", "/index.html");
+        httpd_resp_send(req, NULL, 0);
+        return ESP_OK;
+    }
+
+    char path[64];
+    size_t path_len = strcspn(req->uri, "?");
+    if (path_len >= sizeof(path)) {
+        return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "File not found");
+    }
+    memcpy(path, req->uri, path_len);
+    path[path_len] = 0;
+
+    const web_asset_t *asset = web_assets_find(path);
+    if (!asset) {
+        // Every unmatched GET lands here (favicon, probes); not worth a warning
+        ESP_LOGD(TAG, "File not found: %s", path);
+        return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "File not found");
+    }
+
+    // Pages are not fingerprinted: let browsers cache them but revalidate every load
+    httpd_resp_set_hdr(req, "ETag", asset->etag);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    char if_none_match[64];
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", if_none_match, sizeof(if_none_match)) == ESP_OK &&
+        strstr(if_none_match, asset->etag)) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    httpd_resp_set_type(req, asset->mime);
+    if (asset->gzip) {
+        httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    }
+    httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+    // One send with Content-Length; httpd writes it to the socket in as few segments as the window allows
+    return httpd_resp_send(req, (const char *)asset->data, asset->size);
+}
+
+const httpd_uri_t uri_static = {
+    .uri       = "/*",
+    .method    = HTTP_GET,
+    .handler   = serve_file_handler,
+    .user_ctx  = NULL
+};
@@ -0,0 +1,203 @@
+#include "web_parse.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cJSON.h"
+
+// Copies a JSON string field; false if missing, *too_long if it does not fit
+static bool copy_string(const cJSON *json, const char *name, char *out, size_t len, bool *too_long) {
+    const cJSON *item = cJSON_GetObjectItem(json, name);
+    if (!cJSON_IsString(item) || item->valuestring == NULL) {
+        return false;
+    }
+    size_t n = strlen(item->valuestring);
+    if (n >= len) {
+        *too_long = true;
+        return true;
+    }
+    memcpy(out, item->valuestring, n + 1);
+    return true;
+}
+
+// Returns a non-negative number field saturated at max, or current if absent
+static unsigned read_uint(const cJSON *json, const char *name, unsigned current, unsigned max) {
+    const cJSON *item = cJSON_GetObjectItem(json, name);
+    if (!cJSON_IsNumber(item)) {
+        return current;
+    }
+    double value = item->valuedouble;
+    return value <= 0 ? 0 : value >= max ? max : (unsigned)value;
+}
+
+static void read_bool(const cJSON *json, const char *name, bool *out) {
+    const cJSON *item = cJSON_GetObjectItem(json, name);
+    if (cJSON_IsBool(item)) {
+        *out = cJSON_IsTrue(item);
+    }
+}
+
+esp_err_t web_parse_wifi_credentials(const char *body, web_wifi_credentials_t *out) {
+    cJSON *json = cJSON_Parse(body);
+    if (!json) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(out, 0, sizeof(*out));
+    bool too_long = false;
+    bool found = copy_string(json, "ssid", out->ssid, sizeof(out->ssid), &too_long) &&
+                 copy_string(json, "password", out->password, sizeof(out->password), &too_long);
+    cJSON_Delete(json);
+    if (!found) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return too_long ? ESP_ERR_INVALID_SIZE : ESP_OK;
+}
+
+esp_err_t web_parse_trigger(const char *body, web_trigger_request_t *out) {
+    cJSON *json = cJSON_Parse(body);
+    if (!json) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out = (web_trigger_request_t){ .output_pin = -1, .output_level = 1 };
+
+    const cJSON *item = cJSON_GetObjectItem(json, "channel");
+    if (cJSON_IsNumber(item)) out->channel = item->valueint;
+    out->disarm = cJSON_IsTrue(cJSON_GetObjectItem(json, "disarm"));
+
+    esp_err_t err = ESP_OK;
+    if (!out->disarm) {
+        item = cJSON_GetObjectItem(json, "target_m");
+        if (cJSON_IsNumber(item)) {
+            out->target_m = item->valuedouble;
+        } else {
+            err = ESP_ERR_NOT_FOUND;
+        }
+        item = cJSON_GetObjectItem(json, "output_pin");
+        if (cJSON_IsNumber(item)) out->output_pin = item->valueint;
+        item = cJSON_GetObjectItem(json, "output_level");
+        if (cJSON_IsNumber(item)) out->output_level = item->valueint ? 1 : 0;
+    }
+    cJSON_Delete(json);
+    return err;
+}
+
+esp_err_t web_parse_httpd_tuning(const char *body, settings_httpd_t *inout) {
+    cJSON *json = cJSON_Parse(body);
+    if (!json) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    inout->max_open_sockets = read_uint(json, "max_open_sockets", inout->max_open_sockets, UINT16_MAX);
+    inout->backlog_conn = read_uint(json, "backlog_conn", inout->backlog_conn, UINT16_MAX);
+    inout->keep_alive_idle_s = read_uint(json, "keep_alive_idle_s", inout->keep_alive_idle_s, UINT16_MAX);
+    inout->recv_timeout_s = read_uint(json, "recv_timeout_s", inout->recv_timeout_s, UINT16_MAX);
+    inout->send_timeout_s = read_uint(json, "send_timeout_s", inout->send_timeout_s, UINT16_MAX);
+    inout->stack_size = read_uint(json, "stack_size", inout->stack_size, UINT32_MAX);
+    read_bool(json, "lru_purge", &inout->lru_purge);
+    read_bool(json, "keep_alive", &inout->keep_alive);
+    const cJSON *item = cJSON_GetObjectItem(json, "core");
+    if (cJSON_IsNumber(item)) {
+        // Out of range reads as -1, which the caller's clamp replaces with the default core
+        inout->core = item->valueint < 0 || item->valueint > INT8_MAX ? -1 : (int8_t)item->valueint;
+    }
+    cJSON_Delete(json);
+    return ESP_OK;
+}
+
+esp_err_t web_parse_settings_channel(const char *body, int *channel) {
+    cJSON *json = cJSON_Parse(body);
+    if (!json) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const cJSON *item = cJSON_GetObjectItem(json, "channel");
+    *channel = cJSON_IsNumber(item) ? item->valueint : 0;
+    cJSON_Delete(json);
+    return ESP_OK;
+}
+
+// Applies the "filter" object; false on an unknown type
+static bool parse_filter_settings(const cJSON *filter_json, encoder_filter_config_t *filter) {
+    const cJSON *item = cJSON_GetObjectItem(filter_json, "type");
+    if (cJSON_IsString(item) && encoder_filter_type_from_name(item->valuestring, &filter->type) != 0) {
+        return false;
+    }
+    filter->window = (uint16_t)read_uint(filter_json, "window", filter->window, UINT16_MAX);
+    item = cJSON_GetObjectItem(filter_json, "alpha");
+    if (cJSON_IsNumber(item)) filter->alpha = item->valuedouble;
+    item = cJSON_GetObjectItem(filter_json, "beta");
+    if (cJSON_IsNumber(item)) filter->beta = item->valuedouble;
+    item = cJSON_GetObjectItem(filter_json, "process_noise");
+    if (cJSON_IsNumber(item)) filter->process_noise = item->valuedouble;
+    item = cJSON_GetObjectItem(filter_json, "measurement_noise");
+    if (cJSON_IsNumber(item)) filter->measurement_noise = item->valuedouble;
+    return true;
+}
+
+// Applies the "noise" object
+static void parse_noise_settings(const cJSON *noise_json, web_settings_t *inout) {
+    const cJSON *item = cJSON_GetObjectItem(noise_json, "glitch_ns");
+    if (cJSON_IsNumber(item) && item->valuedouble >= 0) {
+        inout->glitch_filter_ns = read_uint(noise_json, "glitch_ns", inout->glitch_filter_ns, UINT32_MAX);
+    }
+    item = cJSON_GetObjectItem(noise_json, "max_speed");
+    if (cJSON_IsNumber(item)) inout->plausibility.max_speed_mps = item->valuedouble;
+    item = cJSON_GetObjectItem(noise_json, "max_accel");
+    if (cJSON_IsNumber(item)) inout->plausibility.max_accel_mps2 = item->valuedouble;
+}
+
+// Applies the "counting" object (pin_z -1 = no index)
+static void parse_counting_settings(const cJSON *counting_json, web_settings_t *inout) {
+    const cJSON *item = cJSON_GetObjectItem(counting_json, "pin_a");
+    if (cJSON_IsNumber(item)) inout->pin_a = item->valueint;
+    item = cJSON_GetObjectItem(counting_json, "pin_b");
+    if (cJSON_IsNumber(item)) inout->pin_b = item->valueint;
+    item = cJSON_GetObjectItem(counting_json, "pin_z");
+    if (cJSON_IsNumber(item)) inout->pin_z = item->valueint;
+    item = cJSON_GetObjectItem(counting_json, "ppr");
+    if (cJSON_IsNumber(item)) inout->pulses_per_rev = item->valueint;
+    item = cJSON_GetObjectItem(counting_json, "mode");
+    if (cJSON_IsNumber(item)) inout->count_mode = (encoder_count_mode_t)item->valueint;
+    read_bool(counting_json, "invert", &inout->invert);
+}
+
+esp_err_t web_parse_settings(const char *body, web_settings_t *inout) {
+    cJSON *json = cJSON_Parse(body);
+    if (!json) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const cJSON *item = cJSON_GetObjectItem(json, "diameter");
+    if (cJSON_IsNumber(item)) inout->diameter = item->valuedouble;
+    item = cJSON_GetObjectItem(json, "factor");
+    if (cJSON_IsNumber(item)) inout->factor = item->valuedouble;
+
+    esp_err_t err = ESP_OK;
+    item = cJSON_GetObjectItem(json, "filter");
+    inout->has_filter = cJSON_IsObject(item);
+    if (inout->has_filter && !parse_filter_settings(item, &inout->filter)) {
+        err = ESP_ERR_NOT_SUPPORTED;
+    }
+    item = cJSON_GetObjectItem(json, "noise");
+    inout->has_noise = cJSON_IsObject(item);
+    if (inout->has_noise) {
+        parse_noise_settings(item, inout);
+    }
+    item = cJSON_GetObjectItem(json, "counting");
+    inout->has_counting = cJSON_IsObject(item);
+    if (inout->has_counting) {
+        parse_counting_settings(item, inout);
+    }
+    cJSON_Delete(json);
+    return err;
+}
+
+esp_err_t web_parse_calibration(const char *body, float *value) {
+    const char *field = strstr(body, "value=");
+    if (!field) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    float val = strtof(field + 6, NULL);
+    if (!isfinite(val) || val <= 0.0f) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *value = val;
+    return ESP_OK;
+}
@@ -1,67 +1,117 @@
 #include "webserver.h"
 #include "wifi_handler.h"
+#include "prometheus_handler.h"
+#include "ws_stream.h"
+#include "sse_stream.h"
+#include "samples_handler.h"
+#include "static_handler.h"
+#include "web_parse.h"
 
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <stdatomic.h>
 
+#include "sdkconfig.h"
 #include "esp_log.h"
+#include "freertos/FreeRTOS.h"
 #include "esp_http_server.h"
-#include "esp_spiffs.h"
+#include "lwip/sockets.h"
 #include "cJSON.h"
 #include "nvs_flash.h"
 #include "nvs.h"
 #include "settings.h"
 #include "encoder.h"
 #include "calibration.h"
+#include "odometer.h"
+#include "task_layout.h"
+#include "metrics.h"
 
 #define TAG "WEBSERVER"
-#define FILE_PATH_MAX 520
-
-static esp_err_t serve_file_handler(httpd_req_t *req) {
-    // Serves static files from SPIFFS (HTML, CSS, JS, etc.)
-    char filepath[FILE_PATH_MAX];
-
-    if (strcmp(req->uri, "/") == 0) {
-        // Redirect root to /index.html
-        httpd_resp_set_status(req, "302 Found");
-        httpd_resp_set_hdr(req, "Location", "/index.html");
-        httpd_resp_send(req, NULL, 0);
-        return ESP_OK;
-    }
-
-    snprintf(filepath, sizeof(filepath), "/spiffs%s", req->uri);
-    FILE *file = fopen(filepath, "r");
-    if (!file) {
-        // File not found in SPIFFS
-        ESP_LOGW(TAG, "File not found: %s", filepath);
-        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "File not found");
-        return ESP_FAIL;
+#define DATA_JSON_MAX (480 + 384 * ENCODER_MAX_CHANNELS)
+#define METRICS_JSON_MAX (128 + 256 * METRIC_COUNT)
+
+// httpd keeps three sockets of its own besides the client connections
+#ifdef CONFIG_LWIP_MAX_SOCKETS
+#define HTTPD_SOCKETS_MAX (CONFIG_LWIP_MAX_SOCKETS - 3)
+#else
+#define HTTPD_SOCKETS_MAX 7
+#endif
+
+static settings_httpd_t s_httpd_tuning;     // what the running server was started with
+
+// Resolves the encoder channel from the "channel" query parameter (default 0)
+static encoder_handle_t query_channel(httpd_req_t *req, int *out_index) {
+    int index = 0;
+    char query[32];
+    char value[8];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "channel", value, sizeof(value)) == ESP_OK) {
+        index = atoi(value);
     }
-
-    if (strstr(req->uri, ".html"))       httpd_resp_set_type(req, "text/html");
-    else if (strstr(req->uri, ".css"))   httpd_resp_set_type(req, "text/css");
-    else if (strstr(req->uri, ".js"))    httpd_resp_set_type(req, "application/javascript");
-    else if (strstr(req->uri, ".json"))  httpd_resp_set_type(req, "application/json");
-    else                                 httpd_resp_set_type(req, "text/plain");
-
-    char line[256];
-    while (fgets(line, sizeof(line), file)) {
-        httpd_resp_sendstr_chunk(req, line);
+    if (index < 0) {
+        return NULL;
     }
-    httpd_resp_sendstr_chunk(req, NULL);
-    fclose(file);
-    return ESP_OK;
+    *out_index = index;
+    return encoder_channel_get((size_t)index);
 }
 
-
 static esp_err_t data_get_handler(httpd_req_t *req) {
-    // Sends current speed and distance as a JSON response
+    // Sends current speed and distance as a JSON response; the top-level
+    // fields are the first channel, "channels" lists every channel
     float distance = encoder_get_distance_m();
     float speed = encoder_get_speed_mps();
-
-    char json_response[128];
-    snprintf(json_response, sizeof(json_response),
-             "{\"distance\": %.2f, \"speed\": %.2f}", distance, speed);
+    float accel = encoder_get_accel_mps2();
+    encoder_plausibility_stats_t noise = encoder_get_noise_stats();
+    encoder_sampler_stats_t sampler;
+    encoder_get_sampler_stats(&sampler);
+
+    static char json_response[DATA_JSON_MAX];   // handlers run on the single httpd task
+    int len = snprintf(json_response, sizeof(json_response),
+                       "{\"distance\": %.2f, \"speed\": %.2f, \"accel\": %.3f, "
+                       "\"rejected_speed\": %u, \"rejected_accel\": %u, "
+                       "\"sampler\": {\"rate_hz\": %u, \"core\": %d, \"passes\": %u, "
+                       "\"interval_min_us\": %d, \"interval_max_us\": %d, "
+                       "\"jitter_mean_us\": %u, \"jitter_max_us\": %u, "
+                       "\"wake_latency_mean_us\": %u, \"wake_latency_max_us\": %u, "
+                       "\"run_mean_us\": %u, \"run_max_us\": %u, \"overruns\": %u}, \"channels\": [",
+                       distance, speed, accel,
+                       (unsigned)noise.speed_violations, (unsigned)noise.accel_violations,
+                       (unsigned)sampler.rate_hz, sampler.core, (unsigned)sampler.passes,
+                       (int)sampler.interval_min_us, (int)sampler.interval_max_us,
+                       (unsigned)sampler.jitter_mean_us, (unsigned)sampler.jitter_max_us,
+                       (unsigned)sampler.wake_latency_mean_us, (unsigned)sampler.wake_latency_max_us,
+                       (unsigned)sampler.run_mean_us, (unsigned)sampler.run_max_us, (unsigned)sampler.overruns);
+
+    size_t count = encoder_channel_count();
+    for (size_t i = 0; i < count && len < (int)sizeof(json_response); i++) {
+        encoder_handle_t enc = encoder_channel_get(i);
+        encoder_plausibility_stats_t stats = encoder_channel_get_noise_stats(enc);
+        encoder_index_t index;
+        encoder_channel_get_index(enc, &index);
+        encoder_irq_stats_t irq = encoder_channel_get_irq_stats(enc);
+        float angle;
+        char angle_str[16] = "null";
+        if (encoder_channel_get_angle_deg(enc, &angle)) {
+            snprintf(angle_str, sizeof(angle_str), "%.2f", angle);
+        }
+        len += snprintf(json_response + len, sizeof(json_response) - len,
+                        "%s{\"distance\": %.2f, \"speed\": %.2f, \"accel\": %.3f, \"jerk\": %.3f, "
+                        "\"samples\": %u, \"rejected_speed\": %u, \"rejected_accel\": %u, "
+                        "\"position\": %lld, \"angle\": %s, \"index_error\": %d, \"index_max_error\": %d, "
+                        "\"index_error_events\": %u, \"watch_irqs\": %u, \"limit_irq\": %s, \"edge_irqs\": %u}",
+                        i ? ", " : "",
+                        encoder_channel_get_distance_m(enc), encoder_channel_get_speed_mps(enc),
+                        encoder_channel_get_accel_mps2(enc), encoder_channel_get_jerk_mps3(enc),
+                        (unsigned)stats.samples, (unsigned)stats.speed_violations, (unsigned)stats.accel_violations,
+                        (long long)encoder_channel_get_position(enc), angle_str,
+                        (int)index.last_error, (int)index.max_error, (unsigned)index.error_events,
+                        (unsigned)irq.watch_irqs, irq.limit_irq ? "true" : "false", (unsigned)irq.edge_irqs);
+    }
+    if (len < (int)sizeof(json_response)) {
+        snprintf(json_response + len, sizeof(json_response) - len, "]}");
+    }
 
     httpd_resp_set_type(req, "application/json");
     httpd_resp_send(req, json_response, HTTPD_RESP_USE_STRLEN);
@@ -69,12 +119,31 @@ static esp_err_t data_get_handler(httpd_req_t *req) {
 }
 
 static esp_err_t reset_post_handler(httpd_req_t *req) {
-    // Resets encoder counter on POST request
-    encoder_reset();
+    // Resets encoder counter and noise counters on POST request (?channel=N, default 0)
+    int index;
+    encoder_handle_t enc = query_channel(req, &index);
+    if (!enc) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown channel");
+    }
+    encoder_channel_reset(enc);
+    encoder_channel_clear_noise_stats(enc);
+    odometer_save_now();    // a power cut must not bring the old count back
     httpd_resp_sendstr(req, "Reset done");
     return ESP_OK;
 }
 
+static esp_err_t home_post_handler(httpd_req_t *req) {
+    // Takes the next index pulse as position zero (?channel=N, default 0)
+    int index;
+    encoder_handle_t enc = query_channel(req, &index);
+    if (!enc) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown channel");
+    }
+    encoder_channel_home_on_index(enc);
+    httpd_resp_sendstr(req, "Homing on next index");
+    return ESP_OK;
+}
+
 static esp_err_t set_calib_handler(httpd_req_t *req) {
     // Handles calibration value submission (form-urlencoded)
     char buf[32] = {0};
@@ -84,16 +153,16 @@ static esp_err_t set_calib_handler(httpd_req_t *req) {
     }
     buf[len] = 0;
 
-    char *val_ptr = strstr(buf, "value=");
-    if (!val_ptr) {
+    float val;
+    esp_err_t err = web_parse_calibration(buf, &val);
+    if (err == ESP_ERR_NOT_FOUND) {
         return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Value not found");
     }
-    float val = atof(val_ptr + 6);
-    if (val <= 0.0f) {
+    if (err != ESP_OK) {
         return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Value must be > 0");
     }
 
-    esp_err_t err = calibration_save(val);
+    err = calibration_save(val);
     if (err != ESP_OK) {
         return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Save failed");
     }
@@ -103,18 +172,52 @@ static esp_err_t set_calib_handler(httpd_req_t *req) {
 }
 
 static esp_err_t api_get_settings_handler(httpd_req_t *req) {
-    // Responds with stored settings (diameter, factor) in JSON format
+    // Responds with stored settings (diameter, factor) of one channel in JSON format
+    int channel;
+    encoder_handle_t enc = query_channel(req, &channel);
+    if (!enc) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown channel");
+        return ESP_FAIL;
+    }
+
     float diameter = 0, factor = 0;
-    esp_err_t err = settings_load(&diameter, &factor);
+    esp_err_t err = settings_load_channel(channel, &diameter, &factor);
     if (err != ESP_OK) {
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to load settings");
         return ESP_FAIL;
     }
 
+    encoder_filter_config_t filter = encoder_channel_get_speed_filter(enc);
+
     cJSON *root = cJSON_CreateObject();
+    cJSON_AddNumberToObject(root, "channel", channel);
+    cJSON_AddNumberToObject(root, "channels", encoder_channel_count());
     cJSON_AddNumberToObject(root, "diameter", diameter);
     cJSON_AddNumberToObject(root, "factor", factor);
 
+    cJSON *filter_json = cJSON_AddObjectToObject(root, "filter");
+    cJSON_AddStringToObject(filter_json, "type", encoder_filter_type_name(filter.type));
+    cJSON_AddNumberToObject(filter_json, "window", filter.window);
+    cJSON_AddNumberToObject(filter_json, "alpha", filter.alpha);
+    cJSON_AddNumberToObject(filter_json, "beta", filter.beta);
+    cJSON_AddNumberToObject(filter_json, "process_noise", filter.process_noise);
+    cJSON_AddNumberToObject(filter_json, "measurement_noise", filter.measurement_noise);
+
+    encoder_noise_config_t noise = encoder_channel_get_noise_config(enc);
+    cJSON *noise_json = cJSON_AddObjectToObject(root, "noise");
+    cJSON_AddNumberToObject(noise_json, "glitch_ns", noise.glitch_filter_ns);
+    cJSON_AddNumberToObject(noise_json, "max_speed", noise.plausibility.max_speed_mps);
+    cJSON_AddNumberToObject(noise_json, "max_accel", noise.plausibility.max_accel_mps2);
+
+    encoder_counting_t counting = encoder_channel_get_counting(enc);
+    cJSON *counting_json = cJSON_AddObjectToObject(root, "counting");
+    cJSON_AddNumberToObject(counting_json, "pin_a", counting.pin_a);
+    cJSON_AddNumberToObject(counting_json, "pin_b", counting.pin_b);
+    cJSON_AddNumberToObject(counting_json, "pin_z", counting.pin_z);
+    cJSON_AddNumberToObject(counting_json, "ppr", counting.pulses_per_rev);
+    cJSON_AddNumberToObject(counting_json, "mode", counting.count_mode);
+    cJSON_AddBoolToObject(counting_json, "invert", counting.invert);
+
     const char *resp_str = cJSON_Print(root);
     httpd_resp_set_type(req, "application/json");
     httpd_resp_sendstr(req, resp_str);
@@ -127,7 +230,7 @@ static esp_err_t api_get_settings_handler(httpd_req_t *req) {
 
 static esp_err_t api_post_settings_handler(httpd_req_t *req) {
     // Accepts and saves settings sent as JSON, applies them to encoder
-    char buf[256];
+    char buf[512];
     int ret = httpd_req_recv(req, buf, sizeof(buf) - 1);
     if (ret <= 0) {
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid request");
@@ -135,76 +238,244 @@ static esp_err_t api_post_settings_handler(httpd_req_t *req) {
     }
     buf[ret] = 0;
 
-    cJSON *json = cJSON_Parse(buf);
-    if (!json) {
+    int channel;
+    if (web_parse_settings_channel(buf, &channel) != ESP_OK) {
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
         return ESP_FAIL;
     }
+    encoder_handle_t enc = channel >= 0 ? encoder_channel_get((size_t)channel) : NULL;
+    if (!enc) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown channel");
+        return ESP_FAIL;
+    }
 
-    float diameter, factor;
-    esp_err_t err = settings_load(&diameter, &factor); // load current settings
+    // Current values of the channel; the body overrides the fields it has
+    web_settings_t settings;
+    esp_err_t err = settings_load_channel(channel, &settings.diameter, &settings.factor);
     if (err != ESP_OK) {
-        cJSON_Delete(json);
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Load failed");
         return ESP_FAIL;
     }
-
-    cJSON *diameter_json = cJSON_GetObjectItem(json, "diameter");
-    if (cJSON_IsNumber(diameter_json)) {
-        diameter = diameter_json->valuedouble;
+    encoder_filter_config_t filter = encoder_channel_get_speed_filter(enc);
+    encoder_noise_config_t noise = encoder_channel_get_noise_config(enc);
+    const encoder_noise_config_t previous_noise = noise;
+    encoder_counting_t counting = encoder_channel_get_counting(enc);
+    settings.filter = filter;
+    settings.glitch_filter_ns = noise.glitch_filter_ns;
+    settings.plausibility = noise.plausibility;
+    settings.pin_a = counting.pin_a;
+    settings.pin_b = counting.pin_b;
+    settings.pin_z = counting.pin_z;
+    settings.pulses_per_rev = counting.pulses_per_rev;
+    settings.count_mode = counting.count_mode;
+    settings.invert = counting.invert;
+
+    if (web_parse_settings(buf, &settings) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown filter type");
+        return ESP_FAIL;
     }
-
-    cJSON *factor_json = cJSON_GetObjectItem(json, "factor");
-    if (cJSON_IsNumber(factor_json)) {
-        factor = factor_json->valuedouble;
+    ESP_LOGI(TAG, "Received updated settings [%d]: diameter=%.2f, factor=%.3f", channel, settings.diameter,
+             settings.factor);
+
+    filter = settings.filter;
+    noise.glitch_filter_ns = settings.glitch_filter_ns;
+    noise.plausibility = settings.plausibility;
+    counting.pin_a = (gpio_num_t)settings.pin_a;
+    counting.pin_b = (gpio_num_t)settings.pin_b;
+    counting.pin_z = (gpio_num_t)settings.pin_z;
+    counting.pulses_per_rev = settings.pulses_per_rev;
+    counting.count_mode = settings.count_mode;
+    counting.invert = settings.invert;
+
+    if (settings.has_noise && encoder_channel_set_noise_config(enc, &noise) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid glitch filter width");
+        return ESP_FAIL;
+    }
+    if (settings.has_counting && encoder_channel_set_counting(enc, &counting) != ESP_OK) {
+        // All or nothing: the filter just applied would otherwise stay live without being saved
+        if (settings.has_noise) {
+            encoder_channel_set_noise_config(enc, &previous_noise);
+        }
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid pins or counting mode");
+        return ESP_FAIL;
     }
 
-    ESP_LOGI(TAG, "Received updated settings: diameter=%.2f, factor=%.3f", diameter, factor);
-
-    err = settings_save(diameter, factor);
+    err = settings_save_channel(channel, settings.diameter, settings.factor);
+    if (err == ESP_OK && settings.has_filter) {
+        err = settings_save_filter(channel, &filter);
+    }
+    if (err == ESP_OK && settings.has_noise) {
+        err = settings_save_noise(channel, &noise);
+    }
+    if (err == ESP_OK && settings.has_counting) {
+        err = settings_save_counting(channel, &counting);
+    }
     if (err != ESP_OK) {
-        cJSON_Delete(json);
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Save failed");
         return ESP_FAIL;
     }
 
-    encoder_set_wheel_diameter_mm(diameter);
-    encoder_set_calibration_factor(factor);
+    encoder_channel_set_wheel_diameter_mm(enc, settings.diameter);
+    encoder_channel_set_calibration_factor(enc, settings.factor);
+    if (settings.has_filter) {
+        encoder_channel_set_speed_filter(enc, &filter);
+    }
+
+    httpd_resp_set_status(req, "204 No Content");
+    httpd_resp_send(req, NULL, 0);
+    return ESP_OK;
+}
 
-    cJSON_Delete(json);
+static const char *trigger_state_name(encoder_trigger_state_t state) {
+    switch (state) {
+        case ENCODER_TRIGGER_ARMED:      return "armed";
+        case ENCODER_TRIGGER_PROGRAMMED: return "programmed";
+        case ENCODER_TRIGGER_FIRED:      return "fired";
+        default:                         return "idle";
+    }
+}
+
+static esp_err_t api_get_trigger_handler(httpd_req_t *req) {
+    // Returns the trigger state and latency statistics of a channel (?channel=N)
+    int index;
+    encoder_handle_t enc = query_channel(req, &index);
+    if (!enc) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown channel");
+    }
+    encoder_trigger_stats_t stats;
+    encoder_channel_get_trigger_stats(enc, &stats);
 
+    char json_response[384];
+    snprintf(json_response, sizeof(json_response),
+             "{\"channel\": %d, \"state\": \"%s\", \"fires\": %u, \"late_fires\": %u, "
+             "\"last_overshoot\": %d, \"max_overshoot\": %d, \"last_latency_us\": %u, "
+             "\"max_latency_us\": %u, \"mean_latency_us\": %.1f}",
+             index, trigger_state_name(encoder_channel_get_trigger_state(enc)),
+             (unsigned)stats.fires, (unsigned)stats.late_fires, (int)stats.last_overshoot, (int)stats.max_overshoot,
+             (unsigned)stats.last_latency_us, (unsigned)stats.max_latency_us,
+             stats.fires ? (double)stats.total_latency_us / stats.fires : 0.0);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json_response);
+    return ESP_OK;
+}
+
+static esp_err_t api_post_trigger_handler(httpd_req_t *req) {
+    // Arms ({"channel", "target_m", "output_pin", "output_level"}) or cancels ({"disarm": true}) the trigger
+    char buf[160];
+    int ret = httpd_req_recv(req, buf, sizeof(buf) - 1);
+    if (ret <= 0) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid request");
+    }
+    buf[ret] = 0;
+
+    web_trigger_request_t request;
+    esp_err_t err = web_parse_trigger(buf, &request);
+    if (err == ESP_ERR_INVALID_ARG) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+    }
+    encoder_handle_t enc = request.channel >= 0 ? encoder_channel_get((size_t)request.channel) : NULL;
+    if (!enc) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown channel");
+    }
+
+    if (request.disarm) {
+        encoder_channel_disarm_trigger(enc);
+    } else {
+        if (err == ESP_ERR_NOT_FOUND) {
+            return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "target_m missing");
+        }
+        encoder_trigger_config_t config = {
+            .target_um = (int64_t)llround(request.target_m * 1e6),
+            .output_pin = request.output_pin < 0 ? GPIO_NUM_NC : (gpio_num_t)request.output_pin,
+            .output_level = request.output_level,
+        };
+        if (encoder_channel_arm_trigger(enc, &config) != ESP_OK) {
+            return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid output pin");
+        }
+    }
     httpd_resp_set_status(req, "204 No Content");
     httpd_resp_send(req, NULL, 0);
     return ESP_OK;
 }
 
-static const httpd_uri_t uri_root = {
-    .uri       = "/",
-    .method    = HTTP_GET,
-    .handler   = serve_file_handler,
-    .user_ctx  = NULL
-};
+static void httpd_tuning_defaults(settings_httpd_t *out) {
+    // Room for several dashboards plus the WebSocket and event streams, which each hold a socket.
+    // No LRU purge: a stream only sends, so it would look idle and be the first socket closed
+    *out = (settings_httpd_t){
+        .max_open_sockets = HTTPD_SOCKETS_MAX,
+        .backlog_conn = 5,
+        .lru_purge = false,
+        .keep_alive = true,
+        .keep_alive_idle_s = 5,
+        .recv_timeout_s = 5,
+        .send_timeout_s = 5,
+        .stack_size = TASK_HTTPD_STACK,
+        .core = TASK_HTTPD_CORE,
+    };
+}
 
-static const httpd_uri_t uri_index = {
-    .uri       = "/index.html",
-    .method    = HTTP_GET,
-    .handler   = serve_file_handler,
-    .user_ctx  = NULL
-};
+static void httpd_tuning_clamp(settings_httpd_t *t) {
+    if (t->max_open_sockets < 1) t->max_open_sockets = 1;
+    if (t->max_open_sockets > HTTPD_SOCKETS_MAX) t->max_open_sockets = HTTPD_SOCKETS_MAX;
+    if (t->backlog_conn < 1) t->backlog_conn = 1;
+    if (t->keep_alive_idle_s < 1) t->keep_alive_idle_s = 1;
+    if (t->recv_timeout_s < 1) t->recv_timeout_s = 1;
+    if (t->send_timeout_s < 1) t->send_timeout_s = 1;
+    if (t->stack_size < 3072) t->stack_size = 3072;
+    if (t->stack_size > 16384) t->stack_size = 16384;
+    if (t->core < 0 || t->core >= portNUM_PROCESSORS) t->core = TASK_HTTPD_CORE;
+}
 
-static const httpd_uri_t uri_config = {
-    .uri       = "/config.html",
-    .method    = HTTP_GET,
-    .handler   = serve_file_handler,
-    .user_ctx  = NULL
-};
+static int httpd_tuning_json(const settings_httpd_t *t, char *buf, size_t len) {
+    return snprintf(buf, len,
+                    "{\"max_open_sockets\": %u, \"backlog_conn\": %u, \"lru_purge\": %s, \"keep_alive\": %s, "
+                    "\"keep_alive_idle_s\": %u, \"recv_timeout_s\": %u, \"send_timeout_s\": %u, "
+                    "\"stack_size\": %u, \"core\": %d}",
+                    (unsigned)t->max_open_sockets, (unsigned)t->backlog_conn, t->lru_purge ? "true" : "false",
+                    t->keep_alive ? "true" : "false", (unsigned)t->keep_alive_idle_s, (unsigned)t->recv_timeout_s,
+                    (unsigned)t->send_timeout_s, (unsigned)t->stack_size, t->core);
+}
 
-static const httpd_uri_t uri_settings = {
-    .uri       = "/settings.html",
-    .method    = HTTP_GET,
-    .handler   = serve_file_handler,
-    .user_ctx  = NULL
-};
+static esp_err_t api_get_httpd_handler(httpd_req_t *req) {
+    // Returns the server tuning in use and the stored one that the next start will apply
+    settings_httpd_t stored = s_httpd_tuning;
+    settings_load_httpd(&stored);
+    httpd_tuning_clamp(&stored);
+
+    char active_json[320], stored_json[320], json_response[720];
+    httpd_tuning_json(&s_httpd_tuning, active_json, sizeof(active_json));
+    httpd_tuning_json(&stored, stored_json, sizeof(stored_json));
+    snprintf(json_response, sizeof(json_response), "{\"sockets_max\": %d, \"active\": %s, \"stored\": %s}",
+             HTTPD_SOCKETS_MAX, active_json, stored_json);
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_sendstr(req, json_response);
+}
+
+static esp_err_t api_post_httpd_handler(httpd_req_t *req) {
+    // Stores new server tuning; fields left out keep their stored value. Applied after a restart.
+    char buf[320];
+    int ret = httpd_req_recv(req, buf, sizeof(buf) - 1);
+    if (ret <= 0) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid request");
+    }
+    buf[ret] = 0;
+
+    settings_httpd_t t = s_httpd_tuning;
+    settings_load_httpd(&t);
+    if (web_parse_httpd_tuning(buf, &t) != ESP_OK) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+    }
+
+    httpd_tuning_clamp(&t);
+    if (settings_save_httpd(&t) != ESP_OK) {
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Save failed");
+    }
+    char stored_json[320], json_response[400];
+    httpd_tuning_json(&t, stored_json, sizeof(stored_json));
+    snprintf(json_response, sizeof(json_response), "{\"restart_required\": true, \"stored\": %s}", stored_json);
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_sendstr(req, json_response);
+}
 
 static const httpd_uri_t uri_data = {
     .uri       = "/data",
@@ -220,6 +491,13 @@ static const httpd_uri_t uri_reset = {
     .user_ctx  = NULL
 };
 
+static const httpd_uri_t uri_home = {
+    .uri       = "/home",
+    .method    = HTTP_POST,
+    .handler   = home_post_handler,
+    .user_ctx  = NULL
+};
+
 static const httpd_uri_t uri_set_calib = {
     .uri       = "/set_calib",
     .method    = HTTP_POST,
@@ -241,42 +519,201 @@ static const httpd_uri_t uri_api_post_settings = {
     .user_ctx  = NULL
 };
 
-esp_err_t handle_favicon(httpd_req_t *req) {
-    // Responds with 404 for /favicon.ico requests to reduce noise
-    httpd_resp_send_404(req);  
+static const httpd_uri_t uri_api_get_httpd = {
+    .uri       = "/api/httpd",
+    .method    = HTTP_GET,
+    .handler   = api_get_httpd_handler,
+    .user_ctx  = NULL
+};
+
+static const httpd_uri_t uri_api_post_httpd = {
+    .uri       = "/api/httpd",
+    .method    = HTTP_POST,
+    .handler   = api_post_httpd_handler,
+    .user_ctx  = NULL
+};
+
+static const httpd_uri_t uri_api_get_trigger = {
+    .uri       = "/api/trigger",
+    .method    = HTTP_GET,
+    .handler   = api_get_trigger_handler,
+    .user_ctx  = NULL
+};
+
+static const httpd_uri_t uri_api_post_trigger = {
+    .uri       = "/api/trigger",
+    .method    = HTTP_POST,
+    .handler   = api_post_trigger_handler,
+    .user_ctx  = NULL
+};
+
+static esp_err_t api_metrics_handler(httpd_req_t *req) {
+    // Latency histograms: {"bucket_lt_us": [...], "<name>": {"n", "sum", "max", "h": [...]}, ...}; ?reset=1 clears them after reading
+    static char json_response[METRICS_JSON_MAX];   // handlers run on the single httpd task
+    int len = snprintf(json_response, sizeof(json_response), "{\"enabled\": %s, \"bucket_lt_us\": [",
+                       METRICS_ENABLED ? "true" : "false");
+    for (int b = 0; b < METRICS_BUCKETS - 1 && len < (int)sizeof(json_response); b++) {
+        len += snprintf(json_response + len, sizeof(json_response) - len, "%s%u", b ? "," : "", 1u << b);
+    }
+    if (len < (int)sizeof(json_response)) {
+        len += snprintf(json_response + len, sizeof(json_response) - len, "]");
+    }
+    for (int id = 0; id < METRIC_COUNT && len < (int)sizeof(json_response); id++) {
+        metrics_histogram_t hist;
+        metrics_get((metric_id_t)id, &hist);
+        len += snprintf(json_response + len, sizeof(json_response) - len, ", \"%s\": {\"n\": %u, \"sum\": %llu, \"max\": %u, \"h\": [",
+                        metrics_name((metric_id_t)id), (unsigned)hist.count, (unsigned long long)hist.sum_us,
+                        (unsigned)hist.max_us);
+        for (int b = 0; b < METRICS_BUCKETS && len < (int)sizeof(json_response); b++) {
+            len += snprintf(json_response + len, sizeof(json_response) - len, "%s%u", b ? "," : "",
+                            (unsigned)hist.buckets[b]);
+        }
+        if (len < (int)sizeof(json_response)) {
+            len += snprintf(json_response + len, sizeof(json_response) - len, "]}");
+        }
+    }
+    if (len < (int)sizeof(json_response)) {
+        snprintf(json_response + len, sizeof(json_response) - len, "}");
+    }
+
+    char query[32], value[4];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "reset", value, sizeof(value)) == ESP_OK && value[0] == '1') {
+        metrics_reset();
+    }
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json_response);
     return ESP_OK;
 }
 
-static const httpd_uri_t favicon = {
-    .uri      = "/favicon.ico",
-    .method   = HTTP_GET,
-    .handler  = handle_favicon,  
-    .user_ctx = NULL
+static const httpd_uri_t uri_api_metrics = {
+    .uri       = "/api/metrics",
+    .method    = HTTP_GET,
+    .handler   = api_metrics_handler,
+    .user_ctx  = NULL
 };
 
+/**
+ * @brief Registered route: the original handler plus its request count.
+ */
+typedef struct {
+    const char *uri;
+    httpd_method_t method;
+    esp_err_t (*handler)(httpd_req_t *req);
+    void *user_ctx;
+    atomic_uint requests;
+} route_t;
+
+static route_t s_routes[MAX_URI_HANDLERS];
+static atomic_size_t s_route_count = 0;
+
+static esp_err_t route_handler(httpd_req_t *req) {
+    // Restores the route's own context, then counts and times its handler
+    route_t *route = req->user_ctx;
+    req->user_ctx = route->user_ctx;
+    atomic_fetch_add_explicit(&route->requests, 1, memory_order_relaxed);
+    METRICS_START(start);
+    esp_err_t err = route->handler(req);
+    METRICS_STOP(METRIC_HTTP, start);
+    return err;
+}
+
+/**
+ * @brief Registers a route through the counting wrapper.
+ */
+static esp_err_t register_route(httpd_handle_t server, const httpd_uri_t *uri) {
+    size_t count = atomic_load(&s_route_count);
+    if (count >= MAX_URI_HANDLERS) {
+        return ESP_ERR_NO_MEM;
+    }
+    route_t *route = &s_routes[count];
+    route->uri = uri->uri;
+    route->method = uri->method;
+    route->handler = uri->handler;
+    route->user_ctx = uri->user_ctx;
+
+    httpd_uri_t wrapped = *uri;
+    wrapped.handler = route_handler;
+    wrapped.user_ctx = route;
+    esp_err_t err = httpd_register_uri_handler(server, &wrapped);
+    if (err == ESP_OK) {
+        atomic_store(&s_route_count, count + 1);    // publish after the entry is complete
+    }
+    return err;
+}
+
+/**
+ * @brief Copies the request counters of the registered routes.
+ */
+size_t webserver_get_route_stats(webserver_route_stats_t *out, size_t max) {
+    size_t count = atomic_load(&s_route_count);
+    if (count > max) count = max;
+    for (size_t i = 0; i < count; i++) {
+        out[i].uri = s_routes[i].uri;
+        out[i].method = s_routes[i].method;
+        out[i].requests = atomic_load_explicit(&s_routes[i].requests, memory_order_relaxed);
+    }
+    return count;
+}
+
+static void on_session_close(httpd_handle_t server, int sockfd) {
+    // Session teardown: drop stream clients first, then close the socket as httpd would
+    ws_stream_on_close(sockfd);
+    close(sockfd);
+}
+
 esp_err_t start_webserver(void) {
     // Starts HTTP server and registers URI handlers
     httpd_handle_t server = NULL;
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
-    config.max_uri_handlers = 16;  // or any other suitable number
+    config.max_uri_handlers = MAX_URI_HANDLERS;
+    config.task_priority = TASK_HTTPD_PRIORITY;
+
+    // Connection limits and timeouts come from settings (POST /api/httpd), defaults otherwise
+    httpd_tuning_defaults(&s_httpd_tuning);
+    settings_load_httpd(&s_httpd_tuning);
+    httpd_tuning_clamp(&s_httpd_tuning);
+    config.max_open_sockets = s_httpd_tuning.max_open_sockets;
+    config.backlog_conn = s_httpd_tuning.backlog_conn;
+    config.lru_purge_enable = s_httpd_tuning.lru_purge;
+    config.keep_alive_enable = s_httpd_tuning.keep_alive;
+    config.keep_alive_idle = s_httpd_tuning.keep_alive_idle_s;
+    config.recv_wait_timeout = s_httpd_tuning.recv_timeout_s;
+    config.send_wait_timeout = s_httpd_tuning.send_timeout_s;
+    config.stack_size = s_httpd_tuning.stack_size;
+    config.core_id = s_httpd_tuning.core;
+    config.close_fn = on_session_close;
+    config.uri_match_fn = httpd_uri_match_wildcard;    // one "/*" route serves every embedded page
 
     esp_err_t err = httpd_start(&server, &config);
     if (err == ESP_OK) {
-        httpd_register_uri_handler(server, &uri_root);
-        httpd_register_uri_handler(server, &uri_index);
-        httpd_register_uri_handler(server, &uri_config);
-        httpd_register_uri_handler(server, &uri_settings);
-        httpd_register_uri_handler(server, &uri_data);
-        httpd_register_uri_handler(server, &uri_reset);
-        httpd_register_uri_handler(server, &uri_set_calib);
-        httpd_register_uri_handler(server, &uri_api_get_settings);
-        httpd_register_uri_handler(server, &uri_api_post_settings);
-        httpd_register_uri_handler(server, &favicon);
+        register_route(server, &uri_data);
+        register_route(server, &uri_reset);
+        register_route(server, &uri_home);
+        register_route(server, &uri_set_calib);
+        register_route(server, &uri_api_get_settings);
+        register_route(server, &uri_api_post_settings);
+        register_route(server, &uri_api_get_httpd);
+        register_route(server, &uri_api_post_httpd);
+        register_route(server, &uri_api_get_trigger);
+        register_route(server, &uri_api_post_trigger);
+        register_route(server, &uri_api_metrics);
+        register_route(server, &uri_api_samples);
+        register_route(server, &uri_prometheus_metrics);
+        register_route(server, &uri_ws_stream);
+        ws_stream_start(server);
+        register_route(server, &uri_sse_stream);
+        sse_stream_start();
 
         extern const httpd_uri_t uri_wifi_post;
-        httpd_register_uri_handler(server, &uri_wifi_post);
-        
-        ESP_LOGI(TAG, "Webserver started");
+        register_route(server, &uri_wifi_post);
+
+        // Last: the first matching route wins, so the wildcard only gets what nothing else claims
+        register_route(server, &uri_static);
+
+        ESP_LOGI(TAG, "Webserver started: %u sockets, LRU purge %s, keep-alive %s",
+                 (unsigned)config.max_open_sockets, config.lru_purge_enable ? "on" : "off",
+                 config.keep_alive_enable ? "on" : "off");
 
     } else {
         ESP_LOGE(TAG, "Failed to start webserver");
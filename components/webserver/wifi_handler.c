@@ -1,10 +1,11 @@
 #include "wifi_handler.h"
 #include "esp_log.h"
-#include "cJSON.h"
+#include "web_parse.h"
 #include <string.h>
 #include "nvs_flash.h"
 #include "nvs.h"
 #include "esp_system.h"
+#include "odometer.h"
 
 #define TAG "WIFI_HANDLER"
 #define MAX_POST_SIZE 512
@@ -42,27 +43,20 @@ esp_err_t wifi_config_post_handler(httpd_req_t *req) {
         return ESP_FAIL;
     }
 
-    cJSON *json = cJSON_Parse(content);
-    if (!json) {
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+    web_wifi_credentials_t credentials;
+    esp_err_t err = web_parse_wifi_credentials(content, &credentials);
+    if (err == ESP_ERR_INVALID_ARG) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON or missing SSID or password");
         return ESP_FAIL;
     }
-
-    const cJSON *ssid = cJSON_GetObjectItem(json, "ssid");
-    const cJSON *password = cJSON_GetObjectItem(json, "password");
-
-    if (!cJSON_IsString(ssid) || !cJSON_IsString(password) ||
-        ssid->valuestring == NULL || password->valuestring == NULL) {
-        cJSON_Delete(json);
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing SSID or password");
+    if (err == ESP_ERR_INVALID_SIZE) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "SSID or password too long");
         return ESP_FAIL;
     }
 
-    ESP_LOGI(TAG, "Parsed SSID: %s", ssid->valuestring);
-    ESP_LOGI(TAG, "Parsed PASS: %s", password->valuestring);
+    ESP_LOGI(TAG, "Parsed SSID: %s", credentials.ssid);
 
-    esp_err_t err = save_wifi_credentials(ssid->valuestring, password->valuestring);
-    cJSON_Delete(json);
+    err = save_wifi_credentials(credentials.ssid, credentials.password);
 
     if (err != ESP_OK) {
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to save Wi-Fi settings");
@@ -74,6 +68,7 @@ esp_err_t wifi_config_post_handler(httpd_req_t *req) {
 
     ESP_LOGI(TAG, "Wi-Fi credentials saved, restarting...");
     vTaskDelay(pdMS_TO_TICKS(1000));  // wait a bit before restart
+    odometer_save_now();
     esp_restart();
 
     return ESP_OK;  // this line will not be reached, esp_restart() does not return
@@ -0,0 +1,336 @@
+#include "ws_stream.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "lwip/sockets.h"
+#include "encoder.h"
+#include "task_layout.h"
+#include "sample_record.h"
+
+static const char *TAG = "WS_STREAM";
+
+#define WS_STREAM_PERIOD_MS (1000 / WS_STREAM_MAX_RATE_HZ)
+#define WS_STREAM_READ_BATCH 32
+#define WS_HEADER_MAX 4     // FIN/opcode byte, 126 and a 16-bit length; server frames are not masked
+
+typedef struct __attribute__((packed)) {
+    uint8_t version;
+    uint8_t record_size;
+    uint16_t count;
+    uint32_t dropped;
+} ws_frame_header_t;
+
+static_assert(sizeof(ws_frame_header_t) == 8, "wire header layout");
+static_assert(sizeof(ws_frame_header_t) + sizeof(sample_record_t) * WS_STREAM_BACKLOG <= 0xFFFF,
+              "payload length fits the 16-bit WebSocket length");
+
+/**
+ * @brief Stream state of one client; fd < 0 marks a free slot.
+ */
+typedef struct {
+    int fd;
+    uint32_t interval_us;
+    int64_t next_due_us[ENCODER_MAX_CHANNELS];  ///< Per-channel decimation to the client's rate
+    sample_record_t backlog[WS_STREAM_BACKLOG]; ///< Ring of records not yet framed
+    size_t head;
+    size_t count;
+    uint32_t dropped;                           ///< Records dropped since the last frame
+    bool send_queued;                           ///< A send is queued on the server task
+    size_t frame_len;                           ///< Frame in sending, 0 if none; set by send_work under the lock
+    size_t sent;                                ///< Bytes of that frame the socket has taken
+    int64_t stalled_since_us;                   ///< First send the socket took nothing of, 0 while it makes progress
+    uint8_t frame[WS_HEADER_MAX + sizeof(ws_frame_header_t) + sizeof(sample_record_t) * WS_STREAM_BACKLOG];
+} ws_client_t;
+
+static httpd_handle_t s_server = NULL;
+static TaskHandle_t s_task = NULL;
+static SemaphoreHandle_t s_lock = NULL;         // guards s_clients between the broadcaster and the server task
+static ws_client_t s_clients[WS_STREAM_MAX_CLIENTS];
+static int s_client_count = 0;
+
+static uint32_t rate_to_interval_us(int rate_hz) {
+    if (rate_hz < 1) rate_hz = 1;
+    if (rate_hz > WS_STREAM_MAX_RATE_HZ) rate_hz = WS_STREAM_MAX_RATE_HZ;
+    return 1000000 / rate_hz;
+}
+
+static ws_client_t *find_client(int fd) {
+    for (int i = 0; i < WS_STREAM_MAX_CLIENTS; i++) {
+        if (s_clients[i].fd == fd) {
+            return &s_clients[i];
+        }
+    }
+    return NULL;
+}
+
+static void remove_client(int fd) {
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    ws_client_t *client = find_client(fd);
+    if (client) {
+        client->fd = -1;
+        client->frame_len = 0;
+        s_client_count--;
+        ESP_LOGI(TAG, "Client %d left", fd);
+    }
+    xSemaphoreGive(s_lock);
+}
+
+/**
+ * @brief Appends a record, dropping the oldest if the backlog is full.
+ */
+static void client_push(ws_client_t *client, const sample_record_t *record) {
+    if (client->count == WS_STREAM_BACKLOG) {
+        client->head = (client->head + 1) % WS_STREAM_BACKLOG;
+        client->count--;
+        client->dropped++;
+    }
+    client->backlog[(client->head + client->count) % WS_STREAM_BACKLOG] = *record;
+    client->count++;
+}
+
+/**
+ * @brief Frames the backlog as one binary WebSocket frame; caller holds s_lock.
+ */
+static void client_frame(ws_client_t *client) {
+    size_t payload = sizeof(ws_frame_header_t) + client->count * sizeof(sample_record_t);
+    uint8_t *out = client->frame;
+    *out++ = 0x80 | HTTPD_WS_TYPE_BINARY;   // FIN
+    if (payload < 126) {
+        *out++ = (uint8_t)payload;
+    } else {
+        *out++ = 126;
+        *out++ = (uint8_t)(payload >> 8);
+        *out++ = (uint8_t)payload;
+    }
+    ws_frame_header_t header = {
+        .version = WS_STREAM_VERSION,
+        .record_size = sizeof(sample_record_t),
+        .count = client->count,
+        .dropped = client->dropped,
+    };
+    memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    for (size_t i = 0; i < client->count; i++) {
+        memcpy(out, &client->backlog[(client->head + i) % WS_STREAM_BACKLOG], sizeof(sample_record_t));
+        out += sizeof(sample_record_t);
+    }
+    client->frame_len = out - client->frame;
+    client->sent = 0;
+    client->head = 0;
+    client->count = 0;
+    client->dropped = 0;
+}
+
+/**
+ * @brief Writes a client's frame to its socket without blocking; runs on the server task.
+ *
+ * The frame is written with MSG_DONTWAIT, so the server task never waits on
+ * a client. What the socket does not take now stays in the frame and is
+ * retried on the next tick while records collect in the backlog. A client
+ * whose socket takes nothing for WS_STREAM_STALL_MS is closed.
+ */
+static void send_work(void *arg) {
+    ws_client_t *client = arg;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int fd = client->fd;
+    if (fd >= 0 && !client->frame_len && client->count) {
+        client_frame(client);
+    }
+    size_t len = fd >= 0 ? client->frame_len : 0;
+    xSemaphoreGive(s_lock);
+
+    // Only this function touches the frame after framing, and it always runs on the server task
+    bool drop = false;
+    if (len) {
+        int n = httpd_socket_send(s_server, fd, (const char *)client->frame + client->sent, len - client->sent,
+                                  MSG_DONTWAIT);
+        if (n > 0) {
+            client->sent += n;
+            client->stalled_since_us = 0;
+            httpd_sess_update_lru_counter(s_server, fd);    // keeps LRU purge, if enabled, off the stream
+        } else if (n == 0 || n == HTTPD_SOCK_ERR_TIMEOUT) {
+            int64_t now_us = esp_timer_get_time();
+            if (!client->stalled_since_us) {
+                client->stalled_since_us = now_us;
+            }
+            drop = now_us - client->stalled_since_us >= WS_STREAM_STALL_MS * 1000LL;
+        } else {
+            drop = true;
+        }
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    client->send_queued = false;
+    if (len && client->sent == client->frame_len) {
+        client->frame_len = 0;
+    }
+    xSemaphoreGive(s_lock);
+
+    if (drop) {
+        ESP_LOGW(TAG, "Send to %d failed or stalled, closing", fd);
+        httpd_sess_trigger_close(s_server, fd);
+    }
+}
+
+/**
+ * @brief Broadcaster: encodes new samples once and hands them to the clients.
+ */
+static void ws_stream_task(void *arg) {
+    encoder_ring_cursor_t cursors[ENCODER_MAX_CHANNELS];
+    bool streaming = false;
+    const TickType_t period = pdMS_TO_TICKS(WS_STREAM_PERIOD_MS) ? pdMS_TO_TICKS(WS_STREAM_PERIOD_MS) : 1;
+    TickType_t last_wake = xTaskGetTickCount();
+
+    while (1) {
+        vTaskDelayUntil(&last_wake, period);
+
+        size_t channels = encoder_channel_count();
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        int clients = s_client_count;
+        xSemaphoreGive(s_lock);
+        if (!clients) {
+            streaming = false;
+            continue;
+        }
+        if (!streaming) {
+            // First client: start at the newest samples, not at whatever the rings still hold
+            for (size_t ch = 0; ch < channels; ch++) {
+                encoder_channel_samples_cursor_init(encoder_channel_get(ch), &cursors[ch]);
+            }
+            streaming = true;
+        }
+
+        for (size_t ch = 0; ch < channels; ch++) {
+            encoder_handle_t enc = encoder_channel_get(ch);
+            encoder_sample_t samples[WS_STREAM_READ_BATCH];
+            size_t n;
+            while ((n = encoder_channel_samples_read(enc, &cursors[ch], samples, WS_STREAM_READ_BATCH)) > 0) {
+                // Samples the ring overwrote before the broadcaster got to them are lost to every client
+                uint32_t lost = cursors[ch].dropped;
+                cursors[ch].dropped = 0;
+                xSemaphoreTake(s_lock, portMAX_DELAY);
+                if (lost) {
+                    for (int c = 0; c < WS_STREAM_MAX_CLIENTS; c++) {
+                        if (s_clients[c].fd >= 0) {
+                            s_clients[c].dropped += lost;
+                        }
+                    }
+                }
+                for (size_t i = 0; i < n; i++) {
+                    const encoder_sample_t *sample = &samples[i];
+                    sample_record_t record = sample_record_make(enc, (uint8_t)ch, sample);
+                    for (int c = 0; c < WS_STREAM_MAX_CLIENTS; c++) {
+                        ws_client_t *client = &s_clients[c];
+                        // Half a period of slack keeps the decimation from beating with the sampler
+                        if (client->fd < 0 ||
+                            sample->timestamp_us < client->next_due_us[ch] - client->interval_us / 2) {
+                            continue;
+                        }
+                        client->next_due_us[ch] += client->interval_us;
+                        if (client->next_due_us[ch] < sample->timestamp_us) {
+                            client->next_due_us[ch] = sample->timestamp_us + client->interval_us;
+                        }
+                        client_push(client, &record);
+                    }
+                }
+                xSemaphoreGive(s_lock);
+            }
+        }
+
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        for (int c = 0; c < WS_STREAM_MAX_CLIENTS; c++) {
+            ws_client_t *client = &s_clients[c];
+            if (client->fd >= 0 && (client->count || client->frame_len) && !client->send_queued) {
+                client->send_queued = httpd_queue_work(s_server, send_work, client) == ESP_OK;
+            }
+        }
+        xSemaphoreGive(s_lock);
+    }
+}
+
+/**
+ * @brief Handles the upgrade request and "rate=N" text messages.
+ */
+static esp_err_t ws_stream_handler(httpd_req_t *req) {
+    int fd = httpd_req_to_sockfd(req);
+    if (req->method == HTTP_GET) {
+        // Handshake done: register the client
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        ws_client_t *client = find_client(-1);
+        if (client) {
+            memset(client, 0, sizeof(*client));
+            client->fd = fd;
+            client->interval_us = rate_to_interval_us(WS_STREAM_DEFAULT_RATE_HZ);
+            s_client_count++;
+        }
+        xSemaphoreGive(s_lock);
+        if (!client) {
+            ESP_LOGW(TAG, "Client limit reached, rejecting %d", fd);
+            httpd_sess_trigger_close(req->handle, fd);
+            return ESP_OK;
+        }
+        ESP_LOGI(TAG, "Client %d joined", fd);
+        return ESP_OK;
+    }
+
+    char buf[32];
+    httpd_ws_frame_t frame = { .payload = (uint8_t *)buf };
+    esp_err_t err = httpd_ws_recv_frame(req, &frame, sizeof(buf) - 1);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (frame.type == HTTPD_WS_TYPE_TEXT) {
+        buf[frame.len] = 0;
+        if (strncmp(buf, "rate=", 5) == 0) {
+            uint32_t interval_us = rate_to_interval_us(atoi(buf + 5));
+            xSemaphoreTake(s_lock, portMAX_DELAY);
+            ws_client_t *client = find_client(fd);
+            if (client) {
+                client->interval_us = interval_us;
+                memset(client->next_due_us, 0, sizeof(client->next_due_us));
+            }
+            xSemaphoreGive(s_lock);
+        }
+    }
+    return ESP_OK;
+}
+
+void ws_stream_on_close(int fd) {
+    if (s_lock) {
+        remove_client(fd);
+    }
+}
+
+esp_err_t ws_stream_start(httpd_handle_t server) {
+    if (s_task) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_lock = xSemaphoreCreateMutex();
+    if (!s_lock) {
+        return ESP_ERR_NO_MEM;
+    }
+    for (int i = 0; i < WS_STREAM_MAX_CLIENTS; i++) {
+        s_clients[i].fd = -1;
+    }
+    s_server = server;
+    if (xTaskCreatePinnedToCore(ws_stream_task, "ws_stream", TASK_WS_STACK, NULL, TASK_WS_PRIORITY, &s_task,
+                                TASK_WS_CORE) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+const httpd_uri_t uri_ws_stream = {
+    .uri          = "/ws",
+    .method       = HTTP_GET,
+    .handler      = ws_stream_handler,
+    .user_ctx     = NULL,
+    .is_websocket = true
+};
@@ -0,0 +1,1258 @@
+/**
+ * @file encoder_bench.c
+ *
+ * Host benchmark and accounting checks for the encoder core.
+ *
+ * The core is bound to a simulated PCNT unit (sim_pcnt.c). Scripted waveforms
+ * are played through the emulated channels, including forced watch-point
+ * overflows at the unit limits, and the core's pulse count is compared with
+ * the simulator's ground truth. Benchmarks report throughput and per-call
+ * latency percentiles of the hot read paths.
+ *
+ * Usage: encoder_bench [--quick]
+ * Exit code is non-zero if any accounting check fails.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "encoder_core.h"
+#include "encoder_ring.h"
+#include "encoder_filter.h"
+#include "encoder_deriv.h"
+#include "encoder_events.h"
+#include "sim_pcnt.h"
+
+#define PPR          600
+#define DIAMETER_MM  100.0f
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do {                                   \
+        if (!(cond)) {                                          \
+            failures++;                                         \
+            printf("  FAIL %s:%d: ", __FILE__, __LINE__);       \
+            printf(__VA_ARGS__);                                \
+            printf("\n");                                       \
+        }                                                       \
+    } while (0)
+
+static int64_t mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void setup(encoder_core_t *core, sim_pcnt_t *sim) {
+    memset(core, 0, sizeof(*core));
+    sim_pcnt_init(sim, core);
+    encoder_core_init(core, &sim_pcnt_backend, sim, PPR, DIAMETER_MM);
+}
+
+// ---------------------------------------------------------------------------
+// Accounting checks
+// ---------------------------------------------------------------------------
+
+static void check_forward_overflows(void) {
+    encoder_core_t core;
+    sim_pcnt_t sim;
+    setup(&core, &sim);
+
+    sim_pcnt_run(&sim, 5 * 32767 + 123, 1);
+    CHECK(sim.watch_events == 5, "expected 5 watch events, got %u", (unsigned)sim.watch_events);
+    CHECK(encoder_core_get_pulses(&core) == sim.true_position,
+          "forward: pulses %lld != truth %lld", (long long)encoder_core_get_pulses(&core), (long long)sim.true_position);
+}
+
+static void check_reverse_overflows(void) {
+    encoder_core_t core;
+    sim_pcnt_t sim;
+    setup(&core, &sim);
+
+    sim_pcnt_run(&sim, -(3 * 32768 + 77), 1);
+    CHECK(sim.watch_events == 3, "expected 3 watch events, got %u", (unsigned)sim.watch_events);
+    CHECK(encoder_core_get_pulses(&core) == sim.true_position,
+          "reverse: pulses %lld != truth %lld", (long long)encoder_core_get_pulses(&core), (long long)sim.true_position);
+}
+
+static void check_limit_dither(void) {
+    encoder_core_t core;
+    sim_pcnt_t sim;
+    setup(&core, &sim);
+
+    // Hunt back and forth across both limits; every crossing is an overflow
+    sim_pcnt_preset_count(&sim, ENCODER_CORE_HIGH_LIMIT - 3);
+    for (int i = 0; i < 1000; i++) {
+        sim_pcnt_run(&sim, 5, 1);
+        sim_pcnt_run(&sim, -5, 1);
+    }
+    CHECK(encoder_core_get_pulses(&core) == sim.true_position,
+          "high dither: pulses %lld != truth %lld", (long long)encoder_core_get_pulses(&core), (long long)sim.true_position);
+
+    sim_pcnt_preset_count(&sim, ENCODER_CORE_LOW_LIMIT + 3);
+    for (int i = 0; i < 1000; i++) {
+        sim_pcnt_run(&sim, -5, 1);
+        sim_pcnt_run(&sim, 5, 1);
+    }
+    CHECK(sim.watch_events > 0, "dither produced no watch events");
+    CHECK(encoder_core_get_pulses(&core) == sim.true_position,
+          "low dither: pulses %lld != truth %lld", (long long)encoder_core_get_pulses(&core), (long long)sim.true_position);
+}
+
+static void check_direct_levels(void) {
+    encoder_core_t core;
+    sim_pcnt_t sim;
+    setup(&core, &sim);
+
+    // One full forward cycle on raw levels counts +4 in x4 mode
+    sim_pcnt_set_levels(&sim, 0, 1);
+    sim_pcnt_set_levels(&sim, 1, 1);
+    sim_pcnt_set_levels(&sim, 1, 0);
+    sim_pcnt_set_levels(&sim, 0, 0);
+    CHECK(encoder_core_get_pulses(&core) == 4, "raw cycle: pulses %lld != 4", (long long)encoder_core_get_pulses(&core));
+}
+
+static void check_speed(void) {
+    encoder_core_t core;
+    sim_pcnt_t sim;
+    setup(&core, &sim);
+
+    // 10 kHz edge rate, speed sampled every second
+    sim_pcnt_advance_us(&sim, 1000000);
+    encoder_core_update_speed(&core);
+    for (int s = 0; s < 5; s++) {
+        sim_pcnt_run(&sim, 10000, 100);
+        encoder_core_update_speed(&core);
+    }
+    float expected = 10000.0f * (float)M_PI * (DIAMETER_MM / 1000.0f) / PPR;
+    float speed = encoder_core_get_speed_mps(&core);
+    CHECK(fabsf(speed - expected) < 1e-3f * expected, "speed %.6f != %.6f", speed, expected);
+
+    sim_pcnt_run(&sim, -10000, 100);
+    encoder_core_update_speed(&core);
+    speed = encoder_core_get_speed_mps(&core);
+    CHECK(fabsf(speed + expected) < 1e-3f * expected, "reverse speed %.6f != %.6f", speed, -expected);
+}
+
+static void check_period_speed(void) {
+    encoder_core_t core;
+    sim_pcnt_t sim;
+    memset(&core, 0, sizeof(core));
+    core.speed_mode = ENCODER_SPEED_MODE_PERIOD;
+    sim_pcnt_init(&sim, &core);
+    encoder_core_init(&core, &sim_pcnt_backend, &sim, PPR, DIAMETER_MM);
+    CHECK(sim.edge_capture, "period mode did not enable edge capture");
+
+    // 7 pulses/s sampled at 10 Hz: count mode would read 0 or 10 pulses/s
+    const int64_t edge_period_us = 1000000 / 7;
+    float expected = 7.0f * (float)M_PI * (DIAMETER_MM / 1000.0f) / PPR;
+    float worst = 0.0f;
+    for (int i = 0; i < 100; i++) {
+        for (int64_t t = 0; t < 100000; t += 1000) {
+            if ((sim.now_us % edge_period_us) < 1000) {
+                sim_pcnt_step(&sim, 1);
+            }
+            sim_pcnt_advance_us(&sim, 1000);
+        }
+        encoder_core_update_speed(&core);
+        if (i >= 10) {
+            float err = fabsf(encoder_core_get_speed_mps(&core) - expected) / expected;
+            if (err > worst) worst = err;
+        }
+    }
+    // Bounded by the 1 ms stepping grid of this waveform, not by pulse quantization
+    CHECK(worst < 0.02f, "period speed error %.2f%%", worst * 100.0f);
+    CHECK(encoder_core_get_active_speed_mode(&core) == ENCODER_SPEED_MODE_PERIOD, "active mode not PERIOD");
+
+    // Stop: the estimate decays and reaches zero after the stall timeout
+    sim_pcnt_advance_us(&sim, ENCODER_SPEED_STALL_US);
+    encoder_core_update_speed(&core);
+    CHECK(encoder_core_get_speed_mps(&core) == 0.0f, "stalled speed %.6f", encoder_core_get_speed_mps(&core));
+}
+
+static void check_auto_speed_mode(void) {
+    encoder_core_t core;
+    sim_pcnt_t sim;
+    memset(&core, 0, sizeof(core));
+    core.speed_mode = ENCODER_SPEED_MODE_AUTO;
+    sim_pcnt_init(&sim, &core);
+    encoder_core_init(&core, &sim_pcnt_backend, &sim, PPR, DIAMETER_MM);
+
+    // Fast: 10k pulses/s switches to counting and drops the edge interrupt
+    sim_pcnt_advance_us(&sim, 100000);
+    encoder_core_update_speed(&core);
+    for (int i = 0; i < 3; i++) {
+        sim_pcnt_run(&sim, 1000, 100);
+        encoder_core_update_speed(&core);
+    }
+    CHECK(encoder_core_get_active_speed_mode(&core) == ENCODER_SPEED_MODE_COUNT, "fast: active mode not COUNT");
+    CHECK(!sim.edge_capture, "fast: edge capture still enabled");
+    CHECK(encoder_core_get_speed_window_us(&core) == 100000, "fast: window %lld", (long long)encoder_core_get_speed_window_us(&core));
+
+    // Slow: 50 pulses/s switches to edge periods
+    for (int i = 0; i < 5; i++) {
+        sim_pcnt_run(&sim, -5, 20000);
+        encoder_core_update_speed(&core);
+    }
+    float expected = -50.0f * (float)M_PI * (DIAMETER_MM / 1000.0f) / PPR;
+    CHECK(encoder_core_get_active_speed_mode(&core) == ENCODER_SPEED_MODE_PERIOD, "slow: active mode not PERIOD");
+    CHECK(sim.edge_capture, "slow: edge capture not enabled");
+    CHECK(fabsf(encoder_core_get_speed_mps(&core) - expected) < 1e-3f * -expected,
+          "slow speed %.6f != %.6f", encoder_core_get_speed_mps(&core), expected);
+}
+
+static void check_reset(void) {
+    encoder_core_t core;
+    sim_pcnt_t sim;
+    setup(&core, &sim);
+
+    sim_pcnt_run(&sim, 40000, 1);
+    encoder_core_reset(&core);
+    sim.true_position = 0;
+    CHECK(encoder_core_get_pulses(&core) == 0, "reset: pulses %lld != 0", (long long)encoder_core_get_pulses(&core));
+    sim_pcnt_run(&sim, 40000, 1);
+    CHECK(encoder_core_get_pulses(&core) == sim.true_position,
+          "after reset: pulses %lld != truth %lld", (long long)encoder_core_get_pulses(&core), (long long)sim.true_position);
+}
+
+static void check_set_pulses(void) {
+    encoder_core_t core;
+    sim_pcnt_t sim;
+    setup(&core, &sim);
+    sim.index_period = PPR;
+
+    // Steady 10 kHz, then restore a checkpoint far past the hardware range
+    sim_pcnt_advance_us(&sim, 1000000);
+    encoder_core_update_speed(&core);
+    sim_pcnt_run(&sim, 10000, 100);
+    encoder_core_update_speed(&core);
+    float speed = encoder_core_get_speed_mps(&core);
+
+    encoder_index_t before, after;
+    encoder_core_get_index(&core, &before);
+    const int64_t preset = 5000000000LL;
+    int64_t offset = preset - sim.true_position;
+    encoder_core_set_pulses(&core, preset);
+    encoder_core_get_index(&core, &after);
+    CHECK(encoder_core_get_pulses(&core) == preset, "preset: pulses %lld", (long long)encoder_core_get_pulses(&core));
+    CHECK(after.pulses - before.pulses == offset, "index not shifted with the preset");
+
+    // The jump is not motion: speed continues, counting stays exact
+    encoder_core_update_speed(&core);
+    CHECK(encoder_core_get_speed_mps(&core) == speed, "preset spiked the speed");
+    for (int s = 0; s < 4; s++) {
+        sim_pcnt_run(&sim, 10000, 100);
+        encoder_core_update_speed(&core);
+    }
+    float expected = 10000.0f * (float)M_PI * (DIAMETER_MM / 1000.0f) / PPR;
+    CHECK(fabsf(encoder_core_get_speed_mps(&core) - expected) < 1e-3f * expected,
+          "speed after preset %.6f", encoder_core_get_speed_mps(&core));
+    CHECK(encoder_core_get_pulses(&core) == sim.true_position + offset,
+          "after preset: pulses %lld != %lld", (long long)encoder_core_get_pulses(&core),
+          (long long)(sim.true_position + offset));
+}
+
+static void check_wide_accumulator(void) {
+    encoder_core_t core;
+    sim_pcnt_t sim;
+    setup(&core, &sim);
+
+    // Park next to the limit and cross it repeatedly: 70k overflows > 2^31 pulses
+    for (int i = 0; i < 70000; i++) {
+        sim_pcnt_preset_count(&sim, ENCODER_CORE_HIGH_LIMIT - 1);
+        sim_pcnt_step(&sim, 1);
+    }
+    CHECK(sim.true_position > INT32_MAX, "truth did not pass 2^31");
+    CHECK(encoder_core_get_pulses(&core) == sim.true_position,
+          "wide: pulses %lld != truth %lld", (long long)encoder_core_get_pulses(&core), (long long)sim.true_position);
+
+    encoder_snapshot_t snap;
+    sim_pcnt_advance_us(&sim, 1234);
+    encoder_core_snapshot(&core, &snap);
+    CHECK(snap.pulses == sim.true_position && snap.timestamp_us == sim.now_us,
+          "snapshot {%lld, %lld} != {%lld, %lld}", (long long)snap.pulses, (long long)snap.timestamp_us,
+          (long long)sim.true_position, (long long)sim.now_us);
+}
+
+// Writer thread standing in for the watch-point ISR
+static void *overflow_writer(void *arg) {
+    encoder_core_t *core = arg;
+    for (int i = 0; i < 200000; i++) {
+        encoder_core_on_watch_point(core, ENCODER_CORE_HIGH_LIMIT);
+    }
+    return NULL;
+}
+
+static void check_concurrent_snapshots(void) {
+    encoder_core_t core;
+    sim_pcnt_t sim;
+    setup(&core, &sim);
+
+    pthread_t writer;
+    pthread_create(&writer, NULL, overflow_writer, &core);
+    int64_t last = 0;
+    int bad = 0;
+    for (int i = 0; i < 200000; i++) {
+        int64_t pulses = encoder_core_get_pulses(&core);
+        if (pulses < last || pulses % ENCODER_CORE_HIGH_LIMIT != 0) {
+            bad++;
+        }
+        last = pulses;
+    }
+    pthread_join(writer, NULL);
+    CHECK(bad == 0, "%d torn or regressing snapshots", bad);
+    CHECK(encoder_core_get_pulses(&core) == 200000LL * ENCODER_CORE_HIGH_LIMIT,
+          "concurrent: pulses %lld", (long long)encoder_core_get_pulses(&core));
+}
+
+static void check_pending_limit(void) {
+    encoder_core_t core;
+    sim_pcnt_t sim;
+    setup(&core, &sim);
+    sim.defer_events = true;
+
+    // Reset raised, ISR not run yet (held up on the other core): reads extend across it, however long it waits
+    sim_pcnt_preset_count(&sim, ENCODER_CORE_HIGH_LIMIT - 1);
+    sim_pcnt_step(&sim, 1);
+    CHECK(sim.count == 0 && sim.pending_count == 1, "limit event not pending");
+    int bad = 0;
+    for (int i = 0; i < 100; i++) {
+        sim_pcnt_run(&sim, 100, 1);
+        if (encoder_core_get_pulses(&core) != sim.true_position) bad++;
+    }
+    CHECK(bad == 0, "pending limit: %d reads off the truth", bad);
+    sim_pcnt_deliver(&sim);
+    CHECK(encoder_core_get_pulses(&core) == sim.true_position, "delivered limit: pulses %lld != truth %lld",
+          (long long)encoder_core_get_pulses(&core), (long long)sim.true_position);
+
+    // The reset lands right after the count register read of a pass
+    sim.edges_per_read = 1;
+    sim_pcnt_preset_count(&sim, ENCODER_CORE_HIGH_LIMIT - 1);
+    encoder_snapshot_t snap;
+    encoder_core_snapshot(&core, &snap);
+    sim.edges_per_read = 0;
+    CHECK(sim.pending_count == 1, "reset between reads not pending");
+    CHECK(snap.pulses == sim.true_position - 1, "reset after the read: pulses %lld != truth %lld",
+          (long long)snap.pulses, (long long)sim.true_position - 1);
+    CHECK(encoder_core_get_pulses(&core) == sim.true_position, "reset before the read: pulses %lld != truth %lld",
+          (long long)encoder_core_get_pulses(&core), (long long)sim.true_position);
+    sim_pcnt_deliver(&sim);
+
+    // Same at the low limit
+    sim_pcnt_preset_count(&sim, ENCODER_CORE_LOW_LIMIT + 1);
+    sim_pcnt_step(&sim, -1);
+    CHECK(sim.pending_count == 1, "low limit event not pending");
+    CHECK(encoder_core_get_pulses(&core) == sim.true_position, "pending low limit: pulses %lld != truth %lld",
+          (long long)encoder_core_get_pulses(&core), (long long)sim.true_position);
+    sim_pcnt_deliver(&sim);
+    CHECK(encoder_core_get_pulses(&core) == sim.true_position, "delivered low limit: pulses %lld != truth %lld",
+          (long long)encoder_core_get_pulses(&core), (long long)sim.true_position);
+    CHECK(encoder_core_get_irq_stats(&core).watch_irqs == 3, "watch irqs %u",
+          (unsigned)encoder_core_get_irq_stats(&core).watch_irqs);
+}
+
+static void check_fold_credit(void) {
+    encoder_core_t core;
+    sim_pcnt_t sim;
+    setup(&core, &sim);
+    sim.defer_events = true;
+
+    // The sampler folds across the reset before its interrupt runs: the interrupt must not add the limit again
+    sim_pcnt_preset_count(&sim, ENCODER_CORE_HIGH_LIMIT - 9000);
+    sim_pcnt_run(&sim, 9005, 1);
+    CHECK(sim.pending_count == 1, "high limit event not pending");
+    encoder_core_update_speed(&core);
+    CHECK(core.limit_irq && core.fold_credit == 1, "fold did not credit the reset");
+    sim_pcnt_deliver(&sim);
+    CHECK(core.fold_credit == 0, "credit left after the interrupt");
+    CHECK(encoder_core_get_pulses(&core) == sim.true_position, "fold first: pulses %lld != truth %lld",
+          (long long)encoder_core_get_pulses(&core), (long long)sim.true_position);
+
+    // The interrupt runs first and adds the limit itself; the next fold sees no reset
+    sim_pcnt_preset_count(&sim, ENCODER_CORE_LOW_LIMIT + 9000);
+    sim_pcnt_run(&sim, -9000, 1);
+    sim_pcnt_deliver(&sim);
+    sim_pcnt_run(&sim, -3, 1);
+    encoder_core_update_speed(&core);
+    CHECK(core.fold_credit == 0, "fold credited an accounted reset");
+    CHECK(encoder_core_get_pulses(&core) == sim.true_position, "interrupt first: pulses %lld != truth %lld",
+          (long long)encoder_core_get_pulses(&core), (long long)sim.true_position);
+    CHECK(encoder_core_get_irq_stats(&core).watch_irqs == 2, "watch irqs %u",
+          (unsigned)encoder_core_get_irq_stats(&core).watch_irqs);
+}
+
+static void check_fixed_point_distance(void) {
+    encoder_core_t core;
+    sim_pcnt_t sim;
+    setup(&core, &sim);
+    encoder_core_set_calibration_factor(&core, 1.0137f);
+
+    // Reference from the exact values the core stores (diameter and factor are floats)
+    const long double um_per_pulse = (long double)M_PI * core.wheel_diameter_m * 1e6L / PPR * core.calibration_factor;
+    const int64_t counts[] = { 1, 600, 16777217, 1000000007, 3000000000LL, -3000000000LL, 1LL << 40 };
+    double worst_fixed = 0.0, worst_float = 0.0;
+    for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        long double exact = counts[i] * um_per_pulse;
+        double fixed_err = fabs((double)(encoder_core_pulses_to_um(&core, counts[i]) - exact));
+        double float_err = fabs((double)((long double)(counts[i] * core.distance_per_pulse * core.calibration_factor) * 1e6L - exact));
+        // Truncation to whole micrometres plus the 2^-32 um quantization of the scale
+        double bound = 1.0 + fabs((double)counts[i]) / 4294967296.0;
+        CHECK(fixed_err <= bound, "fixed-point distance at %lld pulses off by %.3f um", (long long)counts[i], fixed_err);
+        if (fixed_err > worst_fixed) worst_fixed = fixed_err;
+        if (float_err > worst_float) worst_float = float_err;
+    }
+    printf("  distance error up to 2^40 pulses: fixed %.3f um, float %.0f um\n", worst_fixed, worst_float);
+
+    // Through the accumulator: 70k overflows, then one more edge
+    for (int i = 0; i < 70000; i++) {
+        sim_pcnt_preset_count(&sim, ENCODER_CORE_HIGH_LIMIT - 1);
+        sim_pcnt_step(&sim, 1);
+    }
+    long double exact = sim.true_position * um_per_pulse;
+    CHECK(fabs((double)(encoder_core_get_distance_um(&core) - exact)) <= 1.0,
+          "distance_um %lld != %.1Lf", (long long)encoder_core_get_distance_um(&core), exact);
+}
+
+static encoder_filter_t make_filter(encoder_filter_type_t type) {
+    encoder_filter_config_t config = encoder_filter_default_config();
+    config.type = type;
+    encoder_filter_t filter;
+    encoder_filter_init(&filter, &config);
+    return filter;
+}
+
+// Deterministic noise in [-1, 1)
+static float noise(uint32_t *state) {
+    *state = *state * 1664525u + 1013904223u;
+    return (float)(*state >> 8) / (float)(1u << 23) - 1.0f;
+}
+
+static void check_filters(void) {
+    // Moving average: exact after a long noisy run, thanks to the integer running sum
+    encoder_filter_t ma = make_filter(ENCODER_FILTER_MOVING_AVERAGE);
+    uint32_t rng = 1;
+    for (int i = 0; i < 1000000; i++) {
+        encoder_filter_apply(&ma, 3.0f + noise(&rng), 0.01f);
+    }
+    float out = 0.0f;
+    for (int i = 0; i < ENCODER_FILTER_MAX_WINDOW; i++) {
+        out = encoder_filter_apply(&ma, 1.234567f, 0.01f);
+    }
+    CHECK(out == 1.234567f, "moving average drifted: %.7f", out);
+
+    encoder_filter_t ema = make_filter(ENCODER_FILTER_EMA);
+    for (int i = 0; i < 200; i++) {
+        out = encoder_filter_apply(&ema, 2.5f, 0.01f);
+    }
+    CHECK(fabsf(out - 2.5f) < 1e-5f, "EMA did not settle: %.6f", out);
+
+    // Trackers on a noisy ramp: lower error than the raw signal, acceleration recovered
+    const encoder_filter_type_t trackers[] = { ENCODER_FILTER_ALPHA_BETA, ENCODER_FILTER_KALMAN };
+    for (size_t t = 0; t < 2; t++) {
+        encoder_filter_t f = make_filter(trackers[t]);
+        rng = 7;
+        double raw_err = 0.0, filt_err = 0.0;
+        for (int i = 0; i < 2000; i++) {
+            float truth = 0.5f * i * 0.01f;     // 0.5 m/s^2
+            float raw = truth + 0.05f * noise(&rng);
+            out = encoder_filter_apply(&f, raw, 0.01f);
+            if (i >= 500) {
+                raw_err += (raw - truth) * (raw - truth);
+                filt_err += (out - truth) * (out - truth);
+            }
+        }
+        const char *name = encoder_filter_type_name(trackers[t]);
+        CHECK(filt_err < raw_err * 0.5, "%s: error %.3g not below raw %.3g", name, filt_err, raw_err);
+        CHECK(fabsf(encoder_filter_get_accel(&f) - 0.5f) < 0.1f, "%s: accel %.3f", name, encoder_filter_get_accel(&f));
+    }
+
+    encoder_filter_type_t type;
+    CHECK(encoder_filter_type_from_name("kalman", &type) == 0 && type == ENCODER_FILTER_KALMAN, "name lookup");
+    CHECK(encoder_filter_type_from_name("bogus", &type) != 0, "bogus name accepted");
+}
+
+static void check_core_filter_switch(void) {
+    encoder_core_t core;
+    sim_pcnt_t sim;
+    setup(&core, &sim);
+
+    encoder_filter_config_t config = encoder_filter_default_config();
+    config.type = ENCODER_FILTER_MOVING_AVERAGE;
+    config.window = 4;
+    encoder_core_set_filter(&core, &config);
+
+    sim_pcnt_advance_us(&sim, 10000);
+    encoder_core_update_speed(&core);
+    for (int i = 0; i < 8; i++) {
+        sim_pcnt_run(&sim, i & 1 ? 200 : 0, 50);
+        sim_pcnt_advance_us(&sim, i & 1 ? 0 : 10000);
+        encoder_core_update_speed(&core);
+    }
+    float expected = 100.0f / 0.01f * (float)M_PI * (DIAMETER_MM / 1000.0f) / PPR;
+    CHECK(encoder_core_get_filter(&core).type == ENCODER_FILTER_MOVING_AVERAGE, "filter not applied");
+    CHECK(fabsf(encoder_core_get_speed_mps(&core) - expected) < 1e-3f * expected,
+          "filtered %.6f != %.6f (raw %.6f)", encoder_core_get_speed_mps(&core), expected, encoder_core_get_raw_speed_mps(&core));
+}
+
+static void check_derivatives(void) {
+    // Quadratic speed profile: accel is linear, jerk constant
+    encoder_deriv_t accel, jerk;
+    encoder_deriv_init(&accel, 9);
+    encoder_deriv_init(&jerk, 9);
+    const float a0 = 0.8f, j = 0.3f;
+    float a = 0.0f, jk = 0.0f, t = 0.0f;
+    for (int i = 0; i < 500; i++) {
+        int64_t t_us = i * 10000;
+        t = t_us / 1e6f;
+        float speed = 1.0f + a0 * t + 0.5f * j * t * t;
+        a = encoder_deriv_push(&accel, speed, t_us);
+        jk = encoder_deriv_push(&jerk, a, t_us);
+    }
+    // The fit belongs to the window centre, 4 samples back
+    float centre = t - 0.04f;
+    CHECK(fabsf(a - (a0 + j * centre)) < 0.01f, "accel %.4f != %.4f", a, a0 + j * centre);
+    CHECK(fabsf(jk - j) < 0.05f, "jerk %.4f != %.4f", jk, j);
+
+    // Sampling jitter: the mean interval across the window keeps the slope unbiased
+    encoder_deriv_init(&accel, 8);
+    for (int i = 0; i < 500; i++) {
+        int64_t t_us = i * 10000 + (i % 3) * 200;
+        a = encoder_deriv_push(&accel, 1.0f + a0 * (t_us / 1e6f), t_us);
+    }
+    CHECK(fabsf(a - a0) < 0.05f * a0, "jittered accel %.4f != %.4f", a, a0);
+
+    // Constant-speed run through the core: acceleration settles at zero, window change applies
+    encoder_core_t core;
+    sim_pcnt_t sim;
+    setup(&core, &sim);
+    encoder_core_set_deriv_window(&core, 4);
+    sim_pcnt_advance_us(&sim, 10000);
+    encoder_core_update_speed(&core);
+    for (int i = 0; i < 20; i++) {
+        sim_pcnt_run(&sim, 100, 100);
+        encoder_core_update_speed(&core);
+    }
+    CHECK(encoder_core_get_deriv_window(&core) == 4, "window %u", encoder_core_get_deriv_window(&core));
+    CHECK(fabsf(encoder_core_get_accel_mps2(&core)) < 1e-3f, "steady accel %.6f", encoder_core_get_accel_mps2(&core));
+}
+
+static void check_plausibility(void) {
+    encoder_core_t core;
+    sim_pcnt_t sim;
+    setup(&core, &sim);
+    encoder_plausibility_t limits = { .max_speed_mps = 50.0f, .max_accel_mps2 = 100.0f };
+    encoder_core_set_plausibility(&core, &limits);
+
+    // Steady 1 kHz edges at 10 ms samples: ~0.52 m/s, plausible
+    sim_pcnt_advance_us(&sim, 10000);
+    encoder_core_update_speed(&core);
+    for (int i = 0; i < 20; i++) {
+        sim_pcnt_run(&sim, 10, 1000);
+        encoder_core_update_speed(&core);
+    }
+    encoder_plausibility_stats_t stats = encoder_core_get_plausibility_stats(&core);
+    CHECK(stats.samples == 21 && stats.speed_violations == 0 && stats.accel_violations == 0,
+          "steady run flagged: %u/%u/%u", stats.samples, stats.speed_violations, stats.accel_violations);
+    float steady = encoder_core_get_raw_speed_mps(&core);
+
+    // A burst of phantom counts: the speed jump is clamped, the pulses are kept
+    int64_t before = encoder_core_get_pulses(&core);
+    sim_pcnt_run(&sim, 400, 25);
+    encoder_core_update_speed(&core);
+    stats = encoder_core_get_plausibility_stats(&core);
+    CHECK(stats.accel_violations == 1, "accel violations %u", stats.accel_violations);
+    float limit = steady + 100.0f * 0.01f;
+    CHECK(fabsf(encoder_core_get_raw_speed_mps(&core) - limit) < 1e-3f,
+          "clamped speed %.4f != %.4f", encoder_core_get_raw_speed_mps(&core), limit);
+    CHECK(encoder_core_get_pulses(&core) - before == 400, "pulses lost: %lld", (long long)(encoder_core_get_pulses(&core) - before));
+
+    encoder_core_clear_plausibility_stats(&core);
+    stats = encoder_core_get_plausibility_stats(&core);
+    CHECK(stats.samples == 0 && stats.accel_violations == 0, "stats not cleared");
+}
+
+static void check_index(void) {
+    encoder_core_t core;
+    sim_pcnt_t sim;
+    setup(&core, &sim);
+    sim.index_period = PPR;
+
+    // Clean revolutions: no error, angle follows the index
+    sim_pcnt_run(&sim, 3 * PPR + PPR / 4, 10);
+    encoder_index_t index;
+    encoder_core_get_index(&core, &index);
+    CHECK(index.count == 3 && index.revolutions == 2 && index.max_error == 0 && index.error_events == 0,
+          "clean run: %u indexes, %u revs, max error %d", index.count, index.revolutions, index.max_error);
+    float angle = -1.0f;
+    CHECK(encoder_core_get_angle_deg(&core, &angle) && fabsf(angle - 90.0f) < 1e-3f, "angle %.3f", angle);
+
+    // Three missed counts in the next revolution
+    sim_pcnt_slip(&sim, 3);
+    sim_pcnt_run(&sim, PPR, 10);
+    encoder_core_get_index(&core, &index);
+    CHECK(index.last_error == -3 && index.max_error == 3 && index.error_events == 1,
+          "slip: last %d, max %d, events %u", index.last_error, index.max_error, index.error_events);
+
+    // Reversing over the index is not a revolution
+    uint32_t revs = index.revolutions;
+    sim_pcnt_run(&sim, -PPR / 2, 10);
+    encoder_core_get_index(&core, &index);
+    CHECK(index.revolutions == revs && index.error_events == 1, "reversal counted as revolution");
+
+    // Homing: position is zero at the next index, and survives a reset
+    encoder_core_home_on_index(&core);
+    CHECK(encoder_core_get_position(&core) == encoder_core_get_pulses(&core), "position before homing");
+    sim_pcnt_run(&sim, -PPR, 10);
+    encoder_core_get_index(&core, &index);
+    int64_t expected = encoder_core_get_pulses(&core) - index.pulses;
+    CHECK(index.homed && encoder_core_get_position(&core) == expected,
+          "homed position %lld != %lld", (long long)encoder_core_get_position(&core), (long long)expected);
+    encoder_core_reset(&core);
+    CHECK(encoder_core_get_position(&core) == expected, "position lost on reset");
+    CHECK(encoder_core_get_angle_deg(&core, &angle) && fabsf(angle - 360.0f * (expected + PPR) / PPR) < 1e-3f,
+          "angle after reset %.3f", angle);
+}
+
+static void check_index_pending_limit(void) {
+    encoder_core_t core;
+    sim_pcnt_t sim;
+    setup(&core, &sim);
+    sim.defer_events = true;
+
+    // A revolution across the high limit; the index arrives before the limit interrupt
+    sim_pcnt_preset_count(&sim, ENCODER_CORE_HIGH_LIMIT - PPR + 5);
+    encoder_core_on_index(&core, sim.now_us);
+    encoder_core_home_on_index(&core);
+    sim_pcnt_run(&sim, PPR, 10);
+    CHECK(sim.count == 5 && sim.pending_count == 1, "limit event not pending");
+    encoder_core_on_index(&core, sim.now_us);
+    sim_pcnt_deliver(&sim);
+
+    encoder_index_t index;
+    encoder_core_get_index(&core, &index);
+    CHECK(index.revolutions == 1 && index.last_error == 0 && index.error_events == 0,
+          "pending limit: %u revs, error %d, %u events", index.revolutions, index.last_error, index.error_events);
+    CHECK(index.pulses == sim.true_position && index.home_pulses == sim.true_position,
+          "latched %lld, home %lld != truth %lld", (long long)index.pulses, (long long)index.home_pulses,
+          (long long)sim.true_position);
+    CHECK(encoder_core_get_position(&core) == 0, "homed position %lld", (long long)encoder_core_get_position(&core));
+}
+
+static void check_count_modes(void) {
+    encoder_core_t core;
+    sim_pcnt_t sim;
+    setup(&core, &sim);
+    encoder_core_set_speed_mode(&core, ENCODER_SPEED_MODE_PERIOD);
+    const float m_per_edge = (float)M_PI * (DIAMETER_MM / 1000.0f) / PPR;
+
+    sim_pcnt_run(&sim, 40000, 5);
+    int64_t um_x4 = encoder_core_get_distance_um(&core);
+
+    // x4 -> x1 with the counter stopped: distance continues
+    sim.count_mode = 1;
+    encoder_core_set_count_mode(&core, ENCODER_COUNT_X1);
+    CHECK(encoder_core_get_pulses(&core) == 10000, "x1 pulses %lld", (long long)encoder_core_get_pulses(&core));
+    CHECK(llabs(encoder_core_get_distance_um(&core) - um_x4) <= 1, "distance jumped on switch");
+
+    // Period speed with one count per captured edge, no jump from the rescale
+    encoder_core_update_speed(&core);
+    for (int i = 0; i < 10; i++) {
+        sim_pcnt_run(&sim, 400, 25);    // 40 kedge/s
+        encoder_core_update_speed(&core);
+    }
+    float expected = 40000.0f * m_per_edge;
+    CHECK(fabsf(encoder_core_get_speed_mps(&core) - expected) < 1e-3f * expected,
+          "x1 speed %.5f != %.5f", encoder_core_get_speed_mps(&core), expected);
+    int64_t true_um = (int64_t)(sim.true_position * (double)M_PI * DIAMETER_MM * 1000.0 / PPR);
+    CHECK(llabs(encoder_core_get_distance_um(&core) - true_um) <= 2 * (int64_t)(m_per_edge * 4e6f),
+          "x1 distance %lld != %lld", (long long)encoder_core_get_distance_um(&core), (long long)true_um);
+
+    // x1 -> x2, then inverted direction
+    sim.count_mode = 2;
+    encoder_core_set_count_mode(&core, ENCODER_COUNT_X2);
+    int64_t before = encoder_core_get_pulses(&core);
+    sim_pcnt_run(&sim, 400, 25);
+    CHECK(encoder_core_get_pulses(&core) - before == 200, "x2 counted %lld", (long long)(encoder_core_get_pulses(&core) - before));
+    sim.invert = true;
+    before = encoder_core_get_pulses(&core);
+    sim_pcnt_run(&sim, 400, 25);
+    CHECK(encoder_core_get_pulses(&core) - before == -200, "inverted counted %lld", (long long)(encoder_core_get_pulses(&core) - before));
+}
+
+static void check_irq_stats(void) {
+    encoder_core_t core;
+    sim_pcnt_t sim;
+    setup(&core, &sim);
+
+    // Fast: the limit interrupts stay on as the backstop, one watch irq per
+    // limit crossed and no edge lost, however the sampler reads in between
+    sim.edges_per_read = 3;
+    for (int tick = 0; tick < 40; tick++) {
+        sim_pcnt_run(&sim, tick < 20 ? 12000 : -12000, 1);
+        encoder_core_update_speed(&core);
+    }
+    sim.edges_per_read = 0;
+    encoder_irq_stats_t stats = encoder_core_get_irq_stats(&core);
+    CHECK(stats.limit_irq, "backstop off while fast");
+    CHECK(stats.watch_irqs == sim.watch_events, "watch irqs %u != limit events %u",
+          (unsigned)stats.watch_irqs, (unsigned)sim.watch_events);
+    CHECK(stats.watch_irqs > 0, "no limit was crossed");
+    CHECK(encoder_core_get_pulses(&core) == sim.true_position,
+          "irq stats: pulses %lld != truth %lld", (long long)encoder_core_get_pulses(&core), (long long)sim.true_position);
+
+    // Slow: the sampler's fold alone extends the count across the limits
+    uint32_t irqs = stats.watch_irqs;
+    sim.edges_per_read = 3;
+    for (int tick = 0; tick < 100; tick++) {
+        sim_pcnt_run(&sim, tick < 50 ? 2000 : -2000, 1);
+        encoder_core_update_speed(&core);
+    }
+    sim.edges_per_read = 0;
+    stats = encoder_core_get_irq_stats(&core);
+    CHECK(!stats.limit_irq && stats.watch_irqs == irqs, "slow: backstop %d, %u watch irqs",
+          stats.limit_irq, (unsigned)(stats.watch_irqs - irqs));
+    CHECK(encoder_core_get_pulses(&core) == sim.true_position,
+          "slow: pulses %lld != truth %lld", (long long)encoder_core_get_pulses(&core), (long long)sim.true_position);
+}
+
+static uint32_t sample_events(encoder_core_t *core, encoder_event_detector_t *det) {
+    encoder_core_update_speed(core);
+    return encoder_event_detector_update(det, core->last_time_us, core->last_pulse_count,
+                                         encoder_core_pulses_to_um(core, core->last_pulse_count), core->last_speed);
+}
+
+static void check_events(void) {
+    encoder_core_t core;
+    sim_pcnt_t sim;
+    setup(&core, &sim);
+    encoder_event_config_t config = { .stall_ms = 50, .overspeed_mps = 15.0f };
+    encoder_event_detector_t det;
+    encoder_event_detector_init(&det, &config);
+    const double um_per_edge = M_PI * DIAMETER_MM * 1000.0 / PPR;
+
+    // Standing still at start: no stall, no direction
+    uint32_t seen = 0;
+    for (int i = 0; i < 10; i++) {
+        sim_pcnt_advance_us(&sim, 10000);
+        seen |= sample_events(&core, &det);
+    }
+    CHECK(seen == 0, "events at rest: 0x%x", (unsigned)seen);
+
+    // Forward at ~10.5 m/s, then dithering by one count is not a reversal
+    for (int i = 0; i < 10; i++) {
+        sim_pcnt_run(&sim, 200, 50);
+        seen |= sample_events(&core, &det);
+    }
+    sim_pcnt_run(&sim, -2, 1000);
+    seen |= sample_events(&core, &det);
+    sim_pcnt_run(&sim, 2, 1000);
+    seen |= sample_events(&core, &det);
+    CHECK(seen == 0, "events while moving forward: 0x%x", (unsigned)seen);
+    CHECK(det.direction == 1, "direction %d", det.direction);
+
+    // Target ahead fires once when crossed
+    int64_t target_um = encoder_core_get_distance_um(&core) + (int64_t)(500 * um_per_edge);
+    encoder_event_detector_set_target(&det, target_um);
+    int target_hits = 0;
+    for (int i = 0; i < 10; i++) {
+        sim_pcnt_run(&sim, 200, 50);
+        if (sample_events(&core, &det) & ENCODER_EVENT_TARGET) target_hits++;
+    }
+    CHECK(target_hits == 1, "target fired %d times", target_hits);
+
+    // Overspeed fires once above the limit and re-arms below 90 %
+    int overspeed = 0;
+    for (int i = 0; i < 20; i++) {
+        sim_pcnt_run(&sim, 400, 25);    // ~21 m/s
+        if (sample_events(&core, &det) & ENCODER_EVENT_OVERSPEED) overspeed++;
+    }
+    CHECK(overspeed == 1, "overspeed fired %d times", overspeed);
+
+    // Reversal, then stall after 50 ms without counts
+    uint32_t reversal = 0;
+    for (int i = 0; i < 5; i++) {
+        sim_pcnt_run(&sim, -200, 50);
+        reversal |= sample_events(&core, &det);
+    }
+    CHECK(reversal & ENCODER_EVENT_DIRECTION, "no reversal reported");
+    CHECK(det.direction == -1, "direction after reversal %d", det.direction);
+    int stalls = 0;
+    for (int i = 0; i < 20; i++) {
+        sim_pcnt_advance_us(&sim, 10000);
+        if (sample_events(&core, &det) & ENCODER_EVENT_STALL) stalls++;
+    }
+    CHECK(stalls == 1, "stall fired %d times", stalls);
+
+    // A reset is not a reversal
+    encoder_core_reset(&core);
+    encoder_event_detector_restart(&det);
+    sim_pcnt_run(&sim, -200, 50);
+    uint32_t after_reset = sample_events(&core, &det);
+    CHECK(!(after_reset & ENCODER_EVENT_DIRECTION), "reset reported as reversal");
+}
+
+typedef struct {
+    sim_pcnt_t *sim;
+    int calls;
+    int64_t hit_pulses;
+} trigger_probe_t;
+
+static void trigger_probe(void *arg) {
+    trigger_probe_t *probe = arg;
+    probe->calls++;
+    // The ISR folded just before the callback
+    encoder_core_t *core = probe->sim->core;
+    probe->hit_pulses = core->total_pulse_count + (probe->sim->count - core->last_count);
+}
+
+// One sampler tick: trigger service, then speed update
+static void run_ticks(encoder_core_t *core, sim_pcnt_t *sim, int ticks, int64_t edges_per_tick) {
+    for (int i = 0; i < ticks; i++) {
+        sim_pcnt_run(sim, edges_per_tick, 1);
+        encoder_core_service_trigger(core);
+        encoder_core_update_speed(core);
+    }
+}
+
+static void check_trigger(void) {
+    encoder_core_t core;
+    sim_pcnt_t sim;
+    setup(&core, &sim);
+    trigger_probe_t probe = { .sim = &sim };
+    encoder_trigger_stats_t stats;
+
+    // Far target: chained across windows, fired once by the watch point at the exact count
+    CHECK(encoder_core_arm_trigger(&core, 100003, trigger_probe, &probe), "arm failed");
+    CHECK(encoder_core_get_trigger_state(&core) == ENCODER_TRIGGER_ARMED, "far target programmed too early");
+    run_ticks(&core, &sim, 12, 10000);
+    encoder_core_get_trigger_stats(&core, &stats);
+    CHECK(probe.calls == 1 && stats.fires == 1 && stats.late_fires == 0,
+          "far target: %d calls, %u fires, %u late", probe.calls, (unsigned)stats.fires, (unsigned)stats.late_fires);
+    CHECK(probe.hit_pulses == 100003, "fired at %lld", (long long)probe.hit_pulses);
+    CHECK(encoder_core_get_trigger_state(&core) == ENCODER_TRIGGER_IDLE && !sim.watch_set, "watch point left behind");
+    CHECK(encoder_core_get_pulses(&core) == sim.true_position, "trigger broke accounting");
+
+    // A near target is programmed at once; a replaced one survives an overflow moving the window away
+    probe.calls = 0;
+    int64_t start = encoder_core_get_pulses(&core);
+    encoder_core_arm_trigger(&core, start - 20000, trigger_probe, &probe);
+    CHECK(encoder_core_get_trigger_state(&core) == ENCODER_TRIGGER_PROGRAMMED, "near target not programmed");
+    encoder_core_disarm_trigger(&core);
+    encoder_core_arm_trigger(&core, start + 20000, trigger_probe, &probe);
+    run_ticks(&core, &sim, 4, -12000);     // away from the target, through the low limit
+    run_ticks(&core, &sim, 12, 10000);
+    CHECK(probe.calls == 1 && probe.hit_pulses == start + 20000,
+          "after overflow: %d calls at %lld", probe.calls, (long long)probe.hit_pulses);
+
+    // Target at the current count fires at once from the task
+    probe.calls = 0;
+    encoder_core_arm_trigger(&core, encoder_core_get_pulses(&core), trigger_probe, &probe);
+    encoder_core_get_trigger_stats(&core, &stats);
+    CHECK(probe.calls == 1 && stats.late_fires == 1, "immediate target: %d calls", probe.calls);
+
+    // Disarmed and reset triggers never fire
+    probe.calls = 0;
+    encoder_core_arm_trigger(&core, encoder_core_get_pulses(&core) + 100, trigger_probe, &probe);
+    encoder_core_disarm_trigger(&core);
+    encoder_core_arm_trigger(&core, encoder_core_get_pulses(&core) + 200, trigger_probe, &probe);
+    encoder_core_reset(&core);
+    sim.true_position = 0;
+    run_ticks(&core, &sim, 1, 300);
+    CHECK(probe.calls == 0 && !sim.watch_set, "cancelled trigger fired");
+
+    // The count moves between the service call's register reads: the window
+    // must still come from one consistent pass, or the watch point is off
+    probe.calls = 0;
+    encoder_core_get_trigger_stats(&core, &stats);
+    uint32_t late = stats.late_fires;
+    int64_t target = encoder_core_get_pulses(&core) + 5000;
+    sim.edges_per_read = 1;
+    encoder_core_arm_trigger(&core, target, trigger_probe, &probe);
+    run_ticks(&core, &sim, 20, 400);
+    sim.edges_per_read = 0;
+    encoder_core_get_trigger_stats(&core, &stats);
+    CHECK(probe.calls == 1 && probe.hit_pulses == target && stats.late_fires == late,
+          "moving reads: %d calls at %lld (target %lld), %u late", probe.calls, (long long)probe.hit_pulses,
+          (long long)target, (unsigned)(stats.late_fires - late));
+    CHECK(encoder_core_get_pulses(&core) == sim.true_position, "moving reads: pulses %lld != truth %lld",
+          (long long)encoder_core_get_pulses(&core), (long long)sim.true_position);
+
+    // Micrometre target converts to the nearest count
+    int64_t um = encoder_core_pulses_to_um(&core, 12345);
+    CHECK(encoder_core_um_to_pulses(&core, um) == 12345, "um -> pulses %lld", (long long)encoder_core_um_to_pulses(&core, um));
+}
+
+static encoder_ring_t ring;
+
+static void push_n(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t seq = atomic_load(&ring.head);
+        encoder_sample_t s = { .timestamp_us = seq, .pulses = 3 * (int64_t)seq, .speed_mps = (float)seq };
+        encoder_ring_push(&ring, &s);
+    }
+}
+
+static void check_ring_consumers(void) {
+    encoder_ring_init(&ring);
+    encoder_ring_cursor_t web, logger, display;
+    encoder_ring_cursor_init(&ring, &web);
+    encoder_ring_cursor_init(&ring, &logger);
+    encoder_ring_cursor_init(&ring, &display);
+
+    encoder_sample_t out[64];
+    push_n(10);
+    CHECK(encoder_ring_read(&ring, &web, out, 64) == 10 && out[9].seq == 9, "web did not read 10 samples");
+    CHECK(encoder_ring_read(&ring, &logger, out, 4) == 4 && out[3].seq == 3, "logger did not read 4 samples");
+
+    // Display falls far behind: it resumes at the oldest held sample and counts the loss
+    push_n(ENCODER_RING_CAPACITY + 100);
+    size_t n = encoder_ring_read(&ring, &display, out, 1);
+    CHECK(n == 1 && out[0].seq == 110, "display resumed at seq %u", (unsigned)out[0].seq);
+    CHECK(display.dropped == 110, "display dropped %u, expected 110", (unsigned)display.dropped);
+
+    n = encoder_ring_read(&ring, &web, out, 64);
+    CHECK(n == 64 && web.dropped == 100 && out[0].seq == 110, "web after overrun: n=%zu dropped=%u first=%u",
+          n, (unsigned)web.dropped, (unsigned)out[0].seq);
+
+    encoder_sample_t latest;
+    CHECK(encoder_ring_latest(&ring, &latest) && latest.seq == ENCODER_RING_CAPACITY + 109, "latest seq %u", (unsigned)latest.seq);
+}
+
+static void check_ring_seek(void) {
+    encoder_ring_init(&ring);
+    encoder_ring_cursor_t cursor;
+    encoder_sample_t out[4];
+
+    // Nothing produced yet: any seek waits at the start
+    encoder_ring_cursor_seek(&ring, &cursor, 0);
+    CHECK(cursor.next == 0 && cursor.dropped == 0, "empty seek next=%u", (unsigned)cursor.next);
+
+    push_n(100);
+    encoder_ring_cursor_seek(&ring, &cursor, 42);
+    CHECK(encoder_ring_read(&ring, &cursor, out, 4) == 4 && out[0].seq == 42 && cursor.dropped == 0,
+          "seek 42 read seq %u", (unsigned)out[0].seq);
+    encoder_ring_cursor_seek(&ring, &cursor, 100);
+    CHECK(encoder_ring_read(&ring, &cursor, out, 4) == 0, "seek to head returned samples");
+
+    // Overwritten: resume at the oldest held and count the gap
+    push_n(ENCODER_RING_CAPACITY);
+    encoder_ring_cursor_seek(&ring, &cursor, 60);
+    CHECK(encoder_ring_read(&ring, &cursor, out, 1) == 1 && out[0].seq == 100 && cursor.dropped == 40,
+          "stale seek: first=%u dropped=%u", (unsigned)out[0].seq, (unsigned)cursor.dropped);
+
+    // Ahead of the producer (previous boot): start over at the oldest, nothing counted
+    encoder_ring_cursor_seek(&ring, &cursor, 1000000);
+    CHECK(encoder_ring_read(&ring, &cursor, out, 1) == 1 && out[0].seq == 100 && cursor.dropped == 0,
+          "future seek: first=%u dropped=%u", (unsigned)out[0].seq, (unsigned)cursor.dropped);
+}
+
+static void check_ring_wrap(void) {
+    encoder_ring_init(&ring);
+    push_n(ENCODER_RING_CAPACITY);
+    // Fast-forward the sequence to just short of 2^32, as after ~500 days at 100 Hz
+    atomic_store(&ring.head, UINT32_MAX - 9);
+    push_n(ENCODER_RING_CAPACITY);
+
+    // head is now CAPACITY - 10: a full ring, not one holding CAPACITY - 10 samples from 0
+    encoder_ring_cursor_t cursor;
+    encoder_sample_t out[ENCODER_RING_CAPACITY];
+    encoder_ring_cursor_oldest(&ring, &cursor);
+    CHECK(cursor.next == UINT32_MAX - 9, "oldest after wrap %u", (unsigned)cursor.next);
+    size_t n = encoder_ring_read(&ring, &cursor, out, ENCODER_RING_CAPACITY);
+    CHECK(n == ENCODER_RING_CAPACITY && out[9].seq == UINT32_MAX && out[10].seq == 0 && cursor.dropped == 0,
+          "read across wrap: n=%zu dropped=%u", n, (unsigned)cursor.dropped);
+
+    // A seek from before the wrap counts the gap across it
+    encoder_ring_cursor_seek(&ring, &cursor, UINT32_MAX - 19);
+    CHECK(cursor.next == UINT32_MAX - 9 && cursor.dropped == 10, "seek across wrap: next=%u dropped=%u",
+          (unsigned)cursor.next, (unsigned)cursor.dropped);
+
+    // Land exactly on head == 0: the ring is full, not empty
+    atomic_store(&ring.head, UINT32_MAX - 4);
+    push_n(5);
+    encoder_sample_t latest;
+    CHECK(encoder_ring_latest(&ring, &latest) && latest.seq == UINT32_MAX, "latest at head 0");
+}
+
+static atomic_int producer_done;
+
+static void *ring_producer(void *arg) {
+    push_n((uint32_t)(uintptr_t)arg);
+    atomic_store(&producer_done, 1);
+    return NULL;
+}
+
+static void check_ring_concurrent(void) {
+    encoder_ring_init(&ring);
+    atomic_store(&producer_done, 0);
+    encoder_ring_cursor_t cursor;
+    encoder_ring_cursor_init(&ring, &cursor);
+
+    const uint32_t total = 2000000;
+    pthread_t producer;
+    pthread_create(&producer, NULL, ring_producer, (void *)(uintptr_t)total);
+
+    encoder_sample_t out[256];
+    uint32_t got = 0, bad = 0, expect = 0;
+    for (;;) {
+        int done = atomic_load(&producer_done);
+        size_t n = encoder_ring_read(&ring, &cursor, out, 256);
+        for (size_t i = 0; i < n; i++) {
+            if (out[i].seq < expect || out[i].pulses != 3 * (int64_t)out[i].seq || out[i].timestamp_us != out[i].seq) {
+                bad++;
+            }
+            expect = out[i].seq + 1;
+        }
+        got += n;
+        if (done && n == 0) break;
+    }
+    pthread_join(producer, NULL);
+    CHECK(bad == 0, "%u inconsistent or out-of-order samples", (unsigned)bad);
+    CHECK(got + cursor.dropped == total, "read %u + dropped %u != %u", (unsigned)got, (unsigned)cursor.dropped, (unsigned)total);
+}
+
+// ---------------------------------------------------------------------------
+// Benchmarks
+// ---------------------------------------------------------------------------
+
+static volatile int64_t sink;
+
+static int cmp_i64(const void *a, const void *b) {
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Prints throughput over a tight loop and latency percentiles over individually timed calls.
+ */
+static void report(const char *name, int64_t loop_ns, long iterations, int64_t *lat, long lat_n) {
+    qsort(lat, lat_n, sizeof(*lat), cmp_i64);
+    printf("  %-28s %8.1f Mcall/s  %6.1f ns/call  p50 %4lld ns  p99 %4lld ns  max %6lld ns\n",
+           name,
+           iterations / (loop_ns / 1e3),
+           (double)loop_ns / iterations,
+           (long long)lat[lat_n / 2],
+           (long long)lat[lat_n * 99 / 100],
+           (long long)lat[lat_n - 1]);
+}
+
+static void bench_get_pulses(long iterations) {
+    encoder_core_t core;
+    sim_pcnt_t sim;
+    setup(&core, &sim);
+    sim_pcnt_run(&sim, 100000, 1);
+
+    int64_t t0 = mono_ns();
+    for (long i = 0; i < iterations; i++) {
+        sink = encoder_core_get_pulses(&core);
+    }
+    int64_t loop_ns = mono_ns() - t0;
+
+    long lat_n = iterations < 100000 ? iterations : 100000;
+    int64_t *lat = malloc(lat_n * sizeof(*lat));
+    for (long i = 0; i < lat_n; i++) {
+        int64_t s = mono_ns();
+        sink = encoder_core_get_pulses(&core);
+        lat[i] = mono_ns() - s;
+    }
+    report("encoder_get_pulses", loop_ns, iterations, lat, lat_n);
+    free(lat);
+}
+
+static void bench_snapshot(long iterations) {
+    encoder_core_t core;
+    sim_pcnt_t sim;
+    setup(&core, &sim);
+    encoder_snapshot_t snap;
+
+    int64_t t0 = mono_ns();
+    for (long i = 0; i < iterations; i++) {
+        encoder_core_snapshot(&core, &snap);
+        sink = snap.pulses;
+    }
+    int64_t loop_ns = mono_ns() - t0;
+
+    long lat_n = iterations < 100000 ? iterations : 100000;
+    int64_t *lat = malloc(lat_n * sizeof(*lat));
+    for (long i = 0; i < lat_n; i++) {
+        int64_t s = mono_ns();
+        encoder_core_snapshot(&core, &snap);
+        lat[i] = mono_ns() - s;
+    }
+    report("encoder_get_snapshot", loop_ns, iterations, lat, lat_n);
+    free(lat);
+}
+
+static void bench_update_speed(long iterations) {
+    encoder_core_t core;
+    sim_pcnt_t sim;
+    setup(&core, &sim);
+
+    int64_t t0 = mono_ns();
+    for (long i = 0; i < iterations; i++) {
+        sim_pcnt_step(&sim, 1);
+        sim.now_us += 1000;
+        encoder_core_update_speed(&core);
+    }
+    int64_t loop_ns = mono_ns() - t0;
+
+    long lat_n = iterations < 100000 ? iterations : 100000;
+    int64_t *lat = malloc(lat_n * sizeof(*lat));
+    for (long i = 0; i < lat_n; i++) {
+        sim_pcnt_step(&sim, 1);
+        sim.now_us += 1000;
+        int64_t s = mono_ns();
+        encoder_core_update_speed(&core);
+        lat[i] = mono_ns() - s;
+    }
+    report("encoder_update_speed", loop_ns, iterations, lat, lat_n);
+    free(lat);
+}
+
+static void bench_ring(long iterations) {
+    encoder_ring_init(&ring);
+    encoder_ring_cursor_t cursor;
+    encoder_ring_cursor_init(&ring, &cursor);
+    encoder_sample_t sample = {0}, out[64];
+
+    int64_t t0 = mono_ns();
+    for (long i = 0; i < iterations; i++) {
+        encoder_ring_push(&ring, &sample);
+    }
+    int64_t push_ns = mono_ns() - t0;
+
+    long reads = 0;
+    encoder_ring_cursor_oldest(&ring, &cursor);
+    t0 = mono_ns();
+    for (long i = 0; i < iterations; i += 64) {
+        if (encoder_ring_read(&ring, &cursor, out, 64) == 0) {
+            encoder_ring_cursor_oldest(&ring, &cursor);
+        }
+        reads += 64;
+    }
+    int64_t read_ns = mono_ns() - t0;
+    printf("  %-28s %8.1f Msample/s  %6.1f ns/sample\n", "encoder_ring_push", iterations / (push_ns / 1e3), (double)push_ns / iterations);
+    printf("  %-28s %8.1f Msample/s  %6.1f ns/sample\n", "encoder_ring_read (x64)", reads / (read_ns / 1e3), (double)read_ns / reads);
+}
+
+static void bench_distance_paths(long iterations) {
+    encoder_core_t core;
+    sim_pcnt_t sim;
+    setup(&core, &sim);
+    encoder_core_set_calibration_factor(&core, 1.0137f);
+
+    volatile float fsink = 0.0f;
+    int64_t t0 = mono_ns();
+    for (long i = 0; i < iterations; i++) {
+        fsink = (float)(i * 7919) * core.distance_per_pulse * core.calibration_factor;
+    }
+    int64_t float_ns = mono_ns() - t0;
+    (void)fsink;
+
+    t0 = mono_ns();
+    for (long i = 0; i < iterations; i++) {
+        sink = encoder_core_pulses_to_um(&core, (int64_t)i * 7919);
+    }
+    int64_t fixed_ns = mono_ns() - t0;
+
+    printf("  %-28s %8.1f Mcall/s  %6.1f ns/call\n", "distance float path", iterations / (float_ns / 1e3), (double)float_ns / iterations);
+    printf("  %-28s %8.1f Mcall/s  %6.1f ns/call\n", "distance Q32.32 path", iterations / (fixed_ns / 1e3), (double)fixed_ns / iterations);
+}
+
+static void bench_filters(long iterations) {
+    for (int type = ENCODER_FILTER_NONE; type <= ENCODER_FILTER_KALMAN; type++) {
+        encoder_filter_t f = make_filter((encoder_filter_type_t)type);
+        uint32_t rng = 3;
+        float acc = 0.0f;
+        int64_t t0 = mono_ns();
+        for (long i = 0; i < iterations; i++) {
+            acc += encoder_filter_apply(&f, 1.0f + 0.01f * noise(&rng), 0.01f);
+        }
+        int64_t ns = mono_ns() - t0;
+        sink = (int64_t)acc;
+        char name[40];
+        snprintf(name, sizeof(name), "filter %s", encoder_filter_type_name((encoder_filter_type_t)type));
+        printf("  %-28s %8.1f Msample/s  %6.1f ns/sample (incl. noise)\n", name, iterations / (ns / 1e3), (double)ns / iterations);
+    }
+}
+
+static void bench_derivatives(long iterations) {
+    encoder_deriv_t accel, jerk;
+    encoder_deriv_init(&accel, ENCODER_DERIV_MAX_WINDOW);
+    encoder_deriv_init(&jerk, ENCODER_DERIV_MAX_WINDOW);
+    uint32_t rng = 5;
+    float acc = 0.0f;
+    int64_t t0 = mono_ns();
+    for (long i = 0; i < iterations; i++) {
+        float a = encoder_deriv_push(&accel, 1.0f + 0.01f * noise(&rng), i * 10000);
+        acc += encoder_deriv_push(&jerk, a, i * 10000);
+    }
+    int64_t ns = mono_ns() - t0;
+    sink = (int64_t)acc;
+    printf("  %-28s %8.1f Msample/s  %6.1f ns/sample (window %d)\n",
+           "accel + jerk", iterations / (ns / 1e3), (double)ns / iterations, ENCODER_DERIV_MAX_WINDOW);
+}
+
+static void bench_sim_throughput(long iterations) {
+    encoder_core_t core;
+    sim_pcnt_t sim;
+    setup(&core, &sim);
+
+    int64_t t0 = mono_ns();
+    sim_pcnt_run(&sim, iterations, 1);
+    int64_t loop_ns = mono_ns() - t0;
+    printf("  %-28s %8.1f Medge/s  (%u watch events)\n",
+           "simulated edges", iterations / (loop_ns / 1e3), (unsigned)sim.watch_events);
+}
+
+int main(int argc, char **argv) {
+    int quick = argc > 1 && strcmp(argv[1], "--quick") == 0;
+    long iterations = quick ? 200000 : 20000000;
+
+    printf("Accounting checks\n");
+    check_forward_overflows();
+    check_reverse_overflows();
+    check_limit_dither();
+    check_direct_levels();
+    check_speed();
+    check_period_speed();
+    check_auto_speed_mode();
+    check_reset();
+    check_set_pulses();
+    check_fixed_point_distance();
+    check_filters();
+    check_core_filter_switch();
+    check_derivatives();
+    check_plausibility();
+    check_index();
+    check_index_pending_limit();
+    check_count_modes();
+    check_irq_stats();
+    check_events();
+    check_trigger();
+    check_ring_consumers();
+    check_ring_seek();
+    check_ring_wrap();
+    check_ring_concurrent();
+    check_wide_accumulator();
+    check_concurrent_snapshots();
+    check_pending_limit();
+    check_fold_credit();
+    printf("  %s (%d failure%s)\n", failures ? "FAILED" : "ok", failures, failures == 1 ? "" : "s");
+
+    printf("Benchmarks (%ld iterations)\n", iterations);
+    bench_get_pulses(iterations);
+    bench_snapshot(iterations);
+    bench_update_speed(iterations);
+    bench_ring(iterations);
+    bench_distance_paths(iterations);
+    bench_filters(iterations);
+    bench_derivatives(iterations);
+    bench_sim_throughput(iterations);
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,622 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE     // memmem
+#endif
+#include "mock_httpd.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include "esp_log.h"
+
+static const char *TAG = "MOCK_HTTPD";
+
+#define MOCK_MAX_HEADERS 32
+
+typedef struct {
+    httpd_config_t config;
+    httpd_uri_t *routes;
+    size_t route_count;
+} mock_server_t;
+
+/**
+ * @brief State of the request being handled; req->aux points back here.
+ */
+typedef struct {
+    httpd_req_t req;
+    mock_server_t *server;
+    char raw[MOCK_HTTPD_REQUEST_MAX + 1];       ///< Copy of the request, split in place
+    const char *hdr_name[MOCK_MAX_HEADERS];
+    const char *hdr_value[MOCK_MAX_HEADERS];
+    size_t hdr_count;
+    const char *body;
+    size_t body_read;
+
+    const char *status;
+    const char *type;
+    const char *resp_name[MOCK_MAX_HEADERS];
+    const char *resp_value[MOCK_MAX_HEADERS];
+    size_t resp_count;
+    bool started;
+    bool chunked;
+    bool finished;
+    mock_httpd_buf_t *out;
+} mock_req_t;
+
+static mock_req_t s_req;        // one request at a time, like the IDF server task
+
+const char *esp_err_to_name(esp_err_t code) {
+    switch (code) {
+        case ESP_OK:                        return "ESP_OK";
+        case ESP_FAIL:                      return "ESP_FAIL";
+        case ESP_ERR_NO_MEM:                return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG:           return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE:         return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE:          return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND:             return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_HTTPD_RESULT_TRUNC:    return "ESP_ERR_HTTPD_RESULT_TRUNC";
+        default:                            return "UNKNOWN";
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Output buffer
+// ---------------------------------------------------------------------------
+
+void mock_httpd_buf_free(mock_httpd_buf_t *buf) {
+    free(buf->data);
+    *buf = (mock_httpd_buf_t){0};
+}
+
+static void buf_append(mock_httpd_buf_t *buf, const void *data, size_t len) {
+    if (buf->len + len + 1 > buf->cap) {
+        size_t cap = buf->cap ? buf->cap : 1024;
+        while (cap < buf->len + len + 1) cap *= 2;
+        char *grown = realloc(buf->data, cap);
+        if (!grown) abort();
+        buf->data = grown;
+        buf->cap = cap;
+    }
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+    buf->data[buf->len] = 0;        // keeps the raw response printable in checks
+}
+
+static void buf_printf(mock_httpd_buf_t *buf, const char *fmt, ...) {
+    char line[512];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    if (n > 0) buf_append(buf, line, (size_t)n < sizeof(line) ? (size_t)n : sizeof(line) - 1);
+}
+
+// ---------------------------------------------------------------------------
+// Server and routes
+// ---------------------------------------------------------------------------
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config) {
+    mock_server_t *server = calloc(1, sizeof(*server));
+    if (!server) return ESP_ERR_NO_MEM;
+    server->config = *config;
+    server->routes = calloc(config->max_uri_handlers ? config->max_uri_handlers : 1, sizeof(httpd_uri_t));
+    if (!server->routes) {
+        free(server);
+        return ESP_ERR_NO_MEM;
+    }
+    *handle = server;
+    return ESP_OK;
+}
+
+esp_err_t httpd_stop(httpd_handle_t handle) {
+    mock_server_t *server = handle;
+    if (!server) return ESP_ERR_INVALID_ARG;
+    free(server->routes);
+    free(server);
+    return ESP_OK;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler) {
+    mock_server_t *server = handle;
+    if (!server || !uri_handler || !uri_handler->uri || !uri_handler->handler) return ESP_ERR_INVALID_ARG;
+    for (size_t i = 0; i < server->route_count; i++) {
+        if (server->routes[i].method == uri_handler->method && strcmp(server->routes[i].uri, uri_handler->uri) == 0) {
+            return ESP_ERR_HTTPD_HANDLER_EXISTS;
+        }
+    }
+    if (server->route_count >= server->config.max_uri_handlers) return ESP_ERR_HTTPD_HANDLERS_FULL;
+    server->routes[server->route_count++] = *uri_handler;
+    return ESP_OK;
+}
+
+/**
+ * @brief IDF's wildcard matcher: a trailing '*' matches any rest, a trailing
+ * '?' makes the character before it optional ("/path/?*" style).
+ */
+bool httpd_uri_match_wildcard(const char *uri_template, const char *uri_to_match, size_t match_upto) {
+    size_t tpl_len = strlen(uri_template);
+    char last = tpl_len > 0 ? uri_template[tpl_len - 1] : 0;
+    char prev = tpl_len > 1 ? uri_template[tpl_len - 2] : 0;
+    bool asterisk = last == '*' || (prev == '*' && last == '?');
+    bool quest = last == '?' || (prev == '?' && last == '*');
+
+    size_t special = (asterisk ? 1 : 0) + (quest ? 2 : 0);  // '?' also consumes its optional character
+    if (tpl_len < special) return false;
+    size_t exact = tpl_len - special;
+    if (match_upto < exact) return false;
+
+    if (!quest) {
+        if (!asterisk && match_upto != exact) return false;
+        return strncmp(uri_template, uri_to_match, exact) == 0;
+    }
+    if (match_upto > exact && uri_template[exact] != uri_to_match[exact]) return false;
+    if (strncmp(uri_template, uri_to_match, exact) != 0) return false;
+    return asterisk || match_upto <= exact + 1;
+}
+
+// ---------------------------------------------------------------------------
+// Request side
+// ---------------------------------------------------------------------------
+
+static mock_req_t *mock_of(httpd_req_t *r) {
+    return r ? (mock_req_t *)r->aux : NULL;
+}
+
+static const char *find_header(const mock_req_t *mr, const char *field) {
+    for (size_t i = 0; i < mr->hdr_count; i++) {
+        if (strcasecmp(mr->hdr_name[i], field) == 0) return mr->hdr_value[i];
+    }
+    return NULL;
+}
+
+// Copies src truncated to size - 1; ESP_ERR_HTTPD_RESULT_TRUNC if it did not fit
+static esp_err_t copy_truncated(char *dst, size_t size, const char *src, size_t len) {
+    if (size == 0) return ESP_ERR_INVALID_ARG;
+    size_t n = len < size - 1 ? len : size - 1;
+    memcpy(dst, src, n);
+    dst[n] = 0;
+    return n < len ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+}
+
+int httpd_req_recv(httpd_req_t *r, char *buf, size_t buf_len) {
+    mock_req_t *mr = mock_of(r);
+    if (!mr || !buf) return -1;
+    size_t left = r->content_len - mr->body_read;
+    size_t n = left < buf_len ? left : buf_len;
+    memcpy(buf, mr->body + mr->body_read, n);
+    mr->body_read += n;
+    return (int)n;
+}
+
+size_t httpd_req_get_hdr_value_len(httpd_req_t *r, const char *field) {
+    mock_req_t *mr = mock_of(r);
+    const char *value = mr ? find_header(mr, field) : NULL;
+    return value ? strlen(value) : 0;
+}
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *r, const char *field, char *val, size_t val_size) {
+    mock_req_t *mr = mock_of(r);
+    if (!mr || !field || !val) return ESP_ERR_INVALID_ARG;
+    const char *value = find_header(mr, field);
+    if (!value) return ESP_ERR_NOT_FOUND;
+    return copy_truncated(val, val_size, value, strlen(value));
+}
+
+size_t httpd_req_get_url_query_len(httpd_req_t *r) {
+    const char *q = r ? strchr(r->uri, '?') : NULL;
+    return q ? strlen(q + 1) : 0;
+}
+
+esp_err_t httpd_req_get_url_query_str(httpd_req_t *r, char *buf, size_t buf_len) {
+    if (!r || !buf) return ESP_ERR_INVALID_ARG;
+    const char *q = strchr(r->uri, '?');
+    if (!q) return ESP_ERR_NOT_FOUND;
+    return copy_truncated(buf, buf_len, q + 1, strlen(q + 1));
+}
+
+esp_err_t httpd_query_key_value(const char *qry, const char *key, char *val, size_t val_size) {
+    if (!qry || !key || !val) return ESP_ERR_INVALID_ARG;
+    size_t key_len = strlen(key);
+    const char *p = qry;
+    while (*p) {
+        size_t param_len = strcspn(p, "&");
+        const char *eq = memchr(p, '=', param_len);
+        if (eq && (size_t)(eq - p) == key_len && strncmp(p, key, key_len) == 0) {
+            return copy_truncated(val, val_size, eq + 1, param_len - key_len - 1);
+        }
+        p += param_len;
+        if (*p == '&') p++;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+// ---------------------------------------------------------------------------
+// Response side
+// ---------------------------------------------------------------------------
+
+esp_err_t httpd_resp_set_status(httpd_req_t *r, const char *status) {
+    mock_req_t *mr = mock_of(r);
+    if (!mr || !status) return ESP_ERR_INVALID_ARG;
+    mr->status = status;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type) {
+    mock_req_t *mr = mock_of(r);
+    if (!mr || !type) return ESP_ERR_INVALID_ARG;
+    mr->type = type;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *r, const char *field, const char *value) {
+    mock_req_t *mr = mock_of(r);
+    if (!mr || !field || !value) return ESP_ERR_INVALID_ARG;
+    size_t max = mr->server->config.max_resp_headers;
+    if (max > MOCK_MAX_HEADERS) max = MOCK_MAX_HEADERS;
+    if (mr->resp_count >= max) return ESP_ERR_HTTPD_RESP_HDR;
+    // Pointers are kept, as in IDF: the strings must outlive the response
+    mr->resp_name[mr->resp_count] = field;
+    mr->resp_value[mr->resp_count] = value;
+    mr->resp_count++;
+    return ESP_OK;
+}
+
+static void write_head(mock_req_t *mr, bool chunked, size_t length) {
+    buf_printf(mr->out, "HTTP/1.1 %s\r\nContent-Type: %s\r\n", mr->status ? mr->status : "200 OK",
+               mr->type ? mr->type : "text/html");
+    for (size_t i = 0; i < mr->resp_count; i++) {
+        buf_printf(mr->out, "%s: %s\r\n", mr->resp_name[i], mr->resp_value[i]);
+    }
+    if (chunked) {
+        buf_printf(mr->out, "Transfer-Encoding: chunked\r\n\r\n");
+    } else {
+        buf_printf(mr->out, "Content-Length: %zu\r\n\r\n", length);
+    }
+    mr->started = true;
+    mr->chunked = chunked;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len) {
+    mock_req_t *mr = mock_of(r);
+    if (!mr) return ESP_ERR_INVALID_ARG;
+    if (mr->started) return ESP_ERR_HTTPD_RESP_SEND;
+    size_t len = buf_len == HTTPD_RESP_USE_STRLEN ? (buf ? strlen(buf) : 0) : (size_t)buf_len;
+    write_head(mr, false, buf ? len : 0);
+    if (buf && len) buf_append(mr->out, buf, len);
+    mr->finished = true;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, ssize_t buf_len) {
+    mock_req_t *mr = mock_of(r);
+    if (!mr) return ESP_ERR_INVALID_ARG;
+    if (mr->finished || (mr->started && !mr->chunked)) return ESP_ERR_HTTPD_RESP_SEND;
+    if (!mr->started) write_head(mr, true, 0);
+    size_t len = buf_len == HTTPD_RESP_USE_STRLEN ? (buf ? strlen(buf) : 0) : (size_t)buf_len;
+    if (!buf || len == 0) {
+        buf_printf(mr->out, "0\r\n\r\n");
+        mr->finished = true;
+        return ESP_OK;
+    }
+    buf_printf(mr->out, "%zx\r\n", len);
+    buf_append(mr->out, buf, len);
+    buf_printf(mr->out, "\r\n");
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t error, const char *msg) {
+    const char *status, *text;
+    switch (error) {
+        case HTTPD_501_METHOD_NOT_IMPLEMENTED:   status = "501 Method Not Implemented"; text = "Request method is not supported by server"; break;
+        case HTTPD_505_VERSION_NOT_SUPPORTED:    status = "505 Version Not Supported"; text = "HTTP version not supported by server"; break;
+        case HTTPD_400_BAD_REQUEST:              status = "400 Bad Request"; text = "Bad request syntax"; break;
+        case HTTPD_401_UNAUTHORIZED:             status = "401 Unauthorized"; text = "No permission -- see authorization schemes"; break;
+        case HTTPD_403_FORBIDDEN:                status = "403 Forbidden"; text = "Request forbidden -- authorization will not help"; break;
+        case HTTPD_404_NOT_FOUND:                status = "404 Not Found"; text = "Nothing matches the given URI"; break;
+        case HTTPD_405_METHOD_NOT_ALLOWED:       status = "405 Method Not Allowed"; text = "Specified method is invalid for this resource"; break;
+        case HTTPD_408_REQ_TIMEOUT:              status = "408 Request Timeout"; text = "Server closed this connection"; break;
+        case HTTPD_411_LENGTH_REQUIRED:          status = "411 Length Required"; text = "Chunked encoding not supported by server"; break;
+        case HTTPD_414_URI_TOO_LONG:             status = "414 URI Too Long"; text = "URI is too long"; break;
+        case HTTPD_431_REQ_HDR_FIELDS_TOO_LARGE: status = "431 Request Header Fields Too Large"; text = "Header fields are too long"; break;
+        default:                                 status = "500 Internal Server Error"; text = "Server has encountered an unexpected error"; break;
+    }
+    mock_req_t *mr = mock_of(req);
+    if (!mr) return ESP_ERR_INVALID_ARG;
+    mr->status = status;
+    mr->type = "text/html";
+    mr->resp_count = 0;
+    return httpd_resp_send(req, msg ? msg : text, HTTPD_RESP_USE_STRLEN);
+}
+
+// ---------------------------------------------------------------------------
+// Parsing and dispatch
+// ---------------------------------------------------------------------------
+
+static int method_of(const char *name) {
+    if (strcmp(name, "GET") == 0)    return HTTP_GET;
+    if (strcmp(name, "POST") == 0)   return HTTP_POST;
+    if (strcmp(name, "PUT") == 0)    return HTTP_PUT;
+    if (strcmp(name, "DELETE") == 0) return HTTP_DELETE;
+    if (strcmp(name, "HEAD") == 0)   return HTTP_HEAD;
+    return -1;
+}
+
+size_t mock_httpd_request_size(const char *data, size_t len) {
+    const char *end = memmem(data, len, "\r\n\r\n", 4);
+    if (!end) {
+        return len >= MOCK_HTTPD_REQUEST_MAX ? SIZE_MAX : 0;
+    }
+    size_t head = (size_t)(end - data) + 4;
+    size_t body = 0;
+    for (const char *line = data; line < end; ) {
+        const char *eol = memmem(line, (size_t)(end - line) + 2, "\r\n", 2);
+        if (!eol) break;
+        if ((size_t)(eol - line) > 15 && strncasecmp(line, "Content-Length:", 15) == 0) {
+            body = strtoul(line + 15, NULL, 10);
+        }
+        line = eol + 2;
+    }
+    if (body > MOCK_HTTPD_REQUEST_MAX || head + body > MOCK_HTTPD_REQUEST_MAX) return SIZE_MAX;
+    return head + body <= len ? head + body : 0;
+}
+
+// Splits the request in mr->raw; returns the error to answer with, or -1 if it is well-formed
+static int parse_request(mock_req_t *mr, size_t len, bool *keep_alive) {
+    char *end = strstr(mr->raw, "\r\n\r\n");
+    if (!end) return HTTPD_400_BAD_REQUEST;
+    *end = 0;
+    mr->body = end + 4;
+    size_t body_avail = len - (size_t)(mr->body - mr->raw);
+
+    char *line_end = strstr(mr->raw, "\r\n");
+    if (line_end) *line_end = 0;
+    char *method = mr->raw;
+    char *uri = strchr(method, ' ');
+    if (!uri) return HTTPD_400_BAD_REQUEST;
+    *uri++ = 0;
+    char *version = strchr(uri, ' ');
+    if (!version) return HTTPD_400_BAD_REQUEST;
+    *version++ = 0;
+    if (strncmp(version, "HTTP/1.", 7) != 0) return HTTPD_505_VERSION_NOT_SUPPORTED;
+    *keep_alive = strcmp(version, "HTTP/1.1") == 0;
+
+    mr->req.method = method_of(method);
+    if (mr->req.method < 0) return HTTPD_501_METHOD_NOT_IMPLEMENTED;
+    if (strlen(uri) > HTTPD_MAX_URI_LEN) return HTTPD_414_URI_TOO_LONG;
+    strcpy((char *)mr->req.uri, uri);
+
+    char *line = line_end ? line_end + 2 : end;
+    while (line < end) {
+        char *next = strstr(line, "\r\n");
+        if (next) *next = 0;
+        char *colon = strchr(line, ':');
+        if (!colon) return HTTPD_400_BAD_REQUEST;
+        if (mr->hdr_count >= MOCK_MAX_HEADERS) return HTTPD_431_REQ_HDR_FIELDS_TOO_LARGE;
+        *colon = 0;
+        char *value = colon + 1;
+        while (*value == ' ' || *value == '\t') value++;
+        mr->hdr_name[mr->hdr_count] = line;
+        mr->hdr_value[mr->hdr_count] = value;
+        mr->hdr_count++;
+        line = next ? next + 2 : end;
+    }
+
+    const char *connection = find_header(mr, "Connection");
+    if (connection) {
+        if (strcasecmp(connection, "close") == 0) *keep_alive = false;
+        if (strcasecmp(connection, "keep-alive") == 0) *keep_alive = true;
+    }
+    if (find_header(mr, "Transfer-Encoding")) return HTTPD_411_LENGTH_REQUIRED;
+    const char *length = find_header(mr, "Content-Length");
+    mr->req.content_len = length ? strtoul(length, NULL, 10) : 0;
+    if (mr->req.content_len > body_avail) return HTTPD_400_BAD_REQUEST;
+    return -1;
+}
+
+esp_err_t mock_httpd_handle(httpd_handle_t handle, const char *request, size_t len, mock_httpd_buf_t *out,
+                            bool *keep_alive) {
+    mock_server_t *server = handle;
+    mock_req_t *mr = &s_req;
+    // Reset only the bookkeeping; raw and uri are overwritten by the parser
+    mr->server = server;
+    mr->out = out;
+    mr->hdr_count = 0;
+    mr->body = NULL;
+    mr->body_read = 0;
+    mr->status = NULL;
+    mr->type = NULL;
+    mr->resp_count = 0;
+    mr->started = mr->chunked = mr->finished = false;
+    memset(&mr->req, 0, sizeof(mr->req));     // uri is const in the IDF layout, so no struct assignment
+    mr->req.handle = handle;
+    mr->req.aux = mr;
+    *keep_alive = false;
+
+    if (len > MOCK_HTTPD_REQUEST_MAX) {
+        httpd_resp_send_err(&mr->req, HTTPD_431_REQ_HDR_FIELDS_TOO_LARGE, NULL);
+        return ESP_FAIL;
+    }
+    memcpy(mr->raw, request, len);
+    mr->raw[len] = 0;
+
+    int error = parse_request(mr, len, keep_alive);
+    if (error >= 0) {
+        *keep_alive = false;
+        httpd_resp_send_err(&mr->req, (httpd_err_code_t)error, NULL);
+        return ESP_FAIL;
+    }
+
+    size_t upto = strcspn(mr->req.uri, "?");
+    const httpd_uri_t *route = NULL;
+    bool other_method = false;
+    for (size_t i = 0; i < server->route_count && !route; i++) {
+        const httpd_uri_t *candidate = &server->routes[i];
+        if (candidate->is_websocket) continue;
+        bool match = server->config.uri_match_fn
+                         ? server->config.uri_match_fn(candidate->uri, mr->req.uri, upto)
+                         : strlen(candidate->uri) == upto && strncmp(candidate->uri, mr->req.uri, upto) == 0;
+        if (match && (int)candidate->method == mr->req.method) {
+            route = candidate;
+        } else if (match) {
+            other_method = true;
+        }
+    }
+    if (!route) {
+        httpd_resp_send_err(&mr->req, other_method ? HTTPD_405_METHOD_NOT_ALLOWED : HTTPD_404_NOT_FOUND, NULL);
+        return ESP_OK;
+    }
+
+    mr->req.user_ctx = route->user_ctx;
+    esp_err_t err = route->handler(&mr->req);
+    if (err != ESP_OK) {
+        // IDF closes the session without completing the response
+        *keep_alive = false;
+        return ESP_FAIL;
+    }
+    if (!mr->started) {
+        ESP_LOGW(TAG, "%s returned ESP_OK without a response", route->uri);
+        httpd_resp_send_err(&mr->req, HTTPD_500_INTERNAL_SERVER_ERROR, NULL);
+    } else if (!mr->finished) {
+        ESP_LOGW(TAG, "%s left a chunked response open", route->uri);
+        httpd_resp_send_chunk(&mr->req, NULL, 0);
+    }
+    return ESP_OK;
+}
+
+// ---------------------------------------------------------------------------
+// TCP server
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    int fd;
+    size_t len;
+    uint64_t last_used;
+    char buf[MOCK_HTTPD_REQUEST_MAX];
+} mock_conn_t;
+
+static void conn_close(mock_conn_t *conn) {
+    close(conn->fd);
+    conn->fd = -1;
+    conn->len = 0;
+}
+
+static bool send_all(int fd, const char *data, size_t len) {
+    while (len) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+// Handles every complete request in the connection buffer; false once the connection is closed
+static bool conn_process(mock_server_t *server, mock_conn_t *conn, mock_httpd_buf_t *out) {
+    for (;;) {
+        size_t size = mock_httpd_request_size(conn->buf, conn->len);
+        if (size == 0) return true;
+        bool keep_alive = false;
+        out->len = 0;
+        mock_httpd_handle(server, conn->buf, size == SIZE_MAX ? conn->len : size, out, &keep_alive);
+        if (!send_all(conn->fd, out->data, out->len) || !keep_alive || size == SIZE_MAX) {
+            conn_close(conn);
+            return false;
+        }
+        memmove(conn->buf, conn->buf + size, conn->len - size);
+        conn->len -= size;
+    }
+}
+
+esp_err_t mock_httpd_serve(httpd_handle_t handle, volatile sig_atomic_t *stop) {
+    mock_server_t *server = handle;
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (listener < 0) return ESP_FAIL;
+    int one = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(server->config.server_port),
+                                .sin_addr.s_addr = htonl(INADDR_ANY) };
+    if (bind(listener, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(listener, server->config.backlog_conn) < 0) {
+        ESP_LOGE(TAG, "Cannot listen on port %u: %s", server->config.server_port, strerror(errno));
+        close(listener);
+        return ESP_FAIL;
+    }
+
+    size_t max_conns = server->config.max_open_sockets ? server->config.max_open_sockets : 1;
+    mock_conn_t *conns = calloc(max_conns, sizeof(*conns));
+    struct pollfd *fds = calloc(max_conns + 1, sizeof(*fds));
+    if (!conns || !fds) {
+        free(conns);
+        free(fds);
+        close(listener);
+        return ESP_ERR_NO_MEM;
+    }
+    for (size_t i = 0; i < max_conns; i++) conns[i].fd = -1;
+    mock_httpd_buf_t out = {0};
+    uint64_t tick = 0;
+
+    while (!*stop) {
+        fds[0] = (struct pollfd){ .fd = listener, .events = POLLIN };
+        for (size_t i = 0; i < max_conns; i++) {
+            fds[i + 1] = (struct pollfd){ .fd = conns[i].fd, .events = POLLIN };
+        }
+        if (poll(fds, max_conns + 1, 200) <= 0) continue;
+
+        if (fds[0].revents & POLLIN) {
+            int fd = accept(listener, NULL, NULL);
+            if (fd >= 0) {
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                mock_conn_t *slot = NULL, *lru = NULL;
+                for (size_t i = 0; i < max_conns && !slot; i++) {
+                    if (conns[i].fd < 0) slot = &conns[i];
+                    else if (!lru || conns[i].last_used < lru->last_used) lru = &conns[i];
+                }
+                if (!slot && server->config.lru_purge_enable) {
+                    conn_close(lru);
+                    slot = lru;
+                }
+                if (slot) {
+                    slot->fd = fd;
+                    slot->len = 0;
+                    slot->last_used = ++tick;
+                } else {
+                    close(fd);      // no free socket, as IDF without LRU purge
+                }
+            }
+        }
+        for (size_t i = 0; i < max_conns; i++) {
+            mock_conn_t *conn = &conns[i];
+            if (conn->fd < 0 || fds[i + 1].fd != conn->fd || !(fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR))) {
+                continue;
+            }
+            ssize_t n = recv(conn->fd, conn->buf + conn->len, sizeof(conn->buf) - conn->len, 0);
+            if (n <= 0) {
+                conn_close(conn);
+                continue;
+            }
+            conn->len += (size_t)n;
+            conn->last_used = ++tick;
+            conn_process(server, conn, &out);
+        }
+    }
+
+    for (size_t i = 0; i < max_conns; i++) {
+        if (conns[i].fd >= 0) conn_close(&conns[i]);
+    }
+    mock_httpd_buf_free(&out);
+    free(conns);
+    free(fds);
+    close(listener);
+    return ESP_OK;
+}
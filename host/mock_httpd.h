@@ -0,0 +1,59 @@
+#pragma once
+
+/*
+ * Mock ESP-IDF HTTP server for host builds.
+ *
+ * Implements the esp_http_server.h stand-in in host/include. Requests come
+ * either as raw bytes (mock_httpd_handle(), for checks, fuzzing and
+ * benchmarks) or from TCP clients (mock_httpd_serve(), for load tests).
+ * Both paths share the same parser, routing and response writer. Handlers run
+ * one at a time, as on IDF's single server task, so none of this is
+ * thread-safe.
+ */
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "esp_http_server.h"
+
+#define MOCK_HTTPD_REQUEST_MAX 8192     ///< Request line, headers and body
+
+/**
+ * @brief Growable byte buffer the raw response is written to.
+ */
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} mock_httpd_buf_t;
+
+void mock_httpd_buf_free(mock_httpd_buf_t *buf);
+
+/**
+ * @brief Returns the size of the first complete request in data.
+ *
+ * @return size_t Bytes up to the end of its body, 0 if more bytes are needed,
+ *         SIZE_MAX if it can never fit MOCK_HTTPD_REQUEST_MAX
+ */
+size_t mock_httpd_request_size(const char *data, size_t len);
+
+/**
+ * @brief Runs one complete raw request through the registered routes.
+ *
+ * The raw HTTP/1.1 response is appended to out. Malformed requests get the
+ * error response IDF would send.
+ *
+ * @param keep_alive Set to whether the connection may carry another request
+ * @return esp_err_t ESP_OK, or ESP_FAIL if the handler failed (IDF closes the connection)
+ */
+esp_err_t mock_httpd_handle(httpd_handle_t server, const char *request, size_t len, mock_httpd_buf_t *out,
+                            bool *keep_alive);
+
+/**
+ * @brief Serves TCP clients on config.server_port until *stop is set.
+ *
+ * Holds up to max_open_sockets connections. When they are all in use, a new
+ * one either replaces the least recently used (lru_purge_enable) or is refused.
+ */
+esp_err_t mock_httpd_serve(httpd_handle_t server, volatile sig_atomic_t *stop);
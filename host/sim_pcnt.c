@@ -0,0 +1,187 @@
+#include "sim_pcnt.h"
+
+// Gray sequence that the PCNT channel setup decodes as counting up
+static const int forward_a[4] = {0, 0, 1, 1};
+static const int forward_b[4] = {0, 1, 1, 0};
+
+static int phase_index(const sim_pcnt_t *sim) {
+    for (int i = 0; i < 4; i++) {
+        if (forward_a[i] == sim->level_a && forward_b[i] == sim->level_b) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+static void raise_event(sim_pcnt_t *sim, int watch_point) {
+    if (!sim->core) {
+        return;
+    }
+    if (sim->defer_events && sim->pending_count < (int)(sizeof(sim->pending) / sizeof(sim->pending[0]))) {
+        sim->pending[sim->pending_count++] = watch_point;
+        return;
+    }
+    // The ISR runs between two edges: its own count reads must not move the shaft mid-step
+    int edges_per_read = sim->edges_per_read;
+    sim->edges_per_read = 0;
+    encoder_core_on_watch_point(sim->core, watch_point);
+    sim->edges_per_read = edges_per_read;
+}
+
+/**
+ * @brief Applies one count step and emulates the unit limit behaviour.
+ */
+static void apply_delta(sim_pcnt_t *sim, int delta) {
+    sim->count += delta;
+    if (sim->count == ENCODER_CORE_HIGH_LIMIT || sim->count == ENCODER_CORE_LOW_LIMIT) {
+        int watch_point = sim->count;
+        sim->count = 0;
+        if (sim->limit_irq) {
+            sim->watch_events++;
+            raise_event(sim, watch_point);
+        }
+    } else if (sim->watch_set && sim->count == sim->watch_value) {
+        raise_event(sim, sim->count);
+    }
+}
+
+void sim_pcnt_deliver(sim_pcnt_t *sim) {
+    int count = sim->pending_count;
+    sim->pending_count = 0;
+    for (int i = 0; i < count; i++) {
+        encoder_core_on_watch_point(sim->core, sim->pending[i]);
+    }
+}
+
+static int backend_get_count(void *ctx) {
+    sim_pcnt_t *sim = ctx;
+    int count = sim->count;
+    if (sim->edges_per_read) {
+        sim_pcnt_run(sim, sim->edges_per_read, 0);
+    }
+    return count;
+}
+
+static void backend_set_limit_irq(void *ctx, bool enable) {
+    ((sim_pcnt_t *)ctx)->limit_irq = enable;
+}
+
+static int64_t backend_now_us(void *ctx) {
+    return ((sim_pcnt_t *)ctx)->now_us;
+}
+
+static void backend_set_edge_capture(void *ctx, bool enable) {
+    ((sim_pcnt_t *)ctx)->edge_capture = enable;
+}
+
+static int backend_add_watch(void *ctx, int value) {
+    sim_pcnt_t *sim = ctx;
+    if (sim->watch_set) {
+        return -1;  // the core programs one trigger watch point at a time
+    }
+    sim->watch_set = true;
+    sim->watch_value = value;
+    return 0;
+}
+
+static void backend_remove_watch(void *ctx, int value) {
+    sim_pcnt_t *sim = ctx;
+    if (sim->watch_set && sim->watch_value == value) {
+        sim->watch_set = false;
+    }
+}
+
+const encoder_backend_t sim_pcnt_backend = {
+    .get_count   = backend_get_count,
+    .now_us      = backend_now_us,
+    .set_edge_capture = backend_set_edge_capture,
+    .add_watch   = backend_add_watch,
+    .remove_watch = backend_remove_watch,
+    .set_limit_irq = backend_set_limit_irq,
+};
+
+void sim_pcnt_init(sim_pcnt_t *sim, encoder_core_t *core) {
+    sim->count = 0;
+    sim->level_a = 0;
+    sim->level_b = 0;
+    sim->true_position = 0;
+    sim->now_us = 0;
+    sim->watch_events = 0;
+    sim->limit_irq = true;
+    sim->edge_capture = false;
+    sim->index_period = 0;
+    sim->count_mode = 4;
+    sim->invert = false;
+    sim->watch_set = false;
+    sim->watch_value = 0;
+    sim->defer_events = false;
+    sim->pending_count = 0;
+    sim->edges_per_read = 0;
+    sim->core = core;
+}
+
+void sim_pcnt_set_levels(sim_pcnt_t *sim, int level_a, int level_b) {
+    level_a = level_a ? 1 : 0;
+    level_b = level_b ? 1 : 0;
+
+    int sign = sim->invert ? -1 : 1;
+    // Channel A: edge on A, level on B (rise +1, fall -1, inverted while B low); x1 holds on fall
+    if (level_a != sim->level_a) {
+        int delta = level_a ? 1 : -1;
+        if (!sim->level_b) delta = -delta;
+        sim->level_a = level_a;
+        bool counted = sim->count_mode != 1 || level_a;
+        if (counted) {
+            apply_delta(sim, sign * delta);
+        }
+        if (counted && sim->edge_capture && sim->core) {
+            encoder_core_on_edge(sim->core, sim->now_us);
+        }
+    }
+    // Channel B: edge on B, level on A (rise +1, fall -1, inverted while A high); x4 only
+    if (level_b != sim->level_b) {
+        int delta = level_b ? 1 : -1;
+        if (sim->level_a) delta = -delta;
+        sim->level_b = level_b;
+        if (sim->count_mode == 4) {
+            apply_delta(sim, sign * delta);
+        }
+    }
+}
+
+void sim_pcnt_step(sim_pcnt_t *sim, int direction) {
+    int next = (phase_index(sim) + (direction > 0 ? 1 : 3)) & 3;
+    sim->true_position += direction > 0 ? 1 : -1;
+    sim_pcnt_set_levels(sim, forward_a[next], forward_b[next]);
+    if (sim->index_period > 0 && sim->true_position % sim->index_period == 0) {
+        encoder_core_on_index(sim->core, sim->now_us);
+    }
+}
+
+void sim_pcnt_slip(sim_pcnt_t *sim, int64_t pulses) {
+    sim->true_position += pulses;
+}
+
+void sim_pcnt_run(sim_pcnt_t *sim, int64_t edges, int64_t edge_period_us) {
+    int direction = edges >= 0 ? 1 : -1;
+    int64_t n = edges >= 0 ? edges : -edges;
+    for (int64_t i = 0; i < n; i++) {
+        sim->now_us += edge_period_us;
+        sim_pcnt_step(sim, direction);
+    }
+}
+
+void sim_pcnt_preset_count(sim_pcnt_t *sim, int count) {
+    int jump = count - sim->count;
+    sim->true_position += jump;
+    sim->count = count;
+    if (sim->core) {
+        // Fold the jump in as motion; extended, it could pass for a limit reset
+        sim->core->total_pulse_count += jump;
+        sim->core->last_count += jump;
+    }
+}
+
+void sim_pcnt_advance_us(sim_pcnt_t *sim, int64_t us) {
+    sim->now_us += us;
+}
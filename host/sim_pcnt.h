@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "encoder_core.h"
+
+/**
+ * Simulated PCNT unit for host builds.
+ *
+ * Mirrors the channel configuration of encoder_pcnt.c (x4 decoding with A edge /
+ * B level and B edge / A level, x2 and x1 on channel A only, optional
+ * inversion) and the unit behaviour at the limits: when the
+ * count reaches ENCODER_CORE_HIGH_LIMIT or ENCODER_CORE_LOW_LIMIT it is reset
+ * to zero and, while the core keeps the limit interrupts on, the watch-point
+ * event is delivered to the bound core; a watch point added through the
+ * backend fires without a reset. Alongside the emulated hardware it keeps the
+ * true position, so accounting errors in the core show up as a mismatch.
+ *
+ * Events are delivered synchronously unless defer_events is set; they then
+ * wait, as for an ISR on the other core, until sim_pcnt_deliver().
+ */
+typedef struct {
+    int count;                  ///< Emulated hardware count
+    int level_a;
+    int level_b;
+    int64_t true_position;      ///< Ground truth in quadrature edges (x4 counts)
+    int64_t now_us;             ///< Simulated clock
+    uint32_t watch_events;      ///< Raised limit events
+    bool limit_irq;             ///< Limit resets raise an event (set through the backend)
+    bool edge_capture;          ///< Phase A edges are timestamped into the core
+    int index_period;           ///< True pulses per index (Z) pulse; 0 = no index channel
+    int count_mode;             ///< Decoding: 1 (A rising), 2 (A both edges) or 4 (default)
+    bool invert;                ///< Count direction swapped
+    bool watch_set;             ///< Extra watch point added through the backend
+    int watch_value;
+    bool defer_events;          ///< Queue watch-point events instead of delivering them
+    int pending[4];             ///< Queued watch-point values
+    int pending_count;
+    int edges_per_read;         ///< Edges the shaft moves after every count read, as between two register reads
+    encoder_core_t *core;       ///< Receives watch-point events
+} sim_pcnt_t;
+
+/**
+ * @brief Backend operations reading the simulated unit and clock.
+ */
+extern const encoder_backend_t sim_pcnt_backend;
+
+/**
+ * @brief Resets the simulated unit to count 0, A=B=0 and clock 0.
+ */
+void sim_pcnt_init(sim_pcnt_t *sim, encoder_core_t *core);
+
+/**
+ * @brief Sets the phase levels; each changed phase is decoded as one edge.
+ */
+void sim_pcnt_set_levels(sim_pcnt_t *sim, int level_a, int level_b);
+
+/**
+ * @brief Advances one quadrature edge. Positive direction counts up.
+ */
+void sim_pcnt_step(sim_pcnt_t *sim, int direction);
+
+/**
+ * @brief Runs a constant-rate waveform.
+ *
+ * @param sim Simulated unit
+ * @param edges Number of edges; the sign selects the direction
+ * @param edge_period_us Clock advance per edge
+ */
+void sim_pcnt_run(sim_pcnt_t *sim, int64_t edges, int64_t edge_period_us);
+
+/**
+ * @brief Moves the shaft without counting, as missed counts would.
+ *
+ * Only the ground truth advances; index pulses still follow the true
+ * position, so the core sees the loss as a revolution error.
+ */
+void sim_pcnt_slip(sim_pcnt_t *sim, int64_t pulses);
+
+/**
+ * @brief Forces the hardware count (and the ground truth with it).
+ *
+ * Used to park the counter next to a limit and provoke watch-point events
+ * without stepping through 32k edges first. The bound core is told about the
+ * jump as if it had folded the motion, so it need not stay within a half
+ * window.
+ */
+void sim_pcnt_preset_count(sim_pcnt_t *sim, int count);
+
+/**
+ * @brief Delivers the watch-point events queued while defer_events was set.
+ */
+void sim_pcnt_deliver(sim_pcnt_t *sim);
+
+/**
+ * @brief Advances the simulated clock.
+ */
+void sim_pcnt_advance_us(sim_pcnt_t *sim, int64_t us);
@@ -0,0 +1,648 @@
+/**
+ * @file web_bench.c
+ *
+ * Host checks, fuzzing and benchmarks for the web layer.
+ *
+ * The firmware's static page handler, and the request body parsers when cJSON
+ * is available (WEB_BENCH_HAVE_CJSON), are linked against the mock httpd in
+ * mock_httpd.c. Requests are fed as raw bytes, so the measured time is the
+ * parsing, routing, handler and response writing of one request, without
+ * sockets. Allocations are counted by wrapping malloc and friends at link
+ * time (-Wl,--wrap).
+ *
+ * Usage: web_bench [--quick] [--parsers] [--fuzz N] [--serve PORT]
+ *   --parsers     only the body parser checks and fuzzing
+ *   --fuzz N      N mutated requests (and parser bodies) instead of the default
+ *   --serve PORT  serve the same routes over TCP, e.g. for tools/http_loadtest.py
+ * Exit code is non-zero if any check fails, and WEB_BENCH_SKIPPED for
+ * --parsers in a build without cJSON, so ctest reports that test as skipped.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <signal.h>
+#include <time.h>
+
+#include "mock_httpd.h"
+#include "static_handler.h"
+#include "web_assets.h"
+#ifdef WEB_BENCH_HAVE_CJSON
+#include "web_parse.h"
+#endif
+
+#define WEB_BENCH_SKIPPED 77     ///< SKIP_RETURN_CODE of the web_bench_parsers test
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do {                                   \
+        if (!(cond)) {                                          \
+            failures++;                                         \
+            printf("  FAIL %s:%d: ", __FILE__, __LINE__);       \
+            printf(__VA_ARGS__);                                \
+            printf("\n");                                       \
+        }                                                       \
+    } while (0)
+
+static int64_t mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// ---------------------------------------------------------------------------
+// Allocation counting (linked with -Wl,--wrap=malloc,--wrap=calloc,...)
+// ---------------------------------------------------------------------------
+
+static size_t alloc_calls = 0;
+static size_t alloc_bytes = 0;
+static long alloc_live = 0;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+void *__wrap_malloc(size_t size) {
+    void *p = __real_malloc(size);
+    if (p) {
+        alloc_calls++;
+        alloc_bytes += size;
+        alloc_live++;
+    }
+    return p;
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+    void *p = __real_calloc(n, size);
+    if (p) {
+        alloc_calls++;
+        alloc_bytes += n * size;
+        alloc_live++;
+    }
+    return p;
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    void *p = __real_realloc(ptr, size);
+    if (p && size) {
+        alloc_calls++;
+        alloc_bytes += size;
+        if (!ptr) alloc_live++;
+    }
+    return p;
+}
+
+void __wrap_free(void *ptr) {
+    if (ptr) alloc_live--;
+    __real_free(ptr);
+}
+
+// ---------------------------------------------------------------------------
+// Routes and request helpers
+// ---------------------------------------------------------------------------
+
+#ifdef WEB_BENCH_HAVE_CJSON
+/**
+ * @brief /api/trigger without an encoder: receives and parses the body like
+ * the firmware handler, then echoes what it parsed.
+ */
+static esp_err_t trigger_echo_handler(httpd_req_t *req) {
+    char buf[160];
+    int ret = httpd_req_recv(req, buf, sizeof(buf) - 1);
+    if (ret <= 0) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid request");
+    }
+    buf[ret] = 0;
+
+    web_trigger_request_t request;
+    esp_err_t err = web_parse_trigger(buf, &request);
+    if (err == ESP_ERR_INVALID_ARG) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+    }
+    if (err == ESP_ERR_NOT_FOUND && !request.disarm) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "target_m missing");
+    }
+    char json[128];
+    int len = snprintf(json, sizeof(json), "{\"channel\":%d,\"disarm\":%s,\"target_m\":%.3f,\"output_pin\":%d}",
+                       request.channel, request.disarm ? "true" : "false", request.target_m, request.output_pin);
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, json, len);
+}
+
+static const httpd_uri_t uri_trigger_echo = {
+    .uri       = "/api/trigger",
+    .method    = HTTP_POST,
+    .handler   = trigger_echo_handler,
+    .user_ctx  = NULL
+};
+#endif
+
+// Same matching and limits as start_webserver(); the wildcard route goes last
+static httpd_handle_t start_server(uint16_t port) {
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = port;
+    config.max_open_sockets = 13;
+    config.max_uri_handlers = 20;
+    config.lru_purge_enable = true;
+    config.uri_match_fn = httpd_uri_match_wildcard;
+
+    httpd_handle_t server = NULL;
+    if (httpd_start(&server, &config) != ESP_OK) {
+        return NULL;
+    }
+#ifdef WEB_BENCH_HAVE_CJSON
+    httpd_register_uri_handler(server, &uri_trigger_echo);
+#endif
+    httpd_register_uri_handler(server, &uri_static);
+    return server;
+}
+
+static int handle(httpd_handle_t server, const char *request, mock_httpd_buf_t *out, bool *keep_alive) {
+    bool keep = false;
+    out->len = 0;
+    mock_httpd_handle(server, request, strlen(request), out, keep_alive ? keep_alive : &keep);
+    return out->len > 12 && strncmp(out->data, "HTTP/1.1 ", 9) == 0 ? atoi(out->data + 9) : -1;
+}
+
+// Copies a response header value; false if absent
+static bool resp_header(const mock_httpd_buf_t *out, const char *name, char *value, size_t len) {
+    const char *end = strstr(out->data, "\r\n\r\n");
+    size_t name_len = strlen(name);
+    for (const char *line = strstr(out->data, "\r\n"); line && line < end; line = strstr(line + 2, "\r\n")) {
+        const char *field = line + 2;
+        if (strncasecmp(field, name, name_len) == 0 && field[name_len] == ':') {
+            const char *v = field + name_len + 1;
+            while (*v == ' ') v++;
+            size_t n = strcspn(v, "\r");
+            if (n >= len) n = len - 1;
+            memcpy(value, v, n);
+            value[n] = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+static const char *resp_body(const mock_httpd_buf_t *out) {
+    const char *end = strstr(out->data, "\r\n\r\n");
+    return end ? end + 4 : NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Checks
+// ---------------------------------------------------------------------------
+
+static void check_static(httpd_handle_t server, mock_httpd_buf_t *out) {
+    char value[128];
+    const web_asset_t *index = web_assets_find("/index.html");
+    CHECK(index != NULL, "index.html not embedded");
+    if (!index) return;
+
+    int status = handle(server, "GET /index.html HTTP/1.1\r\nHost: esp\r\nAccept-Encoding: gzip\r\n\r\n", out, NULL);
+    CHECK(status == 200, "GET /index.html: %d", status);
+    CHECK(resp_header(out, "Content-Encoding", value, sizeof(value)) && strcmp(value, "gzip") == 0,
+          "no gzip encoding");
+    CHECK(resp_header(out, "Content-Length", value, sizeof(value)) && strtoul(value, NULL, 10) == index->size,
+          "Content-Length %s, asset %zu bytes", value, index->size);
+    const char *body = resp_body(out);
+    CHECK(body && (size_t)(out->data + out->len - body) == index->size && memcmp(body, index->data, index->size) == 0,
+          "body differs from the embedded asset");
+    CHECK(index->size > 2 && index->data[0] == 0x1f && index->data[1] == 0x8b, "asset is not gzip");
+
+    char etag[64] = "";
+    CHECK(resp_header(out, "ETag", etag, sizeof(etag)) && strcmp(etag, index->etag) == 0, "ETag '%s'", etag);
+    char request[256];
+    snprintf(request, sizeof(request), "GET /index.html HTTP/1.1\r\nIf-None-Match: %s\r\n\r\n", etag);
+    status = handle(server, request, out, NULL);
+    CHECK(status == 304, "If-None-Match: %d", status);
+    CHECK(resp_header(out, "Content-Length", value, sizeof(value)) && strcmp(value, "0") == 0, "304 with a body");
+    status = handle(server, "GET /index.html HTTP/1.1\r\nIf-None-Match: \"stale\"\r\n\r\n", out, NULL);
+    CHECK(status == 200, "stale ETag: %d", status);
+
+    status = handle(server, "GET /index.html?v=3 HTTP/1.1\r\n\r\n", out, NULL);
+    CHECK(status == 200, "query string: %d", status);
+    status = handle(server, "GET / HTTP/1.1\r\n\r\n", out, NULL);
+    CHECK(status == 302 && resp_header(out, "Location", value, sizeof(value)) && strcmp(value, "/index.html") == 0,
+          "GET /: %d", status);
+    status = handle(server, "GET /missing.html HTTP/1.1\r\n\r\n", out, NULL);
+    CHECK(status == 404, "missing file: %d", status);
+    status = handle(server, "POST /index.html HTTP/1.1\r\nContent-Length: 0\r\n\r\n", out, NULL);
+    CHECK(status == 405, "POST to a GET route: %d", status);
+}
+
+static void check_protocol(httpd_handle_t server, mock_httpd_buf_t *out) {
+    bool keep = false;
+    handle(server, "GET /index.html HTTP/1.1\r\n\r\n", out, &keep);
+    CHECK(keep, "HTTP/1.1 not kept alive");
+    handle(server, "GET /index.html HTTP/1.1\r\nConnection: close\r\n\r\n", out, &keep);
+    CHECK(!keep, "Connection: close kept alive");
+    handle(server, "GET /index.html HTTP/1.0\r\n\r\n", out, &keep);
+    CHECK(!keep, "HTTP/1.0 kept alive");
+
+    int status = handle(server, "GARBAGE\r\n\r\n", out, &keep);
+    CHECK(status == 400 && !keep, "malformed request line: %d", status);
+    status = handle(server, "PATCH /index.html HTTP/1.1\r\n\r\n", out, NULL);
+    CHECK(status == 501, "unknown method: %d", status);
+    status = handle(server, "GET /index.html HTTP/2.0\r\n\r\n", out, NULL);
+    CHECK(status == 505, "HTTP/2.0: %d", status);
+    status = handle(server, "GET /index.html HTTP/1.1\r\nNoColon\r\n\r\n", out, NULL);
+    CHECK(status == 400, "header without colon: %d", status);
+
+    static char long_uri[HTTPD_MAX_URI_LEN + 64];
+    int n = snprintf(long_uri, sizeof(long_uri), "GET /");
+    memset(long_uri + n, 'a', HTTPD_MAX_URI_LEN);
+    strcpy(long_uri + n + HTTPD_MAX_URI_LEN, " HTTP/1.1\r\n\r\n");
+    status = handle(server, long_uri, out, NULL);
+    CHECK(status == 414, "long URI: %d", status);
+
+    // Framing: pipelined requests are split at the end of each body
+    const char *pipelined = "POST /x HTTP/1.1\r\nContent-Length: 3\r\n\r\nabcGET / HTTP/1.1\r\n\r\n";
+    size_t first = strstr(pipelined, "GET") - pipelined;
+    CHECK(mock_httpd_request_size(pipelined, strlen(pipelined)) == first, "pipelined size");
+    CHECK(mock_httpd_request_size(pipelined, first - 1) == 0, "partial body not waited for");
+    CHECK(mock_httpd_request_size("GET / HTTP/1.1\r\n", 16) == 0, "partial headers not waited for");
+    CHECK(mock_httpd_request_size("GET / HTTP/1.1\r\nContent-Length: 999999\r\n\r\n", 42) == SIZE_MAX,
+          "oversized body accepted");
+
+    // IDF's wildcard rules
+    CHECK(httpd_uri_match_wildcard("/*", "/index.html", 11), "/* vs /index.html");
+    CHECK(httpd_uri_match_wildcard("/api/*", "/api/samples", 12), "/api/* vs /api/samples");
+    CHECK(!httpd_uri_match_wildcard("/api/*", "/apx/samples", 12), "/api/* vs /apx/samples");
+    CHECK(httpd_uri_match_wildcard("/path/?", "/path", 5), "/path/? vs /path");
+    CHECK(httpd_uri_match_wildcard("/path/?", "/path/", 6), "/path/? vs /path/");
+    CHECK(!httpd_uri_match_wildcard("/path/?", "/path/x", 7), "/path/? vs /path/x");
+    CHECK(httpd_uri_match_wildcard("/path/?*", "/path/x", 7), "/path/?* vs /path/x");
+    CHECK(!httpd_uri_match_wildcard("/a", "/ab", 3), "/a vs /ab");
+
+    char val[8];
+    CHECK(httpd_query_key_value("a=1&bb=22&b=3", "b", val, sizeof(val)) == ESP_OK && strcmp(val, "3") == 0,
+          "query key b: '%s'", val);
+    CHECK(httpd_query_key_value("a=1", "b", val, sizeof(val)) == ESP_ERR_NOT_FOUND, "absent query key");
+    CHECK(httpd_query_key_value("a=123456789", "a", val, sizeof(val)) == ESP_ERR_HTTPD_RESULT_TRUNC,
+          "query value not truncated");
+}
+
+#ifdef WEB_BENCH_HAVE_CJSON
+static void check_parsers(httpd_handle_t server, mock_httpd_buf_t *out) {
+    long live = alloc_live;
+    web_wifi_credentials_t wifi;
+    CHECK(web_parse_wifi_credentials("{\"ssid\":\"lab\",\"password\":\"secret\"}", &wifi) == ESP_OK &&
+          strcmp(wifi.ssid, "lab") == 0 && strcmp(wifi.password, "secret") == 0, "wifi credentials");
+    CHECK(web_parse_wifi_credentials("{\"ssid\":\"lab\"}", &wifi) == ESP_ERR_INVALID_ARG, "missing password");
+    CHECK(web_parse_wifi_credentials("{\"ssid\":\"123456789012345678901234567890123\",\"password\":\"\"}", &wifi) ==
+          ESP_ERR_INVALID_SIZE, "33-byte SSID accepted");
+    CHECK(web_parse_wifi_credentials("ssid=lab", &wifi) == ESP_ERR_INVALID_ARG, "form body accepted");
+
+    web_trigger_request_t trigger;
+    CHECK(web_parse_trigger("{\"target_m\":1.5}", &trigger) == ESP_OK && trigger.channel == 0 &&
+          trigger.target_m == 1.5 && trigger.output_pin == -1 && trigger.output_level == 1, "trigger defaults");
+    CHECK(web_parse_trigger("{\"channel\":1,\"disarm\":true}", &trigger) == ESP_OK && trigger.disarm &&
+          trigger.channel == 1, "disarm");
+    CHECK(web_parse_trigger("{\"channel\":1}", &trigger) == ESP_ERR_NOT_FOUND, "missing target_m");
+
+    settings_httpd_t tuning = { .max_open_sockets = 7, .backlog_conn = 5, .core = 0 };
+    CHECK(web_parse_httpd_tuning("{\"max_open_sockets\":10,\"lru_purge\":true,\"core\":9000}", &tuning) == ESP_OK &&
+          tuning.max_open_sockets == 10 && tuning.backlog_conn == 5 && tuning.lru_purge && tuning.core == -1,
+          "tuning partial update");
+    CHECK(web_parse_httpd_tuning("{\"backlog_conn\":-4,\"recv_timeout_s\":1e9}", &tuning) == ESP_OK &&
+          tuning.backlog_conn == 0 && tuning.recv_timeout_s == UINT16_MAX, "tuning saturation");
+    CHECK(web_parse_httpd_tuning("[", &tuning) == ESP_ERR_INVALID_ARG, "tuning not JSON");
+
+    int channel = -1;
+    CHECK(web_parse_settings_channel("{\"diameter\":50}", &channel) == ESP_OK && channel == 0, "settings channel default");
+    CHECK(web_parse_settings_channel("{\"channel\":3}", &channel) == ESP_OK && channel == 3, "settings channel");
+    web_settings_t settings = { .diameter = 100, .factor = 1, .pin_z = -1, .count_mode = ENCODER_COUNT_X4,
+                                .filter = { .type = ENCODER_FILTER_EMA, .window = 8 } };
+    CHECK(web_parse_settings("{\"factor\":1.02,\"filter\":{\"type\":\"kalman\"},\"noise\":{\"glitch_ns\":-5,"
+                             "\"max_speed\":3},\"counting\":{\"pin_z\":15,\"mode\":2,\"invert\":true}}",
+                             &settings) == ESP_OK &&
+          settings.diameter == 100 && settings.factor == 1.02f && settings.has_filter &&
+          settings.filter.type == ENCODER_FILTER_KALMAN && settings.filter.window == 8 && settings.has_noise &&
+          settings.glitch_filter_ns == 0 && settings.plausibility.max_speed_mps == 3 && settings.has_counting &&
+          settings.pin_z == 15 && settings.count_mode == ENCODER_COUNT_X2 && settings.invert, "settings partial update");
+    CHECK(web_parse_settings("{\"noise\":{\"glitch_ns\":1e12}}", &settings) == ESP_OK && !settings.has_filter &&
+          settings.glitch_filter_ns == UINT32_MAX, "settings glitch_ns saturation");
+    CHECK(web_parse_settings("{\"filter\":{\"type\":\"median\"}}", &settings) == ESP_ERR_NOT_SUPPORTED,
+          "unknown filter type accepted");
+    CHECK(web_parse_settings("diameter=50", &settings) == ESP_ERR_INVALID_ARG, "settings not JSON");
+
+    float factor = 0;
+    CHECK(web_parse_calibration("value=1.015", &factor) == ESP_OK && factor == 1.015f, "calibration value");
+    CHECK(web_parse_calibration("x=1&value=2", &factor) == ESP_OK && factor == 2.0f, "calibration second field");
+    CHECK(web_parse_calibration("factor=1.5", &factor) == ESP_ERR_NOT_FOUND, "calibration without value");
+    CHECK(web_parse_calibration("value=-1", &factor) == ESP_ERR_INVALID_ARG &&
+          web_parse_calibration("value=nan", &factor) == ESP_ERR_INVALID_ARG &&
+          web_parse_calibration("value=inf", &factor) == ESP_ERR_INVALID_ARG, "calibration out of range accepted");
+    CHECK(alloc_live == live, "%ld allocations leaked by the parsers", alloc_live - live);
+
+    int status = handle(server, "POST /api/trigger HTTP/1.1\r\nContent-Length: 29\r\n\r\n"
+                                "{\"channel\":1,\"target_m\":2.25}", out, NULL);
+    const char *body = resp_body(out);
+    CHECK(status == 200 && body && strstr(body, "\"target_m\":2.250"), "trigger through the mock: %d", status);
+    status = handle(server, "POST /api/trigger HTTP/1.1\r\nContent-Length: 4\r\n\r\nnope", out, NULL);
+    CHECK(status == 400, "bad trigger body: %d", status);
+}
+#endif
+
+// ---------------------------------------------------------------------------
+// Fuzzing
+// ---------------------------------------------------------------------------
+
+static uint32_t rng_state = 0x2545F491u;
+
+static uint32_t rng(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+// Applies a few byte-level mutations in place; returns the new length
+static size_t mutate(char *buf, size_t len, size_t cap) {
+    static const char tokens[][32] = {
+        "\r\n", "\r\n\r\n", ":", "?", "*", "%", "\"", "{", "}", "[", "\\u0000", "Content-Length: 9999\r\n",
+        "Transfer-Encoding: chunked\r\n", "If-None-Match: ", "1e308", "-1", "null", "true",
+    };
+    int rounds = 1 + rng() % 4;
+    for (int r = 0; r < rounds; r++) {
+        size_t at = len ? rng() % len : 0;
+        switch (rng() % 5) {
+            case 0:             // flip a byte
+                if (len) buf[at] = (char)rng();
+                break;
+            case 1:             // truncate
+                len = at;
+                break;
+            case 2:             // delete a span
+                if (len) {
+                    size_t n = 1 + rng() % (len - at);
+                    memmove(buf + at, buf + at + n, len - at - n);
+                    len -= n;
+                }
+                break;
+            default: {          // insert a token
+                const char *token = tokens[rng() % (sizeof(tokens) / sizeof(tokens[0]))];
+                size_t n = strlen(token);
+                if (len + n < cap) {
+                    memmove(buf + at + n, buf + at, len - at);
+                    memcpy(buf + at, token, n);
+                    len += n;
+                }
+                break;
+            }
+        }
+    }
+    buf[len] = 0;
+    return len;
+}
+
+static void fuzz_requests(httpd_handle_t server, mock_httpd_buf_t *out, long count) {
+    static const char *seeds[] = {
+        "GET /index.html HTTP/1.1\r\nHost: esp\r\nAccept-Encoding: gzip\r\n\r\n",
+        "GET /index.html?v=1&x=2 HTTP/1.1\r\nIf-None-Match: \"0123456789abcdef\"\r\n\r\n",
+        "GET / HTTP/1.0\r\nConnection: keep-alive\r\n\r\n",
+        "POST /api/trigger HTTP/1.1\r\nContent-Length: 29\r\n\r\n{\"channel\":1,\"target_m\":2.25}",
+    };
+    char buf[1024];
+    long malformed = 0;
+    for (long i = 0; i < count; i++) {
+        const char *seed = seeds[rng() % (sizeof(seeds) / sizeof(seeds[0]))];
+        size_t len = strlen(seed);
+        memcpy(buf, seed, len);
+        len = mutate(buf, len, sizeof(buf) - 1);
+
+        // Handle whatever the framing accepts, as the socket loop would
+        size_t size = mock_httpd_request_size(buf, len);
+        if (size == 0 || size == SIZE_MAX) {
+            size = len;
+        }
+        bool keep = false;
+        out->len = 0;
+        mock_httpd_handle(server, buf, size, out, &keep);
+        if (out->len == 0) {
+            continue;   // handler failed before responding; IDF closes the connection
+        }
+        int status = out->len > 12 ? atoi(out->data + 9) : 0;
+        CHECK(strncmp(out->data, "HTTP/1.1 ", 9) == 0 && status >= 200 && status < 600,
+              "fuzz %ld: malformed status line", i);
+        const char *body = resp_body(out);
+        char value[32];
+        if (body && resp_header(out, "Content-Length", value, sizeof(value))) {
+            CHECK(strtoul(value, NULL, 10) == (size_t)(out->data + out->len - body), "fuzz %ld: Content-Length %s", i,
+                  value);
+        }
+        malformed += status >= 400;
+    }
+    printf("  requests: %ld mutated, %ld answered with an error\n", count, malformed);
+}
+
+#ifdef WEB_BENCH_HAVE_CJSON
+static void fuzz_parsers(long count) {
+    static const char *seeds[] = {
+        "{\"ssid\":\"lab\",\"password\":\"secret\"}",
+        "{\"channel\":1,\"target_m\":2.25,\"output_pin\":4,\"output_level\":0}",
+        "{\"disarm\":true}",
+        "{\"max_open_sockets\":10,\"lru_purge\":true,\"core\":1,\"stack_size\":8192}",
+        "{\"channel\":1,\"diameter\":63.5,\"factor\":1.02,\"filter\":{\"type\":\"alpha_beta\",\"window\":8,"
+        "\"alpha\":0.5,\"beta\":0.1}}",
+        "{\"noise\":{\"glitch_ns\":1000,\"max_speed\":5,\"max_accel\":50},"
+        "\"counting\":{\"pin_a\":13,\"pin_b\":14,\"pin_z\":-1,\"ppr\":2400,\"mode\":4,\"invert\":false}}",
+        "value=1.015",
+    };
+    char buf[256];
+    long live = alloc_live;
+    for (long i = 0; i < count; i++) {
+        const char *seed = seeds[rng() % (sizeof(seeds) / sizeof(seeds[0]))];
+        size_t len = strlen(seed);
+        memcpy(buf, seed, len);
+        mutate(buf, len, sizeof(buf) - 1);
+
+        web_wifi_credentials_t wifi;
+        if (web_parse_wifi_credentials(buf, &wifi) == ESP_OK) {
+            CHECK(strlen(wifi.ssid) < sizeof(wifi.ssid) && strlen(wifi.password) < sizeof(wifi.password),
+                  "fuzz %ld: unterminated credentials", i);
+        }
+        web_trigger_request_t trigger;
+        if (web_parse_trigger(buf, &trigger) == ESP_OK) {
+            CHECK(trigger.output_level == 0 || trigger.output_level == 1, "fuzz %ld: output_level %d", i,
+                  trigger.output_level);
+        }
+        settings_httpd_t tuning = {0};
+        web_parse_httpd_tuning(buf, &tuning);
+        int channel;
+        web_parse_settings_channel(buf, &channel);
+        web_settings_t settings = {0};
+        web_parse_settings(buf, &settings);
+        float factor;
+        if (web_parse_calibration(buf, &factor) == ESP_OK) {
+            CHECK(factor > 0 && isfinite(factor), "fuzz %ld: calibration %f", i, (double)factor);
+        }
+        CHECK(alloc_live == live, "fuzz %ld: %ld allocations leaked on '%s'", i, alloc_live - live, buf);
+        live = alloc_live;
+    }
+    printf("  parsers: %ld mutated bodies\n", count);
+}
+#endif
+
+// ---------------------------------------------------------------------------
+// Benchmarks
+// ---------------------------------------------------------------------------
+
+static void bench_request(httpd_handle_t server, mock_httpd_buf_t *out, const char *name, const char *request,
+                          long iterations) {
+    size_t len = strlen(request);
+    bool keep = false;
+    // Warm-up: grows the response buffer once, as a long-lived connection would
+    for (int i = 0; i < 100; i++) {
+        out->len = 0;
+        mock_httpd_handle(server, request, len, out, &keep);
+    }
+    size_t calls = alloc_calls, bytes = alloc_bytes;
+    int64_t t0 = mono_ns();
+    for (long i = 0; i < iterations; i++) {
+        out->len = 0;
+        mock_httpd_handle(server, request, len, out, &keep);
+    }
+    int64_t dt = mono_ns() - t0;
+    printf("  %-28s %8.1f ns/req  %5.2f allocs/req  %7.1f B alloc/req  %6zu B out (%.3s)\n", name,
+           (double)dt / iterations, (double)(alloc_calls - calls) / iterations,
+           (double)(alloc_bytes - bytes) / iterations, out->len, out->len > 12 ? out->data + 9 : "---");
+}
+
+#ifdef WEB_BENCH_HAVE_CJSON
+typedef esp_err_t (*parse_fn_t)(const char *body, void *out);
+
+static void bench_parser(const char *name, parse_fn_t parse, const char *body, void *out, long iterations) {
+    size_t calls = alloc_calls, bytes = alloc_bytes;
+    int64_t t0 = mono_ns();
+    for (long i = 0; i < iterations; i++) {
+        parse(body, out);
+    }
+    int64_t dt = mono_ns() - t0;
+    printf("  %-28s %8.1f ns/call %5.2f allocs/call %6.1f B alloc/call\n", name, (double)dt / iterations,
+           (double)(alloc_calls - calls) / iterations, (double)(alloc_bytes - bytes) / iterations);
+}
+#endif
+
+static void run_benches(httpd_handle_t server, mock_httpd_buf_t *out, long iterations) {
+    const web_asset_t *index = web_assets_find("/index.html");
+    char conditional[256];
+    snprintf(conditional, sizeof(conditional), "GET /index.html HTTP/1.1\r\nIf-None-Match: %s\r\n\r\n",
+             index ? index->etag : "\"\"");
+
+    bench_request(server, out, "GET /index.html (200)",
+                  "GET /index.html HTTP/1.1\r\nHost: esp\r\nAccept-Encoding: gzip, deflate\r\n"
+                  "User-Agent: web_bench\r\nAccept: */*\r\n\r\n", iterations);
+    bench_request(server, out, "GET /index.html (304)", conditional, iterations);
+    bench_request(server, out, "GET / (302)", "GET / HTTP/1.1\r\n\r\n", iterations);
+    bench_request(server, out, "GET /missing (404)", "GET /missing HTTP/1.1\r\n\r\n", iterations);
+#ifdef WEB_BENCH_HAVE_CJSON
+    bench_request(server, out, "POST /api/trigger",
+                  "POST /api/trigger HTTP/1.1\r\nContent-Type: application/json\r\nContent-Length: 29\r\n\r\n"
+                  "{\"channel\":1,\"target_m\":2.25}", iterations);
+
+    web_wifi_credentials_t wifi;
+    web_trigger_request_t trigger;
+    settings_httpd_t tuning = {0};
+    bench_parser("web_parse_wifi_credentials", (parse_fn_t)web_parse_wifi_credentials,
+                 "{\"ssid\":\"workshop-lab\",\"password\":\"correct horse battery\"}", &wifi, iterations);
+    bench_parser("web_parse_trigger", (parse_fn_t)web_parse_trigger,
+                 "{\"channel\":1,\"target_m\":2.25,\"output_pin\":4,\"output_level\":0}", &trigger, iterations);
+    bench_parser("web_parse_httpd_tuning", (parse_fn_t)web_parse_httpd_tuning,
+                 "{\"max_open_sockets\":10,\"backlog_conn\":5,\"lru_purge\":true,\"keep_alive\":true,"
+                 "\"keep_alive_idle_s\":5,\"recv_timeout_s\":5,\"send_timeout_s\":5,\"stack_size\":6144,\"core\":0}",
+                 &tuning, iterations);
+    web_settings_t settings = {0};
+    float factor;
+    bench_parser("web_parse_settings", (parse_fn_t)web_parse_settings,
+                 "{\"channel\":1,\"diameter\":63.5,\"factor\":1.02,\"filter\":{\"type\":\"kalman\","
+                 "\"process_noise\":0.5,\"measurement_noise\":0.01},\"noise\":{\"glitch_ns\":1000},"
+                 "\"counting\":{\"pin_a\":13,\"pin_b\":14,\"ppr\":2400,\"mode\":4}}", &settings, iterations);
+    bench_parser("web_parse_calibration", (parse_fn_t)web_parse_calibration, "value=1.015", &factor, iterations);
+#endif
+}
+
+// ---------------------------------------------------------------------------
+
+static volatile sig_atomic_t stop_serving = 0;
+
+static void on_signal(int sig) {
+    (void)sig;
+    stop_serving = 1;
+}
+
+int main(int argc, char **argv) {
+    int quick = 0;
+    int parsers_only = 0;
+    long fuzz = -1;
+    int port = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            quick = 1;
+        } else if (strcmp(argv[i], "--parsers") == 0) {
+            parsers_only = 1;
+        } else if (strcmp(argv[i], "--fuzz") == 0 && i + 1 < argc) {
+            fuzz = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--quick] [--parsers] [--fuzz N] [--serve PORT]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (port > 0) {
+        httpd_handle_t server = start_server((uint16_t)port);
+        if (!server) return EXIT_FAILURE;
+        signal(SIGINT, on_signal);
+        signal(SIGTERM, on_signal);
+        printf("Serving on http://127.0.0.1:%d/ (Ctrl-C to stop)\n", port);
+        esp_err_t err = mock_httpd_serve(server, &stop_serving);
+        httpd_stop(server);
+        return err == ESP_OK ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    long iterations = quick ? 20000 : 1000000;
+    if (fuzz < 0) fuzz = quick ? 20000 : 1000000;
+#ifndef WEB_BENCH_HAVE_CJSON
+    if (parsers_only) {
+        printf("Body parsers skipped: built without cJSON\n");
+        return WEB_BENCH_SKIPPED;
+    }
+#endif
+
+    httpd_handle_t server = start_server(80);
+    mock_httpd_buf_t out = {0};
+    if (!server) return EXIT_FAILURE;
+
+    printf("Web layer checks\n");
+    if (!parsers_only) {
+        check_static(server, &out);
+        check_protocol(server, &out);
+    }
+#ifdef WEB_BENCH_HAVE_CJSON
+    check_parsers(server, &out);
+#else
+    printf("  (body parsers skipped: built without cJSON)\n");
+#endif
+    printf("Fuzzing\n");
+    if (!parsers_only) {
+        fuzz_requests(server, &out, fuzz);
+    }
+#ifdef WEB_BENCH_HAVE_CJSON
+    fuzz_parsers(fuzz);
+#endif
+    printf("  %s (%d failure%s)\n", failures ? "FAILED" : "ok", failures, failures == 1 ? "" : "s");
+
+    if (!parsers_only) {
+        printf("Benchmarks (%ld iterations)\n", iterations);
+        run_benches(server, &out, iterations);
+    }
+
+    mock_httpd_buf_free(&out);
+    httpd_stop(server);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -2,15 +2,22 @@
  * @brief Main application entry point.
  *
  * Initializes NVS flash, SPIFFS filesystem,
- * display, encoder settings (wheel diameter, calibration factor),
+ * display, encoder channels on the measurement core with their settings
+ * (wheel diameter, calibration factor),
+ * restores the odometer from its last checkpoint,
  * button on GPIO12,
  * starts Wi-Fi connection task,
- * and runs the main loop to update the display and handle button presses.
+ * and starts the display task that updates the display, reacts to encoder
+ * events and handles button presses. Task placement comes from task_layout.h.
  */
 
+#include <stdlib.h>
+
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "nvs_flash.h"
 #include "driver/gpio.h"
 #include "button.h"
@@ -21,9 +28,90 @@
 #include "encoder.h"
 #include "display.h"
 #include "settings.h"
+#include "odometer.h"
+#include "task_layout.h"
+#include "metrics.h"
 
 #define TAG_MAIN "MAIN"
 #define BUTTON_GPIO 12
+#define ENCODER_PPR 600
+#define DISPLAY_PERIOD_MS 1000
+
+// Encoder channels {A, B, Z}; Z is GPIO_NUM_NC without an index pulse. The first channel is shown on the display
+static const gpio_num_t encoder_pins[][3] = {
+    { GPIO_NUM_13, GPIO_NUM_14, GPIO_NUM_NC },
+};
+
+/**
+ * @brief Refreshes the display every second or on an encoder event, and handles the button.
+ */
+static void display_task(void *arg) {
+    QueueHandle_t encoder_events = (QueueHandle_t)arg;
+    while (1) {
+        display_show_status(encoder_get_speed_mps(), encoder_get_distance_m());
+
+        if (button_pressed_flag()) {
+            encoder_reset();
+            odometer_save_now();
+            ESP_LOGI(TAG_MAIN, "Button pressed — encoder reset");
+        }
+
+        // Refresh every second, or as soon as an encoder event arrives
+        encoder_event_t event;
+        METRICS_START(wait_start);
+        if (xQueueReceive(encoder_events, &event, pdMS_TO_TICKS(DISPLAY_PERIOD_MS)) == pdTRUE) {
+            ESP_LOGI(TAG_MAIN, "Encoder %d: %s at %.3f m, %.2f m/s", event.channel,
+                     encoder_event_name(event.type), event.distance_um / 1e6, event.speed_mps);
+        } else {
+            METRICS_RECORD(METRIC_DISPLAY_JITTER,
+                           (uint32_t)llabs(esp_timer_get_time() - wait_start - DISPLAY_PERIOD_MS * 1000LL));
+        }
+    }
+}
+
+/**
+ * @brief Creates the encoder channels, then wakes app_main and exits.
+ *
+ * Runs pinned to TASK_SAMPLER_CORE: the PCNT unit interrupts and the GPIO ISR
+ * service (edge and index pulses) are allocated on the core that installs
+ * them, so this keeps them next to the sampler instead of on core 0.
+ */
+static void encoder_setup_task(void *arg) {
+    // Encoder channels with their stored wheel diameter, calibration factor and speed filter
+    for (int i = 0; i < (int)(sizeof(encoder_pins) / sizeof(encoder_pins[0])); i++) {
+        float diameter = 100.0f;    // in millimeters
+        float factor = 1.0f;
+        if (settings_load_channel(i, &diameter, &factor) == ESP_OK) {
+            ESP_LOGI(TAG_MAIN, "Encoder %d settings: diameter=%.2f, factor=%.3f", i, diameter, factor);
+        } else {
+            ESP_LOGW(TAG_MAIN, "Encoder %d: using default settings", i);
+        }
+
+        encoder_config_t config = ENCODER_CONFIG_DEFAULT(encoder_pins[i][0], encoder_pins[i][1]);
+        config.counting.pin_z = encoder_pins[i][2];
+        config.counting.pulses_per_rev = ENCODER_PPR;
+        config.wheel_diameter_mm = diameter;
+        config.calibration_factor = factor;
+        encoder_counting_t board_counting = config.counting;
+        settings_load_counting(i, &config.counting);   // pins, PPR, x1/x2/x4, direction
+        settings_load_noise(i, &config.noise);         // glitch filter and plausibility limits
+
+        encoder_handle_t enc;
+        if (encoder_channel_new(&config, &enc) != ESP_OK) {
+            // Stored pins may not suit this board: fall back to the pin table
+            ESP_LOGW(TAG_MAIN, "Encoder %d: stored counting setup rejected, using board defaults", i);
+            config.counting = board_counting;
+            ESP_ERROR_CHECK(encoder_channel_new(&config, &enc));
+        }
+
+        // Speed filter (none by default)
+        encoder_filter_config_t filter;
+        settings_load_filter(i, &filter);
+        encoder_channel_set_speed_filter(enc, &filter);
+    }
+    xTaskNotifyGive((TaskHandle_t)arg);
+    vTaskDelete(NULL);
+}
 
 void app_main(void) {
     // Get and log the reason for the last reset
@@ -48,34 +136,38 @@ void app_main(void) {
         ESP_LOGE(TAG_MAIN, "Display init failed");
     }
 
-    // Load encoder settings: wheel diameter and calibration factor
-    float diameter = 100.0f;    // in millimeters
-    float factor = 1.0f;
-    if (settings_load(&diameter, &factor)) {
-        ESP_LOGI(TAG_MAIN, "Loaded settings: diameter=%.2f, factor=%.3f", diameter, factor);
-    } else {
-        ESP_LOGW(TAG_MAIN, "Using default settings");
-    }
+    // Interrupts land on the core that installs them: create the channels on the measurement core
+    xTaskCreatePinnedToCore(encoder_setup_task, "encoder_setup", TASK_SAMPLER_STACK, xTaskGetCurrentTaskHandle(),
+                            TASK_SAMPLER_PRIORITY, NULL, TASK_SAMPLER_CORE);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    // Continue counting from the last checkpoint and keep checkpointing
+    odometer_restore();
+    odometer_config_t odometer = ODOMETER_CONFIG_DEFAULT();
+    odometer.core = TASK_ODOMETER_CORE;
+    odometer.priority = TASK_ODOMETER_PRIORITY;
+    odometer.stack_size = TASK_ODOMETER_STACK;
+    ESP_ERROR_CHECK(odometer_start(&odometer));
 
-    // Initialize encoder with given parameters
-    encoder_init(GPIO_NUM_13, GPIO_NUM_14, 600, diameter);
-    encoder_set_calibration_factor(factor);
-    encoder_start_speed_task();
+    // Speed samples of all channels at 100 Hz, on the measurement core
+    encoder_sampler_config_t sampler = ENCODER_SAMPLER_CONFIG_DEFAULT(100);
+    sampler.core = TASK_SAMPLER_CORE;
+    sampler.priority = TASK_SAMPLER_PRIORITY;
+    sampler.stack_size = TASK_SAMPLER_STACK;
+    ESP_ERROR_CHECK(encoder_start_sampler(&sampler));
+
+    // Encoder events wake the display task instead of waiting for the next refresh
+    QueueHandle_t encoder_events = xQueueCreate(16, sizeof(encoder_event_t));
+    ESP_ERROR_CHECK(encoder_event_subscribe_queue(NULL, ENCODER_EVENT_ALL, encoder_events));
 
     // Initialize hardware button
     button_init(BUTTON_GPIO);
 
-    // Start Wi-Fi connection task pinned to core 1
-    xTaskCreatePinnedToCore(wifi_connect_task, "wifi_connect_task", 4096, NULL, 5, NULL, 1);
+    // Start Wi-Fi connection task next to the Wi-Fi driver
+    xTaskCreatePinnedToCore(wifi_connect_task, "wifi_connect_task", TASK_WIFI_STACK, NULL, TASK_WIFI_PRIORITY, NULL,
+                            TASK_WIFI_CORE);
 
-    // Main loop to display status and handle button presses
-    while (1) {
-        display_show_status(encoder_get_speed_mps(), encoder_get_distance_m());
-
-        if (button_pressed_flag()) {
-            encoder_reset();
-            ESP_LOGI(TAG_MAIN, "Button pressed — encoder reset");
-        }
-        vTaskDelay(pdMS_TO_TICKS(1000));    // Delay 1 second
-    }
-}
\ No newline at end of file
+    // The display loop replaces the main task, which is fixed to core 0 by sdkconfig
+    xTaskCreatePinnedToCore(display_task, "display", TASK_DISPLAY_STACK, encoder_events, TASK_DISPLAY_PRIORITY, NULL,
+                            TASK_DISPLAY_CORE);
+}
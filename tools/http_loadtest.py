@@ -0,0 +1,177 @@
+#!/usr/bin/env python3
+"""HTTP load test for the encoder web server.
+
+Opens N concurrent clients against one path (default /data) for a fixed
+time and reports requests/s and latency percentiles. Works against a
+device or any other server speaking HTTP/1.1:
+
+    tools/http_loadtest.py http://192.168.4.1 -c 4 -d 20
+    tools/http_loadtest.py http://192.168.4.1 --path /api/samples -c 2 --no-keepalive
+    tools/http_loadtest.py http://192.168.4.1 -c 8 --streams 3
+
+Standard library only. Each client is a thread with its own connection,
+which is reused unless --no-keepalive is given. A failed request is
+counted, and the client reconnects.
+
+--streams N opens N Server-Sent Event streams (/events) before the load
+starts and keeps reading them. A stream the server closes during the run,
+e.g. by purging it to make room for a request, fails the test.
+"""
+import argparse
+import http.client
+import sys
+import threading
+import time
+import urllib.parse
+
+
+def percentile(sorted_values, p):
+    if not sorted_values:
+        return 0.0
+    k = min(len(sorted_values) - 1, max(0, int(round(p / 100.0 * (len(sorted_values) - 1)))))
+    return sorted_values[k]
+
+
+class Client(threading.Thread):
+    def __init__(self, host, port, path, keepalive, deadline, timeout):
+        super().__init__(daemon=True)
+        self.host, self.port, self.path = host, port, path
+        self.keepalive, self.deadline, self.timeout = keepalive, deadline, timeout
+        self.latencies = []
+        self.errors = 0
+        self.statuses = {}
+        self.bytes = 0
+
+    def run(self):
+        conn = None
+        headers = {} if self.keepalive else {"Connection": "close"}
+        while time.monotonic() < self.deadline:
+            if conn is None:
+                conn = http.client.HTTPConnection(self.host, self.port, timeout=self.timeout)
+            start = time.perf_counter()
+            try:
+                conn.request("GET", self.path, headers=headers)
+                resp = conn.getresponse()
+                body = resp.read()
+            except (OSError, http.client.HTTPException):
+                self.errors += 1
+                conn.close()
+                conn = None
+                continue
+            self.latencies.append(time.perf_counter() - start)
+            self.statuses[resp.status] = self.statuses.get(resp.status, 0) + 1
+            self.bytes += len(body)
+            if not self.keepalive or resp.will_close:
+                conn.close()
+                conn = None
+        if conn is not None:
+            conn.close()
+
+
+class Stream(threading.Thread):
+    """Holds one event stream open until the deadline and counts what arrives."""
+
+    # The server sends a keep-alive comment at least every 15 s on an idle stream
+    READ_TIMEOUT = 20.0
+
+    def __init__(self, host, port, path, deadline):
+        super().__init__(daemon=True)
+        self.host, self.port, self.path, self.deadline = host, port, path, deadline
+        self.opened = threading.Event()
+        self.status = None
+        self.messages = 0
+        self.closed_after = None    # seconds into the run when the server ended the stream
+
+    def run(self):
+        started = time.monotonic()
+        conn = http.client.HTTPConnection(self.host, self.port, timeout=self.READ_TIMEOUT)
+        try:
+            conn.request("GET", self.path, headers={"Accept": "text/event-stream"})
+            resp = conn.getresponse()
+            self.status = resp.status
+            self.opened.set()
+            if resp.status != 200:
+                return
+            while time.monotonic() < self.deadline:
+                line = resp.readline()
+                if not line:
+                    self.closed_after = time.monotonic() - started
+                    return
+                if line.startswith(b"data:") or line.startswith(b":"):
+                    self.messages += 1
+        except (OSError, http.client.HTTPException):
+            if time.monotonic() < self.deadline:
+                self.closed_after = time.monotonic() - started
+        finally:
+            self.opened.set()
+            conn.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="HTTP load test; reports requests/s and latency percentiles")
+    parser.add_argument("url", help="Server base URL, e.g. http://192.168.4.1")
+    parser.add_argument("--path", default="/data", help="Path to request (default /data)")
+    parser.add_argument("-c", "--clients", type=int, default=4, help="Concurrent clients (default 4)")
+    parser.add_argument("-d", "--duration", type=float, default=10.0, help="Seconds to run (default 10)")
+    parser.add_argument("--timeout", type=float, default=5.0, help="Per-request timeout in seconds")
+    parser.add_argument("--no-keepalive", action="store_true", help="Open a new connection per request")
+    parser.add_argument("--streams", type=int, default=0, help="Event streams held open during the run (default 0)")
+    parser.add_argument("--stream-path", default="/events?rate=5", help="Stream path (default /events?rate=5)")
+    args = parser.parse_args()
+
+    url = urllib.parse.urlsplit(args.url if "://" in args.url else "http://" + args.url)
+    host, port = url.hostname, url.port or 80
+    path = args.path if args.path.startswith("/") else "/" + args.path
+
+    # Streams first, so the load has to find room around them
+    streams = [Stream(host, port, args.stream_path, time.monotonic() + args.duration + 1.0)
+               for _ in range(args.streams)]
+    for s in streams:
+        s.start()
+        s.opened.wait(args.timeout)
+
+    deadline = time.monotonic() + args.duration
+    started = time.monotonic()
+    clients = [Client(host, port, path, not args.no_keepalive, deadline, args.timeout) for _ in range(args.clients)]
+    for c in clients:
+        c.start()
+    for c in clients:
+        c.join()
+    elapsed = time.monotonic() - started
+    for s in streams:
+        s.join()
+
+    latencies = sorted(l for c in clients for l in c.latencies)
+    errors = sum(c.errors for c in clients)
+    statuses = {}
+    for c in clients:
+        for code, n in c.statuses.items():
+            statuses[code] = statuses.get(code, 0) + n
+    total_bytes = sum(c.bytes for c in clients)
+
+    ms = lambda s: s * 1000.0
+    print("target      %s:%d%s, %d clients, %s" % (host, port, path, args.clients,
+                                                  "new connection per request" if args.no_keepalive else "keep-alive"))
+    print("requests    %d in %.1f s = %.1f req/s (%.1f KiB/s)" % (len(latencies), elapsed, len(latencies) / elapsed,
+                                                               total_bytes / 1024.0 / elapsed))
+    print("errors      %d" % errors)
+    print("status      %s" % ", ".join("%d: %d" % kv for kv in sorted(statuses.items())) if statuses else "status      none")
+    if latencies:
+        print("latency ms  min %.1f  p50 %.1f  p90 %.1f  p99 %.1f  max %.1f" % (
+            ms(latencies[0]), ms(percentile(latencies, 50)), ms(percentile(latencies, 90)),
+            ms(percentile(latencies, 99)), ms(latencies[-1])))
+    stream_failures = 0
+    for i, s in enumerate(streams):
+        if s.status != 200:
+            state = "not opened (status %s)" % s.status
+        elif s.closed_after is not None:
+            state = "closed by the server after %.1f s" % s.closed_after
+        else:
+            state = "open throughout"
+        stream_failures += state != "open throughout"
+        print("stream %-4d %s, %d messages" % (i, state, s.messages))
+    return 1 if errors or stream_failures or not latencies else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())